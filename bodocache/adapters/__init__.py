@@ -3,6 +3,7 @@ from .bwrt_adapter import BwRuntimeAdapter  # noqa: F401
 __all__ = [
     "file_backend",
     "segmented_file_backend",
+    "packed_segment_backend",
     "bwrt_adapter",
     "BwRuntimeAdapter",
 ]
@@ -0,0 +1,375 @@
+from __future__ import annotations
+
+import os
+import struct
+import sys
+import threading
+import zlib
+from array import array
+from pathlib import Path
+from typing import Any, Dict, List, Optional, Sequence, Tuple
+
+# On-disk layout of a packed segment (one file per model/version), little endian:
+#
+#   [header][presence bitmap][crc32 table][data]
+#
+# every region starting on an `align` boundary. Data is page-major: the slot of
+# (page p, layer l) is p * n_layers + l, at data_offset + slot * slot_bytes, where
+# slot_bytes is page_bytes rounded up to `align`. Pages [s, e] of all layers are thus
+# one sequential extent, and any slot is O_DIRECT-aligned. The bitmap holds one bit per
+# slot (written or not); the crc table (present when FLAG_CHECKSUMS is set) one
+# crc32 per slot.
+MAGIC = b"BCPSEG01"
+FORMAT_VERSION = 1
+FLAG_CHECKSUMS = 1
+_HEADER = struct.Struct("<8sIIIIIIQQQQ")  # magic, version, flags, n_layers, page_bytes, slot_bytes, align,
+#                                          max_pages, bitmap_offset, crc_offset, data_offset
+_HEADER_CRC = struct.Struct("<I")
+
+
+def _round_up(n: int, a: int) -> int:
+    return (n + a - 1) // a * a
+
+
+class _PackedSegment:
+    """An open packed segment: fd, decoded header and the in-memory index."""
+
+    def __init__(self, path: Path, create: Optional[Dict[str, int]] = None):
+        self.path = path
+        self.lock = threading.Lock()
+        if create is not None and not path.exists():
+            path.parent.mkdir(parents=True, exist_ok=True)
+            self.fd = os.open(str(path), os.O_RDWR | os.O_CREAT, 0o644)
+            self._init(**create)
+        else:
+            self.fd = os.open(str(path), os.O_RDWR)
+            self._load()
+
+    def _init(self, n_layers: int, max_pages: int, page_bytes: int, align: int, checksums: bool) -> None:
+        if n_layers <= 0 or max_pages <= 0 or page_bytes <= 0:
+            raise ValueError("n_layers, max_pages and page_bytes must be positive")
+        if align <= 0 or align & (align - 1):
+            raise ValueError("align must be a power of two")
+        self.n_layers = n_layers
+        self.max_pages = max_pages
+        self.page_bytes = page_bytes
+        self.align = align
+        self.flags = FLAG_CHECKSUMS if checksums else 0
+        self.slot_bytes = _round_up(page_bytes, align)
+        slots = n_layers * max_pages
+        self.bitmap_offset = _round_up(_HEADER.size + _HEADER_CRC.size, align)
+        self.crc_offset = _round_up(self.bitmap_offset + (slots + 7) // 8, align)
+        self.data_offset = _round_up(self.crc_offset + (4 * slots if checksums else 0), align)
+        head = _HEADER.pack(
+            MAGIC, FORMAT_VERSION, self.flags, n_layers, page_bytes, self.slot_bytes, align,
+            max_pages, self.bitmap_offset, self.crc_offset, self.data_offset,
+        )
+        os.pwrite(self.fd, head + _HEADER_CRC.pack(zlib.crc32(head)), 0)
+        # Sparse until written; the index regions read back as zeros
+        os.ftruncate(self.fd, self.data_offset)
+        self.present = bytearray((slots + 7) // 8)
+        self.crcs = array("I", bytes(4 * slots)) if checksums else None
+
+    def _load(self) -> None:
+        raw = os.pread(self.fd, _HEADER.size + _HEADER_CRC.size, 0)
+        if len(raw) < _HEADER.size + _HEADER_CRC.size:
+            raise IOError(f"{self.path}: truncated packed segment header")
+        head = raw[:_HEADER.size]
+        (magic, version, self.flags, self.n_layers, self.page_bytes, self.slot_bytes, self.align,
+         self.max_pages, self.bitmap_offset, self.crc_offset, self.data_offset) = _HEADER.unpack(head)
+        if magic != MAGIC:
+            raise IOError(f"{self.path}: not a packed segment")
+        if version != FORMAT_VERSION:
+            raise IOError(f"{self.path}: unsupported packed segment version {version}")
+        if _HEADER_CRC.unpack(raw[_HEADER.size:])[0] != zlib.crc32(head):
+            raise IOError(f"{self.path}: header checksum mismatch")
+        slots = self.n_layers * self.max_pages
+        self.present = bytearray(os.pread(self.fd, (slots + 7) // 8, self.bitmap_offset).ljust((slots + 7) // 8, b"\0"))
+        if self.flags & FLAG_CHECKSUMS:
+            self.crcs = array("I", os.pread(self.fd, 4 * slots, self.crc_offset).ljust(4 * slots, b"\0"))
+            if sys.byteorder != "little":
+                self.crcs.byteswap()
+        else:
+            self.crcs = None
+
+    def slot(self, layer: int, page_id: int) -> int:
+        if not 0 <= layer < self.n_layers:
+            raise IndexError(f"layer {layer} out of range [0, {self.n_layers})")
+        if not 0 <= page_id < self.max_pages:
+            raise IndexError(f"page_id {page_id} out of range [0, {self.max_pages})")
+        return page_id * self.n_layers + layer
+
+    def slot_offset(self, slot: int) -> int:
+        return self.data_offset + slot * self.slot_bytes
+
+    def is_present(self, slot: int) -> bool:
+        return bool(self.present[slot >> 3] & (1 << (slot & 7)))
+
+    def write(self, layer: int, page_id: int, data: bytes) -> None:
+        s = self.slot(layer, page_id)
+        buf = bytes(data).ljust(self.slot_bytes, b"\0")
+        os.pwrite(self.fd, buf, self.slot_offset(s))
+        with self.lock:
+            if self.crcs is not None:
+                self.crcs[s] = zlib.crc32(data)
+                os.pwrite(self.fd, struct.pack("<I", self.crcs[s]), self.crc_offset + 4 * s)
+            self.present[s >> 3] |= 1 << (s & 7)
+            os.pwrite(self.fd, bytes(self.present[s >> 3:(s >> 3) + 1]), self.bitmap_offset + (s >> 3))
+
+    def check(self, slot: int, data) -> None:
+        if not self.is_present(slot):
+            page, layer = divmod(slot, self.n_layers)
+            raise IOError(f"{self.path}: page {page} of layer {layer} was never written")
+        if self.crcs is not None and zlib.crc32(data) != self.crcs[slot]:
+            page, layer = divmod(slot, self.n_layers)
+            raise IOError(f"{self.path}: checksum mismatch at page {page} layer {layer}")
+
+    def close(self) -> None:
+        os.close(self.fd)
+
+
+class PackedSegmentBackend:
+    """
+    Packed multi-layer segment backend: one page-major file per (model_id, model_version)
+    with a small header, a written-page bitmap and optional per-page crc32s.
+
+    A (layer, page range) read is one I/O per page, but pages [s, e] of layers
+    [layer, layer_end] are one sequential extent (read_block); with a plan from
+    run_window(merge_layers=True) a prefix spanning every layer is one large read.
+    Slots are padded to `align` so native O_DIRECT/GDS readers can use extent() offsets
+    directly. New segments take n_layers/max_pages/page_bytes/align/checksums from the
+    constructor; existing ones keep the parameters in their header.
+    """
+
+    def __init__(
+        self,
+        root: str,
+        n_layers: int,
+        max_pages: int,
+        page_bytes: int = 256 * 1024,
+        align: int = 4096,
+        checksums: bool = True,
+        verify_reads: bool = True,
+    ):
+        self.root = Path(root)
+        self.root.mkdir(parents=True, exist_ok=True)
+        self._create = {
+            "n_layers": int(n_layers),
+            "max_pages": int(max_pages),
+            "page_bytes": int(page_bytes),
+            "align": int(align),
+            "checksums": bool(checksums),
+        }
+        # Check presence bits and crc32s on every read (checksums need checksums=True at create)
+        self.verify_reads = verify_reads
+        self._segments: Dict[Path, _PackedSegment] = {}
+        self._lock = threading.Lock()
+
+    def segment_path(self, model_id: str, model_version: str, layer: int) -> Path:
+        """Path of the packed file holding every layer (for native readers that open it directly);
+        pair it with extent() for offsets."""
+        return self.root / model_id / model_version / "segment.pseg"
+
+    def _segment(self, model_id: str, model_version: str) -> _PackedSegment:
+        p = self.segment_path(model_id, model_version, 0)
+        with self._lock:
+            seg = self._segments.get(p)
+            if seg is None:
+                seg = _PackedSegment(p, create=self._create)
+                self._segments[p] = seg
+            return seg
+
+    def ensure_segment(self, model_id: str, model_version: str, layer: int):
+        self._segment(model_id, model_version)
+
+    def index(self, model_id: str, model_version: str) -> Dict[str, Any]:
+        """Header fields of a segment plus the number of written pages."""
+        seg = self._segment(model_id, model_version)
+        written = sum(bin(b).count("1") for b in seg.present)
+        return {
+            "n_layers": seg.n_layers,
+            "max_pages": seg.max_pages,
+            "page_bytes": seg.page_bytes,
+            "slot_bytes": seg.slot_bytes,
+            "align": seg.align,
+            "checksums": seg.crcs is not None,
+            "data_offset": seg.data_offset,
+            "written_pages": written,
+        }
+
+    def _check_page_bytes(self, seg: _PackedSegment, page_bytes: int) -> None:
+        if page_bytes != seg.page_bytes:
+            raise ValueError(f"page_bytes {page_bytes} does not match the segment's {seg.page_bytes}")
+
+    def write_page(self, model_id: str, model_version: str, layer: int, page_id: int, page_bytes: int, data: bytes):
+        assert len(data) == page_bytes, "data length must equal page_bytes"
+        seg = self._segment(model_id, model_version)
+        self._check_page_bytes(seg, page_bytes)
+        seg.write(layer, page_id, data)
+
+    def extent(
+        self,
+        model_id: str,
+        model_version: str,
+        layer: int,
+        start_pid: int,
+        end_pid: int,
+        page_bytes: int,
+        layer_end: Optional[int] = None,
+    ) -> Optional[Tuple[Path, int, int]]:
+        """(path, offset, size) of pages [start_pid, end_pid] x layers [layer, layer_end] when
+        they form one contiguous extent of exactly those pages, else None.
+
+        Contiguous means a single page, or every layer of the segment.
+        """
+        seg = self._segment(model_id, model_version)
+        self._check_page_bytes(seg, page_bytes)
+        layer_end = layer if layer_end is None else layer_end
+        if end_pid < start_pid or layer_end < layer:
+            return None
+        if seg.slot_bytes != seg.page_bytes:
+            # Padding between slots would land in the destination
+            return None
+        if start_pid != end_pid and (layer != 0 or layer_end != seg.n_layers - 1):
+            return None
+        first = seg.slot(layer, start_pid)
+        last = seg.slot(layer_end, end_pid)
+        return seg.path, seg.slot_offset(first), (last - first + 1) * seg.slot_bytes
+
+    def read_block_into(
+        self,
+        model_id: str,
+        model_version: str,
+        layer: int,
+        layer_end: int,
+        start_pid: int,
+        end_pid: int,
+        page_bytes: int,
+        out_buf,
+    ) -> int:
+        """Read pages [start_pid, end_pid] of layers [layer, layer_end] with one sequential read.
+
+        out_buf receives them page-major, as on disk: page p of layer l lands at
+        ((p - start_pid) * (layer_end - layer + 1) + (l - layer)) * page_bytes. Layers
+        outside the span that sit between the requested rows are read and skipped.
+        Returns the number of bytes written.
+        """
+        if end_pid < start_pid or layer_end < layer:
+            return 0
+        seg = self._segment(model_id, model_version)
+        self._check_page_bytes(seg, page_bytes)
+        nl = layer_end - layer + 1
+        size = (end_pid - start_pid + 1) * nl * page_bytes
+        mv = memoryview(out_buf)
+        if mv.readonly:
+            raise ValueError("out_buf must be writable")
+        if mv.nbytes < size:
+            raise ValueError(f"out_buf too small: need {size}, have {mv.nbytes}")
+        out = mv.cast("B")
+        first = seg.slot(layer, start_pid)
+        last = seg.slot(layer_end, end_pid)
+        span = (last - first + 1) * seg.slot_bytes
+        tight = seg.slot_bytes == page_bytes and (nl == seg.n_layers or start_pid == end_pid)
+        raw = bytearray(span) if not tight else None
+        dst = out[:size] if tight else memoryview(raw)
+        got = os.preadv(seg.fd, [dst], seg.slot_offset(first))
+        if got != span:
+            raise IOError(f"short read: expected {span} bytes, got {got} (pages {start_pid}-{end_pid})")
+        k = 0
+        for p in range(start_pid, end_pid + 1):
+            for l in range(layer, layer_end + 1):
+                s = seg.slot(l, p)
+                off = (s - first) * seg.slot_bytes
+                page = dst[off:off + page_bytes]
+                if self.verify_reads:
+                    seg.check(s, page)
+                if not tight:
+                    out[k:k + page_bytes] = page
+                k += page_bytes
+        return size
+
+    def read_block(
+        self, model_id: str, model_version: str, layer: int, layer_end: int, start_pid: int, end_pid: int, page_bytes: int
+    ) -> bytes:
+        """read_block_into() into a fresh bytes object."""
+        buf = bytearray(max(0, end_pid - start_pid + 1) * max(0, layer_end - layer + 1) * page_bytes)
+        self.read_block_into(model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes, buf)
+        return bytes(buf)
+
+    def read_range_into(
+        self,
+        model_id: str,
+        model_version: str,
+        layer: int,
+        start_pid: int,
+        end_pid: int,
+        page_bytes: int,
+        out_buf,
+    ) -> int:
+        """Read pages [start_pid, end_pid] of one layer into out_buf (one read per page).
+
+        Raises IOError for pages that were never written or fail their checksum.
+        """
+        if end_pid < start_pid:
+            return 0
+        seg = self._segment(model_id, model_version)
+        self._check_page_bytes(seg, page_bytes)
+        size = (end_pid - start_pid + 1) * page_bytes
+        mv = memoryview(out_buf)
+        if mv.readonly:
+            raise ValueError("out_buf must be writable")
+        if mv.nbytes < size:
+            raise ValueError(f"out_buf too small: need {size}, have {mv.nbytes}")
+        out = mv.cast("B")
+        for i, p in enumerate(range(start_pid, end_pid + 1)):
+            s = seg.slot(layer, p)
+            view = out[i * page_bytes:(i + 1) * page_bytes]
+            got = os.preadv(seg.fd, [view], seg.slot_offset(s))
+            if got != page_bytes:
+                raise IOError(f"short read: expected {page_bytes} bytes, got {got} (layer={layer} page={p})")
+            if self.verify_reads:
+                seg.check(s, view)
+        return size
+
+    def read_range(self, model_id: str, model_version: str, layer: int, start_pid: int, end_pid: int, page_bytes: int) -> bytes:
+        """Read a consecutive page range [start_pid, end_pid] inclusive of one layer."""
+        buf = bytearray(max(0, end_pid - start_pid + 1) * page_bytes)
+        self.read_range_into(model_id, model_version, layer, start_pid, end_pid, page_bytes, buf)
+        return bytes(buf)
+
+    def read_batch(
+        self,
+        model_id: str,
+        model_version: str,
+        ranges: Sequence[Tuple[int, int, int, int]],
+        out_bufs: Sequence[Any],
+    ) -> List[int]:
+        """Read several (layer, start_pid, end_pid, page_bytes) ranges into out_bufs."""
+        if len(ranges) != len(out_bufs):
+            raise ValueError("ranges and out_bufs must have the same length")
+        return [
+            self.read_range_into(model_id, model_version, layer, start_pid, end_pid, page_bytes, buf)
+            for (layer, start_pid, end_pid, page_bytes), buf in zip(ranges, out_bufs)
+        ]
+
+    def verify(self, model_id: str, model_version: str) -> List[Tuple[int, int]]:
+        """(layer, page_id) of every written page whose crc32 no longer matches."""
+        seg = self._segment(model_id, model_version)
+        if seg.crcs is None:
+            return []
+        bad: List[Tuple[int, int]] = []
+        for s in range(seg.n_layers * seg.max_pages):
+            if not seg.is_present(s):
+                continue
+            data = os.pread(seg.fd, seg.page_bytes, seg.slot_offset(s))
+            if zlib.crc32(data) != seg.crcs[s]:
+                page, layer = divmod(s, seg.n_layers)
+                bad.append((layer, page))
+        return bad
+
+    def close(self) -> None:
+        with self._lock:
+            segs = list(self._segments.values())
+            self._segments.clear()
+        for seg in segs:
+            seg.close()
@@ -0,0 +1,140 @@
+from __future__ import annotations
+
+import numpy as np
+
+# Fixed-ratio KV page encodings; the layout and rounding match native/page_codec.hpp,
+# whose kernel decodes the same bytes on the device after the H2D copy.
+#
+# Pages hold 16-bit KV elements (float16 or bfloat16). Encoded data is a sequence of
+# groups of GROUP elements, each a float32 scale followed by the payload: GROUP e4m3
+# bytes ("fp8", scale = amax / 448) or GROUP / 2 bytes of 4-bit q + 8 with
+# q = rint(x / scale) in [-7, 7], low nibble first ("int4", scale = amax / 7).
+CODEC_IDS = {"none": 0, "fp8": 1, "int4": 2}
+CODEC_BF16 = 0x100
+GROUP = 128
+KV_DTYPES = ("float16", "bfloat16")
+
+_PAYLOAD = {"fp8": GROUP, "int4": GROUP // 2}
+_FP8_MAX = 448.0
+
+
+def _e4m3_table() -> np.ndarray:
+    codes = np.arange(256, dtype=np.uint32)
+    e = (codes >> 3) & 15
+    m = codes & 7
+    normal = ((e + 120) << 23) | (m << 20)
+    vals = np.where(e == 0, m.astype(np.float32) / np.float32(512.0), normal.astype(np.uint32).view(np.float32))
+    return np.where(codes & 0x80, -vals, vals).astype(np.float32)
+
+
+_E4M3 = _e4m3_table()
+# Non-negative finite e4m3 values in code order (0x00..0x7e), which is ascending
+_E4M3_POS = _E4M3[:127]
+
+
+def check_codec(codec: str, kv_dtype: str = "float16") -> None:
+    if codec not in CODEC_IDS:
+        raise ValueError(f"unknown codec {codec!r}; expected one of {sorted(CODEC_IDS)}")
+    if kv_dtype not in KV_DTYPES:
+        raise ValueError(f"kv_dtype must be one of {KV_DTYPES}")
+
+
+def codec_id(codec: str, kv_dtype: str = "float16") -> int:
+    """Native PageCodec value (CopyEngine.submit_array's codec column)."""
+    check_codec(codec, kv_dtype)
+    cid = CODEC_IDS[codec]
+    return cid | CODEC_BF16 if cid and kv_dtype == "bfloat16" else cid
+
+
+def encoded_page_bytes(page_bytes: int, codec: str) -> int:
+    """Stored size of one page; pages must be a whole number of GROUP-element groups."""
+    check_codec(codec)
+    if codec == "none":
+        return int(page_bytes)
+    if page_bytes % (GROUP * 2):
+        raise ValueError(f"page_bytes must be a multiple of {GROUP * 2} for codec {codec!r}")
+    return page_bytes // (GROUP * 2) * (4 + _PAYLOAD[codec])
+
+
+def _to_float32(data, kv_dtype: str) -> np.ndarray:
+    raw = np.frombuffer(data, dtype=np.uint16)
+    if kv_dtype == "bfloat16":
+        return (raw.astype(np.uint32) << np.uint32(16)).view(np.float32)
+    return raw.view(np.float16).astype(np.float32)
+
+
+def _from_float32(v: np.ndarray, kv_dtype: str) -> np.ndarray:
+    if kv_dtype == "bfloat16":
+        bits = v.view(np.uint32)
+        nan = (bits & np.uint32(0x7FFFFFFF)) > np.uint32(0x7F800000)
+        with np.errstate(over="ignore"):
+            rounded = (bits + np.uint32(0x7FFF) + ((bits >> np.uint32(16)) & np.uint32(1))) >> np.uint32(16)
+        return np.where(nan, (bits >> np.uint32(16)) | np.uint32(0x40), rounded).astype(np.uint16)
+    return v.astype(np.float16).view(np.uint16)
+
+
+def encode(data, codec: str, kv_dtype: str = "float16") -> bytes:
+    """Encode whole pages of KV elements; returns encoded_page_bytes(len(data), codec) bytes."""
+    check_codec(codec, kv_dtype)
+    if codec == "none":
+        return bytes(data)
+    encoded_page_bytes(len(memoryview(data).cast("B")), codec)
+    x = _to_float32(data, kv_dtype).reshape(-1, GROUP)
+    amax = np.abs(x).max(axis=1)
+    top = np.float32(_FP8_MAX if codec == "fp8" else 7.0)
+    scale = (amax / top).astype(np.float32)
+    safe = np.where(scale > 0, scale, np.float32(1.0))[:, None]
+    y = np.where(scale[:, None] > 0, x / safe, np.float32(0.0))
+    if codec == "fp8":
+        a = np.minimum(np.abs(y), np.float32(_FP8_MAX))
+        hi = np.clip(np.searchsorted(_E4M3_POS, a), 1, len(_E4M3_POS) - 1)
+        lo = hi - 1
+        code = np.where(a - _E4M3_POS[lo] <= _E4M3_POS[hi] - a, lo, hi).astype(np.uint8)
+        payload = code | np.where(np.signbit(y), np.uint8(0x80), np.uint8(0))
+    else:
+        q = (np.clip(np.rint(y), -7, 7) + 8).astype(np.uint8)
+        payload = q[:, 0::2] | (q[:, 1::2] << np.uint8(4))
+    out = np.empty((x.shape[0], 4 + payload.shape[1]), dtype=np.uint8)
+    out[:, :4] = scale.astype("<f4").view(np.uint8).reshape(-1, 4)
+    out[:, 4:] = payload
+    return out.tobytes()
+
+
+def decode_into(src, out_buf, codec: str, kv_dtype: str = "float16") -> int:
+    """Decode an encoded run into out_buf; returns the number of bytes written."""
+    check_codec(codec, kv_dtype)
+    enc = np.frombuffer(src, dtype=np.uint8)
+    out = np.frombuffer(out_buf, dtype=np.uint8)
+    if codec == "none":
+        if len(out) < len(enc):
+            raise ValueError(f"out_buf too small: need {len(enc)}, have {len(out)}")
+        out[: len(enc)] = enc
+        return len(enc)
+    rec = 4 + _PAYLOAD[codec]
+    if len(enc) % rec:
+        raise ValueError(f"encoded data is not a whole number of {codec} groups")
+    recs = enc.reshape(-1, rec)
+    n = recs.shape[0] * GROUP * 2
+    if len(out) < n:
+        raise ValueError(f"out_buf too small: need {n}, have {len(out)}")
+    scale = np.ascontiguousarray(recs[:, :4]).view("<f4").astype(np.float32)
+    payload = recs[:, 4:]
+    if codec == "fp8":
+        v = _E4M3[payload] * scale
+    else:
+        q = np.empty((recs.shape[0], GROUP), dtype=np.float32)
+        q[:, 0::2] = (payload & np.uint8(15)).astype(np.float32) - 8
+        q[:, 1::2] = (payload >> np.uint8(4)).astype(np.float32) - 8
+        v = q * scale
+    out[:n] = _from_float32(v.reshape(-1), kv_dtype).view(np.uint8)
+    return n
+
+
+def decode(src, codec: str, kv_dtype: str = "float16") -> bytes:
+    """decode_into() into a fresh bytes object."""
+    check_codec(codec, kv_dtype)
+    enc = memoryview(src).cast("B")
+    n = len(enc) if codec == "none" else len(enc) // (4 + _PAYLOAD[codec]) * GROUP * 2
+    buf = bytearray(n)
+    decode_into(enc, buf, codec, kv_dtype)
+    return bytes(buf)
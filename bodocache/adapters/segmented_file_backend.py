@@ -1,8 +1,44 @@
 from __future__ import annotations
 
+import mmap
 import os
+import threading
 from pathlib import Path
-from typing import Tuple
+from typing import Any, Dict, List, Sequence, Tuple
+
+import numpy as np
+
+from . import page_codec
+
+_MADVISE = {
+    name: getattr(mmap, f"MADV_{name.upper()}")
+    for name in ("willneed", "sequential", "random", "dontneed", "normal")
+    if hasattr(mmap, f"MADV_{name.upper()}")
+}
+
+
+class _SegmentMap:
+    """A read-only shared mapping of one segment file."""
+
+    __slots__ = ("mm", "size", "addr", "engine")
+
+    def __init__(self, mm: mmap.mmap, size: int):
+        self.mm = mm
+        self.size = size
+        arr = np.frombuffer(mm, dtype=np.uint8)
+        self.addr = int(arr.ctypes.data)
+        del arr
+        self.engine: Any = None  # copy engine the whole mapping is registered with
+
+    def release(self) -> None:
+        if self.engine is not None:
+            self.engine.unregister_host(self.addr)
+            self.engine = None
+        try:
+            self.mm.close()
+        except BufferError:
+            # A caller still holds a view; the mapping goes away with its last reference
+            pass
 
 
 class SegmentedFileBackend:
@@ -10,14 +46,52 @@ class SegmentedFileBackend:
     Segment-per-layer file backend.
     Each (model_id, model_version, layer) maps to one file with fixed-size pages.
     Page offset = page_id * page_bytes.
+
+    With mmap_mode=True every segment gets one persistent read-only mapping: reads
+    are served from the page cache without open/seek/read syscalls, `map_range()` hands
+    out zero-copy memoryviews, and `mapped_address()` registers the mapping with a copy
+    engine (`register_host`, i.e. cudaHostRegister) so H2D copies DMA straight from the
+    page cache. `advise_plan()` turns a plan window into madvise(WILLNEED/SEQUENTIAL)
+    hints. A mapping is replaced when its segment grows; replaced mappings stay alive
+    until close() because copies may still be reading them.
+
+    codec="fp8"|"int4" stores pages quantized (see page_codec.py) at a fixed encoded
+    size, stored_page_bytes(page_bytes), in `layer_N.<codec>.seg`. read_range* returns
+    decoded pages; read_encoded_into() and the mmap helpers expose the stored bytes, for
+    copy engines that decode on the device (`CopyEngine.decode_codecs()`).
     """
 
-    def __init__(self, root: str):
+    def __init__(
+        self,
+        root: str,
+        mmap_mode: bool = False,
+        register_max_bytes: int = 1 << 30,
+        codec: str = "none",
+        kv_dtype: str = "float16",
+    ):
+        page_codec.check_codec(codec, kv_dtype)
         self.root = Path(root)
         self.root.mkdir(parents=True, exist_ok=True)
+        self.codec = codec
+        self.kv_dtype = kv_dtype
+        self.mmap_mode = mmap_mode
+        # Larger mappings are not page-locked whole; they are copied from as pageable memory
+        self.register_max_bytes = register_max_bytes
+        self._maps: Dict[Path, _SegmentMap] = {}
+        self._retired: List[_SegmentMap] = []
+        self._map_lock = threading.Lock()
+
+    def segment_path(self, model_id: str, model_version: str, layer: int) -> Path:
+        """Path of the segment file for a layer (for native readers that open it directly)."""
+        return self._seg_path(model_id, model_version, layer)
 
     def _seg_path(self, model_id: str, model_version: str, layer: int) -> Path:
-        return self.root / model_id / model_version / f"layer_{layer}.seg"
+        suffix = "" if self.codec == "none" else f".{self.codec}"
+        return self.root / model_id / model_version / f"layer_{layer}{suffix}.seg"
+
+    def stored_page_bytes(self, page_bytes: int) -> int:
+        """Bytes one page of page_bytes occupies in the segment (and on the wire when encoded)."""
+        return page_codec.encoded_page_bytes(page_bytes, self.codec)
 
     def ensure_segment(self, model_id: str, model_version: str, layer: int):
         p = self._seg_path(model_id, model_version, layer)
@@ -29,10 +103,11 @@ class SegmentedFileBackend:
         assert len(data) == page_bytes, "data length must equal page_bytes"
         self.ensure_segment(model_id, model_version, layer)
         p = self._seg_path(model_id, model_version, layer)
+        stored = page_codec.encode(data, self.codec, self.kv_dtype) if self.codec != "none" else data
         with p.open('r+b') as f:
-            off = page_id * page_bytes
+            off = page_id * len(stored)
             f.seek(off)
-            f.write(data)
+            f.write(stored)
 
     def read_range(self, model_id: str, model_version: str, layer: int, start_pid: int, end_pid: int, page_bytes: int) -> bytes:
         """Read a consecutive page range [start_pid, end_pid] inclusive as one coalesced IO.
@@ -41,6 +116,13 @@ class SegmentedFileBackend:
         """
         if end_pid < start_pid:
             return b""
+        if self.codec != "none":
+            buf = bytearray((end_pid - start_pid + 1) * page_bytes)
+            self.read_range_into(model_id, model_version, layer, start_pid, end_pid, page_bytes, buf)
+            return bytes(buf)
+        if self.mmap_mode:
+            with self.map_range(model_id, model_version, layer, start_pid, end_pid, page_bytes) as view:
+                return bytes(view)
         self.ensure_segment(model_id, model_version, layer)
         p = self._seg_path(model_id, model_version, layer)
         size = (end_pid - start_pid + 1) * page_bytes
@@ -68,20 +150,59 @@ class SegmentedFileBackend:
     ) -> int:
         """Read range directly into a writable buffer supporting the buffer protocol.
 
-        Returns the number of bytes written.
+        Encoded segments are decoded into out_buf. Returns the number of bytes written.
         """
         if end_pid < start_pid:
             return 0
-        self.ensure_segment(model_id, model_version, layer)
-        p = self._seg_path(model_id, model_version, layer)
         size = (end_pid - start_pid + 1) * page_bytes
         mv = memoryview(out_buf)
         if mv.readonly:
             raise ValueError("out_buf must be writable")
         if mv.nbytes < size:
             raise ValueError(f"out_buf too small: need {size}, have {mv.nbytes}")
+        if self.codec != "none":
+            enc = bytearray((end_pid - start_pid + 1) * self.stored_page_bytes(page_bytes))
+            self.read_encoded_into(model_id, model_version, layer, start_pid, end_pid, page_bytes, enc)
+            return page_codec.decode_into(enc, mv.cast('B')[:size], self.codec, self.kv_dtype)
+        return self._read_stored_into(model_id, model_version, layer, start_pid, end_pid, page_bytes, mv)
+
+    def read_encoded_into(
+        self,
+        model_id: str,
+        model_version: str,
+        layer: int,
+        start_pid: int,
+        end_pid: int,
+        page_bytes: int,
+        out_buf,
+    ) -> int:
+        """Read pages [start_pid, end_pid] as stored (encoded) into out_buf.
+
+        out_buf needs (end_pid - start_pid + 1) * stored_page_bytes(page_bytes) bytes.
+        Returns the number of bytes written.
+        """
+        if end_pid < start_pid:
+            return 0
+        size = (end_pid - start_pid + 1) * self.stored_page_bytes(page_bytes)
+        mv = memoryview(out_buf)
+        if mv.readonly:
+            raise ValueError("out_buf must be writable")
+        if mv.nbytes < size:
+            raise ValueError(f"out_buf too small: need {size}, have {mv.nbytes}")
+        return self._read_stored_into(model_id, model_version, layer, start_pid, end_pid, page_bytes, mv)
+
+    def _read_stored_into(
+        self, model_id: str, model_version: str, layer: int, start_pid: int, end_pid: int, page_bytes: int, mv
+    ) -> int:
+        # Stored bytes of the range; mv has been checked to hold them
+        self.ensure_segment(model_id, model_version, layer)
+        p = self._seg_path(model_id, model_version, layer)
+        off, size = self._stored_extent(start_pid, end_pid, page_bytes)
+        if self.mmap_mode:
+            with self.map_range(model_id, model_version, layer, start_pid, end_pid, page_bytes) as view:
+                mv.cast('B')[:size] = view
+            return size
         with p.open('rb') as f:
-            off = start_pid * page_bytes
             f.seek(0, os.SEEK_END)
             seg_size = f.tell()
             if off + size > seg_size:
@@ -96,3 +217,151 @@ class SegmentedFileBackend:
             if n != size:
                 raise IOError(f"short read: expected {size} bytes, got {n}")
             return n
+
+    def read_batch(
+        self,
+        model_id: str,
+        model_version: str,
+        ranges: Sequence[Tuple[int, int, int, int]],
+        out_bufs: Sequence[Any],
+    ) -> List[int]:
+        """Read several (layer, start_pid, end_pid, page_bytes) ranges into out_bufs.
+
+        Same contract as the io_uring backend's vectored read; here the ranges are simply
+        read one after another. Returns bytes written per range.
+        """
+        if len(ranges) != len(out_bufs):
+            raise ValueError("ranges and out_bufs must have the same length")
+        return [
+            self.read_range_into(model_id, model_version, layer, start_pid, end_pid, page_bytes, buf)
+            for (layer, start_pid, end_pid, page_bytes), buf in zip(ranges, out_bufs)
+        ]
+
+    # ---- mmap mode -------------------------------------------------------
+
+    def _mapping(self, model_id: str, model_version: str, layer: int, need: int) -> _SegmentMap:
+        p = self._seg_path(model_id, model_version, layer)
+        with self._map_lock:
+            m = self._maps.get(p)
+            if m is not None and m.size >= need:
+                return m
+            self.ensure_segment(model_id, model_version, layer)
+            with p.open('rb') as f:
+                seg_size = os.fstat(f.fileno()).st_size
+                if need > seg_size or seg_size == 0:
+                    raise IOError(f"segment too small for read: need {need} bytes, have {seg_size} (layer={layer})")
+                mm = mmap.mmap(f.fileno(), seg_size, access=mmap.ACCESS_READ)
+            if m is not None:
+                self._retired.append(m)
+            m = _SegmentMap(mm, seg_size)
+            self._maps[p] = m
+            return m
+
+    def map_range(
+        self, model_id: str, model_version: str, layer: int, start_pid: int, end_pid: int, page_bytes: int
+    ) -> memoryview:
+        """Read-only zero-copy view of pages [start_pid, end_pid] inside the segment mapping
+        (their stored bytes, i.e. still encoded for a codec backend).
+
+        Raises IOError if the segment does not contain the full range. Release the view
+        (or use it as a context manager) when done so close() can unmap the segment.
+        """
+        if end_pid < start_pid:
+            return memoryview(b"")
+        off, size = self._stored_extent(start_pid, end_pid, page_bytes)
+        m = self._mapping(model_id, model_version, layer, off + size)
+        return memoryview(m.mm)[off:off + size]
+
+    def _stored_extent(self, start_pid: int, end_pid: int, page_bytes: int) -> Tuple[int, int]:
+        stored = self.stored_page_bytes(page_bytes)
+        return start_pid * stored, max(0, end_pid - start_pid + 1) * stored
+
+    def mapped_address(
+        self,
+        model_id: str,
+        model_version: str,
+        layer: int,
+        start_pid: int,
+        end_pid: int,
+        page_bytes: int,
+        engine: Any = None,
+    ) -> int:
+        """Host address of pages [start_pid, end_pid] in the segment mapping, for submit_array.
+
+        When `engine` implements register_host() and the segment is at most
+        register_max_bytes, the whole mapping is page-locked with it once so copies from
+        any range of the segment are true async DMA.
+        """
+        off, size = self._stored_extent(start_pid, end_pid, page_bytes)
+        m = self._mapping(model_id, model_version, layer, off + size)
+        register = getattr(engine, "register_host", None)
+        if callable(register) and m.engine is None and m.size <= self.register_max_bytes:
+            with self._map_lock:
+                if m.engine is None and register(m.addr, m.size):
+                    m.engine = engine
+        return m.addr + off
+
+    def advise(
+        self,
+        model_id: str,
+        model_version: str,
+        layer: int,
+        start_pid: int,
+        end_pid: int,
+        page_bytes: int,
+        advice: str = "willneed",
+    ) -> bool:
+        """madvise() pages [start_pid, end_pid] of the segment mapping.
+
+        advice is one of willneed, sequential, random, dontneed, normal. Returns False
+        when the platform lacks that hint or the segment does not cover the range.
+        """
+        flag = _MADVISE.get(advice)
+        if flag is None or end_pid < start_pid:
+            return False
+        off, size = self._stored_extent(start_pid, end_pid, page_bytes)
+        try:
+            m = self._mapping(model_id, model_version, layer, off + size)
+        except (IOError, OSError):
+            return False
+        # madvise wants a page-aligned start
+        lo = off - off % mmap.PAGESIZE
+        m.mm.madvise(flag, lo, off + size - lo)
+        return True
+
+    def advise_plan(
+        self,
+        plan_df,
+        model_id: str,
+        model_version: str,
+        page_bytes: int = 256 * 1024,
+        sequential_min_bytes: int = 4 << 20,
+    ) -> int:
+        """Hint the kernel about a plan window before it is executed.
+
+        Every (layer, start_pid, end_pid) row gets MADV_WILLNEED so readahead starts
+        ahead of the copies; rows of at least sequential_min_bytes also get
+        MADV_SEQUENTIAL. A page_bytes column overrides page_bytes per row. Returns the
+        number of rows advised.
+        """
+        if not self.mmap_mode or plan_df is None or len(plan_df) == 0:
+            return 0
+        advised = 0
+        for r in plan_df.itertuples(index=False):
+            layer, start_pid, end_pid = int(r.layer), int(r.start_pid), int(r.end_pid)
+            pb = int(getattr(r, "page_bytes", page_bytes))
+            if not self.advise(model_id, model_version, layer, start_pid, end_pid, pb, "willneed"):
+                continue
+            advised += 1
+            if (end_pid - start_pid + 1) * self.stored_page_bytes(pb) >= sequential_min_bytes:
+                self.advise(model_id, model_version, layer, start_pid, end_pid, pb, "sequential")
+        return advised
+
+    def close(self) -> None:
+        """Unregister and unmap every segment mapping (callers must have drained copies)."""
+        with self._map_lock:
+            maps = list(self._maps.values()) + self._retired
+            self._maps.clear()
+            self._retired = []
+        for m in maps:
+            m.release()
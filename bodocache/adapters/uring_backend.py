@@ -2,16 +2,25 @@ from __future__ import annotations
 
 import os
 from pathlib import Path
-from typing import Optional
+from typing import Any, Callable, Dict, List, Optional, Sequence, Tuple
 
 
 class SegmentedUringBackend:
     """Segmented backend using io_uring (native module) for high-throughput reads.
 
     Falls back to raising ImportError if the native module is not available.
+    Reads go through one persistent `IoUringReader` (long-lived ring, cached fds,
+    queue_depth chunks in flight); `o_direct=True` bypasses the page cache for aligned
+    reads into aligned buffers such as the copy engine's pinned pool.
     """
 
-    def __init__(self, root: str):
+    def __init__(
+        self,
+        root: str,
+        queue_depth: int = 64,
+        chunk_bytes: int = 1 << 20,
+        o_direct: bool = False,
+    ):
         self.root = Path(root)
         self.root.mkdir(parents=True, exist_ok=True)
         try:
@@ -19,6 +28,16 @@ class SegmentedUringBackend:
         except Exception as e:  # pragma: no cover - optional dependency
             raise ImportError("bodocache_agent_io_uring module not found. Build with -DUSE_URING=ON")
         self._uring = uring
+        reader_cls = getattr(uring, "IoUringReader", None)
+        self._reader = (
+            reader_cls(queue_depth=int(queue_depth), chunk_bytes=int(chunk_bytes), o_direct=bool(o_direct))
+            if reader_cls is not None
+            else None
+        )
+
+    def segment_path(self, model_id: str, model_version: str, layer: int) -> Path:
+        """Path of the segment file for a layer (for native readers that open it directly)."""
+        return self._seg_path(model_id, model_version, layer)
 
     def _seg_path(self, model_id: str, model_version: str, layer: int) -> Path:
         p = self.root / model_id / model_version / f"layer_{layer}.seg"
@@ -40,5 +59,47 @@ class SegmentedUringBackend:
         p = self._seg_path(model_id, model_version, layer)
         size = (end_pid - start_pid + 1) * page_bytes
         offset = start_pid * page_bytes
-        return int(self._uring.read_range_into(str(p), int(offset), int(size), out_buf))
+        reader = self._reader if self._reader is not None else self._uring
+        return int(reader.read_range_into(str(p), int(offset), int(size), out_buf))
+
+    def read_batch(
+        self,
+        model_id: str,
+        model_version: str,
+        ranges: Sequence[Tuple[int, int, int, int]],
+        out_bufs: Sequence[Any],
+        on_range_done: Optional[Callable[[int, int], None]] = None,
+    ) -> List[int]:
+        """Read (layer, start_pid, end_pid, page_bytes) ranges in one io_uring submission pipeline.
+
+        on_range_done(index, nbytes) fires as each range lands. Raises IOError if any range failed.
+        """
+        if len(ranges) != len(out_bufs):
+            raise ValueError("ranges and out_bufs must have the same length")
+        paths, offsets, sizes = [], [], []
+        for layer, start_pid, end_pid, page_bytes in ranges:
+            paths.append(str(self._seg_path(model_id, model_version, int(layer))))
+            offsets.append(int(start_pid) * int(page_bytes))
+            sizes.append(max(0, int(end_pid) - int(start_pid) + 1) * int(page_bytes))
+        reader = self._reader if self._reader is not None else self._uring
+        if not hasattr(reader, "read_batch"):
+            out = [int(reader.read_range_into(p, o, n, b)) for p, o, n, b in zip(paths, offsets, sizes, out_bufs)]
+            if on_range_done is not None:
+                for i, n in enumerate(out):
+                    on_range_done(i, n)
+            return out
+        res = [int(r) for r in reader.read_batch(paths, offsets, sizes, list(out_bufs), on_range_done)]
+        for i, r in enumerate(res):
+            if r < 0:
+                raise IOError(f"read failed for {paths[i]} at offset {offsets[i]}: {os.strerror(-r)}")
+        return res
+
+    def register_buffers(self, bufs: List[Any]) -> int:
+        """Register long-lived pinned buffers so reads into them use fixed-buffer SQEs."""
+        if self._reader is None:
+            return 0
+        return int(self._reader.register_buffers(list(bufs)))
+
+    def stats(self) -> Dict[str, Any]:
+        return dict(self._reader.stats()) if self._reader is not None else {}
 
@@ -1,8 +1,18 @@
 from __future__ import annotations
 
+import os
 import time
 from dataclasses import dataclass
-from typing import Any, Callable, List, Optional, Protocol
+from typing import Any, Callable, Dict, List, Optional, Protocol, Sequence, Tuple
+
+
+# Copy directions, matching the native engine's CopyDirection (and its H2D/D2H/D2D attrs).
+H2D = 0
+D2H = 1
+D2D = 2
+# Completion directions of submit_peer() ops (native PEER_RECV/PEER_SEND)
+PEER_RECV = 3
+PEER_SEND = 4
 
 
 @dataclass
@@ -25,31 +35,426 @@ class CopyOp:
     stream_id: int = 0
     gpu_id: int = 0
     deadline_ms: int = 0
+    # H2D (prefetch), D2H (eviction to pinned host memory) or D2D (cross-GPU, to dst_gpu_id)
+    direction: int = H2D
+    dst_gpu_id: int = 0
+    # Engine scheduler tie-break among equal deadlines; lower issues first
+    priority: int = 0
+    # H2D of encoded pages (native PageCodec, 0 = plain): `bytes` expand to decoded_bytes at dst
+    codec: int = 0
+    decoded_bytes: int = 0
 
 
 class AbstractCopyEngine(Protocol):
-    def submit(self, ops: List[CopyOp], callback: Callable[[CopyOp], None]) -> None:
-        """Submit a batch of copy ops and invoke callback as they complete."""
+    def submit(self, ops: List[CopyOp], callback: Optional[Callable[[Dict[str, Any]], None]] = None) -> int:
+        """Submit a batch of copy ops and invoke callback with each op's completion record
+        (a dict with op_id, tag, status, ...) as they complete.
+
+        Returns the op_id of the first op; a batch occupies consecutive ids. Engines that
+        implement `poll()` buffer completions for it when callback is None.
+        """
 
 
 class SimCopyEngine:
     """A minimal in-process, CPU-only engine.
 
     This is a placeholder to preserve functionality without requiring a
-    compiled backend. It immediately invokes the callback for each op.
+    compiled backend. It immediately invokes the callback for each op, or
+    records the completion for `poll()` when no callback is given.
     """
 
-    def submit(self, ops: List[CopyOp], callback: Callable[[CopyOp], None]) -> None:  # type: ignore[override]
+    def __init__(self) -> None:
+        self._next_op_id = 0
+        self._completed: List[Dict[str, Any]] = []
+        self._host_ranges: Dict[int, int] = {}
+        self._plan_rows = 0
+        self._peer: Optional[Tuple[bytes, int, int]] = None
+        self._peer_ops = 0
+        self._peer_bytes = 0
+        self.reset_stats()
+
+    def submit(self, ops: List[CopyOp], callback: Optional[Callable[[Dict[str, Any]], None]] = None) -> int:  # type: ignore[override]
+        first_op_id = self._next_op_id
+        self._next_op_id += len(ops)
         # Micro-sleep to mimic async behavior without blocking too long.
-        for op in ops:
+        for i, op in enumerate(ops):
             # 0.05ms per op for a tiny hint of asynchrony
             time.sleep(0.00005)
-            callback(op)
+            now_ns = time.monotonic_ns()
+            self._observe(int(op.gpu_id), int(op.stream_id), int(op.bytes), int(op.deadline_ms), 0, now_ns)
+            rec = {
+                "op_id": first_op_id + i,
+                "gpu_id": int(op.gpu_id),
+                "stream_id": int(op.stream_id),
+                "bytes": int(op.bytes),
+                "deadline_ms": int(op.deadline_ms),
+                "t_submit_ns": now_ns,
+                "t_done_ns": now_ns,
+                "tag": 0,
+                "direction": int(op.direction),
+                "status": 0,
+            }
+            if callback is not None:
+                callback(rec)
+            else:
+                self._completed.append(rec)
+        return first_op_id
+
+    def submit_array(
+        self,
+        src_ptr: Sequence[int],
+        dst_ptr: Sequence[int],
+        bytes: Sequence[int],
+        stream_id: Optional[Sequence[int]] = None,
+        gpu_id: Optional[Sequence[int]] = None,
+        deadline_ms: Optional[Sequence[int]] = None,
+        tag: Optional[Sequence[int]] = None,
+        callback: Optional[Callable[[Dict[str, Any]], None]] = None,
+        direction: Optional[Sequence[int]] = None,
+        dst_gpu_id: Optional[Sequence[int]] = None,
+        priority: Optional[Sequence[int]] = None,
+        codec: Optional[Sequence[int]] = None,
+        decoded_bytes: Optional[Sequence[int]] = None,
+    ) -> int:
+        """Columnar submit mirroring the native fast path. Addresses are never dereferenced.
+
+        codec/decoded_bytes are accepted (and checked for length) like the native engine's
+        device decode columns; nothing is decoded here.
+
+        The callback (when given) receives the completion record dict, including `tag`.
+        """
+        n = len(src_ptr)
+        if len(dst_ptr) != n or len(bytes) != n:
+            raise ValueError("src_ptr, dst_ptr and bytes must have the same length")
+
+        def col(values: Optional[Sequence[int]], i: int) -> int:
+            return int(values[i]) if values is not None else 0
+
+        for i in range(n):
+            if col(direction, i) not in (H2D, D2H, D2D):
+                raise ValueError("direction must be 0 (H2D), 1 (D2H) or 2 (D2D)")
+        if codec is not None and (decoded_bytes is None or len(codec) != n or len(decoded_bytes) != n):
+            raise ValueError("codec needs decoded_bytes, both with the same length as src_ptr")
+
+        first_op_id = self._next_op_id
+        self._next_op_id += n
+        for i in range(n):
+            time.sleep(0.00005)
+            now_ns = time.monotonic_ns()
+            rec = {
+                "op_id": first_op_id + i,
+                "gpu_id": col(gpu_id, i),
+                "stream_id": col(stream_id, i),
+                "bytes": int(bytes[i]),
+                "deadline_ms": col(deadline_ms, i),
+                "t_submit_ns": now_ns,
+                "t_done_ns": now_ns,
+                "tag": col(tag, i),
+                "direction": col(direction, i),
+                "status": 0,
+            }
+            self._observe(rec["gpu_id"], rec["stream_id"], rec["bytes"], rec["deadline_ms"], 0, now_ns)
+            if callback is not None:
+                callback(rec)
+            else:
+                self._completed.append(rec)
+        return first_op_id
+
+    def submit_scatter(
+        self,
+        src_ptr: Sequence[int],
+        seg_index: Sequence[int],
+        seg_dst: Sequence[int],
+        seg_src_offset: Sequence[int],
+        seg_bytes: Sequence[int],
+        stream_id: Optional[Sequence[int]] = None,
+        gpu_id: Optional[Sequence[int]] = None,
+        deadline_ms: Optional[Sequence[int]] = None,
+        tag: Optional[Sequence[int]] = None,
+        callback: Optional[Callable[[Dict[str, Any]], None]] = None,
+        priority: Optional[Sequence[int]] = None,
+    ) -> int:
+        """Scatter H2D mirroring the native engine: op i fans src_ptr[i] out to the
+        segments seg_index[i]..seg_index[i+1]; one completion record per op."""
+        n = len(src_ptr)
+        m = len(seg_dst)
+        if len(seg_index) != n + 1:
+            raise ValueError("seg_index must have len(src_ptr) + 1 entries")
+        if len(seg_src_offset) != m or len(seg_bytes) != m:
+            raise ValueError("seg_dst, seg_src_offset and seg_bytes must have the same length")
+        index = [int(x) for x in seg_index]
+        if index[0] != 0 or index[n] != m:
+            raise ValueError("seg_index must run from 0 to len(seg_dst)")
+        if any(index[i + 1] <= index[i] for i in range(n)):
+            raise ValueError("every scatter op needs at least one segment")
+        return self.submit_array(
+            src_ptr,
+            [int(seg_dst[index[i]]) for i in range(n)],
+            [sum(int(b) for b in seg_bytes[index[i]:index[i + 1]]) for i in range(n)],
+            stream_id=stream_id,
+            gpu_id=gpu_id,
+            deadline_ms=deadline_ms,
+            tag=tag,
+            callback=callback,
+            priority=priority,
+        )
+
+    def execute_plan(
+        self,
+        files: Sequence[str],
+        file_index: Sequence[int],
+        offsets: Sequence[int],
+        sizes: Sequence[int],
+        dst_ptr: Sequence[int],
+        overlap: Optional[Sequence[int]] = None,
+        stream_id: Optional[Sequence[int]] = None,
+        gpu_id: Optional[Sequence[int]] = None,
+        deadline_ms: Optional[Sequence[int]] = None,
+        tag: Optional[Sequence[int]] = None,
+        priority: Optional[Sequence[int]] = None,
+        tier: Optional[Sequence[int]] = None,
+        tier_inflight_bytes: Optional[Dict[int, int]] = None,
+        callback: Optional[Callable[[Dict[str, Any]], None]] = None,
+    ) -> int:
+        """Plan executor mirroring the native engine: row i reads sizes[i] bytes of
+        files[file_index[i]] at offsets[i] and lands them at dst_ptr[i].
+
+        Reads are performed (so a missing or short file fails its row with -errno/-EIO);
+        destinations are never dereferenced. One completion record per row, tag
+        defaulting to the row index.
+        """
+        n = len(file_index)
+        if len(offsets) != n or len(sizes) != n or len(dst_ptr) != n:
+            raise ValueError("file_index, offsets, sizes and dst_ptr must have the same length")
+        for name, values in (("overlap", overlap), ("stream_id", stream_id), ("gpu_id", gpu_id),
+                             ("deadline_ms", deadline_ms), ("tag", tag), ("priority", priority),
+                             ("tier", tier)):
+            if values is not None and len(values) != n:
+                raise ValueError(f"{name} must have the same length as file_index")
+        if any(int(b) < 0 for b in (tier_inflight_bytes or {}).values()):
+            raise ValueError("tier_inflight_bytes caps must be non-negative")
+        for i in range(n):
+            if not 0 <= int(file_index[i]) < len(files):
+                raise ValueError("file_index out of range")
+            if int(sizes[i]) > 0 and not int(dst_ptr[i]):
+                raise ValueError("execute_plan needs a non-null dst_ptr for every non-empty row")
+
+        def col(values: Optional[Sequence[int]], i: int, default: int = 0) -> int:
+            return int(values[i]) if values is not None else default
+
+        first_op_id = self._next_op_id
+        self._next_op_id += n
+        self._plan_rows += n
+        for i in range(n):
+            status = 0
+            nbytes = int(sizes[i])
+            t_read_ns = time.monotonic_ns()
+            try:
+                with open(files[int(file_index[i])], "rb") as f:
+                    f.seek(int(offsets[i]))
+                    if len(f.read(nbytes)) != nbytes:
+                        status = -5  # EIO: short read
+            except OSError as e:
+                status = -(e.errno or 5)
+            now_ns = time.monotonic_ns()
+            rec = {
+                "op_id": first_op_id + i,
+                "gpu_id": col(gpu_id, i),
+                "stream_id": col(stream_id, i),
+                "bytes": nbytes,
+                "deadline_ms": col(deadline_ms, i),
+                "t_submit_ns": now_ns,
+                "t_done_ns": now_ns,
+                "tag": col(tag, i, i),
+                "direction": H2D,
+                "status": status,
+            }
+            self._observe(
+                rec["gpu_id"], rec["stream_id"], nbytes, rec["deadline_ms"], status, t_read_ns,
+                read_ns=now_ns - t_read_ns, tier=col(tier, i),
+            )
+            if callback is not None:
+                callback(rec)
+            else:
+                self._completed.append(rec)
+        return first_op_id
+
+    def plan_stats(self) -> Dict[str, Any]:
+        # Rows complete synchronously, so nothing is ever queued or holding tier credit.
+        return {"rows": self._plan_rows, "queued_rows": 0, "tier_inflight_bytes": {}}
+
+    def _observe(
+        self, gpu_id: int, stream_id: int, nbytes: int, deadline_ms: int, status: int, t_submit_ns: int,
+        read_ns: int = 0, tier: Optional[int] = None,
+    ) -> None:
+        # Same accounting as the native engine's per-stream telemetry; copies take no time here.
+        t_done_ns = time.monotonic_ns()
+        st = self._streams.setdefault((gpu_id, stream_id), {
+            "ops": 0, "bytes": 0, "deadline_misses": 0, "failures": 0,
+            "read_ns": [], "queue_wait_ns": [], "dma_ns": [], "e2e_ns": [],
+        })
+        st["ops"] += 1
+        st["bytes"] += nbytes
+        self._deadline_ops += int(deadline_ms > 0)
+        st["deadline_misses"] += int(deadline_ms > 0 and time.time() * 1000.0 > deadline_ms)
+        st["failures"] += int(status != 0)
+        if read_ns > 0:
+            st["read_ns"].append(read_ns)
+        st["queue_wait_ns"].append(0)
+        st["dma_ns"].append(max(t_done_ns - t_submit_ns - read_ns, 0))
+        st["e2e_ns"].append(t_done_ns - t_submit_ns)
+        if tier is not None:
+            self._tier_bytes[tier] = self._tier_bytes.get(tier, 0) + nbytes
+
+    def stats(self) -> Dict[str, Any]:
+        """Telemetry snapshot shaped like the native engine's `stats()`."""
+        secs = max((time.monotonic_ns() - self._stats_since_ns) / 1e9, 1e-9)
 
-    def acquire_host_buffer(self, nbytes: int):  # type: ignore[override]
+        def summary(values: List[int]) -> Dict[str, Any]:
+            v = sorted(values)
+
+            def q(p: float) -> int:
+                return int(v[min(len(v) - 1, max(int(p * len(v) + 0.5), 1) - 1)]) if v else 0
+
+            return {
+                "count": len(v), "mean_ns": float(sum(v)) / len(v) if v else 0.0, "max_ns": v[-1] if v else 0,
+                "p50_ns": q(0.5), "p90_ns": q(0.9), "p99_ns": q(0.99), "p999_ns": q(0.999),
+            }
+
+        devices: Dict[int, Dict[str, Any]] = {}
+        for (gpu, stream), st in sorted(self._streams.items()):
+            counters = {k: st[k] for k in ("ops", "bytes", "deadline_misses", "failures")}
+            dev = devices.setdefault(gpu, {"ops": 0, "bytes": 0, "deadline_misses": 0, "failures": 0, "streams": {}})
+            for k, v in counters.items():
+                dev[k] += v
+            dev["streams"][stream] = dict(
+                counters, bytes_per_s=st["bytes"] / secs,
+                **{k: summary(st[k]) for k in ("read_ns", "queue_wait_ns", "dma_ns", "e2e_ns")},
+            )
+        for dev in devices.values():
+            dev["bytes_per_s"] = dev["bytes"] / secs
+        misses = sum(d["deadline_misses"] for d in devices.values())
+        return {
+            "uptime_s": secs,
+            "devices": devices,
+            "tiers": {t: {"bytes": b, "bytes_per_s": b / secs} for t, b in self._tier_bytes.items()},
+            # acquire_host_buffer() hands out plain bytearrays, so nothing is pooled
+            "pool": {"bytes_in_use": 0, "bytes_resident": 0, "occupancy": 0.0},
+            "deadline_ops": self._deadline_ops,
+            "deadline_misses": misses,
+        }
+
+    def reset_stats(self) -> None:
+        self._streams: Dict[Tuple[int, int], Dict[str, Any]] = {}
+        self._tier_bytes: Dict[int, int] = {}
+        self._deadline_ops = 0
+        self._stats_since_ns = time.monotonic_ns()
+
+    def poll(self, max_records: int = 0) -> List[Dict[str, Any]]:
+        """Return (and forget) buffered completion records, mirroring the native engine."""
+        n = len(self._completed) if max_records <= 0 else min(max_records, len(self._completed))
+        out, self._completed = self._completed[:n], self._completed[n:]
+        return out
+
+    def drain(self, timeout_ms: int = -1) -> List[Dict[str, Any]]:
+        # Copies complete synchronously in submit(), so there is never anything in flight.
+        return self.poll()
+
+    def decode_codecs(self) -> List[str]:
+        # Mirrors the CUDA/HIP engines so encoded paths can be exercised without a GPU.
+        return ["fp8", "int4"]
+
+    def register_host(self, ptr: int, bytes: int) -> bool:
+        # Nothing to pin; remember the range so callers see the native contract.
+        if not ptr or bytes <= 0:
+            raise ValueError("register_host needs a non-null address and size")
+        self._host_ranges.setdefault(int(ptr), int(bytes))
+        return True
+
+    def unregister_host(self, ptr: int) -> bool:
+        return self._host_ranges.pop(int(ptr), None) is not None
+
+    def acquire_host_buffer(self, nbytes: int, gpu_id: Optional[int] = None):  # type: ignore[override]
         # Return a writable bytearray as a stand-in for pinned memory.
         return memoryview(bytearray(nbytes))
 
+    def release_host_buffer(self, buf) -> bool:
+        # Nothing is pooled
+        return False
+
+    def peer_unique_id(self) -> bytes:
+        return os.urandom(128)
+
+    def peer_init(self, unique_id: bytes, nranks: int, rank: int, gpu_id: Optional[int] = None) -> None:
+        if nranks < 1 or not 0 <= rank < nranks:
+            raise ValueError("rank must be in [0, nranks)")
+        self._peer = (bytes(unique_id), int(nranks), int(rank))
+
+    def register_peer_buffer(self, ptr: int, bytes: int, gpu_id: Optional[int] = None) -> bool:
+        if not ptr or bytes <= 0:
+            raise ValueError("register_peer_buffer needs a non-null address and size")
+        return True
+
+    def unregister_peer_buffer(self, ptr: int, gpu_id: Optional[int] = None) -> None:
+        return None
+
+    def submit_peer(
+        self,
+        ptr: Sequence[int],
+        bytes: Sequence[int],
+        peer: Sequence[int],
+        send: Optional[Sequence[int]] = None,
+        stream_id: int = 0,
+        gpu_id: Optional[int] = None,
+        deadline_ms: Optional[Sequence[int]] = None,
+        tag: Optional[Sequence[int]] = None,
+        callback: Optional[Callable[[Dict[str, Any]], None]] = None,
+    ) -> int:
+        """Peer send/recv mirroring the native NCCL path: validated and completed at once,
+        nothing is transferred. Requires peer_init() like the native engine."""
+        n = len(ptr)
+        if len(bytes) != n or len(peer) != n:
+            raise ValueError("ptr, bytes and peer must have the same length")
+        if self._peer is None:
+            raise RuntimeError("peer transport is not initialized (call peer_init)")
+        if any(not int(p) for p in ptr):
+            raise ValueError("ptr entries must be non-null addresses")
+        first_op_id = self._next_op_id
+        self._next_op_id += n
+        gpu = int(gpu_id) if gpu_id is not None else 0
+        for i in range(n):
+            now_ns = time.monotonic_ns()
+            rec = {
+                "op_id": first_op_id + i,
+                "gpu_id": gpu,
+                "stream_id": int(stream_id),
+                "bytes": int(bytes[i]),
+                "deadline_ms": int(deadline_ms[i]) if deadline_ms is not None else 0,
+                "t_submit_ns": now_ns,
+                "t_done_ns": now_ns,
+                "tag": int(tag[i]) if tag is not None else 0,
+                "direction": PEER_SEND if send is not None and int(send[i]) else PEER_RECV,
+                "status": 0,
+            }
+            self._observe(gpu, rec["stream_id"], rec["bytes"], rec["deadline_ms"], 0, now_ns)
+            self._peer_ops += 1
+            self._peer_bytes += rec["bytes"]
+            if callback is not None:
+                callback(rec)
+            else:
+                self._completed.append(rec)
+        return first_op_id
+
+    def peer_stats(self) -> Dict[str, Any]:
+        return {"peer_ops": self._peer_ops, "peer_bytes": self._peer_bytes}
+
+    def stream_wait_ops(self, op_ids: Sequence[int], stream: int, gpu_id: Optional[int] = None) -> int:
+        """Device-side readiness fence, mirroring the native engine. Copies here complete
+        inside submit(), so there is never anything to wait for."""
+        if not int(stream):
+            raise ValueError("stream must be a non-null stream handle")
+        return 0
+
 
 def load_native_copy_engine() -> Optional[AbstractCopyEngine]:
     """Try loading a native (pybind11) copy engine if available.
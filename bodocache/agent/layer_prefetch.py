@@ -0,0 +1,320 @@
+from __future__ import annotations
+
+import threading
+import time
+from typing import Any, Callable, Dict, List, Optional, Set, Tuple
+
+import numpy as np
+import pandas as pd
+
+from .node_agent import NodeAgent
+
+# Layer-ahead prefetch. A window's plan is issued layer by layer instead of all at once:
+# when compute reaches layer L (layer_started), the copies of every layer up to L + k are
+# issued, where k is the smallest lookahead whose compute time covers the transfer of the
+# layer it brings in:
+#     transfer(L + k) <= lat(L) + lat(L + 1) + ... + lat(L + k - 1)
+# Compute gaps start from layer_lat_df and follow the gaps measured between
+# layer_started() calls. Transfer times come from the copy engine's telemetry histograms
+# (stats(): bytes per op over the dma latency quantile of each stream, plus the queue
+# wait quantile); until there is telemetry, the plan's `overlap` hint stands in for k. A
+# layer whose copies had not landed when compute reached it raises k by one until k
+# on-time layers in a row have passed. A WaveSpec's swap_window bounds k to the wave's
+# compute region, so prefetch never runs past the point where the wave swaps weights.
+#
+# Readiness is per layer: wait_layer(L, stream) fences the caller's compute stream on the
+# completion events of layer L's copies (engine.stream_wait_ops, i.e. cudaStreamWaitEvent),
+# so compute on L queues behind exactly those copies rather than the whole window. Ops the
+# engine cannot fence yet (held by its scheduler) and engines without stream_wait_ops are
+# waited for on the host, still one layer at a time.
+QUANTILES = ("p50", "p90", "p99", "p999")
+_DEFAULT_LAT_MS = 1.0  # layers missing from layer_lat_df, as in the planner cores
+
+
+def copy_rate_from_stats(
+    stats: Dict[str, Any], gpu_id: Optional[int] = None, quantile: str = "p90",
+) -> Optional[Tuple[float, float]]:
+    """(bytes per ns, fixed ns per op) of a device's copies from engine stats(), or None
+    without telemetry.
+
+    Each stream moves its mean op size per `quantile` dma latency and the streams run
+    concurrently, so the rates add up; the fixed cost is the largest queue wait quantile.
+    gpu_id None pools every device.
+    """
+    if quantile not in QUANTILES:
+        raise ValueError(f"quantile must be one of {QUANTILES}")
+    devices = stats.get("devices", {})
+    picked = [devices[gpu_id]] if gpu_id is not None and gpu_id in devices else list(devices.values())
+    rate = 0.0
+    fixed = 0.0
+    for dev in picked:
+        for st in dev.get("streams", {}).values():
+            ops = int(st.get("ops", 0))
+            dma_ns = float(st.get("dma_ns", {}).get(f"{quantile}_ns", 0))
+            if ops <= 0 or dma_ns <= 0:
+                continue
+            rate += float(st["bytes"]) / ops / dma_ns
+            fixed = max(fixed, float(st.get("queue_wait_ns", {}).get(f"{quantile}_ns", 0)))
+    return (rate, fixed) if rate > 0 else None
+
+
+class LayerAheadPrefetcher:
+    """Issues a plan window's copies k layers ahead of compute, with per-layer readiness.
+
+    Drive it from the model's forward pass: begin(plan_df) at the start of a window,
+    layer_started(L) as each layer's compute begins, and wait_layer(L, stream) before the
+    compute that reads layer L's pages. lookahead=None adapts k online (see the module
+    comment); an int pins it. Rows go through agent.execute() one layer group at a time
+    with the given dest_resolver, so every storage/peer path the agent has applies.
+    """
+
+    def __init__(
+        self,
+        agent: NodeAgent,
+        model_id: str,
+        model_version: str,
+        layer_lat_df: Optional[pd.DataFrame] = None,
+        *,
+        dest_resolver: Optional[Callable[[Dict[str, Any]], Any]] = None,
+        on_ready: Optional[Callable[[Dict[str, Any]], None]] = None,
+        lookahead: Optional[int] = None,
+        min_lookahead: int = 1,
+        max_lookahead: int = 8,
+        quantile: str = "p90",
+        ewma: float = 0.25,
+        gpu_id: Optional[int] = None,
+        prefer_native_engine: bool = True,
+        defer_completions: bool = False,
+    ):
+        if quantile not in QUANTILES:
+            raise ValueError(f"quantile must be one of {QUANTILES}")
+        if not 1 <= min_lookahead <= max_lookahead:
+            raise ValueError("lookahead bounds must satisfy 1 <= min_lookahead <= max_lookahead")
+        self.agent = agent
+        self.model_id = model_id
+        self.model_version = model_version
+        self.dest_resolver = dest_resolver
+        self.on_ready = on_ready
+        self.fixed_lookahead = lookahead
+        self.min_lookahead = int(min_lookahead)
+        self.max_lookahead = int(max_lookahead)
+        self.quantile = quantile
+        self.ewma = float(ewma)
+        self.gpu_id = gpu_id
+        self.prefer_native_engine = prefer_native_engine
+        self.defer_completions = defer_completions
+        # Per-layer compute gap in ms, seeded from layer_lat_df and updated from measurements
+        self.lat_ms: Dict[int, float] = {}
+        if layer_lat_df is not None and len(layer_lat_df):
+            self.lat_ms = {
+                int(L): float(v)
+                for L, v in zip(layer_lat_df["layer"].to_numpy(), layer_lat_df["lat_ms"].to_numpy())
+            }
+        self.counters = {
+            "windows": 0, "layers_issued": 0, "bytes": 0, "late_layers": 0, "on_time_layers": 0,
+            "fenced_waits": 0, "host_waits": 0, "demand_issues": 0,
+        }
+        self._cv = threading.Condition()
+        self._boost = 0
+        self._on_time_run = 0
+        self._last_start: Optional[Tuple[int, float]] = None
+        self._k = self.min_lookahead if lookahead is None else int(lookahead)
+        self._window = 0
+        self._reset_window(pd.DataFrame(), None)
+
+    def _reset_window(self, plan_df: pd.DataFrame, wave: Optional[Dict[str, Any]]) -> None:
+        self._window += 1  # completions of earlier windows' copies must not count here
+        self._groups: Dict[int, pd.DataFrame] = {}
+        self._group_bytes: Dict[int, int] = {}
+        self._covers: Dict[int, Set[int]] = {}  # layer -> group layers whose rows cover it
+        self._pending: Dict[int, int] = {}  # layer -> rows covering it not landed yet
+        self._op_ids: Dict[int, List[int]] = {}  # group layer -> engine op ids, once issued
+        self._order: List[int] = []
+        self._hint_k = self.min_lookahead
+        self._cap_k = self.max_lookahead
+        if wave is not None and "swap_window" in wave:
+            begin, end = (int(x) for x in wave["swap_window"])
+            self._cap_k = max(self.min_lookahead, min(self.max_lookahead, end - begin))
+        if plan_df.empty:
+            return
+        layer = plan_df["layer"].to_numpy(dtype=np.int64)
+        layer_end = plan_df["layer_end"].to_numpy(dtype=np.int64) if "layer_end" in plan_df.columns else layer
+        start = plan_df["start_pid"].to_numpy(dtype=np.int64)
+        end = plan_df["end_pid"].to_numpy(dtype=np.int64)
+        page_bytes = (
+            plan_df["page_bytes"].to_numpy(dtype=np.int64)
+            if "page_bytes" in plan_df.columns
+            else np.full(len(plan_df), self.agent.page_bytes, dtype=np.int64)
+        )
+        nbytes = np.where(end >= start, (end - start + 1) * page_bytes * (layer_end - layer + 1), 0)
+        for L, idx in pd.Series(np.arange(len(plan_df))).groupby(layer, sort=True):
+            L = int(L)
+            pos = idx.to_numpy()
+            self._groups[L] = plan_df.iloc[pos]
+            self._group_bytes[L] = int(nbytes[pos].sum())
+            for p in pos:
+                if nbytes[p] <= 0:
+                    continue
+                for covered in range(int(layer[p]), int(layer_end[p]) + 1):
+                    self._covers.setdefault(covered, set()).add(L)
+                    self._pending[covered] = self._pending.get(covered, 0) + 1
+        self._order = sorted(self._groups)
+        if "overlap" in plan_df.columns:
+            self._hint_k = max(self.min_lookahead, int(plan_df["overlap"].max()))
+
+    @property
+    def lookahead(self) -> int:
+        return self._k
+
+    def begin(self, plan_df: pd.DataFrame, wave: Optional[Dict[str, Any]] = None) -> Dict[str, Any]:
+        """Start a window: issue its first layer plus a lookahead's worth behind it.
+
+        wave, a WaveSpec built for this window (planner.waves), bounds the lookahead by
+        its swap_window. Layers of the previous window not issued yet are dropped."""
+        with self._cv:
+            self._reset_window(plan_df, wave)
+            self._last_start = None
+        self.counters["windows"] += 1
+        if self._order:
+            first = self._order[0]
+            self._k = self._choose_lookahead(first)
+            self._issue_through(first + self._k)
+        return self.stats()
+
+    def layer_started(self, layer: int) -> None:
+        """Compute of `layer` has begun: update its predecessors' measured gaps and the
+        lookahead, then issue every layer up to layer + k."""
+        now = time.perf_counter()
+        layer = int(layer)
+        with self._cv:
+            if self._last_start is not None and layer > self._last_start[0]:
+                prev, t_prev = self._last_start
+                gap_ms = (now - t_prev) * 1000.0 / (layer - prev)
+                for L in range(prev, layer):
+                    old = self.lat_ms.get(L)
+                    self.lat_ms[L] = gap_ms if old is None else old + self.ewma * (gap_ms - old)
+            self._last_start = (layer, now)
+            late = self._pending.get(layer, 0) > 0
+        if layer in self._covers:
+            if late:
+                self.counters["late_layers"] += 1
+                self._boost = min(self._boost + 1, self.max_lookahead)
+                self._on_time_run = 0
+            else:
+                self.counters["on_time_layers"] += 1
+                self._on_time_run += 1
+                if self._boost and self._on_time_run >= self._k:
+                    self._boost -= 1
+                    self._on_time_run = 0
+        self._k = self._choose_lookahead(layer)
+        self._issue_through(layer + self._k)
+
+    def wait_layer(self, layer: int, stream: Optional[int] = None, timeout_ms: float = -1) -> bool:
+        """Make layer's pages safe to read. With `stream` (a raw device stream handle, e.g.
+        torch.cuda.current_stream().cuda_stream) and an engine with stream_wait_ops, the
+        stream waits on the device and this returns without blocking; otherwise (or for
+        ops the engine could not fence) it blocks until the layer's copies have landed.
+        A layer not issued yet is issued now. False on timeout."""
+        layer = int(layer)
+        groups = sorted(self._covers.get(layer, ()))
+        missing = [L for L in groups if L not in self._op_ids]
+        if missing:
+            self.counters["demand_issues"] += 1
+            self._issue_through(max(missing))
+        with self._cv:
+            if self._pending.get(layer, 0) == 0:
+                return True
+            ops = [op for L in groups for op in self._op_ids.get(L, ())]
+        eng = self.agent.copy_engine
+        fence = getattr(eng, "stream_wait_ops", None)
+        if stream and ops and callable(fence):
+            kwargs = {} if self.gpu_id is None else {"gpu_id": self.gpu_id}
+            if int(fence(np.asarray(ops, dtype=np.uint64), int(stream), **kwargs)) == 0:
+                self.counters["fenced_waits"] += 1
+                return True
+        self.counters["host_waits"] += 1
+        deadline = None if timeout_ms < 0 else time.monotonic() + timeout_ms / 1000.0
+        polling = self.agent.pending_completions() > 0
+        with self._cv:
+            while self._pending.get(layer, 0) > 0:
+                left = None if deadline is None else deadline - time.monotonic()
+                if left is not None and left <= 0:
+                    return False
+                if polling:
+                    # Deferred completions only arrive through the agent's poll
+                    self._cv.release()
+                    try:
+                        self.agent.poll_completions()
+                    finally:
+                        self._cv.acquire()
+                    if self._pending.get(layer, 0) > 0:
+                        self._cv.wait(0.0002 if left is None else min(left, 0.0002))
+                else:
+                    self._cv.wait(left)
+            return True
+
+    def ready(self, layer: int) -> bool:
+        with self._cv:
+            return self._pending.get(int(layer), 0) == 0
+
+    def _transfer_ms(self, layer: int, rate: Optional[Tuple[float, float]]) -> float:
+        if rate is None:
+            return 0.0
+        nbytes = self._group_bytes.get(layer, 0)
+        if nbytes <= 0:
+            return 0.0
+        per_ns, fixed_ns = rate
+        return (fixed_ns + nbytes / per_ns) / 1e6
+
+    def _choose_lookahead(self, layer: int) -> int:
+        if self.fixed_lookahead is not None:
+            return int(self.fixed_lookahead)
+        stats = getattr(self.agent.copy_engine, "stats", None)
+        rate = copy_rate_from_stats(stats(), self.gpu_id, self.quantile) if callable(stats) else None
+        if rate is None:
+            k = self._hint_k
+        else:
+            k = self._cap_k
+            gap = 0.0
+            for cand in range(1, self._cap_k + 1):
+                gap += self.lat_ms.get(layer + cand - 1, _DEFAULT_LAT_MS)
+                if cand >= self.min_lookahead and self._transfer_ms(layer + cand, rate) <= gap:
+                    k = cand
+                    break
+        return max(self.min_lookahead, min(self._cap_k, k + self._boost))
+
+    def _issue_through(self, last_layer: int) -> None:
+        # Issue every not yet issued group up to last_layer, in layer order
+        for L in self._order:
+            if L > last_layer:
+                break
+            if L in self._op_ids:
+                continue
+            self._op_ids[L] = []
+            window = self._window
+            self.agent.execute(
+                self._groups[L], self.model_id, self.model_version,
+                on_ready=lambda info, _w=window: self._row_ready(_w, info),
+                dest_resolver=self.dest_resolver, prefer_native_engine=self.prefer_native_engine,
+                defer_completions=self.defer_completions,
+            )
+            with self._cv:
+                self._op_ids[L] = list(self.agent.issued_op_ids)
+            self.counters["layers_issued"] += 1
+            self.counters["bytes"] += self._group_bytes[L]
+
+    def _row_ready(self, window: int, info: Dict[str, Any]) -> None:
+        # Runs on the engine's worker thread (or inline for synchronous paths)
+        first = int(info["layer"])
+        with self._cv:
+            for L in range(first, int(info.get("layer_end", first)) + 1) if window == self._window else ():
+                if self._pending.get(L, 0) > 0:
+                    self._pending[L] -= 1
+            self._cv.notify_all()
+        if self.on_ready is not None:
+            self.on_ready(info)
+
+    def stats(self) -> Dict[str, Any]:
+        with self._cv:
+            pending = sum(1 for v in self._pending.values() if v > 0)
+        return dict(self.counters, lookahead=self._k, pending_layers=pending)
@@ -1,12 +1,39 @@
 from __future__ import annotations
 
+import threading
 import time
-from typing import Callable, Dict, Any, Optional
+from dataclasses import replace
+from typing import Callable, Dict, Any, Iterable, List, Optional, Tuple
 
+import numpy as np
 import pandas as pd
 
+from bodocache.adapters import page_codec
 from bodocache.adapters.segmented_file_backend import SegmentedFileBackend
+from bodocache.integrations.ptr import ptr_to_int
+from bodocache.planner.models import Tier
 from .copy_engine import AbstractCopyEngine, CopyOp, get_copy_engine
+from .peer import PeerTier
+
+
+IO_MODES = ("auto", "gds", "stream", "mmap", "bounce")
+
+
+def io_mode_from_route_hint(route_hint: Optional[str]) -> str:
+    """Storage->device path requested by a plan row's route_hint.
+
+    Hints are ';'-separated tokens (e.g. "prefix:p0;io=gds"). `io=` selects "gds"
+    (GPUDirect Storage), "stream" (io_uring chunk pipeline), "mmap" (straight from the
+    backend's page-cache mapping) or "bounce" (pinned buffer); rows without one use
+    "auto", the best path the engine and backend support.
+    """
+    if not route_hint:
+        return "auto"
+    for token in str(route_hint).split(";"):
+        key, _, value = token.strip().partition("=")
+        if key == "io" and value in IO_MODES:
+            return value
+    return "auto"
 
 
 class NodeAgent:
@@ -20,11 +47,29 @@ class NodeAgent:
         backend: SegmentedFileBackend,
         page_bytes: int = 256 * 1024,
         copy_engine: Optional[AbstractCopyEngine] = None,
+        io_mode_resolver: Optional[Callable[[Optional[str]], str]] = None,
+        peer: Optional[PeerTier] = None,
     ):
         self.backend = backend
         self.page_bytes = page_bytes
         # Optional device copy engine. Falls back to a simulated engine if explicitly requested.
         self.copy_engine = copy_engine
+        # route_hint -> one of IO_MODES, evaluated per plan row
+        self.io_mode_resolver = io_mode_resolver or io_mode_from_route_hint
+        # Deferred completions: op_id -> (ready info, on_ready) awaiting poll_completions()
+        self._deferred: Dict[int, Tuple[Dict[str, Any], Optional[Callable[[Dict[str, Any]], None]]]] = {}
+        # Callback completions, routed by op_id through _on_complete. Native engines keep one
+        # engine-wide op callback that each submit replaces, so every submission hands the
+        # engine that same bound method; records that beat their submit call's return wait
+        # in _early until the call has registered its ops.
+        self._routes: Dict[int, Tuple[Dict[str, Any], Optional[Callable[[Dict[str, Any]], None]]]] = {}
+        self._early: Dict[int, Any] = {}
+        self._routes_mu = threading.Lock()
+        # Peer tier (tier_src == PEER rows pulled from the node holding the pages), or None
+        self.peer = peer
+        # Engine op ids of the copies the last execute()/execute_columnar()/evict() call
+        # submitted, e.g. for stream_wait_ops() readiness fences (see layer_prefetch.py)
+        self.issued_op_ids: List[int] = []
 
     def execute(
         self,
@@ -34,20 +79,93 @@ class NodeAgent:
         on_ready: Optional[Callable[[Dict[str, Any]], None]] = None,
         dest_resolver: Optional[Callable[[Dict[str, Any]], Any]] = None,
         prefer_native_engine: bool = True,
+        defer_completions: bool = False,
     ) -> Dict[str, Any]:
+        """Execute a plan window.
+
+        With defer_completions=True and an engine that supports `poll()`, device copies are
+        submitted without a callback and on_ready fires from `poll_completions()` /
+        `drain_completions()` instead of the engine's worker thread.
+
+        Engines that expose `submit_array()` receive the whole window as one columnar
+        submission (raw addresses, one call) instead of one `submit()` per row. When the
+        storage backend also implements `read_batch()`, the window's reads are issued
+        together before that submission. Engines built with the io_uring streaming stage
+        (`submit_stream()`) read segment files themselves and overlap each range's disk
+        reads with its H2D chunks; on_ready then fires when the last chunk has landed.
+        Engines with GPUDirect Storage (`submit_gds()`) read straight into device memory.
+        A backend in mmap mode serves rows from its segment mappings instead: the window
+        is madvise()d up front, each mapping is registered with the engine and the copies
+        are submitted with the mapped addresses as sources, so there is no read and no
+        bounce buffer; "auto" rows prefer this path when the backend is in mmap mode.
+        The path is chosen per row by `io_mode_resolver(route_hint)`.
+
+        With an encoded backend (codec="fp8"|"int4") and an engine whose
+        `decode_codecs()` lists that codec, rows are copied as stored (bounce or mmap)
+        and decoded on the device into dst; otherwise they are decoded on the host first.
+        Engine file reads (gds/stream) are not used for encoded segments.
+
+        dest_resolver may return a list of destinations, one per page (page-major across
+        layers for merged rows), e.g. the non-contiguous vLLM/SGLang KV blocks the pages
+        map to (see vllm_blocks.block_dest_resolver). The row is still read as one run
+        (bounce or mmap, decoded on the host when encoded) and handed to the engine's
+        `submit_scatter()` as one op with one completion; adjacent blocks are merged.
+
+        With a PeerTier (`peer`), tier_src == PEER rows are pulled from the nodes holding
+        their pages (see _execute_peer); rows it cannot serve take the storage paths.
+
+        The info dicts given to dest_resolver and on_ready carry the row's position in
+        plan_df as "row", whatever order the rows are resolved in.
+        """
+        self.issued_op_ids = []
         if plan_df.empty:
             return {"ops": 0, "bytes": 0, "duration_ms": 0.0}
         t0 = time.time()
         total_bytes = 0
-        for r in plan_df.itertuples(index=False):
+        peer_ops = 0
+        rows = np.arange(len(plan_df))
+        if self.peer is not None and "tier_src" in plan_df.columns:
+            served, total_bytes = self._execute_peer(plan_df, model_id, model_version, on_ready, dest_resolver)
+            peer_ops = int(served.sum())
+            if peer_ops:
+                plan_df, rows = plan_df[~served], rows[~served]
+        # Rows staged for a single submit_array() call at the end of the window, with their
+        # (layer, start_pid, end_pid, page_bytes) read when it is deferred to read_batch()
+        batched: List[Tuple[Any, int, CopyOp, Dict[str, Any], Optional[Tuple[int, int, int, int]]]] = []
+        batch_reads = callable(getattr(self.backend, "read_batch", None))
+        # Rows the engine reads from segment files itself: (dst_addr, op, info, (path, offset))
+        streamed: List[Tuple[int, CopyOp, Dict[str, Any], Tuple[str, int]]] = []
+        gds_rows: List[Tuple[int, CopyOp, Dict[str, Any], Tuple[str, int]]] = []
+        # Rows copied straight out of the backend's segment mappings: (src_addr, dst_addr, op, info)
+        mapped: List[Tuple[int, int, CopyOp, Dict[str, Any]]] = []
+        # Rows fanned out to several device ranges: (src_addr, [(dst, src_offset, bytes)], op, info, src_buf)
+        scattered: List[Tuple[int, List[Tuple[int, int, int]], CopyOp, Dict[str, Any], Any]] = []
+        backend_mmap = bool(getattr(self.backend, "mmap_mode", False)) and callable(
+            getattr(self.backend, "mapped_address", None)
+        )
+        encoded = getattr(self.backend, "codec", "none") != "none"
+        dev_codec: Optional[int] = None  # PageCodec the engine decodes on the device, 0 = none
+        if backend_mmap and callable(getattr(self.backend, "advise_plan", None)):
+            self.backend.advise_plan(plan_df, model_id, model_version, page_bytes=self.page_bytes)
+        # Planner priority (urgency, lower is sooner) as a dense rank: the engine scheduler's
+        # tie-break among equal deadlines.
+        prio_rank = (
+            plan_df["priority"].fillna(0.0).rank(method="dense").astype(np.int64).to_numpy() - 1
+            if "priority" in plan_df.columns
+            else None
+        )
+        for i, r in enumerate(plan_df.itertuples(index=False)):
             layer = int(r.layer)
             start_pid = int(r.start_pid)
             end_pid = int(r.end_pid)
             page_bytes = int(getattr(r, "page_bytes", self.page_bytes))
             route_hint = getattr(r, "route_hint", None)
+            # Rows merged across layers (run_window(merge_layers=True)) span [layer, layer_end]
+            layer_end = int(getattr(r, "layer_end", layer))
             # Compute total bytes for this coalesced read
-            nbytes = (end_pid - start_pid + 1) * page_bytes if end_pid >= start_pid else 0
+            nbytes = (end_pid - start_pid + 1) * page_bytes * (layer_end - layer + 1) if end_pid >= start_pid else 0
             total_bytes += nbytes
+            prio = int(prio_rank[i]) if prio_rank is not None else 0
 
             # If a device copy engine is available and a destination is provided, enqueue a copy.
             # Otherwise, treat the read as "ready" immediately.
@@ -55,85 +173,891 @@ class NodeAgent:
                 # Try to lazily load a native engine if requested and not provided.
                 self.copy_engine = get_copy_engine(prefer_native=prefer_native_engine)
 
-            dst = dest_resolver({
+            info = {
                 "node": getattr(r, "node", ""),
                 "layer": layer,
                 "start_pid": start_pid,
                 "end_pid": end_pid,
                 "bytes": nbytes,
                 "route_hint": route_hint,
-            }) if dest_resolver is not None else None
+                "row": int(rows[i]),
+            }
+            if layer_end != layer:
+                info["layer_end"] = layer_end
+            dst = dest_resolver(dict(info)) if dest_resolver is not None else None
+            segs = self._scatter_segments(dst, nbytes, page_bytes) if dst is not None else None
+
+            if segs is not None and self.copy_engine is not None and self._can_scatter():
+                # One staged run fanned out to its (non-contiguous) device blocks
+                if not segs:
+                    continue
+                op = self._row_op(r, None, dst, nbytes, prio)
+                mode = self.io_mode_resolver(route_hint)
+                if mode in ("auto", "mmap") and backend_mmap and layer_end == layer and not encoded:
+                    src_addr = self.backend.mapped_address(
+                        model_id, model_version, layer, start_pid, end_pid, page_bytes, engine=self.copy_engine
+                    )
+                    scattered.append((src_addr, segs, op, info, None))
+                    continue
+                src_buf = self._acquire(nbytes, op.gpu_id)
+                if src_buf is not None:
+                    # Encoded pages are decoded on the host: device decode needs one contiguous dst
+                    if layer_end != layer:
+                        self._read_block_into(
+                            model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes, src_buf
+                        )
+                    else:
+                        self.backend.read_range_into(model_id, model_version, layer, start_pid, end_pid, page_bytes, src_buf)
+                    scattered.append((self._buffer_address(src_buf), segs, op, info, src_buf))
+                    continue
+            elif self.copy_engine is not None and dst is not None:
+                # Let the engine read the segment file itself when it can: straight into
+                # device memory (GDS) or through its pinned chunk pipeline (io_uring).
+                mode = self.io_mode_resolver(route_hint)
+                if dev_codec is None:
+                    dev_codec = self._device_codec()
+                # Bytes on the wire: the stored (encoded) size when the engine decodes
+                wire_bytes = (
+                    (end_pid - start_pid + 1) * self.backend.stored_page_bytes(page_bytes) if dev_codec and nbytes else nbytes
+                )
+                extent = (
+                    self._file_extent(model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes)
+                    if mode in ("auto", "gds", "stream") and nbytes > 0 and not encoded
+                    else None
+                )
+                has_path = extent is not None
+                mapped_dst = (
+                    ptr_to_int(dst)
+                    if mode in ("auto", "mmap")
+                    and backend_mmap
+                    and layer_end == layer
+                    and (dev_codec or not encoded)
+                    and nbytes > 0
+                    and callable(getattr(self.copy_engine, "submit_array", None))
+                    else None
+                )
+                if mapped_dst:
+                    src_addr = self.backend.mapped_address(
+                        model_id, model_version, layer, start_pid, end_pid, page_bytes, engine=self.copy_engine
+                    )
+                    op = self._row_op(r, None, dst, wire_bytes, prio, dev_codec, nbytes)
+                    mapped.append((src_addr, mapped_dst, op, info))
+                    continue
+                use_gds = mode in ("auto", "gds") and has_path and callable(getattr(self.copy_engine, "submit_gds", None))
+                use_stream = (
+                    not use_gds
+                    and mode in ("auto", "stream")
+                    and has_path
+                    and callable(getattr(self.copy_engine, "submit_stream", None))
+                )
+                dst_addr = ptr_to_int(dst) if (use_gds or use_stream) and nbytes > 0 else None
+                if dst_addr is not None:
+                    op = self._row_op(r, None, dst, nbytes, prio)
+                    rows = gds_rows if use_gds else streamed
+                    rows.append((dst_addr, op, info, extent))
+                    continue
 
-            if self.copy_engine is not None and dst is not None:
                 # Use pinned buffer path if supported by the engine
-                src_buf = None
-                acquire = getattr(self.copy_engine, "acquire_host_buffer", None)
-                if callable(acquire) and nbytes > 0:
-                    try:
-                        src_buf = acquire(nbytes)  # expected to be a writable memoryview
-                    except Exception:
-                        src_buf = None
+                src_buf = self._acquire(wire_bytes, int(getattr(r, "gpu_id", 0))) if nbytes > 0 else None
 
                 if src_buf is not None:
-                    # Read directly into pinned buffer and submit device copy
-                    self.backend.read_range_into(
-                        model_id,
-                        model_version,
-                        layer,
-                        start_pid,
-                        end_pid,
-                        page_bytes,
-                        src_buf,
-                    )
-                    op = CopyOp(
-                        src=src_buf,
-                        dst=dst,
-                        bytes=nbytes,
-                        stream_id=int(getattr(r, "overlap", 1)) - 1 if hasattr(r, "overlap") else 0,
-                        gpu_id=int(getattr(r, "gpu_id", 0)) if hasattr(r, "gpu_id") else 0,
-                        deadline_ms=int(getattr(r, "deadline_ms", 0)) if hasattr(r, "deadline_ms") else 0,
+                    dst_addr = ptr_to_int(dst) if callable(getattr(self.copy_engine, "submit_array", None)) else None
+                    deferred_read = (
+                        (layer, start_pid, end_pid, page_bytes)
+                        if dst_addr is not None and batch_reads and layer_end == layer and not dev_codec
+                        else None
                     )
+                    if dev_codec:
+                        # Stored bytes go over PCIe; the engine decodes them into dst
+                        self.backend.read_encoded_into(
+                            model_id, model_version, layer, start_pid, end_pid, page_bytes, src_buf
+                        )
+                    elif layer_end != layer:
+                        # One sequential read of the packed block, delivered page-major
+                        self._read_block_into(
+                            model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes, src_buf
+                        )
+                    elif deferred_read is None:
+                        # Read directly into pinned buffer and submit device copy
+                        self.backend.read_range_into(
+                            model_id,
+                            model_version,
+                            layer,
+                            start_pid,
+                            end_pid,
+                            page_bytes,
+                            src_buf,
+                        )
+                    op = self._row_op(r, src_buf, dst, wire_bytes, prio, dev_codec, nbytes)
 
-                    def _done(_op: CopyOp, _r=r, _bytes=nbytes) -> None:
-                        _route_hint = getattr(_r, "route_hint", None)
-                        if on_ready is not None:
-                            on_ready(
-                                {
-                                    "node": getattr(_r, "node", ""),
-                                    "layer": int(_r.layer),
-                                    "start_pid": int(_r.start_pid),
-                                    "end_pid": int(_r.end_pid),
-                                    "bytes": _bytes,
-                                    "route_hint": _route_hint,
-                                }
-                            )
+                    if dst_addr is not None:
+                        batched.append((src_buf, dst_addr, op, info, deferred_read))
+                        continue
+                    if defer_completions and callable(getattr(self.copy_engine, "poll", None)):
+                        op_id = self.copy_engine.submit([op], None)
+                        self._deferred[int(op_id)] = (info, on_ready)
+                        self.issued_op_ids.append(int(op_id))
+                        continue
 
                     # Submit as a single-op batch to keep context simple.
-                    self.copy_engine.submit([op], _done)
+                    op_id = int(self.copy_engine.submit([op], self._on_complete))
+                    self._route(op_id, [(info, on_ready)])
                     continue
 
             # Fallback: CPU read and mark ready
-            data = self.backend.read_range(
-                model_id,
-                model_version,
-                layer,
-                start_pid,
-                end_pid,
-                page_bytes,
-            )
+            if layer_end != layer:
+                data = self._read_block(model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes)
+            else:
+                data = self.backend.read_range(
+                    model_id,
+                    model_version,
+                    layer,
+                    start_pid,
+                    end_pid,
+                    page_bytes,
+                )
             if on_ready is not None and nbytes > 0:
-                on_ready(
-                    {
-                        "node": getattr(r, "node", ""),
-                        "layer": layer,
-                        "start_pid": start_pid,
-                        "end_pid": end_pid,
-                        "bytes": len(data),
-                        "route_hint": route_hint,
-                    }
+                on_ready(dict(info, bytes=len(data)))
+        if batched:
+            self._submit_batched(batched, model_id, model_version, on_ready, defer_completions)
+        if mapped:
+            self._submit_addresses(
+                np.array([m[0] for m in mapped], dtype=np.uint64),
+                [(m[1], m[2], m[3]) for m in mapped],
+                on_ready,
+                defer_completions,
+            )
+        if scattered:
+            self._submit_scatter(scattered, on_ready, defer_completions)
+        if streamed:
+            self._submit_from_files(
+                self.copy_engine.submit_stream, streamed, model_id, model_version, on_ready, defer_completions
+            )
+        if gds_rows:
+            self._submit_from_files(
+                self.copy_engine.submit_gds, gds_rows, model_id, model_version, on_ready, defer_completions
+            )
+        dt = (time.time() - t0) * 1000.0
+        return {"ops": int(len(plan_df)) + peer_ops, "bytes": int(total_bytes), "duration_ms": float(dt)}
+
+    @staticmethod
+    def _row_op(
+        r: Any, src: Any, dst: Any, nbytes: int, priority: int, codec: int = 0, decoded_bytes: int = 0,
+    ) -> CopyOp:
+        # A plan row's copy: stream from its overlap, gpu/deadline from its columns when the
+        # plan has them. decoded_bytes only applies to encoded (codec != 0) copies.
+        return CopyOp(
+            src=src,
+            dst=dst,
+            bytes=nbytes,
+            stream_id=int(getattr(r, "overlap", 1)) - 1,
+            gpu_id=int(getattr(r, "gpu_id", 0)),
+            deadline_ms=int(getattr(r, "deadline_ms", 0)),
+            priority=priority,
+            codec=codec,
+            decoded_bytes=decoded_bytes if codec else 0,
+        )
+
+    def _execute_peer(
+        self,
+        plan_df: pd.DataFrame,
+        model_id: str,
+        model_version: str,
+        on_ready: Optional[Callable[[Dict[str, Any]], None]],
+        dest_resolver: Optional[Callable[[Dict[str, Any]], Any]],
+    ) -> Tuple[np.ndarray, int]:
+        # Serves the tier_src == PEER rows it can; returns (mask of the rows served, their
+        # bytes). The other rows are left for the storage paths.
+        is_peer = plan_df["tier_src"].to_numpy() == Tier.PEER.value
+        served = np.zeros(len(plan_df), dtype=bool)
+        total = 0
+        for pos in np.flatnonzero(is_peer):
+            nbytes = self._peer_row(plan_df.iloc[pos], int(pos), model_id, model_version, on_ready, dest_resolver)
+            if nbytes is not None:
+                served[pos] = True
+                total += nbytes
+        counters = self.peer.counters
+        counters["ops"] += int(served.sum())
+        counters["bytes"] += total
+        counters["fallback_ops"] += int(is_peer.sum() - served.sum())
+        return served, total
+
+    def _peer_row(
+        self,
+        r: pd.Series,
+        row: int,
+        model_id: str,
+        model_version: str,
+        on_ready: Optional[Callable[[Dict[str, Any]], None]],
+        dest_resolver: Optional[Callable[[Dict[str, Any]], Any]],
+    ) -> Optional[int]:
+        """One peer-tier row; its bytes once submitted, or None to leave it to storage.
+
+        The row splits into runs by holder. With a device destination, runs held in a
+        peer's GPU go engine-to-engine (PeerTier.device_capable; the holder's server posts
+        the send through NodeAgent.peer_device_sender); the rest are fetched
+        over TCP into one pinned buffer per contiguous stretch and copied H2D. A run the
+        holder no longer has is read from local storage into the same buffer. on_ready
+        fires once every part has landed. Merged-layer rows and per-page destinations
+        are left to storage.
+        """
+        peer = self.peer
+        layer = int(r["layer"])
+        start_pid = int(r["start_pid"])
+        end_pid = int(r["end_pid"])
+        page_bytes = int(r.get("page_bytes", self.page_bytes))
+        if int(r.get("layer_end", layer)) != layer or end_pid < start_pid:
+            return None
+        runs = peer.runs(model_id, model_version, layer, start_pid, end_pid)
+        if runs is None:
+            return None
+        nbytes = (end_pid - start_pid + 1) * page_bytes
+        info = {
+            "node": r.get("node", ""),
+            "layer": layer,
+            "start_pid": start_pid,
+            "end_pid": end_pid,
+            "bytes": nbytes,
+            "route_hint": r.get("route_hint"),
+            "row": row,
+        }
+        dst = dest_resolver(dict(info)) if dest_resolver is not None else None
+        if isinstance(dst, (list, tuple, np.ndarray)):
+            return None
+        eng = self.copy_engine
+        dst_addr = ptr_to_int(dst) if dst is not None and eng is not None else None
+        gpu_id = int(r.get("gpu_id", 0))
+        stream_id = int(r.get("overlap", 1)) - 1
+        deadline_ms = int(r.get("deadline_ms", 0))
+
+        # Parts in flight, plus one held until every part is submitted. Engine callbacks
+        # finish parts while later ones are still being added, so both sides take the lock.
+        left = [1]
+        left_mu = threading.Lock()
+
+        def _part_added() -> None:
+            with left_mu:
+                left[0] += 1
+
+        def _part_done(_rec: Any = None) -> None:
+            with left_mu:
+                left[0] -= 1
+                done = left[0] == 0
+            if done and on_ready is not None:
+                on_ready(dict(info))
+
+        # Device runs first (each receive is posted as soon as its holder has posted the send)
+        host: List[Tuple[int, int, str]] = []  # (start_pid, end_pid, holder)
+        for s, e, holder, tier in runs:
+            if (
+                dst_addr is not None
+                and peer.device_capable(eng, holder, tier)
+                and peer.client.request_device_send(holder, model_id, model_version, layer, s, e, page_bytes, peer.rank)
+            ):
+                _part_added()
+                op_id = int(eng.submit_peer(
+                    [dst_addr + (s - start_pid) * page_bytes], [(e - s + 1) * page_bytes], [peer.ranks[holder]],
+                    stream_id=peer.stream_id, gpu_id=gpu_id, deadline_ms=[deadline_ms], callback=self._on_complete,
+                ))
+                self._route(op_id, [(info, _part_done)])
+                peer.counters["device_runs"] += 1
+            else:
+                host.append((s, e, holder))
+
+        # Host runs in contiguous stretches, one buffer (and one H2D op) per stretch
+        stretches: List[List[Tuple[int, int, str]]] = []
+        for run in host:
+            if stretches and stretches[-1][-1][1] + 1 == run[0]:
+                stretches[-1].append(run)
+            else:
+                stretches.append([run])
+        for stretch in stretches:
+            first_pid = stretch[0][0]
+            size = (stretch[-1][1] - first_pid + 1) * page_bytes
+            buf = self._acquire(size, gpu_id) if dst_addr is not None else None
+            if buf is None:
+                buf = memoryview(bytearray(size))
+            view = memoryview(buf).cast("B")
+            for s, e, holder in stretch:
+                part = view[(s - first_pid) * page_bytes:(e - first_pid + 1) * page_bytes]
+                if not peer.client.fetch_into(holder, model_id, model_version, layer, s, e, page_bytes, part):
+                    self.backend.read_range_into(model_id, model_version, layer, s, e, page_bytes, part)
+                    peer.counters["storage_runs"] += 1
+            if dst_addr is not None:
+                _part_added()
+                op = CopyOp(
+                    src=buf,
+                    dst=dst_addr + (first_pid - start_pid) * page_bytes,
+                    bytes=size,
+                    stream_id=stream_id,
+                    gpu_id=gpu_id,
+                    deadline_ms=deadline_ms,
                 )
+                self._route(int(eng.submit([op], self._on_complete)), [(info, _part_done)])
+        _part_done()
+        return nbytes
+
+    def execute_columnar(
+        self,
+        plan_df: pd.DataFrame,
+        model_id: str,
+        model_version: str,
+        dst_ptr: Any,
+        on_ready: Optional[Callable[[Dict[str, Any]], None]] = None,
+        tier_inflight_bytes: Optional[Dict[int, int]] = None,
+        defer_completions: bool = False,
+    ) -> Dict[str, Any]:
+        """Execute a plan window with one pre-resolved device address per row.
+
+        Engines with `execute_plan()` take the whole window as columns: the engine's plan
+        thread reads each row's file extent (io_uring when built with it) into pinned
+        memory and issues its H2D copy split across `overlap` streams, while at most
+        tier_inflight_bytes[tier] bytes are staged per `tier_dst`. Python only submits the
+        window and consumes one completion per row. Encoded backends, rows that are not
+        one extent of a segment file, and engines without `execute_plan()` go through
+        `execute()` with the same destinations. With a PeerTier, tier_src == PEER rows are
+        served through it first (as in `execute()`) and the rest go to the engine.
+        """
+        self.issued_op_ids = []
+        if plan_df.empty:
+            return {"ops": 0, "bytes": 0, "duration_ms": 0.0}
+        dst = np.asarray(dst_ptr, dtype=np.uint64)
+        if len(dst) != len(plan_df):
+            raise ValueError(f"dst_ptr has {len(dst)} entries for {len(plan_df)} plan rows")
+        t0 = time.time()
+        layer = plan_df["layer"].to_numpy(dtype=np.int64)
+        layer_end = plan_df["layer_end"].to_numpy(dtype=np.int64) if "layer_end" in plan_df.columns else layer
+        start_pid = plan_df["start_pid"].to_numpy(dtype=np.int64)
+        end_pid = plan_df["end_pid"].to_numpy(dtype=np.int64)
+        page_bytes = (
+            plan_df["page_bytes"].to_numpy(dtype=np.int64)
+            if "page_bytes" in plan_df.columns
+            else np.full(len(plan_df), self.page_bytes, dtype=np.int64)
+        )
+        nbytes = np.where(end_pid >= start_pid, (end_pid - start_pid + 1) * page_bytes * (layer_end - layer + 1), 0)
+        eng = self.copy_engine
+        extents = None
+        if callable(getattr(eng, "execute_plan", None)) and getattr(self.backend, "codec", "none") == "none":
+            extents = self._plan_extents(model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes)
+        if extents is None:
+            return self.execute(
+                plan_df, model_id, model_version, on_ready=on_ready,
+                dest_resolver=lambda info: int(dst[info["row"]]), defer_completions=defer_completions,
+            )
+        files, file_index, offsets = extents
+        rows = np.arange(len(plan_df))
+        peer_ops = peer_bytes = 0
+        if self.peer is not None and "tier_src" in plan_df.columns:
+            served, peer_bytes = self._execute_peer(
+                plan_df, model_id, model_version, on_ready, lambda info: int(dst[info["row"]])
+            )
+            peer_ops = int(served.sum())
+            if peer_ops:
+                keep = ~served
+                plan_df, rows, dst, file_index, offsets = (
+                    plan_df[keep], rows[keep], dst[keep], file_index[keep], offsets[keep]
+                )
+                layer, layer_end, start_pid, end_pid, nbytes = (
+                    layer[keep], layer_end[keep], start_pid[keep], end_pid[keep], nbytes[keep]
+                )
+                if plan_df.empty:
+                    dt = (time.time() - t0) * 1000.0
+                    return {"ops": peer_ops, "bytes": int(peer_bytes), "duration_ms": float(dt)}
+
+        def column(name: str, default: int, dtype) -> np.ndarray:
+            if name in plan_df.columns:
+                return plan_df[name].fillna(default).to_numpy(dtype=dtype)
+            return np.full(len(plan_df), default, dtype=dtype)
+
+        prio_rank = (
+            plan_df["priority"].fillna(0.0).rank(method="dense").astype(np.int32).to_numpy() - 1
+            if "priority" in plan_df.columns
+            else None
+        )
+        infos: List[Dict[str, Any]] = []
+        nodes = plan_df["node"].tolist() if "node" in plan_df.columns else [""] * len(plan_df)
+        hints = plan_df["route_hint"].tolist() if "route_hint" in plan_df.columns else [None] * len(plan_df)
+        for i in range(len(plan_df)):
+            info = {
+                "node": nodes[i],
+                "layer": int(layer[i]),
+                "start_pid": int(start_pid[i]),
+                "end_pid": int(end_pid[i]),
+                "bytes": int(nbytes[i]),
+                "route_hint": hints[i],
+                "row": int(rows[i]),
+            }
+            if layer_end[i] != layer[i]:
+                info["layer_end"] = int(layer_end[i])
+            infos.append(info)
+        sizes = nbytes.astype(np.uint64)
+        overlap = np.maximum(column("overlap", 1, np.int32), 1)
+        gpu_id = column("gpu_id", 0, np.int32)
+        deadline_ms = column("deadline_ms", 0, np.int64)
+        tier = column("tier_dst", 0, np.int32)
+        caps = {int(k): int(v) for k, v in (tier_inflight_bytes or {}).items()}
+        self._submit_tagged(
+            lambda tag, cb: eng.execute_plan(
+                files, file_index, offsets, sizes, dst,
+                overlap=overlap, gpu_id=gpu_id, deadline_ms=deadline_ms, tag=tag,
+                priority=prio_rank, tier=tier, tier_inflight_bytes=caps, callback=cb,
+            ),
+            infos,
+            on_ready,
+            defer_completions,
+        )
         dt = (time.time() - t0) * 1000.0
-        return {"ops": int(len(plan_df)), "bytes": int(total_bytes), "duration_ms": float(dt)}
+        return {"ops": int(len(plan_df)) + peer_ops, "bytes": int(nbytes.sum()) + peer_bytes, "duration_ms": float(dt)}
+
+    def _plan_extents(
+        self, model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes
+    ) -> Optional[Tuple[List[str], np.ndarray, np.ndarray]]:
+        # Rows as (files, file_index, offsets) for execute_plan(), or None when a row is
+        # not one contiguous extent of a segment file.
+        n = len(layer)
+        offsets = np.empty(n, dtype=np.uint64)
+        extent = getattr(self.backend, "extent", None)
+        if callable(extent):
+            paths: List[str] = []
+            for i in range(n):
+                ext = extent(
+                    model_id, model_version, int(layer[i]), int(start_pid[i]), int(end_pid[i]), int(page_bytes[i]),
+                    layer_end=int(layer_end[i]),
+                )
+                if ext is None:
+                    return None
+                paths.append(str(ext[0]))
+                offsets[i] = int(ext[1])
+            files, file_index = np.unique(np.array(paths, dtype=object), return_inverse=True)
+            return [str(f) for f in files], file_index.astype(np.int32), offsets
+        if (layer_end != layer).any() or not callable(getattr(self.backend, "segment_path", None)):
+            return None
+        layers, file_index = np.unique(layer, return_inverse=True)
+        files = [str(self.backend.segment_path(model_id, model_version, int(l))) for l in layers]
+        offsets[:] = (start_pid * page_bytes).astype(np.uint64)
+        return files, file_index.astype(np.int32), offsets
+
+    def _device_codec(self) -> int:
+        # PageCodec for submit_array() when the engine decodes the backend's codec, else 0
+        codec = getattr(self.backend, "codec", "none")
+        decode_codecs = getattr(self.copy_engine, "decode_codecs", None)
+        if codec == "none" or not callable(decode_codecs) or not callable(getattr(self.copy_engine, "submit_array", None)):
+            return 0
+        if codec not in decode_codecs():
+            return 0
+        return page_codec.codec_id(codec, getattr(self.backend, "kv_dtype", "float16"))
+
+    def _file_extent(
+        self,
+        model_id: str,
+        model_version: str,
+        layer: int,
+        layer_end: int,
+        start_pid: int,
+        end_pid: int,
+        page_bytes: int,
+    ) -> Optional[Tuple[str, int]]:
+        # (path, offset) for engines that read the segment file themselves, or None when the
+        # row is not one contiguous extent of its file.
+        extent = getattr(self.backend, "extent", None)
+        if callable(extent):
+            ext = extent(model_id, model_version, layer, start_pid, end_pid, page_bytes, layer_end=layer_end)
+            return (str(ext[0]), int(ext[1])) if ext is not None else None
+        if layer_end != layer or not callable(getattr(self.backend, "segment_path", None)):
+            return None
+        return str(self.backend.segment_path(model_id, model_version, layer)), start_pid * page_bytes
+
+    def _read_block_into(self, model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes, out_buf) -> None:
+        read_block_into = getattr(self.backend, "read_block_into", None)
+        if not callable(read_block_into):
+            raise ValueError(f"backend cannot read multi-layer rows (layers {layer}-{layer_end}); use PackedSegmentBackend")
+        read_block_into(model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes, out_buf)
+
+    def _read_block(self, model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes) -> bytes:
+        read_block = getattr(self.backend, "read_block", None)
+        if not callable(read_block):
+            raise ValueError(f"backend cannot read multi-layer rows (layers {layer}-{layer_end}); use PackedSegmentBackend")
+        return read_block(model_id, model_version, layer, layer_end, start_pid, end_pid, page_bytes)
+
+    def _acquire(self, nbytes: int, gpu_id: int) -> Any:
+        # Pinned memory on the NUMA node of the row's GPU (multi-GPU engines), or None
+        acquire = getattr(self.copy_engine, "acquire_host_buffer", None)
+        if not callable(acquire):
+            return None
+        try:
+            return acquire(nbytes, gpu_id=gpu_id)
+        except Exception:
+            return None
+
+    def _buffer_address(self, buf: Any) -> int:
+        buffer_address = getattr(self.copy_engine, "buffer_address", None)
+        if callable(buffer_address):
+            return int(buffer_address(buf))
+        return int(np.frombuffer(buf, dtype=np.uint8).ctypes.data)
+
+    def _can_scatter(self) -> bool:
+        eng = self.copy_engine
+        return callable(getattr(eng, "submit_scatter", None)) or callable(getattr(eng, "submit_array", None))
+
+    @staticmethod
+    def _scatter_segments(dst: Any, nbytes: int, page_bytes: int) -> Optional[List[Tuple[int, int, int]]]:
+        # A dest_resolver may return one destination per page (page-major across layers for
+        # merged rows), e.g. the vLLM blocks the pages map to. Returns (dst, src_offset, bytes)
+        # segments with adjacent blocks merged, or None for a single contiguous destination.
+        if not isinstance(dst, (list, tuple, np.ndarray)):
+            return None
+        addrs = [ptr_to_int(d) for d in dst]
+        if len(addrs) * page_bytes != nbytes:
+            raise ValueError(f"dest_resolver returned {len(addrs)} destinations for {nbytes // max(page_bytes, 1)} pages")
+        if any(not a for a in addrs):
+            raise ValueError("per-page destinations must be non-null device addresses")
+        segs: List[Tuple[int, int, int]] = []
+        for k, addr in enumerate(addrs):
+            if segs and segs[-1][0] + segs[-1][2] == addr:
+                segs[-1] = (segs[-1][0], segs[-1][1], segs[-1][2] + page_bytes)
+            else:
+                segs.append((addr, k * page_bytes, page_bytes))
+        return segs
+
+    def _submit_scatter(
+        self,
+        rows: List[Tuple[int, List[Tuple[int, int, int]], CopyOp, Dict[str, Any], Any]],
+        on_ready: Optional[Callable[[Dict[str, Any]], None]],
+        defer_completions: bool,
+    ) -> None:
+        eng = self.copy_engine
+        submit = getattr(eng, "submit_scatter", None)
+        if not callable(submit):
+            # One op per segment; a row is ready once all of them have landed. Each op
+            # holds the row's pool buffer, so it goes back after the last one finishes.
+            # Segments may complete on several engine threads, hence the lock.
+            for src_addr, segs, op, info, _ in rows:
+                left = [len(segs)]
+
+                def _row_done(_info: Dict[str, Any], _left=left, _mu=threading.Lock()) -> None:
+                    with _mu:
+                        _left[0] -= 1
+                        done = _left[0] == 0
+                    if done and on_ready is not None:
+                        on_ready(_info)
+
+                self._submit_addresses(
+                    np.array([src_addr + off for _, off, _ in segs], dtype=np.uint64),
+                    [(d, replace(op, bytes=b), info) for d, _, b in segs],
+                    _row_done,
+                    defer_completions,
+                )
+            return
+        src = np.array([row[0] for row in rows], dtype=np.uint64)
+        seg_index = np.zeros(len(rows) + 1, dtype=np.int64)
+        np.cumsum([len(row[1]) for row in rows], out=seg_index[1:])
+        seg_dst = np.array([d for row in rows for d, _, _ in row[1]], dtype=np.uint64)
+        seg_off = np.array([off for row in rows for _, off, _ in row[1]], dtype=np.uint64)
+        seg_bytes = np.array([b for row in rows for _, _, b in row[1]], dtype=np.uint64)
+        stream_id = np.array([row[2].stream_id for row in rows], dtype=np.int32)
+        gpu_id = np.array([row[2].gpu_id for row in rows], dtype=np.int32)
+        deadline_ms = np.array([row[2].deadline_ms for row in rows], dtype=np.int64)
+        priority = np.array([row[2].priority for row in rows], dtype=np.int32)
+        self._submit_tagged(
+            lambda tag, cb: submit(
+                src, seg_index, seg_dst, seg_off, seg_bytes, stream_id, gpu_id, deadline_ms, tag, cb, priority=priority
+            ),
+            [row[3] for row in rows],
+            on_ready,
+            defer_completions,
+        )
+
+    def _submit_batched(
+        self,
+        batched: List[Tuple[Any, int, CopyOp, Dict[str, Any], Optional[Tuple[int, int, int, int]]]],
+        model_id: str,
+        model_version: str,
+        on_ready: Optional[Callable[[Dict[str, Any]], None]],
+        defer_completions: bool,
+    ) -> None:
+        # Overlap every storage read of the window in one vectored call.
+        reads = [(b[4], b[0]) for b in batched if b[4] is not None]
+        if reads:
+            self.backend.read_batch(model_id, model_version, [r for r, _ in reads], [buf for _, buf in reads])
+
+        src = np.array([self._buffer_address(b[0]) for b in batched], dtype=np.uint64)
+        self._submit_addresses(src, [(b[1], b[2], b[3]) for b in batched], on_ready, defer_completions)
+
+    def _submit_addresses(
+        self,
+        src: np.ndarray,
+        rows: List[Tuple[int, CopyOp, Dict[str, Any]]],
+        on_ready: Optional[Callable[[Dict[str, Any]], None]],
+        defer_completions: bool,
+    ) -> None:
+        # One columnar submit_array() call for host sources given as raw addresses.
+        eng = self.copy_engine
+        n = len(rows)
+        dst = np.empty(n, dtype=np.uint64)
+        nbytes = np.empty(n, dtype=np.uint64)
+        stream_id = np.empty(n, dtype=np.int32)
+        gpu_id = np.empty(n, dtype=np.int32)
+        deadline_ms = np.empty(n, dtype=np.int64)
+        priority = np.empty(n, dtype=np.int32)
+        for i, (dst_addr, op, _info) in enumerate(rows):
+            dst[i] = dst_addr
+            nbytes[i] = op.bytes
+            stream_id[i] = op.stream_id
+            gpu_id[i] = op.gpu_id
+            deadline_ms[i] = op.deadline_ms
+            priority[i] = op.priority
+        # Encoded ops add the decode columns; plain windows keep the engine's base signature
+        extra: Dict[str, Any] = {}
+        if any(op.codec for _, op, _ in rows):
+            extra["codec"] = np.array([op.codec for _, op, _ in rows], dtype=np.int32)
+            extra["decoded_bytes"] = np.array([op.decoded_bytes for _, op, _ in rows], dtype=np.uint64)
+        self._submit_tagged(
+            lambda tag, cb: eng.submit_array(
+                src, dst, nbytes, stream_id, gpu_id, deadline_ms, tag, cb, priority=priority, **extra
+            ),
+            [r[2] for r in rows],
+            on_ready,
+            defer_completions,
+        )
+
+    def _submit_from_files(
+        self,
+        submit: Callable[..., int],
+        streamed: List[Tuple[int, CopyOp, Dict[str, Any], Tuple[str, int]]],
+        model_id: str,
+        model_version: str,
+        on_ready: Optional[Callable[[Dict[str, Any]], None]],
+        defer_completions: bool,
+    ) -> None:
+        paths = [ext[0] for _, _, _, ext in streamed]
+        offsets = np.array([ext[1] for _, _, _, ext in streamed], dtype=np.uint64)
+        sizes = np.array([op.bytes for _, op, _, _ in streamed], dtype=np.uint64)
+        dst = np.array([addr for addr, _, _, _ in streamed], dtype=np.uint64)
+        stream_id = np.array([op.stream_id for _, op, _, _ in streamed], dtype=np.int32)
+        gpu_id = np.array([op.gpu_id for _, op, _, _ in streamed], dtype=np.int32)
+        deadline_ms = np.array([op.deadline_ms for _, op, _, _ in streamed], dtype=np.int64)
+        self._submit_tagged(
+            lambda tag, cb: submit(paths, offsets, sizes, dst, stream_id, gpu_id, deadline_ms, tag, callback=cb),
+            [info for _, _, info, _ in streamed],
+            on_ready,
+            defer_completions,
+        )
+
+    def _submit_tagged(
+        self,
+        submit: Callable[[Any, Any], int],
+        infos: List[Dict[str, Any]],
+        on_ready: Optional[Callable[[Dict[str, Any]], None]],
+        defer_completions: bool,
+    ) -> None:
+        # Row index as tag (echoed in the records); completions are routed by op_id, since
+        # tags repeat across calls whose ops are in flight together.
+        tag = np.arange(len(infos), dtype=np.uint64)
+        if defer_completions and callable(getattr(self.copy_engine, "poll", None)):
+            first = int(submit(tag, None))
+            for i, info in enumerate(infos):
+                self._deferred[first + i] = (info, on_ready)
+            self.issued_op_ids.extend(range(first, first + len(infos)))
+            return
+
+        first = int(submit(tag, self._on_complete))
+        self._route(first, [(info, on_ready) for info in infos])
+
+    def _route(
+        self, first_op_id: int, handlers: List[Tuple[Dict[str, Any], Optional[Callable[[Dict[str, Any]], None]]]],
+    ) -> None:
+        # Register the (info, on_ready) of ops first_op_id.. of a callback submission; fires
+        # the ones whose completion already arrived.
+        early = []
+        with self._routes_mu:
+            for i, handler in enumerate(handlers):
+                op_id = first_op_id + i
+                self.issued_op_ids.append(op_id)
+                if self._early.pop(op_id, None) is not None:
+                    early.append(handler)
+                else:
+                    self._routes[op_id] = handler
+        for info, on_ready in early:
+            if on_ready is not None:
+                on_ready(dict(info))
+
+    def _on_complete(self, rec: Any) -> None:
+        # The one op callback this agent gives its engine (completion record dicts)
+        op_id = int(rec["op_id"])
+        with self._routes_mu:
+            entry = self._routes.pop(op_id, None)
+            if entry is None:
+                entry = self._deferred.pop(op_id, None)
+            if entry is None:
+                self._early[op_id] = rec
+                return
+        info, on_ready = entry
+        if on_ready is not None:
+            on_ready(dict(info))
+
+    def peer_device_sender(
+        self, src_resolver: Callable[[Dict[str, Any]], Any], gpu_id: int = 0, stream_id: int = 0,
+    ) -> Callable[[str, str, int, int, int, int, int], bool]:
+        """DeviceSender for this node's PeerPageServer (device_sender=): posts a requested
+        run that sits in this node's GPU memory as an engine peer send (`submit_peer()`,
+        NCCL) to the asking rank, so the requester's receive lands device to device.
+
+        src_resolver maps the run's info (model_id, model_version, layer, start_pid,
+        end_pid, bytes) to its device address, or None when it is not resident here (the
+        request is then a miss). Sends complete through this agent's engine callback, so
+        they share the engine with its copies.
+        """
+
+        def send(model_id: str, model_version: str, layer: int, start_pid: int, end_pid: int, page_bytes: int,
+                 rank: int) -> bool:
+            eng = self.copy_engine
+            if not callable(getattr(eng, "submit_peer", None)) or end_pid < start_pid:
+                return False
+            info = {
+                "model_id": model_id,
+                "model_version": model_version,
+                "layer": int(layer),
+                "start_pid": int(start_pid),
+                "end_pid": int(end_pid),
+                "bytes": (int(end_pid) - int(start_pid) + 1) * int(page_bytes),
+            }
+            src = src_resolver(dict(info))
+            addr = ptr_to_int(src) if src is not None else 0
+            if not addr:
+                return False
+            op_id = int(eng.submit_peer(
+                [addr], [info["bytes"]], [int(rank)], send=[1], stream_id=stream_id, gpu_id=gpu_id,
+                callback=self._on_complete,
+            ))
+            # Not one of this agent's copies: routed, but kept out of issued_op_ids
+            with self._routes_mu:
+                if self._early.pop(op_id, None) is None:
+                    self._routes[op_id] = (info, None)
+            return True
+
+        return send
+
+    def evict(
+        self,
+        evict_df: pd.DataFrame,
+        model_id: str,
+        model_version: str,
+        src_resolver: Callable[[Dict[str, Any]], Any],
+        on_done: Optional[Callable[[Dict[str, Any]], None]] = None,
+        defer_completions: bool = False,
+    ) -> Dict[str, Any]:
+        """Demote device-resident page ranges to their segment files.
+
+        Rows carry layer/start_pid/end_pid (optionally page_bytes, gpu_id, stream_id);
+        src_resolver maps a row's info to the device address holding its pages. The engine's
+        writeback stage (`submit_writeback()`) copies each range D2H into pinned memory and
+        writes it into the layer's segment at start_pid * page_bytes, so on_done fires once
+        the pages are on storage and the device memory may be reused. Encoded backends
+        (a codec other than "none") are rejected: writeback stores raw device pages.
+        """
+        submit = getattr(self.copy_engine, "submit_writeback", None)
+        self.issued_op_ids = []
+        if evict_df.empty:
+            return {"ops": 0, "bytes": 0, "duration_ms": 0.0}
+        if not callable(submit):
+            raise RuntimeError("copy engine has no writeback stage (submit_writeback)")
+        t0 = time.time()
+        paths: List[str] = []
+        src: List[int] = []
+        sizes: List[int] = []
+        offsets: List[int] = []
+        stream_id: List[int] = []
+        gpu_id: List[int] = []
+        infos: List[Dict[str, Any]] = []
+        for r in evict_df.itertuples(index=False):
+            layer = int(r.layer)
+            start_pid = int(r.start_pid)
+            end_pid = int(r.end_pid)
+            page_bytes = int(getattr(r, "page_bytes", self.page_bytes))
+            nbytes = (end_pid - start_pid + 1) * page_bytes if end_pid >= start_pid else 0
+            if nbytes == 0:
+                continue
+            info = {
+                "node": getattr(r, "node", ""),
+                "layer": layer,
+                "start_pid": start_pid,
+                "end_pid": end_pid,
+                "bytes": nbytes,
+            }
+            addr = ptr_to_int(src_resolver(info))
+            if not addr:
+                raise ValueError(f"src_resolver returned no device address for layer {layer} pages {start_pid}-{end_pid}")
+            stored_page_bytes = getattr(self.backend, "stored_page_bytes", None)
+            if callable(stored_page_bytes) and stored_page_bytes(page_bytes) != page_bytes:
+                raise ValueError(
+                    f"cannot evict into an encoded segment ({getattr(self.backend, 'codec', '?')}): "
+                    "writeback would store raw pages"
+                )
+            self.backend.ensure_segment(model_id, model_version, layer)
+            ext = self._file_extent(model_id, model_version, layer, layer, start_pid, end_pid, page_bytes)
+            if ext is None:
+                raise ValueError(f"backend has no contiguous extent for layer {layer} pages {start_pid}-{end_pid}")
+            paths.append(ext[0])
+            src.append(addr)
+            sizes.append(nbytes)
+            offsets.append(ext[1])
+            stream_id.append(int(getattr(r, "stream_id", 0)))
+            gpu_id.append(int(getattr(r, "gpu_id", 0)))
+            infos.append(info)
+        if infos:
+            src_a = np.array(src, dtype=np.uint64)
+            sizes_a = np.array(sizes, dtype=np.uint64)
+            offsets_a = np.array(offsets, dtype=np.uint64)
+            stream_a = np.array(stream_id, dtype=np.int32)
+            gpu_a = np.array(gpu_id, dtype=np.int32)
+            self._submit_tagged(
+                lambda tag, cb: submit(
+                    src_a, sizes_a, paths, offsets_a, stream_a, gpu_a, tag=tag, callback=cb
+                ),
+                infos,
+                on_done,
+                defer_completions,
+            )
+        return {"ops": len(infos), "bytes": int(sum(sizes)), "duration_ms": (time.time() - t0) * 1000.0}
+
+    def pending_completions(self) -> int:
+        """Number of deferred copies whose completion has not been delivered yet."""
+        return len(self._deferred)
+
+    def poll_completions(self, max_records: int = 0) -> int:
+        """Deliver on_ready for deferred copies the engine has finished. Non-blocking.
+
+        Returns the number of callbacks fired.
+        """
+        poll = getattr(self.copy_engine, "poll", None)
+        if not (self._deferred or self._routes) or not callable(poll):
+            return 0
+        return self._dispatch_completions(poll(max_records))
+
+    def drain_completions(self, timeout_ms: int = -1) -> int:
+        """Wait for all deferred copies (up to timeout_ms; negative waits forever) and deliver them."""
+        drain = getattr(self.copy_engine, "drain", None)
+        if not self._deferred or not callable(drain):
+            return self.poll_completions()
+        return self._dispatch_completions(drain(timeout_ms))
+
+    def _dispatch_completions(self, records: Iterable[Any]) -> int:
+        fired = 0
+        for rec in records:
+            op_id = int(rec["op_id"])
+            # A callback op can land in the poll ring when a later deferred submit cleared
+            # the engine's op callback while it was in flight
+            with self._routes_mu:
+                entry = self._deferred.pop(op_id, None)
+                if entry is None:
+                    entry = self._routes.pop(op_id, None)
+            if entry is None:
+                continue
+            info, on_ready = entry
+            fired += 1
+            if on_ready is not None:
+                on_ready(info)
+        return fired
 
     def prefetch_wave(
         self,
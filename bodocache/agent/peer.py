@@ -0,0 +1,319 @@
+from __future__ import annotations
+
+import hmac
+import json
+import socket
+import socketserver
+import struct
+import threading
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+import numpy as np
+
+from bodocache.planner.models import Tier
+from bodocache.planner.page_table import CompactPageTable
+
+# Peer page transport: NodeAgents pull tier_src == PEER ops (planner/peer.py) from the
+# node that holds the pages instead of reading them from storage.
+#
+# Every node runs a PeerPageServer over its resident pages; a PeerClient keeps one
+# persistent TCP connection per peer with one request in flight on it:
+#   request  <4sI>   magic b"BCPP", meta length, then meta JSON
+#            {"model_id", "model_version", "layer", "page_start", "page_end", "page_bytes", "rank"?}
+#   reply    <4sIQ>  magic, status (STATUS_*), body length, then the page bytes
+# Page bytes are received straight into the caller's buffer (a pinned buffer from the
+# copy engine), so the H2D copy starts from registered memory with no extra staging.
+#
+# With "rank" set the server does not reply with bytes: its device_sender (built by
+# NodeAgent.peer_device_sender) posts an engine-to-engine send of the run (submit_peer,
+# NCCL) to that rank and the reply only
+# acknowledges it; the client then posts the matching receive into device memory. A
+# pair's sends and receives are posted in request order, which is what NCCL needs.
+#
+# Trust model: the protocol has no tenant isolation, so anyone who can connect can read
+# every page the source serves. Servers bind loopback unless given an address; bind the
+# cluster's private interface explicitly, and set a shared token on every node's server
+# and client (sent in meta, compared in constant time) when that network is not trusted
+# by itself. Requests whose meta exceeds MAX_META_BYTES drop the connection.
+MAGIC = b"BCPP"
+STATUS_OK = 0
+STATUS_MISS = 1
+STATUS_ERROR = 2
+MAX_META_BYTES = 64 * 1024
+_REQUEST = struct.Struct("<4sI")
+_REPLY = struct.Struct("<4sIQ")
+
+# (model_id, model_version, layer, page_start, page_end, page_bytes) -> page bytes or None
+PageSource = Callable[[str, str, int, int, int, int], Any]
+# (model_id, model_version, layer, page_start, page_end, page_bytes, rank) -> send posted
+DeviceSender = Callable[[str, str, int, int, int, int, int], bool]
+
+
+def _recv_into(sock: socket.socket, view: memoryview) -> bool:
+    got = 0
+    while got < view.nbytes:
+        k = sock.recv_into(view[got:], view.nbytes - got)
+        if k == 0:
+            if got == 0:
+                return False
+            raise ConnectionError("connection closed mid-message")
+        got += k
+    return True
+
+
+def _split_address(address: str) -> Tuple[str, int]:
+    host, _, port = address.rpartition(":")
+    return host or "127.0.0.1", int(port)
+
+
+def backend_page_source(backend: Any) -> PageSource:
+    """PageSource over a local segment backend, e.g. one in mmap mode whose segments sit
+    in this node's page cache. Ranges the backend does not have are misses."""
+
+    def source(model_id: str, model_version: str, layer: int, start_pid: int, end_pid: int, page_bytes: int):
+        try:
+            return backend.read_range(model_id, model_version, layer, start_pid, end_pid, page_bytes)
+        except (OSError, ValueError):
+            return None
+
+    return source
+
+
+class _PeerHandler(socketserver.BaseRequestHandler):
+    def handle(self) -> None:
+        sock: socket.socket = self.request
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        owner: PeerPageServer = self.server.owner  # type: ignore[attr-defined]
+        head = bytearray(_REQUEST.size)
+        while _recv_into(sock, memoryview(head)):
+            magic, meta_len = _REQUEST.unpack(head)
+            if magic != MAGIC or meta_len > MAX_META_BYTES:
+                return
+            raw = bytearray(meta_len)
+            _recv_into(sock, memoryview(raw))
+            try:
+                status, body = owner.serve(json.loads(bytes(raw).decode("utf-8")))
+            except Exception:
+                status, body = STATUS_ERROR, b""
+            view = memoryview(body).cast("B")
+            sock.sendall(_REPLY.pack(MAGIC, status, view.nbytes))
+            if view.nbytes:
+                sock.sendall(view)
+
+
+class _ThreadingPeerServer(socketserver.ThreadingMixIn, socketserver.TCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+
+class PeerPageServer:
+    """Serves this node's resident pages to other nodes' PeerClients.
+
+    source returns the bytes of a page run (or None when this node no longer has it);
+    device_sender, when given, posts engine-to-engine sends for the device path (see
+    NodeAgent.peer_device_sender). The
+    default address is loopback; pass this node's cluster address to serve other nodes,
+    with a token the clients share when that network is not trusted.
+    """
+
+    def __init__(
+        self,
+        source: PageSource,
+        address: str = "127.0.0.1:0",
+        device_sender: Optional[DeviceSender] = None,
+        token: Optional[str] = None,
+    ):
+        self.source = source
+        self.device_sender = device_sender
+        self.token = token
+        self._server = _ThreadingPeerServer(_split_address(address), _PeerHandler)
+        self._server.owner = self  # type: ignore[attr-defined]
+        self._thread: Optional[threading.Thread] = None
+
+    @property
+    def address(self) -> str:
+        host, port = self._server.server_address[:2]
+        return f"{host}:{port}"
+
+    def serve(self, meta: Dict[str, Any]) -> Tuple[int, Any]:
+        if self.token is not None and not hmac.compare_digest(str(meta.get("token", "")), self.token):
+            return STATUS_ERROR, b""
+        args = (
+            str(meta["model_id"]), str(meta["model_version"]), int(meta["layer"]),
+            int(meta["page_start"]), int(meta["page_end"]), int(meta["page_bytes"]),
+        )
+        if "rank" in meta:
+            if self.device_sender is None:
+                return STATUS_MISS, b""
+            return (STATUS_OK if self.device_sender(*args, int(meta["rank"])) else STATUS_MISS), b""
+        data = self.source(*args)
+        expected = (args[4] - args[3] + 1) * args[5]
+        if data is None or memoryview(data).nbytes != expected:
+            return STATUS_MISS, b""
+        return STATUS_OK, data
+
+    def start(self) -> "PeerPageServer":
+        self._thread = threading.Thread(target=self._server.serve_forever, name="bodocache-peer", daemon=True)
+        self._thread.start()
+        return self
+
+    def close(self) -> None:
+        if self._thread is not None:
+            self._server.shutdown()
+            self._thread.join()
+            self._thread = None
+        self._server.server_close()
+
+    def __enter__(self) -> "PeerPageServer":
+        return self.start()
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+
+class PeerClient:
+    """Fetches page runs from other nodes' PeerPageServers (node -> "host:port").
+
+    Failures (unknown node, refused connection, miss, timeout) return False and drop the
+    connection; callers fall back to storage. token must match the servers' token.
+    """
+
+    def __init__(self, addresses: Dict[str, str], timeout: Optional[float] = 5.0, token: Optional[str] = None):
+        self.addresses = dict(addresses)
+        self.timeout = timeout
+        self.token = token
+        self._conns: Dict[str, socket.socket] = {}
+        self._locks: Dict[str, threading.Lock] = {}
+        self._mu = threading.Lock()
+
+    def _lock(self, node: str) -> threading.Lock:
+        with self._mu:
+            return self._locks.setdefault(node, threading.Lock())
+
+    def _call(self, node: str, meta: Dict[str, Any], out: Optional[memoryview]) -> bool:
+        address = self.addresses.get(node)
+        if address is None:
+            return False
+        with self._lock(node):
+            try:
+                sock = self._conns.get(node)
+                if sock is None:
+                    sock = socket.create_connection(_split_address(address), timeout=self.timeout)
+                    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                    self._conns[node] = sock
+                if self.token is not None:
+                    meta = dict(meta, token=self.token)
+                raw = json.dumps(meta).encode("utf-8")
+                sock.sendall(_REQUEST.pack(MAGIC, len(raw)) + raw)
+                head = bytearray(_REPLY.size)
+                if not _recv_into(sock, memoryview(head)):
+                    raise ConnectionError("peer closed the connection")
+                magic, status, n = _REPLY.unpack(head)
+                if magic != MAGIC or (n and (out is None or n != out.nbytes)):
+                    raise ConnectionError("malformed peer reply")
+                if n and not _recv_into(sock, out):
+                    raise ConnectionError("peer closed the connection")
+                return status == STATUS_OK
+            except (OSError, ValueError):
+                self._drop(node)
+                return False
+
+    def _drop(self, node: str) -> None:
+        sock = self._conns.pop(node, None)
+        if sock is not None:
+            try:
+                sock.close()
+            except OSError:
+                pass
+
+    def fetch_into(
+        self, node: str, model_id: str, model_version: str, layer: int, start_pid: int, end_pid: int,
+        page_bytes: int, out: Any,
+    ) -> bool:
+        """Read pages [start_pid, end_pid] of `layer` from node into out (a writable buffer
+        of exactly that size)."""
+        view = memoryview(out).cast("B")
+        if view.nbytes != (end_pid - start_pid + 1) * page_bytes:
+            raise ValueError("out must hold exactly the requested pages")
+        meta = {"model_id": model_id, "model_version": model_version, "layer": int(layer),
+                "page_start": int(start_pid), "page_end": int(end_pid), "page_bytes": int(page_bytes)}
+        return self._call(node, meta, view)
+
+    def request_device_send(
+        self, node: str, model_id: str, model_version: str, layer: int, start_pid: int, end_pid: int,
+        page_bytes: int, rank: int,
+    ) -> bool:
+        """Ask node to post an engine peer send of the run to `rank`; True once it has."""
+        meta = {"model_id": model_id, "model_version": model_version, "layer": int(layer),
+                "page_start": int(start_pid), "page_end": int(end_pid), "page_bytes": int(page_bytes),
+                "rank": int(rank)}
+        return self._call(node, meta, None)
+
+    def close(self) -> None:
+        for node in list(self._conns):
+            with self._lock(node):
+                self._drop(node)
+
+    def __enter__(self) -> "PeerClient":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+
+class PeerTier:
+    """What NodeAgent needs to execute peer-tier ops: the page table that says which node
+    holds each page, the client that pulls from it, and this node's name.
+
+    ranks maps nodes to ranks of the copy engines' peer communicator (peer_init). With it,
+    runs a peer holds in GPU memory go engine-to-engine via submit_peer when the local
+    engine has it; everything else arrives over TCP in pinned host memory.
+    """
+
+    def __init__(
+        self,
+        page_table: CompactPageTable,
+        client: PeerClient,
+        node: str,
+        ranks: Optional[Dict[str, int]] = None,
+        stream_id: int = 0,
+    ):
+        self.page_table = page_table
+        self.client = client
+        self.node = node
+        self.ranks = dict(ranks or {})
+        self.stream_id = int(stream_id)
+        self.counters = {"ops": 0, "bytes": 0, "device_runs": 0, "storage_runs": 0, "fallback_ops": 0}
+
+    @property
+    def rank(self) -> Optional[int]:
+        return self.ranks.get(self.node)
+
+    def runs(
+        self, model_id: str, model_version: str, layer: int, start_pid: int, end_pid: int,
+    ) -> Optional[List[Tuple[int, int, str, int]]]:
+        """(start_pid, end_pid, holder node, holder tier) runs covering the pages, or None
+        when a page has no remote holder any more (the op then goes to storage)."""
+        pid = np.arange(start_pid, end_pid + 1, dtype=np.int64)
+        held = self.page_table.remote_holders(model_id, model_version, np.full(len(pid), layer), pid)
+        node = held["node"]
+        if not len(pid) or (node < 0).any() or (node == self.page_table.node_codes([self.node])[0]).any():
+            return None
+        breaks = np.flatnonzero((np.diff(node) != 0) | (np.diff(held["tier"]) != 0)) + 1
+        first = np.concatenate(([0], breaks))
+        last = np.concatenate((breaks - 1, [len(pid) - 1]))
+        return [
+            (int(pid[f]), int(pid[e]), self.page_table.node_name(int(node[f])), int(held["tier"][f]))
+            for f, e in zip(first, last)
+        ]
+
+    def device_capable(self, engine: Any, holder: str, holder_tier: int) -> bool:
+        return (
+            holder_tier == Tier.GPU.value
+            and self.rank is not None
+            and holder in self.ranks
+            and callable(getattr(engine, "submit_peer", None))
+        )
+
+    def stats(self) -> Dict[str, int]:
+        return dict(self.counters)
@@ -1,8 +1,17 @@
 from __future__ import annotations
 
+import heapq
+import os
+from typing import Any, Dict, List, Sequence
+
 import numpy as np
 import pandas as pd
 
+try:
+    import bodocache_stream_sim as _stream_sim  # type: ignore
+except Exception:  # pragma: no cover - optional native module
+    _stream_sim = None
+
 
 def simulate_plan(plan_df: pd.DataFrame, tier_caps_df: pd.DataFrame, window_ms: int = 20) -> pd.DataFrame:
     """Simulate execution of a plan per (node,tier_dst) using simple bandwidth models.
@@ -46,6 +55,137 @@ def summarize_metrics(exec_df: pd.DataFrame) -> dict:
     }
 
 
+def _stream_finish_py(bytes_, overlap, group_offsets, group_bw, case_groups, streams, use_overlap, window_ms):
+    # Same heap and arithmetic as native/stream_sim.cpp
+    finish = np.empty(len(bytes_), dtype=np.float64)
+    b, ov = bytes_.tolist(), overlap.tolist()
+    for k in range(len(case_groups) - 1):
+        n_streams = int(streams[k])
+        wms = float(window_ms[k])
+        for g in range(int(case_groups[k]), int(case_groups[k + 1])):
+            bw_per = float(group_bw[g]) / max(1, n_streams)
+            bw_per = max(1.0, bw_per)
+            heap = [(0.0, s) for s in range(max(1, n_streams))]
+            for i in range(int(group_offsets[g]), int(group_offsets[g + 1])):
+                eff = max(1, min(int(ov[i]) if use_overlap[k] else 1, n_streams))
+                t, s = heap[0]
+                t = t + (b[i] / float(eff) / bw_per) * wms
+                heapq.heapreplace(heap, (t, s))
+                finish[i] = t
+    return finish
+
+
+def _prepare_streams(plan_df: pd.DataFrame, tier_caps_df: pd.DataFrame) -> Dict[str, Any]:
+    # Plan sorted by (node, tier_dst, priority desc) with its (node, tier_dst) group boundaries
+    df = plan_df.copy()
+    caps = tier_caps_df[["tier", "bandwidth_caps"]].rename(columns={"tier": "tier_dst"})
+    df = df.merge(caps, on="tier_dst", how="left")
+    df = df.sort_values(by=["node", "tier_dst", "priority"], ascending=[True, True, False]).reset_index(drop=True)
+    node, tier = df["node"].to_numpy(), df["tier_dst"].to_numpy()
+    starts = (np.flatnonzero(np.r_[True, (node[1:] != node[:-1]) | (tier[1:] != tier[:-1])])
+              if len(df) else np.zeros(0, dtype=np.int64))
+    return {
+        "df": df,
+        "group_offsets": np.r_[starts, len(df)].astype(np.int64),
+        "group_bw": df["bandwidth_caps"].to_numpy(dtype=np.float64, na_value=np.nan)[starts],
+        "bytes": df["bytes"].to_numpy(dtype=np.float64),
+        "overlap": (df["overlap"].to_numpy(dtype=np.int64) if "overlap" in df.columns
+                    else np.ones(len(df), dtype=np.int64)),
+    }
+
+
+def _stream_results(prep: Dict[str, Any], finish: np.ndarray, layer_lat_df: pd.DataFrame | None) -> pd.DataFrame:
+    df = prep["df"]
+    n = len(df)
+    # Required time: from base window start to compute arrival for the op's layer
+    if layer_lat_df is not None and len(layer_lat_df) > 0:
+        lat = layer_lat_df.sort_values("layer")
+        cum = pd.Series(lat["lat_ms"].astype(float).cumsum().to_numpy(), index=lat["layer"].astype(np.int64).to_numpy())
+        cum = cum[~cum.index.duplicated(keep="last")]
+        layer = df["layer"].to_numpy(dtype=np.int64) if "layer" in df.columns else np.zeros(n, dtype=np.int64)
+        pos = cum.index.get_indexer(layer)
+        cum = cum.to_numpy()
+        deadline = np.where(pos >= 0, cum[np.maximum(pos, 0)], 0.0)
+    else:
+        deadline = df["deadline_ms"].to_numpy(dtype=np.float64)
+    out = pd.DataFrame({
+        "node": df["node"].to_numpy(),
+        "tier_dst": df["tier_dst"].to_numpy(),
+        "pcluster": df["pcluster"].to_numpy() if "pcluster" in df.columns else np.full(n, -1),
+        "layer": df["layer"].to_numpy() if "layer" in df.columns else np.full(n, -1),
+        "priority": df["priority"].to_numpy(dtype=np.float64),
+        "deadline_ms": deadline,
+        "finish_ms": finish,
+        "bytes": prep["bytes"],
+    })
+    # On-time if finished before required compute arrival for that layer
+    out["on_time"] = (out["finish_ms"] <= out["deadline_ms"]).astype(np.int64)
+    out["deadline_rel_ms"] = out["deadline_ms"]
+    return out
+
+
+def _use_native_sim() -> bool:
+    return _stream_sim is not None and os.environ.get("BODOCACHE_PURE_PY", "0") != "1"
+
+
+def simulate_plan_streams_batch(
+    plans: pd.DataFrame | Sequence[pd.DataFrame],
+    tier_caps_df: pd.DataFrame,
+    settings: Sequence[Dict[str, Any]],
+    layer_lat_df: pd.DataFrame | None = None,
+    threads: int = 0,
+) -> List[pd.DataFrame]:
+    """simulate_plan_streams for many (plan, knob setting) cases in one call.
+
+    `plans` is one plan shared by every setting or one plan per setting; each setting may
+    set window_ms, streams_per_tier and use_overlap (simulate_plan_streams' defaults
+    otherwise). With the bodocache_stream_sim module the cases run as one columnar batch
+    across `threads` cores (0 = all) without the GIL; otherwise a heapq loop per group.
+    Returns one exec DataFrame per setting, each equal to simulate_plan_streams' output.
+    """
+    if isinstance(plans, pd.DataFrame):
+        plans = [plans] * len(settings)
+    if len(plans) != len(settings):
+        raise ValueError("need one plan per setting (or a single shared plan)")
+    preps: Dict[int, Dict[str, Any]] = {}
+    cases = []
+    for plan, st in zip(plans, settings):
+        if id(plan) not in preps:
+            preps[id(plan)] = _prepare_streams(plan, tier_caps_df) if not plan.empty else None
+        cases.append((preps[id(plan)], plan, st))
+    live = [(prep, st) for prep, _, st in cases if prep is not None]
+    finishes: List[np.ndarray] = []
+    if live:
+        group_sizes = [len(p["group_bw"]) for p, _ in live]
+        row_sizes = [len(p["bytes"]) for p, _ in live]
+        row_base = np.repeat(np.cumsum([0] + row_sizes[:-1]), group_sizes)
+        args = dict(
+            bytes_=np.concatenate([p["bytes"] for p, _ in live]),
+            overlap=np.concatenate([p["overlap"] for p, _ in live]),
+            group_offsets=np.r_[np.concatenate([p["group_offsets"][:-1] for p, _ in live]) + row_base,
+                                sum(row_sizes)].astype(np.int64),
+            group_bw=np.concatenate([p["group_bw"] for p, _ in live]),
+            case_groups=np.r_[0, np.cumsum(group_sizes)].astype(np.int64),
+            streams=np.array([int(st.get("streams_per_tier", 4)) for _, st in live], dtype=np.int64),
+            use_overlap=np.array([bool(st.get("use_overlap", True)) for _, st in live], dtype=bool),
+            window_ms=np.array([float(st.get("window_ms", 20)) for _, st in live], dtype=np.float64),
+        )
+        if _use_native_sim():
+            args["bytes"] = args.pop("bytes_")
+            finish = _stream_sim.simulate_batch(**args, threads=int(threads))
+        else:
+            finish = _stream_finish_py(**args)
+        finishes = np.split(finish, np.cumsum(row_sizes)[:-1])
+    out: List[pd.DataFrame] = []
+    it = iter(finishes)
+    for prep, plan, _ in cases:
+        if prep is None:
+            out.append(plan.assign(finish_ms=np.float64(0.0), deadline_rel_ms=np.float64(0.0), on_time=np.int64(1)))
+        else:
+            out.append(_stream_results(prep, next(it), layer_lat_df))
+    return out
+
+
 def simulate_plan_streams(
     plan_df: pd.DataFrame,
     tier_caps_df: pd.DataFrame,
@@ -59,52 +199,8 @@ def simulate_plan_streams(
     - Sort by (node,tier_dst, priority desc, deadline asc).
     - Each (node,tier) has N equal-bandwidth streams: bw_stream = bandwidth_caps / N.
     - If use_overlap, an op gets speedup = min(overlap, N); effective bytes = bytes / speedup.
-    - Assign each op to earliest-available stream and compute finish time.
+    - Assign each op to earliest-available stream (min-heap per group) and compute finish time.
     - Compare finish time to relative deadlines to estimate on-time completion.
     """
-    if plan_df.empty:
-        return plan_df.assign(finish_ms=np.float64(0.0),
-                              deadline_rel_ms=np.float64(0.0),
-                              on_time=np.int64(1))
-    df = plan_df.copy()
-    caps = tier_caps_df[["tier", "bandwidth_caps"]].rename(columns={"tier": "tier_dst"})
-    df = df.merge(caps, on="tier_dst", how="left")
-    df = df.sort_values(by=["node", "tier_dst", "priority"], ascending=[True, True, False]).reset_index(drop=True)
-    # Build per-layer cumulative compute deadline if provided
-    cum_deadline = None
-    if layer_lat_df is not None and len(layer_lat_df) > 0:
-        lat = layer_lat_df.sort_values('layer')
-        lat['cum_ms'] = lat['lat_ms'].astype(float).cumsum()
-        cum_deadline = dict(zip(lat['layer'].tolist(), lat['cum_ms'].tolist()))
-
-    results = []
-    for (node, tier), grp in df.groupby(["node", "tier_dst"], sort=False):
-        bw_total = float(grp["bandwidth_caps"].iloc[0])
-        bw_per = bw_total / max(1, streams_per_tier)
-        # Stream availability times (ms)
-        stream_time = [0.0 for _ in range(max(1, streams_per_tier))]
-        for row in grp.itertuples(index=False):
-            # Effective bytes with overlap
-            ov = int(getattr(row, "overlap", 1)) if use_overlap else 1
-            eff = max(1, min(ov, streams_per_tier))
-            bytes_eff = float(row.bytes) / float(eff)
-            dur_ms = (bytes_eff / max(1.0, bw_per)) * float(window_ms)
-            # Assign to earliest-available stream
-            sidx = min(range(len(stream_time)), key=lambda i: stream_time[i])
-            start = stream_time[sidx]
-            finish = start + dur_ms
-            stream_time[sidx] = finish
-            # Required time: from base window start to compute arrival for layer
-            req_deadline = float(row.deadline_ms)
-            if cum_deadline is not None:
-                req_deadline = float(cum_deadline.get(int(getattr(row, 'layer', 0)), 0.0))
-            results.append((node, row.tier_dst, getattr(row, 'pcluster', -1), getattr(row, 'layer', -1), float(row.priority), req_deadline, finish, float(row.bytes)))
-
-    out = pd.DataFrame.from_records(
-        results,
-        columns=["node", "tier_dst", "pcluster", "layer", "priority", "deadline_ms", "finish_ms", "bytes"],
-    )
-    # On-time if finished before required compute arrival for that layer
-    out['on_time'] = (out['finish_ms'] <= out['deadline_ms']).astype(np.int64)
-    out['deadline_rel_ms'] = out['deadline_ms']
-    return out
+    setting = {"window_ms": window_ms, "streams_per_tier": streams_per_tier, "use_overlap": use_overlap}
+    return simulate_plan_streams_batch(plan_df, tier_caps_df, [setting], layer_lat_df=layer_lat_df)[0]
@@ -1,6 +1,6 @@
 from __future__ import annotations
 
-from typing import Any
+from typing import Any, Optional
 
 import types
 
@@ -23,6 +23,34 @@ def device_ptr_capsule(ptr: int) -> Any:
     return PyCapsule_New(ctypes.c_void_p(ptr), name, None)
 
 
+def ptr_to_int(obj: Any) -> Optional[int]:
+    """Best-effort raw address for a destination descriptor.
+
+    Accepts plain ints, `device_ptr` capsules and objects exposing `data_ptr()` / `__int__`.
+    Returns None when the object does not carry an address (e.g. adapter-specific handles).
+    """
+    import ctypes
+
+    if isinstance(obj, bool):
+        return None
+    if isinstance(obj, int):
+        return obj
+    if type(obj).__name__ == "PyCapsule":
+        PyCapsule_GetName = ctypes.pythonapi.PyCapsule_GetName
+        PyCapsule_GetName.restype = ctypes.c_char_p
+        PyCapsule_GetName.argtypes = [ctypes.py_object]
+        PyCapsule_GetPointer = ctypes.pythonapi.PyCapsule_GetPointer
+        PyCapsule_GetPointer.restype = ctypes.c_void_p
+        PyCapsule_GetPointer.argtypes = [ctypes.py_object, ctypes.c_char_p]
+        return int(PyCapsule_GetPointer(obj, PyCapsule_GetName(obj)) or 0)
+    data_ptr = getattr(obj, "data_ptr", None)
+    if callable(data_ptr):
+        return int(data_ptr())
+    if hasattr(obj, "__int__"):
+        return int(obj)
+    return None
+
+
 def from_torch_tensor(tensor: Any) -> Any:
     """Return a device pointer capsule for a torch.Tensor (CUDA/HIP) without importing torch here.
 
@@ -49,6 +49,7 @@ class SGLangBCacheAdapter:
         on_admit: Optional[Callable[[pd.DataFrame], None]] = None,
         capture_metrics: bool = True,
         trace: Optional[TraceRecorder] = None,
+        defer_completions: bool = False,
     ) -> None:
         self.agent = agent
         self.node = node
@@ -67,6 +68,8 @@ class SGLangBCacheAdapter:
         self.on_admit = on_admit
         self.capture_metrics = capture_metrics
         self.trace = trace
+        # When set, on_ready callbacks are delivered by poll()/drain() instead of the engine thread
+        self.defer_completions = defer_completions
 
     def prefetch(
         self,
@@ -175,6 +178,7 @@ class SGLangBCacheAdapter:
             model_version=self.model_version,
             on_ready=_wrap_on_ready if (self.capture_metrics or on_ready is not None) else None,
             dest_resolver=dest_resolver,
+            defer_completions=self.defer_completions,
         )
 
         metrics = None
@@ -185,3 +189,11 @@ class SGLangBCacheAdapter:
             }
 
         return PrefetchResult(plan_df=plan_df, evict_df=evict_df, admission_df=admission_df, exec_stats=stats, metrics=metrics)
+
+    def poll(self, max_records: int = 0) -> int:
+        """Deliver on_ready for deferred copies that have finished; returns the number fired."""
+        return self.agent.poll_completions(max_records)
+
+    def drain(self, timeout_ms: int = -1) -> int:
+        """Block until deferred copies finish (or timeout_ms elapses) and deliver their on_ready."""
+        return self.agent.drain_completions(timeout_ms)
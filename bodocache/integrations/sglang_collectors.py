@@ -2,13 +2,14 @@ from __future__ import annotations
 
 from typing import Any, Dict, List
 
+from ..planner.heat_sketch import record_block_hits
 from .ptr import from_torch_tensor
 
 
-def make_sglang_collector(engine: Any):
+def make_sglang_collector(engine: Any, heat: Any = None):
     bm = getattr(engine, "block_manager", None) or getattr(engine, "cache_engine", None)
 
-    def collector(state: Any) -> Dict[int, List[int]]:
+    def _collect(state: Any) -> Dict[int, List[int]]:
         if bm is not None:
             for name in ("next_required_blocks", "get_required_blocks", "collect_required_blocks"):
                 fn = getattr(bm, name, None)
@@ -27,6 +28,11 @@ def make_sglang_collector(engine: Any):
             return {int(k): list(map(int, v)) for k, v in m.items()}
         raise RuntimeError("could not collect required blocks from engine/state")
 
+    def collector(state: Any) -> Dict[int, List[int]]:
+        out = _collect(state)
+        record_block_hits(heat, out)
+        return out
+
     return collector
 
 
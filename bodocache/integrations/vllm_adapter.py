@@ -73,6 +73,7 @@ class VLLMBCacheAdapter:
         capture_metrics: bool = True,
         trace: Optional[TraceRecorder] = None,
         hint_provider: Optional[HintProvider] = None,
+        defer_completions: bool = False,
     ) -> None:
         self.agent = agent
         self.node = node
@@ -92,6 +93,8 @@ class VLLMBCacheAdapter:
         self.capture_metrics = capture_metrics
         self.trace = trace
         self.hint_provider = hint_provider
+        # When set, on_ready callbacks are delivered by poll()/drain() instead of the engine thread
+        self.defer_completions = defer_completions
 
     @staticmethod
     def _request_key(req: KVRequest) -> Tuple[str, int, int, int, str, int, int]:
@@ -318,6 +321,7 @@ class VLLMBCacheAdapter:
             model_version=self.model_version,
             on_ready=_wrap_on_ready if (self.capture_metrics or on_ready is not None) else None,
             dest_resolver=dest_resolver,
+            defer_completions=self.defer_completions,
         )
 
         metrics = None
@@ -328,3 +332,11 @@ class VLLMBCacheAdapter:
             }
 
         return PrefetchResult(plan_df=plan_df, evict_df=evict_df, admission_df=admission_df, exec_stats=stats, metrics=metrics)
+
+    def poll(self, max_records: int = 0) -> int:
+        """Deliver on_ready for deferred copies that have finished; returns the number fired."""
+        return self.agent.poll_completions(max_records)
+
+    def drain(self, timeout_ms: int = -1) -> int:
+        """Block until deferred copies finish (or timeout_ms elapses) and deliver their on_ready."""
+        return self.agent.drain_completions(timeout_ms)
@@ -1,7 +1,7 @@
 from __future__ import annotations
 
 from dataclasses import dataclass
-from typing import Dict, Iterable, List, Sequence, Tuple
+from typing import Any, Callable, Dict, Iterable, List, Mapping, Sequence, Tuple
 
 from .base import KVRequest
 
@@ -82,3 +82,30 @@ def build_requests_from_blocks(
             )
     return reqs
 
+
+
+def block_dest_resolver(
+    cfg: VLLMCacheConfig,
+    layer_base: Callable[[int], int],
+    page_to_block: Mapping[int, int],
+) -> Callable[[Dict[str, Any]], List[int]]:
+    """dest_resolver for NodeAgent.execute() that scatters each page into its KV block.
+
+    A plan row [start_pid, end_pid] is read from storage as one run; page p lands at
+    layer_base(layer) + page_to_block[p] * bytes_per_block(), so the run fills blocks
+    that need not be adjacent in the device cache. Rows merged across layers list their
+    destinations page-major (every layer of a page, then the next page), the order of
+    packed segment reads.
+    """
+    block_bytes = cfg.bytes_per_block()
+
+    def resolve(info: Dict[str, Any]) -> List[int]:
+        layers = range(int(info["layer"]), int(info.get("layer_end", info["layer"])) + 1)
+        bases = [int(layer_base(layer)) for layer in layers]
+        return [
+            base + int(page_to_block[p]) * block_bytes
+            for p in range(int(info["start_pid"]), int(info["end_pid"]) + 1)
+            for base in bases
+        ]
+
+    return resolve
@@ -2,18 +2,20 @@ from __future__ import annotations
 
 from typing import Any, Dict, List, Sequence
 
+from ..planner.heat_sketch import record_block_hits
 from .ptr import from_torch_tensor
 
 
-def make_vllm_collector(engine: Any):
+def make_vllm_collector(engine: Any, heat: Any = None):
     """Return a collector(state) -> Dict[layer, List[int]] for vLLM-like engines.
 
-    Tries several common APIs; override if your engine differs.
+    Tries several common APIs; override if your engine differs. With ``heat`` (e.g. from
+    make_page_heat_sketch) every collected block is also recorded as a hit.
     """
 
     bm = getattr(engine, "block_manager", None) or getattr(engine, "cache_engine", None)
 
-    def collector(state: Any) -> Dict[int, List[int]]:
+    def _collect(state: Any) -> Dict[int, List[int]]:
         # Preferred engine APIs
         if bm is not None:
             for name in ("next_required_blocks", "get_required_blocks", "collect_required_blocks"):
@@ -34,6 +36,11 @@ def make_vllm_collector(engine: Any):
             return {int(k): list(map(int, v)) for k, v in m.items()}
         raise RuntimeError("could not collect required blocks from engine/state")
 
+    def collector(state: Any) -> Dict[int, List[int]]:
+        out = _collect(state)
+        record_block_hits(heat, out)
+        return out
+
     return collector
 
 
@@ -1,8 +1,11 @@
 from .scheduler import run_window  # re-export convenience
 from .cluster import assign_pclusters, assign_pclusters_minhash
+from .incremental import IncrementalPlanner, PlanDelta
 
 __all__ = [
     "run_window",
     "assign_pclusters",
     "assign_pclusters_minhash",
+    "IncrementalPlanner",
+    "PlanDelta",
 ]
@@ -1,10 +1,10 @@
 from __future__ import annotations
 
-from typing import Iterable, List
-
 import numpy as np
 import pandas as pd
 
+from .minhash import make_lsh_index, minhash_signatures, text_tokens
+
 # Optional blake3 dependency with safe fallback
 try:  # pragma: no cover - trivial import/fallback
     from blake3 import blake3 as _blake3_ctor  # type: ignore
@@ -25,100 +25,67 @@ def hash_bucket(s: str, buckets: int = 64) -> int:
     return int.from_bytes(d[:4], 'little') % max(1, buckets)
 
 
-def assign_pclusters(df: pd.DataFrame, buckets: int = 64) -> pd.DataFrame:
-    """Assign a numeric prefix cluster id (pcluster) to requests based on prefix_id.
+def assign_pclusters(df: pd.DataFrame, buckets: int = 64, index=None) -> pd.DataFrame:
+    """Assign a numeric prefix cluster id (pcluster) to requests.
 
-    This is a placeholder for near-duplicate (minhash/LSH) clustering. It produces stable
-    numeric clusters using a fast hash so the Bodo JIT hot path can group by `pcluster`.
+    With a `prefix_tokens` column, near-duplicate prefixes share a cluster via MinHash
+    LSH (see assign_pclusters_minhash; pass a persistent `index` for ids that are stable
+    across windows). Otherwise `prefix_id` is an exact identity (e.g. a prefix digest),
+    hashed into `buckets` once per distinct value.
     """
+    if 'prefix_tokens' in df.columns:
+        if index is None:
+            return assign_pclusters_minhash(df)
+        st = index.stats()
+        return assign_pclusters_minhash(df, num_hashes=st['bands'] * st['rows'], bands=st['bands'], index=index)
     if 'prefix_id' not in df.columns:
         raise KeyError('prefix_id column required')
     out = df.copy()
-    out['pcluster'] = out['prefix_id'].apply(lambda s: hash_bucket(str(s), buckets)).astype(np.int64)
+    codes, uniques = pd.factorize(out['prefix_id'].astype(str), sort=False)
+    table = np.asarray([hash_bucket(u, buckets) for u in uniques], dtype=np.int64)
+    out['pcluster'] = table[codes]
     return out
 
 
-def _k_shingles(s: str, k: int = 5):
-    s = str(s)
-    if len(s) <= k:
-        return [s]
-    return [s[i:i+k] for i in range(len(s) - k + 1)]
-
-
-def _hash_with_seed(x: str, seed: int) -> int:
-    # Mix seed in first 4 bytes for simple families
-    h = _blake_digest((str(seed) + '|' + x).encode('utf-8'))
-    return int.from_bytes(h[:4], 'little') & 0x7FFFFFFF
-
-
 def assign_pclusters_minhash(
     df: pd.DataFrame,
     num_hashes: int = 32,
     bands: int = 8,
     k: int = 5,
+    index=None,
+    seed: int = 0,
 ) -> pd.DataFrame:
-    """Assign numeric clusters via simple minhash + banding.
+    """Assign numeric clusters via MinHash + LSH banding.
 
-    Prefer token-level minhash over `prefix_tokens` (list of ints). If not present,
-    fall back to minhash over string `prefix_id` shingles.
+    Signatures are taken over k-shingles of `prefix_tokens` (list of ints) or, if that
+    column is absent, of the UTF-8 bytes of `prefix_id`. Rows sharing any of the `bands`
+    band keys (num_hashes/bands rows each) land in one cluster. With a persistent
+    `index` from make_lsh_index(bands, num_hashes // bands) ids are stable across calls;
+    without one, ids are dense codes for this frame.
 
     Returns a copy of df with an added int64 column 'pcluster'.
     """
     if num_hashes % bands != 0:
         raise ValueError('num_hashes must be divisible by bands')
-    use_tokens = 'prefix_tokens' in df.columns
-    rows: List[int] = []
-    r = num_hashes // bands
-    seeds = list(range(num_hashes))
-
-    if use_tokens:
-        # Token-level: build k-grams from integer token ids
-        token_seqs: List[List[int]] = df['prefix_tokens'].tolist()
-        for toks in token_seqs:
-            toks = list(map(int, toks)) if toks is not None else []
-            if len(toks) < k:
-                grams = [tuple(toks)] if toks else []
-            else:
-                grams = [tuple(toks[i:i+k]) for i in range(len(toks) - k + 1)]
-            sig: List[int] = []
-            for seed in seeds:
-                # hash each gram with seed, take min
-                vals = []
-                for g in grams:
-                    # Mix seed and ints into bytes deterministically
-                    b = seed.to_bytes(4, 'little') + b''.join(int(x).to_bytes(4, 'little', signed=False) for x in g)
-                    h = _blake_digest(b)[:4]
-                    vals.append(int.from_bytes(h, 'little') & 0x7FFFFFFF)
-                sig.append(min(vals) if vals else 0)
-            band_keys: List[int] = []
-            for bidx in range(bands):
-                start = bidx * r
-                end = start + r
-                chunk = tuple(sig[start:end])
-                band_h = _blake_digest(str(chunk).encode('utf-8'))[:4]
-                band_keys.append(int.from_bytes(band_h, 'little'))
-            combo = _blake_digest(b''.join(int(x).to_bytes(4, 'little') for x in band_keys))[:4]
-            rows.append(int.from_bytes(combo, 'little'))
+    rows = num_hashes // bands
+    if index is not None and (index.stats()['bands'], index.stats()['rows']) != (bands, rows):
+        raise ValueError('index bands/rows do not match num_hashes/bands')
+    codes = None
+    if 'prefix_tokens' in df.columns:
+        seqs = df['prefix_tokens'].tolist()
     else:
         if 'prefix_id' not in df.columns:
             raise KeyError('prefix_tokens or prefix_id column required')
-        for s in df['prefix_id'].astype(str).tolist():
-            shingles = _k_shingles(s, k=k)
-            sig: List[int] = []
-            for seed in seeds:
-                vals = [_hash_with_seed(sh, seed) for sh in shingles]
-                sig.append(min(vals) if vals else 0)
-            band_keys: List[int] = []
-            for bidx in range(bands):
-                start = bidx * r
-                end = start + r
-                chunk = tuple(sig[start:end])
-                band_h = _blake_digest(str(chunk).encode('utf-8'))[:4]
-                band_keys.append(int.from_bytes(band_h, 'little'))
-            combo = _blake_digest(b''.join(int(x).to_bytes(4, 'little') for x in band_keys))[:4]
-            rows.append(int.from_bytes(combo, 'little'))
-
+        # Shingle each distinct prefix once
+        codes, uniques = pd.factorize(df['prefix_id'].astype(str), sort=False)
+        seqs = [text_tokens(u) for u in uniques]
+    sigs = minhash_signatures(seqs, num_hashes=num_hashes, k=k, seed=seed)
+    idx = index if index is not None else make_lsh_index(bands=bands, rows=rows, seed=seed)
+    ids = np.asarray(idx.assign(sigs), dtype=np.int64)
+    if codes is not None:
+        ids = ids[codes]
+    if index is None:
+        ids = pd.factorize(ids, sort=False)[0].astype(np.int64)
     out = df.copy()
-    codes, _ = pd.factorize(pd.Series(rows), sort=False)
-    out['pcluster'] = pd.Series(codes).astype(np.int64)
+    out['pcluster'] = ids
     return out
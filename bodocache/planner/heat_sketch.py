@@ -3,7 +3,15 @@ from __future__ import annotations
 import math
 import time
 from dataclasses import dataclass
-from typing import Dict, Iterable, Tuple
+from typing import Any, Dict, Iterable, List, Mapping, Optional, Tuple
+
+import numpy as np
+
+# Optional native page sketch (native/heat_sketch.cpp)
+try:  # pragma: no cover - depends on the native build
+    import bodocache_heat_sketch as _native_heat  # type: ignore
+except Exception:
+    _native_heat = None
 
 
 @dataclass
@@ -92,3 +100,65 @@ class HeatSketch:
     def export_heat(self) -> Dict[str, int]:
         return {k: cnt for k, cnt, _ in self.ss.topk()}
 
+
+
+class PageHeatSketch:
+    """
+    Pure-Python page-keyed sketch with the native ``bodocache_heat_sketch.HeatSketch`` API.
+
+    Keys are (layer, page_id); export_heat() returns heat_df columns as NumPy arrays.
+    Not thread-safe; use the native sketch to record hits from several threads.
+    """
+
+    def __init__(self, width: int = 4096, depth: int = 4, k: int = 4096, decay_lambda: float = 0.01):
+        self._sketch = HeatSketch(width=width, depth=depth, k=k, decay_lambda=decay_lambda)
+
+    def add(self, layer: int, page_id: int, count: int = 1):
+        self._sketch.add((int(layer), int(page_id)), int(count))
+
+    def add_batch(self, layer, page_id, counts=None):
+        counts = [1] * len(layer) if counts is None else counts
+        for l, p, c in zip(layer, page_id, counts):
+            self.add(l, p, c)
+
+    def estimate(self, layer: int, page_id: int) -> int:
+        return self._sketch.estimate((int(layer), int(page_id)))
+
+    def estimate_batch(self, layer, page_id) -> np.ndarray:
+        return np.asarray([self.estimate(l, p) for l, p in zip(layer, page_id)], dtype=np.uint64)
+
+    def decay(self):
+        self._sketch.decay()
+
+    def export_heat(self) -> Dict[str, np.ndarray]:
+        top = sorted(((cnt, key) for key, cnt, _ in self._sketch.ss.topk() if cnt > 0), key=lambda t: (-t[0], t[1]))
+        return {
+            "layer": np.asarray([key[0] for _, key in top], dtype=np.int64),
+            "page_id": np.asarray([key[1] for _, key in top], dtype=np.int64),
+            "decay_hits": np.asarray([cnt for cnt, _ in top], dtype=np.int64),
+            "tenant_weight": np.ones(len(top), dtype=np.float64),
+        }
+
+
+def make_page_heat_sketch(
+    width: int = 4096,
+    depth: int = 4,
+    k: int = 4096,
+    decay_lambda: float = 0.01,
+    shards: int = 8,
+    prefer_native: bool = True,
+) -> Any:
+    """Return the native page sketch when built (thread-safe, GIL released for batches), else PageHeatSketch."""
+    if prefer_native and _native_heat is not None:
+        return _native_heat.HeatSketch(width=width, depth=depth, k=k, decay_lambda=decay_lambda, shards=shards)
+    return PageHeatSketch(width=width, depth=depth, k=k, decay_lambda=decay_lambda)
+
+
+def record_block_hits(sketch: Optional[Any], layer_to_blocks: Mapping[int, List[int]]) -> None:
+    """Record one hit per collected block, one add_batch call per collection."""
+    if sketch is None or not layer_to_blocks:
+        return
+    layers = np.concatenate([np.full(len(v), int(k), dtype=np.int64) for k, v in layer_to_blocks.items()])
+    pages = np.concatenate([np.asarray(v, dtype=np.int64) for v in layer_to_blocks.values()])
+    if len(pages):
+        sketch.add_batch(layers, pages)
@@ -0,0 +1,393 @@
+from __future__ import annotations
+
+import bisect
+import heapq
+import itertools
+from dataclasses import dataclass
+from typing import Dict, Iterable, List, Optional, Tuple
+
+import numpy as np
+import pandas as pd
+
+from .pipeline import apply_caps
+
+_UNCAPPED = 9_223_372_036_854_775_807
+_REQ_COLS = [
+    "req_id", "node", "model_id", "model_version", "prefix_id", "layer", "page_start", "page_end",
+    "tier_src", "tier_dst", "deadline_ms", "page_bytes", "tenant", "est_fill_ms",
+]
+_RUN_COLS = [
+    "node", "tier_src", "tier_dst", "pcluster", "layer", "run_id", "bytes", "deadline_ms", "fanout",
+    "urgency_min", "start_pid", "end_pid", "page_bytes",
+]
+# Op identity for plan deltas; priority drifts with now_ms and is not part of it
+_KEY_COLS = [
+    "node", "tier_src", "tier_dst", "pcluster", "layer", "run_id", "bytes", "deadline_ms", "fanout",
+    "overlap", "start_pid", "end_pid", "page_bytes",
+]
+
+
+@dataclass
+class PlanDelta:
+    """Ops that appeared in / disappeared from the plan since the previous window."""
+
+    added: pd.DataFrame
+    removed: pd.DataFrame
+
+    @property
+    def empty(self) -> bool:
+        return self.added.empty and self.removed.empty
+
+
+class _Req:
+    __slots__ = ("rid", "seq", "values", "pcluster", "group", "tgroup", "hkey", "ps", "pe", "page_bytes",
+                 "bytes", "deadline", "denom", "cand", "kept")
+
+
+class IncrementalPlanner:
+    """
+    Stateful window planner that keeps pending requests between windows.
+
+    Requests, cancellations/completions and heat updates are applied as deltas; plan()
+    then re-scores only the rows those deltas touched (plus rows whose urgency crossed
+    umin since the last window, found through a heap of crossing times), re-gates only
+    the (node,tier_dst,tenant) groups whose membership or cap changed, and re-coalesces
+    only the (node,tier_src,tier_dst,pcluster,layer) interval groups whose kept rows
+    changed. Each interval group is a sorted list of intervals, and its coalesced runs
+    are cached. The tier-cap stage then runs over the cached runs, which are far fewer
+    than the queued requests.
+
+    plan(now_ms, ...) returns the same plan as run_window_core_py over
+    requests_df() with the same heat, plus a PlanDelta against the previous call.
+    """
+
+    def __init__(
+        self,
+        pmin: float = 1.0,
+        umin: float = 0.0,
+        min_io_bytes: int = 512 * 1024,
+        alpha: float = 1.0,
+        beta: float = 0.0,
+        window_ms: int = 20,
+        max_ops_per_tier: int = 64,
+        enforce_tier_caps: bool = True,
+    ):
+        self.pmin = float(pmin)
+        self.umin = float(umin)
+        self.min_io_bytes = int(min_io_bytes)
+        self.alpha = float(alpha)
+        self.beta = float(beta)
+        self.window_ms = window_ms
+        self.max_ops_per_tier = max_ops_per_tier
+        self.enforce_tier_caps = bool(enforce_tier_caps)
+        self._reqs: Dict[object, _Req] = {}
+        self._seq = 0
+        self._pclusters: Dict[object, int] = {}
+        self._heat: Dict[Tuple[int, int], Tuple[int, float]] = {}
+        self._by_page: Dict[Tuple[int, int], set] = {}
+        self._pending: set = set()
+        self._urgent: List[Tuple[float, int, _Req]] = []  # (urgency crossing time, tie, row)
+        self._tie = itertools.count()
+        # (node,tier_dst,tenant) -> candidate rows by seq, their total bytes, whether the cap binds
+        self._tgroups: Dict[tuple, Dict[int, _Req]] = {}
+        self._tg_bytes: Dict[tuple, int] = {}
+        self._tg_gated: Dict[tuple, bool] = {}
+        self._tg_changed: Dict[tuple, Dict[int, _Req]] = {}
+        self._tenant_caps: Dict[tuple, float] = {}
+        # (node,tier_src,tier_dst,pcluster,layer) -> sorted [(page_start, page_end, seq, req)] of kept rows
+        self._groups: Dict[tuple, list] = {}
+        self._runs: Dict[tuple, list] = {}
+        self._dirty_groups: set = set()
+        self._table: Optional[dict] = None
+        self._last_now: Optional[int] = None
+        self._prev_plan: Optional[pd.DataFrame] = None
+        self.last_stats: Dict[str, int] = {}
+
+    # ---- deltas -------------------------------------------------------------------
+
+    def add_requests(self, requests_df: pd.DataFrame) -> None:
+        """Add requests (run_window columns; pcluster optional). A known req_id is replaced."""
+        has_pcluster = "pcluster" in requests_df.columns
+        cols = _REQ_COLS + (["pcluster"] if has_pcluster else [])
+        for values in requests_df[cols].itertuples(index=False, name=None):
+            rid = values[0]
+            if rid in self._reqs:
+                self._remove(rid)
+            r = _Req()
+            r.rid = rid
+            r.seq = self._seq
+            self._seq += 1
+            r.values = values[: len(_REQ_COLS)]
+            node, prefix, layer = values[1], values[4], int(values[5])
+            ps, pe, tier_src, tier_dst = int(values[6]), int(values[7]), int(values[8]), int(values[9])
+            if has_pcluster:
+                r.pcluster = int(values[-1])
+            else:
+                r.pcluster = self._pclusters.setdefault(prefix, len(self._pclusters))
+            r.group = (node, tier_src, tier_dst, r.pcluster, layer)
+            r.tgroup = (node, tier_dst, values[12])
+            r.hkey = (layer, ps)
+            r.ps, r.pe = ps, pe
+            r.page_bytes = int(values[11])
+            r.bytes = (pe - ps + 1) * r.page_bytes
+            r.deadline = int(values[10])
+            r.denom = max(float(values[13]), 1.0)
+            r.cand = False
+            r.kept = False
+            self._reqs[rid] = r
+            self._by_page.setdefault(r.hkey, set()).add(rid)
+            self._pending.add(rid)
+
+    def cancel(self, req_ids: Iterable) -> None:
+        """Drop cancelled requests; unknown ids are ignored."""
+        for rid in req_ids:
+            if rid in self._reqs:
+                self._remove(rid)
+
+    def complete(self, req_ids: Iterable) -> None:
+        """Drop requests whose pages have landed."""
+        self.cancel(req_ids)
+
+    def update_heat(self, heat_df: pd.DataFrame) -> None:
+        """Upsert heat rows [layer,page_id,decay_hits(,tenant_weight)]; affected requests are re-scored."""
+        weights = heat_df["tenant_weight"] if "tenant_weight" in heat_df.columns else pd.Series(1.0, index=heat_df.index)
+        for layer, page_id, hits, weight in zip(heat_df["layer"], heat_df["page_id"], heat_df["decay_hits"], weights):
+            key = (int(layer), int(page_id))
+            self._heat[key] = (0 if pd.isna(hits) else int(hits), 1.0 if pd.isna(weight) else float(weight))
+            self._pending |= self._by_page.get(key, set())
+
+    def requests_df(self) -> pd.DataFrame:
+        """Pending requests in arrival order, with the pcluster codes used for planning."""
+        rows = [r.values + (r.pcluster,) for r in self._reqs.values()]
+        return pd.DataFrame(rows, columns=_REQ_COLS + ["pcluster"])
+
+    # ---- planning -----------------------------------------------------------------
+
+    def plan(
+        self,
+        now_ms: int,
+        tier_caps_df: pd.DataFrame,
+        tenant_caps_df: pd.DataFrame,
+        layer_lat_df: pd.DataFrame,
+    ) -> Tuple[pd.DataFrame, PlanDelta]:
+        now_ms = int(now_ms)
+        stats = {"rescored": 0, "regated": 0, "recoalesced": 0}
+        if self._last_now is not None and now_ms < self._last_now:
+            # Urgency only decays as time moves forward; re-score everything otherwise
+            self._pending = set(self._reqs)
+        self._last_now = now_ms
+
+        # Rows whose urgency crossed umin since the last window
+        deferred = []
+        while self._urgent and self._urgent[0][0] <= now_ms:
+            _, _, r = heapq.heappop(self._urgent)
+            if self._reqs.get(r.rid) is not r or not r.cand or r.rid in self._pending:
+                continue
+            stats["rescored"] += 1
+            t_flip = self._rescore(r, now_ms)
+            if t_flip is not None:
+                deferred.append(r)  # still urgent by rounding; recheck next window
+        for r in deferred:
+            heapq.heappush(self._urgent, (now_ms + 1, next(self._tie), r))
+        for rid in self._pending:
+            r = self._reqs.get(rid)
+            if r is not None:
+                stats["rescored"] += 1
+                t_flip = self._rescore(r, now_ms)
+                if t_flip is not None:
+                    heapq.heappush(self._urgent, (max(t_flip, now_ms + 1), next(self._tie), r))
+        self._pending = set()
+
+        caps = {}
+        for tenant, tier, cap in zip(tenant_caps_df["tenant"], tenant_caps_df["tier"], tenant_caps_df["bandwidth_caps"]):
+            caps.setdefault((tenant, int(tier)), _UNCAPPED if pd.isna(cap) else float(cap))
+        if caps != self._tenant_caps:
+            changed = {k for k in caps.keys() | self._tenant_caps.keys() if caps.get(k) != self._tenant_caps.get(k)}
+            for tg in self._tgroups:
+                if (tg[2], tg[1]) in changed:
+                    self._tg_changed.setdefault(tg, {})
+            self._tenant_caps = caps
+        for tg, changed_rows in self._tg_changed.items():
+            stats["regated"] += 1
+            self._regate(tg, changed_rows)
+        self._tg_changed = {}
+
+        for g in self._dirty_groups:
+            stats["recoalesced"] += 1
+            self._coalesce(g)
+        if self._dirty_groups or self._table is None:
+            self._table = self._build_table()
+        self._dirty_groups = set()
+
+        t = self._table
+        runs = pd.DataFrame({c: t[c] for c in _RUN_COLS if c != "urgency_min"})
+        if len(runs):
+            urg = (t["member_deadline"] - now_ms) / t["member_denom"]
+            runs.insert(_RUN_COLS.index("urgency_min"), "urgency_min", np.minimum.reduceat(urg, t["offsets"]))
+        else:
+            runs.insert(_RUN_COLS.index("urgency_min"), "urgency_min", np.zeros(0, dtype=np.float64))
+        plan = apply_caps(
+            runs,
+            tier_caps_df=tier_caps_df,
+            layer_lat_df=layer_lat_df,
+            window_ms=self.window_ms,
+            max_ops_per_tier=self.max_ops_per_tier,
+            enforce_tier_caps=self.enforce_tier_caps,
+        )
+        delta = self._diff(plan)
+        self._prev_plan = plan
+        stats["runs"] = len(runs)
+        stats["requests"] = len(self._reqs)
+        self.last_stats = stats
+        return plan, delta
+
+    # ---- internals ----------------------------------------------------------------
+
+    def _remove(self, rid) -> None:
+        r = self._reqs.pop(rid)
+        self._set_cand(r, False)
+        page = self._by_page.get(r.hkey)
+        if page is not None:
+            page.discard(rid)
+            if not page:
+                del self._by_page[r.hkey]
+        self._pending.discard(rid)
+
+    def _popular(self, r: _Req) -> bool:
+        hits, weight = self._heat.get(r.hkey, (0, 1.0))
+        return self.alpha * hits + self.beta * weight > self.pmin
+
+    def _rescore(self, r: _Req, now_ms: int) -> Optional[float]:
+        """Update candidacy; returns when urgency drops to umin if that is all that keeps the row."""
+        popular = self._popular(r)
+        urgent = (r.deadline - now_ms) / r.denom > self.umin
+        self._set_cand(r, popular or urgent)
+        if urgent and not popular:
+            return r.deadline - self.umin * r.denom
+        return None
+
+    def _set_cand(self, r: _Req, cand: bool) -> None:
+        if r.cand == cand:
+            return
+        r.cand = cand
+        members = self._tgroups.setdefault(r.tgroup, {})
+        if cand:
+            members[r.seq] = r
+            self._tg_bytes[r.tgroup] = self._tg_bytes.get(r.tgroup, 0) + r.bytes
+        else:
+            members.pop(r.seq, None)
+            self._tg_bytes[r.tgroup] -= r.bytes
+        self._tg_changed.setdefault(r.tgroup, {})[r.seq] = r
+
+    def _regate(self, tg: tuple, changed_rows: Dict[int, _Req]) -> None:
+        cap = self._tenant_caps.get((tg[2], tg[1]), _UNCAPPED)
+        members = self._tgroups.get(tg, {})
+        gated = self._tg_bytes.get(tg, 0) > cap
+        if not gated and not self._tg_gated.get(tg, False):
+            # Under cap before and after: kept == candidate for exactly the rows that changed
+            for r in changed_rows.values():
+                self._set_kept(r, r.cand)
+        else:
+            for r in changed_rows.values():
+                if not r.cand:
+                    self._set_kept(r, False)
+            cum = 0
+            for r in sorted(members.values(), key=lambda x: (x.deadline, x.seq)):
+                cum += r.bytes
+                self._set_kept(r, cum <= cap)
+        if members:
+            self._tg_gated[tg] = gated
+        else:
+            self._tgroups.pop(tg, None)
+            self._tg_bytes.pop(tg, None)
+            self._tg_gated.pop(tg, None)
+
+    def _set_kept(self, r: _Req, kept: bool) -> None:
+        if r.kept == kept:
+            return
+        r.kept = kept
+        entries = self._groups.setdefault(r.group, [])
+        if kept:
+            bisect.insort(entries, (r.ps, r.pe, r.seq, r))
+        else:
+            i = bisect.bisect_left(entries, (r.ps, r.pe, r.seq))
+            del entries[i]
+            if not entries:
+                del self._groups[r.group]
+        self._dirty_groups.add(r.group)
+
+    def _coalesce(self, g: tuple) -> None:
+        # Same run rules as pipeline.coalesce_intervals: a run breaks when page_start
+        # passes the previous interval's end; pages are the union within the run.
+        entries = self._groups.get(g)
+        if not entries:
+            self._runs.pop(g, None)
+            return
+        runs = []
+        run_id, prev_end, cur = 0, -1, None
+        for ps, pe, _, r in entries:
+            if ps > prev_end + 1:
+                run_id += 1
+                cur = None
+            if cur is None:
+                cur = [run_id, 0, r.deadline, 0, ps, pe, r.page_bytes, [], [], -1]
+                runs.append(cur)
+            eff_start = max(ps, cur[9] + 1)
+            cur[1] += max(0, pe - eff_start + 1)
+            cur[9] = max(cur[9], pe)
+            cur[2] = min(cur[2], r.deadline)
+            cur[3] += 1
+            cur[4] = min(cur[4], ps)
+            cur[5] = max(cur[5], pe)
+            cur[6] = max(cur[6], r.page_bytes)
+            cur[7].append(r.deadline)
+            cur[8].append(r.denom)
+            prev_end = pe
+        kept = []
+        for run in runs:
+            run[1] *= run[6]  # pages -> bytes
+            if run[1] >= self.min_io_bytes:
+                kept.append(run)
+        if kept:
+            self._runs[g] = kept
+        else:
+            self._runs.pop(g, None)
+
+    def _build_table(self) -> dict:
+        # Row order matches the groupby output of coalesce_intervals (sorted group keys, run_id)
+        cols = {c: [] for c in _RUN_COLS if c != "urgency_min"}
+        member_deadline: List[int] = []
+        member_denom: List[float] = []
+        offsets: List[int] = []
+        for g in sorted(self._runs):
+            node, tier_src, tier_dst, pcluster, layer = g
+            for run_id, nbytes, dl, fanout, start, end, pbytes, dls, denoms, _ in self._runs[g]:
+                cols["node"].append(node)
+                cols["tier_src"].append(tier_src)
+                cols["tier_dst"].append(tier_dst)
+                cols["pcluster"].append(pcluster)
+                cols["layer"].append(layer)
+                cols["run_id"].append(run_id)
+                cols["bytes"].append(nbytes)
+                cols["deadline_ms"].append(dl)
+                cols["fanout"].append(fanout)
+                cols["start_pid"].append(start)
+                cols["end_pid"].append(end)
+                cols["page_bytes"].append(pbytes)
+                offsets.append(len(member_deadline))
+                member_deadline.extend(dls)
+                member_denom.extend(denoms)
+        table = {c: (np.asarray(v, dtype=object) if c == "node" else np.asarray(v, dtype=np.int64)) for c, v in cols.items()}
+        table["member_deadline"] = np.asarray(member_deadline, dtype=np.int64)
+        table["member_denom"] = np.asarray(member_denom, dtype=np.float64)
+        table["offsets"] = np.asarray(offsets, dtype=np.int64)
+        return table
+
+    def _diff(self, plan: pd.DataFrame) -> PlanDelta:
+        prev = self._prev_plan if self._prev_plan is not None else plan.head(0)
+        cur_keys = list(zip(*[plan[c].tolist() for c in _KEY_COLS])) if len(plan) else []
+        prev_keys = list(zip(*[prev[c].tolist() for c in _KEY_COLS])) if len(prev) else []
+        cur_set, prev_set = set(cur_keys), set(prev_keys)
+        added = plan[[k not in prev_set for k in cur_keys]] if len(plan) else plan.head(0)
+        removed = prev[[k not in cur_set for k in prev_keys]] if len(prev) else prev.head(0)
+        return PlanDelta(added=added.reset_index(drop=True), removed=removed.reset_index(drop=True))
@@ -0,0 +1,174 @@
+from __future__ import annotations
+
+from typing import Dict, List, Optional, Sequence
+
+import numpy as np
+
+# Optional native kernels (native/minhash.cpp); the NumPy path below computes the same bits
+try:  # pragma: no cover - depends on the native build
+    import bodocache_minhash as _native_minhash  # type: ignore
+except Exception:
+    _native_minhash = None
+
+_MASK64 = (1 << 64) - 1
+_GOLDEN = 0x9E3779B97F4A7C15
+_BAND_SALT = 0x51ED270B27A3C2D1
+_EMPTY = 0xFFFFFFFF
+
+
+def _fmix64_int(k: int) -> int:
+    k &= _MASK64
+    k ^= k >> 33
+    k = (k * 0xFF51AFD7ED558CCD) & _MASK64
+    k ^= k >> 33
+    k = (k * 0xC4CEB9FE1A85EC53) & _MASK64
+    k ^= k >> 33
+    return k
+
+
+def _fmix64(k: np.ndarray) -> np.ndarray:
+    k = k ^ (k >> np.uint64(33))
+    k = k * np.uint64(0xFF51AFD7ED558CCD)
+    k = k ^ (k >> np.uint64(33))
+    k = k * np.uint64(0xC4CEB9FE1A85EC53)
+    return k ^ (k >> np.uint64(33))
+
+
+def _perm_coeffs(num_hashes: int, seed: int):
+    a = np.asarray([(_fmix64_int(seed + 2 * i + 1) & 0xFFFFFFFF) | 1 for i in range(num_hashes)], dtype=np.uint64)
+    b = np.asarray([_fmix64_int(seed + 2 * i + 2) & 0xFFFFFFFF for i in range(num_hashes)], dtype=np.uint64)
+    return a, b
+
+
+def _signatures_py(seqs: Sequence[np.ndarray], num_hashes: int, k: int, seed: int) -> np.ndarray:
+    a, b = _perm_coeffs(num_hashes, seed)
+    out = np.full((len(seqs), num_hashes), _EMPTY, dtype=np.uint32)
+    with np.errstate(over="ignore"):
+        for r, toks in enumerate(seqs):
+            toks = np.asarray(toks, dtype=np.int64).astype(np.uint64)
+            if len(toks) == 0:
+                continue
+            width = min(k, len(toks))
+            m = len(toks) - width + 1
+            h = np.full(m, seed & _MASK64, dtype=np.uint64)
+            for j in range(width):
+                h = _fmix64(h ^ (toks[j:j + m] + np.uint64(_GOLDEN)))
+            x = (h ^ (h >> np.uint64(32))) & np.uint64(0xFFFFFFFF)
+            out[r] = ((a[:, None] * x[None, :] + b[:, None]) & np.uint64(0xFFFFFFFF)).min(axis=1)
+    return out
+
+
+def minhash_signatures(
+    token_seqs: Sequence[Sequence[int]],
+    num_hashes: int = 32,
+    k: int = 5,
+    seed: int = 0,
+    prefer_native: bool = True,
+) -> np.ndarray:
+    """(n, num_hashes) uint32 MinHash signatures over k-shingles of each token sequence.
+
+    Uses the native AVX2 kernel when built; the NumPy fallback produces identical values.
+    """
+    if num_hashes <= 0 or k <= 0:
+        raise ValueError("num_hashes and k must be positive")
+    seqs = [np.asarray(s if s is not None else [], dtype=np.int64) for s in token_seqs]
+    if prefer_native and _native_minhash is not None:
+        offsets = np.zeros(len(seqs) + 1, dtype=np.int64)
+        np.cumsum([len(s) for s in seqs], out=offsets[1:])
+        tokens = np.concatenate(seqs) if seqs else np.zeros(0, dtype=np.int64)
+        return _native_minhash.signatures(tokens, offsets, num_hashes=num_hashes, k=k, seed=seed)
+    return _signatures_py(seqs, num_hashes, k, seed)
+
+
+def lsh_band_keys(sigs: np.ndarray, bands: int, rows: int, seed: int = 0) -> np.ndarray:
+    """(n, bands) uint64 keys; rows sharing any band key are LSH candidates."""
+    sigs = np.asarray(sigs, dtype=np.uint32)
+    if sigs.ndim != 2 or sigs.shape[1] != bands * rows:
+        raise ValueError("signatures must have shape (n, bands*rows)")
+    if _native_minhash is not None:
+        return _native_minhash.band_keys(sigs, bands, rows, seed=seed)
+    out = np.empty((sigs.shape[0], bands), dtype=np.uint64)
+    with np.errstate(over="ignore"):
+        for band in range(bands):
+            h = np.full(sigs.shape[0], _fmix64_int(seed ^ (band << 32) ^ _BAND_SALT), dtype=np.uint64)
+            for j in range(rows):
+                h = _fmix64(h ^ sigs[:, band * rows + j].astype(np.uint64))
+            out[:, band] = h
+    return out
+
+
+class LshIndexPy:
+    """Pure-Python twin of the native LshIndex (same ids for the same input order).
+
+    Band keys map to clusters; a row sharing any band with an earlier row (in this or a
+    previous batch) joins its cluster, and clusters bridged by a row are merged into the
+    older id via union-find.
+    """
+
+    def __init__(self, bands: int = 8, rows: int = 4, seed: int = 0):
+        if bands <= 0 or rows <= 0:
+            raise ValueError("bands and rows must be positive")
+        self.bands = bands
+        self.rows = rows
+        self.seed = seed
+        self._buckets: Dict[int, int] = {}
+        self._parent: List[int] = []
+
+    def _find(self, c: int) -> int:
+        parent = self._parent
+        while parent[c] != c:
+            parent[c] = parent[parent[c]]
+            c = parent[c]
+        return c
+
+    def _new(self) -> int:
+        self._parent.append(len(self._parent))
+        return self._parent[-1]
+
+    def assign(self, sigs: np.ndarray) -> np.ndarray:
+        sigs = np.asarray(sigs, dtype=np.uint32)
+        keys = lsh_band_keys(sigs, self.bands, self.rows, self.seed).tolist()
+        empty = (sigs == _EMPTY).all(axis=1).tolist()
+        out = np.empty(len(keys), dtype=np.int64)
+        for r, row_keys in enumerate(keys):
+            if empty[r]:
+                out[r] = self._new()
+                continue
+            root = -1
+            for key in row_keys:
+                c = self._buckets.get(key)
+                if c is None:
+                    continue
+                c = self._find(c)
+                if root < 0:
+                    root = c
+                elif c != root:
+                    lo, hi = min(root, c), max(root, c)
+                    self._parent[hi] = lo
+                    root = lo
+            if root < 0:
+                root = self._new()
+            for key in row_keys:
+                self._buckets.setdefault(key, root)
+            out[r] = root
+        return np.asarray([self._find(int(c)) for c in out], dtype=np.int64)
+
+    def clear(self) -> None:
+        self._buckets.clear()
+        self._parent.clear()
+
+    def stats(self) -> Dict[str, object]:
+        return {"bands": self.bands, "rows": self.rows, "buckets": len(self._buckets),
+                "clusters": len(self._parent), "simd": "none"}
+
+
+def make_lsh_index(bands: int = 8, rows: int = 4, seed: int = 0, prefer_native: bool = True):
+    """Persistent LSH band index; keep one across windows for stable pcluster ids."""
+    if prefer_native and _native_minhash is not None:
+        return _native_minhash.LshIndex(bands=bands, rows=rows, seed=seed)
+    return LshIndexPy(bands=bands, rows=rows, seed=seed)
+
+
+def text_tokens(s: Optional[str]) -> np.ndarray:
+    """UTF-8 bytes of a string as tokens, for shingling prefixes that only exist as text."""
+    return np.frombuffer(str(s).encode("utf-8"), dtype=np.uint8).astype(np.int64)
@@ -9,6 +9,8 @@ class Tier(Enum):
     STORAGE = 0
     CPU = 1
     GPU = 2
+    # Another node's CPU/GPU memory; only ever a tier_src (see planner/peer.py)
+    PEER = 3
 
 
 @dataclass(frozen=True)
@@ -1,10 +1,19 @@
 from __future__ import annotations
 
 from dataclasses import dataclass
-from typing import Dict, Iterable, List, Optional, Tuple
+from typing import Dict, Iterable, List, Optional, Sequence, Tuple
+
+import numpy as np
+import pandas as pd
 
 from .models import PageKey, Tier
 
+# Optional native table (native/page_table.cpp); PackedPageTablePy mirrors its API
+try:  # pragma: no cover - depends on the native build
+    import bodocache_page_table as _native_pt  # type: ignore
+except Exception:
+    _native_pt = None
+
 
 @dataclass
 class Location:
@@ -17,11 +26,14 @@ class Location:
 class PageTable:
     """
     Minimal in-memory page table mapping PageKey -> Location and metadata.
-    Provides helpers to get contiguous runs by (layer, page_id).
+    Provides helpers to get contiguous runs by (layer, page_id). For millions of pages
+    use CompactPageTable, which has the same get/set/bulk_get API.
     """
 
     def __init__(self):
         self._loc: Dict[str, Location] = {}
+        # Copies held by other nodes (Location.node is the holder), one holder per page
+        self._remote: Dict[str, Location] = {}
 
     @staticmethod
     def encode_key(k: PageKey) -> str:
@@ -39,6 +51,18 @@ class PageTable:
     def bulk_get(self, keys: Iterable[PageKey]) -> List[Optional[Location]]:
         return [self.get(k) for k in keys]
 
+    def set_remote(self, key: PageKey, location: Location):
+        """Record that location.node holds a copy of key in its CPU or GPU tier."""
+        if location.node is None:
+            raise ValueError("a remote location needs the holder node")
+        self._remote[self.encode_key(key)] = location
+
+    def get_remote(self, key: PageKey) -> Optional[Location]:
+        return self._remote.get(self.encode_key(key))
+
+    def erase_remote(self, key: PageKey) -> bool:
+        return self._remote.pop(self.encode_key(key), None) is not None
+
     def iter_layer_pages(
         self, model_id: str, model_version: str, layer: int
     ) -> Iterable[Tuple[PageKey, Location]]:
@@ -71,3 +95,397 @@ class PageTable:
         runs.append((start, prev))
         return runs
 
+
+
+def pack_page_keys(model, layer, page_id) -> np.ndarray:
+    """Pack (model code, layer, page_id) into uint64 keys: model:16 | layer:16 | page_id:32."""
+    layer = np.asarray(layer, dtype=np.int64)
+    page_id = np.asarray(page_id, dtype=np.int64)
+    model = np.broadcast_to(np.asarray(model, dtype=np.int64), page_id.shape)
+    if layer.shape != page_id.shape:
+        raise ValueError("layer and page_id must have matching lengths")
+    if ((model < 0) | (model > 0xFFFE)).any():
+        raise ValueError("model code out of range [0, 65534]")
+    if ((layer < 0) | (layer > 0xFFFF)).any():
+        raise ValueError("layer out of range [0, 65535]")
+    if ((page_id < 0) | (page_id > 0xFFFFFFFF)).any():
+        raise ValueError("page_id out of range [0, 2^32)")
+    return (
+        (model.astype(np.uint64) << np.uint64(48))
+        | (layer.astype(np.uint64) << np.uint64(32))
+        | page_id.astype(np.uint64)
+    )
+
+
+def _runs_of(pages: Iterable[int]) -> List[Tuple[int, int]]:
+    p = np.unique(np.fromiter(pages, dtype=np.int64))
+    if len(p) == 0:
+        return []
+    breaks = np.flatnonzero(np.diff(p) != 1)
+    starts = np.concatenate(([p[0]], p[breaks + 1]))
+    ends = np.concatenate((p[breaks], [p[-1]]))
+    return list(zip(starts.tolist(), ends.tolist()))
+
+
+class PackedPageTablePy:
+    """Pure-Python twin of the native packed table (same packed keys, same results).
+
+    Records are (tier, node, gpu) int tuples with -1 for unset node/gpu; residency is
+    tracked as page-id sets per (model, layer, tier, node) for the runs query.
+    """
+
+    def __init__(self, capacity: int = 1024):
+        self._rec: Dict[int, Tuple[int, int, int]] = {}
+        self._pages: Dict[Tuple[int, int, int, int], set] = {}
+
+    def _mark(self, key: int, rec: Tuple[int, int, int], on: bool) -> None:
+        g = (key >> 48, (key >> 32) & 0xFFFF, rec[0], rec[1])
+        if on:
+            self._pages.setdefault(g, set()).add(key & 0xFFFFFFFF)
+            return
+        pages = self._pages.get(g)
+        if pages is not None:
+            pages.discard(key & 0xFFFFFFFF)
+            if not pages:
+                del self._pages[g]
+
+    def bulk_set(self, keys, tier, node, gpu) -> None:
+        keys = np.asarray(keys, dtype=np.uint64).tolist()
+        tier, node, gpu = (np.asarray(a, dtype=np.int64).tolist() for a in (tier, node, gpu))
+        if not (len(keys) == len(tier) == len(node) == len(gpu)):
+            raise ValueError("keys, tier, node and gpu must have the same length")
+        for k, t, n, g in zip(keys, tier, node, gpu):
+            rec = (t, n, g)
+            old = self._rec.get(k)
+            if old is not None and old[:2] != rec[:2]:
+                self._mark(k, old, False)
+            self._rec[k] = rec
+            self._mark(k, rec, True)
+
+    def bulk_get(self, keys):
+        miss = (-1, -1, -1)
+        recs = [self._rec.get(k, miss) for k in np.asarray(keys, dtype=np.uint64).tolist()]
+        arr = np.asarray(recs, dtype=np.int64).reshape(-1, 3)
+        return arr[:, 0].copy(), arr[:, 1].copy(), arr[:, 2].copy()
+
+    def erase(self, keys) -> int:
+        removed = 0
+        for k in np.asarray(keys, dtype=np.uint64).tolist():
+            rec = self._rec.pop(k, None)
+            if rec is not None:
+                self._mark(k, rec, False)
+                removed += 1
+        return removed
+
+    def runs(self, model: int, layers, tier: int, node: int = -1) -> Dict[str, np.ndarray]:
+        want = sorted(set(np.asarray(layers, dtype=np.int64).tolist()))
+        if not want:
+            want = sorted({g[1] for g in self._pages if g[0] == model and g[2] == tier})
+        out_l: List[int] = []
+        out_s: List[int] = []
+        out_e: List[int] = []
+        for layer in want:
+            pages = set()
+            for g, ps in self._pages.items():
+                if g[0] == model and g[1] == layer and g[2] == tier and (node < 0 or g[3] == node):
+                    pages |= ps
+            for s, e in _runs_of(pages):
+                out_l.append(layer)
+                out_s.append(s)
+                out_e.append(e)
+        return {
+            "layer": np.asarray(out_l, dtype=np.int64),
+            "start_pid": np.asarray(out_s, dtype=np.int64),
+            "end_pid": np.asarray(out_e, dtype=np.int64),
+        }
+
+    def clear(self) -> None:
+        self._rec.clear()
+        self._pages.clear()
+
+    def stats(self) -> Dict[str, object]:
+        return {"size": len(self._rec), "bitmaps": len(self._pages)}
+
+    def __len__(self) -> int:
+        return len(self._rec)
+
+
+class CompactPageTable:
+    """
+    PageTable with packed integer keys and compact records, backed by the native
+    bodocache_page_table module when built (PackedPageTablePy otherwise).
+
+    Model specs (model_id, model_version, dtype, n_kv_heads, d_head) and node names are
+    interned to small codes, so a page costs ~24 bytes instead of a string key plus a
+    Location object. Location.path is not part of the compact record; the few pages
+    that carry one keep it in a side dict. The array methods (bulk_set_pages,
+    bulk_get_pages, resident_runs) take and return NumPy columns so callers never loop
+    per page.
+
+    Pages other nodes hold (the peer tier) live in a second packed table whose records
+    name the holder: tier is the holder's CPU/GPU tier, node the holder node. Local
+    residency and remote copies are independent, one remote holder per page.
+    """
+
+    def __init__(self, capacity: int = 1024, prefer_native: bool = True):
+        if prefer_native and _native_pt is not None:
+            self._t = _native_pt.PageTable(capacity=capacity)
+            self._remote = _native_pt.PageTable(capacity=capacity)
+        else:
+            self._t = PackedPageTablePy(capacity=capacity)
+            self._remote = PackedPageTablePy(capacity=capacity)
+        self._models: Dict[Tuple, int] = {}
+        self._model_specs: List[Tuple] = []
+        self._nodes: Dict[str, int] = {}
+        self._node_names: List[str] = []
+        self._paths: Dict[int, str] = {}
+
+    # Interning ---------------------------------------------------------
+    def model_code(self, model_id: str, model_version: str, dtype: str = "", n_kv_heads: int = 0, d_head: int = 0) -> int:
+        spec = (model_id, model_version, dtype, int(n_kv_heads), int(d_head))
+        code = self._models.get(spec)
+        if code is None:
+            if len(self._model_specs) > 0xFFFE:
+                raise ValueError("too many model specs for a packed page table")
+            code = len(self._model_specs)
+            self._models[spec] = code
+            self._model_specs.append(spec)
+        return code
+
+    def node_code(self, node: Optional[str]) -> int:
+        if node is None:
+            return -1
+        code = self._nodes.get(node)
+        if code is None:
+            code = len(self._node_names)
+            self._nodes[node] = code
+            self._node_names.append(node)
+        return code
+
+    def node_codes(self, nodes: Iterable[Optional[str]]) -> np.ndarray:
+        """Codes of node names without interning them (-1 for unknown names and None)."""
+        return np.fromiter((self._nodes.get(n, -1) if n is not None else -1 for n in nodes), dtype=np.int64)
+
+    def node_name(self, code: int) -> Optional[str]:
+        return self._node_names[code] if 0 <= code < len(self._node_names) else None
+
+    def _model_codes(self, model_id: str, model_version: str) -> List[int]:
+        return [c for c, s in enumerate(self._model_specs) if s[0] == model_id and s[1] == model_version]
+
+    def _pack(self, keys: Sequence[PageKey]) -> np.ndarray:
+        models = [self.model_code(k.model_id, k.model_version, k.dtype, k.n_kv_heads, k.d_head) for k in keys]
+        return pack_page_keys(models, [k.layer for k in keys], [k.page_id for k in keys])
+
+    # Array API ---------------------------------------------------------
+    def bulk_set_pages(self, model: int, layer, page_id, tier, node=None, gpu_id=None) -> None:
+        """Set pages of one model code; tier/node/gpu_id broadcast (node as codes or names)."""
+        keys = pack_page_keys(model, layer, page_id)
+        n = len(keys)
+        tier = np.broadcast_to(np.asarray(tier.value if isinstance(tier, Tier) else tier, dtype=np.int64), (n,))
+        if node is None or isinstance(node, str):
+            node = self.node_code(node)
+        node = np.broadcast_to(np.asarray(node, dtype=np.int64), (n,))
+        gpu = np.broadcast_to(np.asarray(-1 if gpu_id is None else gpu_id, dtype=np.int64), (n,))
+        self._t.bulk_set(keys, tier, node, gpu)
+
+    def bulk_get_pages(self, model: int, layer, page_id) -> Dict[str, np.ndarray]:
+        """Columns tier/node/gpu_id (int64, -1 where missing or unset) for pages of one model code."""
+        tier, node, gpu = self._t.bulk_get(pack_page_keys(model, layer, page_id))
+        return {"tier": tier, "node": node, "gpu_id": gpu}
+
+    def erase_pages(self, model: int, layer, page_id) -> int:
+        keys = pack_page_keys(model, layer, page_id)
+        for k in keys.tolist():
+            self._paths.pop(k, None)
+        return int(self._t.erase(keys))
+
+    def resident_runs(
+        self,
+        model_id: str,
+        model_version: str,
+        tier: Tier,
+        layers: Optional[Iterable[int]] = None,
+        node: Optional[str] = None,
+    ) -> pd.DataFrame:
+        """Maximal contiguous page runs resident in `tier` as a frame of
+        (layer, page_start, page_end), inclusive, in the planner's request-column names.
+        Restricted to `node` when given and to `layers` when given (all layers otherwise).
+        """
+        lay = np.asarray([] if layers is None else list(layers), dtype=np.int64)
+        if node is not None and node not in self._nodes:
+            codes: List[int] = []
+        else:
+            codes = self._model_codes(model_id, model_version)
+        nd = -1 if node is None else self._nodes.get(node, -1)
+        parts = [self._t.runs(c, lay, tier.value, nd) for c in codes]
+        cols = {
+            "layer": np.concatenate([p["layer"] for p in parts]) if parts else np.zeros(0, dtype=np.int64),
+            "page_start": np.concatenate([p["start_pid"] for p in parts]) if parts else np.zeros(0, dtype=np.int64),
+            "page_end": np.concatenate([p["end_pid"] for p in parts]) if parts else np.zeros(0, dtype=np.int64),
+        }
+        out = pd.DataFrame(cols)
+        if len(parts) > 1:
+            out = out.sort_values(["layer", "page_start"], kind="mergesort").reset_index(drop=True)
+        return out
+
+    # Remote (peer tier) locations ---------------------------------------
+    def bulk_set_remote_pages(self, model: int, layer, page_id, tier, node, gpu_id=None) -> None:
+        """Record that `node` (code or name) holds these pages of one model code in `tier`."""
+        if isinstance(node, str):
+            node = self.node_code(node)
+        node = np.asarray(node, dtype=np.int64)
+        if (node < 0).any():
+            raise ValueError("remote pages need a holder node")
+        keys = pack_page_keys(model, layer, page_id)
+        n = len(keys)
+        tier = np.broadcast_to(np.asarray(tier.value if isinstance(tier, Tier) else tier, dtype=np.int64), (n,))
+        gpu = np.broadcast_to(np.asarray(-1 if gpu_id is None else gpu_id, dtype=np.int64), (n,))
+        self._remote.bulk_set(keys, tier, np.broadcast_to(node, (n,)), gpu)
+
+    def bulk_get_remote_pages(self, model: int, layer, page_id) -> Dict[str, np.ndarray]:
+        """Holder columns tier/node/gpu_id (int64, -1 where no other node holds the page)."""
+        tier, node, gpu = self._remote.bulk_get(pack_page_keys(model, layer, page_id))
+        return {"tier": tier, "node": node, "gpu_id": gpu}
+
+    def erase_remote_pages(self, model: int, layer, page_id) -> int:
+        return int(self._remote.erase(pack_page_keys(model, layer, page_id)))
+
+    def remote_holders(self, model_id: str, model_version: str, layer, page_id) -> Dict[str, np.ndarray]:
+        """bulk_get_remote_pages over every model spec of (model_id, model_version): the
+        first spec with a holder wins. Unknown models give all -1."""
+        layer = np.asarray(layer, dtype=np.int64)
+        out = {k: np.full(len(layer), -1, dtype=np.int64) for k in ("tier", "node", "gpu_id")}
+        for code in self._model_codes(model_id, model_version):
+            got = self.bulk_get_remote_pages(code, layer, page_id)
+            fill = (out["node"] < 0) & (got["node"] >= 0)
+            for k in out:
+                out[k][fill] = got[k][fill]
+        return out
+
+    def remote_runs(
+        self,
+        model_id: str,
+        model_version: str,
+        layers: Optional[Iterable[int]] = None,
+        exclude_node: Optional[str] = None,
+    ) -> pd.DataFrame:
+        """Maximal contiguous runs held by one other node as (layer, page_start, page_end,
+        peer_node, peer_tier), ordered by layer and page_start."""
+        lay = np.asarray([] if layers is None else list(layers), dtype=np.int64)
+        parts = []
+        for code in self._model_codes(model_id, model_version):
+            for nd, name in enumerate(self._node_names):
+                if name == exclude_node:
+                    continue
+                for tier in (Tier.CPU, Tier.GPU):
+                    r = self._remote.runs(code, lay, tier.value, nd)
+                    if len(r["layer"]):
+                        parts.append(pd.DataFrame({
+                            "layer": r["layer"], "page_start": r["start_pid"], "page_end": r["end_pid"],
+                            "peer_node": name, "peer_tier": np.int64(tier.value),
+                        }))
+        if not parts:
+            return pd.DataFrame({
+                "layer": np.zeros(0, dtype=np.int64), "page_start": np.zeros(0, dtype=np.int64),
+                "page_end": np.zeros(0, dtype=np.int64), "peer_node": np.zeros(0, dtype=object),
+                "peer_tier": np.zeros(0, dtype=np.int64),
+            })
+        out = pd.concat(parts, ignore_index=True)
+        return out.sort_values(["layer", "page_start"], kind="mergesort").reset_index(drop=True)
+
+    def drop_remote_node(self, node: str) -> int:
+        """Forget every page `node` holds (it left, or flushed its cache); returns the count."""
+        nd = self._nodes.get(node)
+        if nd is None:
+            return 0
+        removed = 0
+        for code in range(len(self._model_specs)):
+            for tier in (Tier.CPU, Tier.GPU):
+                r = self._remote.runs(code, np.zeros(0, dtype=np.int64), tier.value, nd)
+                if not len(r["layer"]):
+                    continue
+                n = (r["end_pid"] - r["start_pid"] + 1).astype(np.int64)
+                layer = np.repeat(r["layer"], n)
+                pid = np.repeat(r["start_pid"], n) + (np.arange(int(n.sum())) - np.repeat(np.cumsum(n) - n, n))
+                removed += int(self._remote.erase(pack_page_keys(code, layer, pid)))
+        return removed
+
+    # PageTable-compatible API -----------------------------------------
+    def set(self, key: PageKey, location: Location):
+        self.bulk_set([key], [location])
+
+    def get(self, key: PageKey) -> Optional[Location]:
+        return self.bulk_get([key])[0]
+
+    def exists(self, key: PageKey) -> bool:
+        return self.get(key) is not None
+
+    def bulk_set(self, keys: Iterable[PageKey], locations: Iterable[Location]) -> None:
+        keys = list(keys)
+        locations = list(locations)
+        if len(keys) != len(locations):
+            raise ValueError("keys and locations must have the same length")
+        packed = self._pack(keys)
+        tier = np.asarray([loc.tier.value for loc in locations], dtype=np.int64)
+        node = np.asarray([self.node_code(loc.node) for loc in locations], dtype=np.int64)
+        gpu = np.asarray([-1 if loc.gpu_id is None else loc.gpu_id for loc in locations], dtype=np.int64)
+        self._t.bulk_set(packed, tier, node, gpu)
+        for k, loc in zip(packed.tolist(), locations):
+            if loc.path is not None:
+                self._paths[k] = loc.path
+            else:
+                self._paths.pop(k, None)
+
+    def bulk_get(self, keys: Iterable[PageKey]) -> List[Optional[Location]]:
+        keys = list(keys)
+        if not keys:
+            return []
+        # Lookups must not intern unseen model specs
+        known = [(k.model_id, k.model_version, k.dtype, int(k.n_kv_heads), int(k.d_head)) in self._models for k in keys]
+        hit = [k for k, ok in zip(keys, known) if ok]
+        out: List[Optional[Location]] = [None] * len(keys)
+        if not hit:
+            return out
+        packed = self._pack(hit)
+        tier, node, gpu = self._t.bulk_get(packed)
+        slots = [i for i, ok in enumerate(known) if ok]
+        for i, k, t, n, g in zip(slots, packed.tolist(), tier.tolist(), node.tolist(), gpu.tolist()):
+            if t < 0:
+                continue
+            out[i] = Location(
+                tier=Tier(t),
+                node=self._node_names[n] if n >= 0 else None,
+                path=self._paths.get(k),
+                gpu_id=g if g >= 0 else None,
+            )
+        return out
+
+    def set_remote(self, key: PageKey, location: Location):
+        if location.node is None:
+            raise ValueError("a remote location needs the holder node")
+        code = self.model_code(key.model_id, key.model_version, key.dtype, key.n_kv_heads, key.d_head)
+        self.bulk_set_remote_pages(code, [key.layer], [key.page_id], location.tier, location.node, location.gpu_id)
+
+    def get_remote(self, key: PageKey) -> Optional[Location]:
+        code = self._models.get((key.model_id, key.model_version, key.dtype, int(key.n_kv_heads), int(key.d_head)))
+        if code is None:
+            return None
+        got = self.bulk_get_remote_pages(code, [key.layer], [key.page_id])
+        if got["node"][0] < 0:
+            return None
+        g = int(got["gpu_id"][0])
+        return Location(tier=Tier(int(got["tier"][0])), node=self._node_names[int(got["node"][0])],
+                        gpu_id=g if g >= 0 else None)
+
+    def erase_remote(self, key: PageKey) -> bool:
+        code = self._models.get((key.model_id, key.model_version, key.dtype, int(key.n_kv_heads), int(key.d_head)))
+        return code is not None and self.erase_remote_pages(code, [key.layer], [key.page_id]) > 0
+
+    def stats(self) -> Dict[str, object]:
+        st = dict(self._t.stats())
+        st.update({"models": len(self._model_specs), "nodes": len(self._node_names), "paths": len(self._paths),
+                   "remote": len(self._remote)})
+        return st
+
+    def __len__(self) -> int:
+        return len(self._t)
@@ -0,0 +1,85 @@
+from __future__ import annotations
+
+import numpy as np
+import pandas as pd
+
+from .models import Tier
+from .page_table import CompactPageTable
+
+# Peer tier. A page another node already holds in CPU or GPU memory is cheaper to pull
+# over the cluster fabric than to read from storage again. route_peer_requests() rewrites
+# storage requests against the page table's remote locations: each request splits into
+# contiguous sub-requests, and the runs some other node holds get tier_src = Tier.PEER.
+# The cores then coalesce and cap peer runs as their own (node, PEER, tier_dst) groups,
+# and pipeline.apply_peer_caps holds a node's peer ops to the link budget on the
+# `tier == 3` row of tier_caps_df. Which node serves a run is not part of the plan; the
+# agent resolves it from the same page table when it executes the op (agent/peer.py).
+
+
+def route_peer_requests(
+    requests_df: pd.DataFrame,
+    page_table: CompactPageTable,
+    min_pages: int = 1,
+) -> pd.DataFrame:
+    """requests_df with storage reads of pages held by another node moved to the peer tier.
+
+    Only tier_src == STORAGE requests are considered. A page counts as remote when a node
+    other than the request's node holds it; remote runs shorter than min_pages stay on
+    storage. Split rows keep every other column of their request, in request order then
+    page order. Returns requests_df itself when nothing is routed.
+    """
+    if requests_df.empty:
+        return requests_df
+    start = requests_df["page_start"].to_numpy(dtype=np.int64)
+    end = requests_df["page_end"].to_numpy(dtype=np.int64)
+    storage = requests_df["tier_src"].to_numpy() == Tier.STORAGE.value
+    n = np.where(storage, np.maximum(end - start + 1, 0), 0)
+    cand = np.flatnonzero(n > 0)
+    if not len(cand):
+        return requests_df
+    counts = n[cand]
+    row = np.repeat(cand, counts)
+    pid = start[row] + (np.arange(len(row), dtype=np.int64) - np.repeat(np.cumsum(counts) - counts, counts))
+    layer = requests_df["layer"].to_numpy(dtype=np.int64)[row]
+
+    holder = np.full(len(row), -1, dtype=np.int64)
+    models = pd.MultiIndex.from_arrays([
+        requests_df["model_id"].astype(str).to_numpy()[row], requests_df["model_version"].astype(str).to_numpy()[row],
+    ])
+    codes, uniques = pd.factorize(models)
+    for k, (model_id, model_version) in enumerate(uniques):
+        m = codes == k
+        holder[m] = page_table.remote_holders(model_id, model_version, layer[m], pid[m])["node"]
+    local = page_table.node_codes(requests_df["node"].to_numpy()[cand])
+    remote = (holder >= 0) & (holder != np.repeat(local, counts))
+    if not remote.any():
+        return requests_df
+
+    def segments(flag: np.ndarray):
+        new = np.ones(len(row), dtype=bool)
+        new[1:] = (row[1:] != row[:-1]) | (flag[1:] != flag[:-1])
+        first = np.flatnonzero(new)
+        last = np.append(first[1:] - 1, len(row) - 1)
+        return first, last
+
+    first, last = segments(remote)
+    if min_pages > 1:
+        short = remote[first] & (last - first + 1 < min_pages)
+        if short.any():
+            remote = remote.copy()
+            for f, l in zip(first[short], last[short]):
+                remote[f:l + 1] = False
+            if not remote.any():
+                return requests_df
+            first, last = segments(remote)
+
+    split = requests_df.iloc[row[first]].copy()
+    split["page_start"] = pid[first].astype(requests_df["page_start"].dtype, copy=False)
+    split["page_end"] = pid[last].astype(requests_df["page_end"].dtype, copy=False)
+    tier_src = np.where(remote[first], Tier.PEER.value, Tier.STORAGE.value)
+    split["tier_src"] = tier_src.astype(requests_df["tier_src"].dtype, copy=False)
+    keep = np.ones(len(requests_df), dtype=bool)
+    keep[cand] = False
+    rest = requests_df[keep]
+    order = np.argsort(np.concatenate([np.flatnonzero(keep), row[first]]), kind="stable")
+    return pd.concat([rest, split]).iloc[order].reset_index(drop=True)
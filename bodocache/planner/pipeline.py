@@ -3,6 +3,43 @@ from __future__ import annotations
 import numpy as np
 import pandas as pd
 
+from .models import Tier
+
+
+def stored_page_view(requests_df: pd.DataFrame):
+    """Requests as the planner cores should size them, plus the page size map to undo it.
+
+    An optional `stored_page_bytes` column gives the bytes one page occupies on its
+    source tier (encoded KV pages, see adapters/page_codec.py). The cores then coalesce,
+    cap and estimate copy time on the stored size, so `bytes`, tier/tenant caps and
+    `est_copy_ms`/overlap follow what actually crosses storage and PCIe. Returns
+    (requests, None) when the column is absent.
+    """
+    if "stored_page_bytes" not in requests_df.columns:
+        return requests_df, None
+    stored = requests_df["stored_page_bytes"].fillna(requests_df["page_bytes"]).astype(np.int64)
+    pages = pd.DataFrame({
+        "tier_src": requests_df["tier_src"].to_numpy(),
+        "stored_page_bytes": stored.to_numpy(),
+        "page_bytes": requests_df["page_bytes"].astype(np.int64).to_numpy(),
+    }).drop_duplicates()
+    if pages.duplicated(["tier_src", "stored_page_bytes"]).any():
+        raise ValueError("each (tier_src, stored_page_bytes) must correspond to a single page_bytes")
+    req = requests_df.drop(columns=["stored_page_bytes"])
+    req["page_bytes"] = stored.to_numpy()
+    return req, pages.reset_index(drop=True)
+
+
+def restore_page_bytes(plan: pd.DataFrame, pages: pd.DataFrame) -> pd.DataFrame:
+    """Map a plan sized by stored_page_view() back to logical page_bytes.
+
+    `bytes` stays the stored size; `stored_page_bytes` is added next to page_bytes.
+    """
+    out = plan.rename(columns={"page_bytes": "stored_page_bytes"})
+    out = out.merge(pages, on=["tier_src", "stored_page_bytes"], how="left", sort=False)
+    out["page_bytes"] = out["page_bytes"].fillna(out["stored_page_bytes"]).astype(np.int64)
+    return out[list(plan.columns) + ["stored_page_bytes"]]
+
 
 def score_and_filter(
     requests_df: pd.DataFrame,
@@ -146,3 +183,86 @@ def apply_caps(
         "start_pid", "end_pid", "page_bytes",
     ]]
     return plan.reset_index(drop=True)
+
+
+def apply_peer_caps(
+    plan: pd.DataFrame,
+    tier_caps_df: pd.DataFrame,
+    layer_lat_df: pd.DataFrame | None,
+    window_ms: int,
+    enforce_tier_caps: bool,
+) -> pd.DataFrame:
+    """Cap peer-tier ops (tier_src == Tier.PEER) by the peer link's own row in tier_caps_df.
+
+    The cores cap every op by its destination tier. A `tier == 3` row in tier_caps_df
+    is the node's budget for pages pulled from other nodes (NIC/NVLink bytes per
+    window): peer ops of a node take it in deadline order, and their overlap hint is
+    re-estimated at the slower of the link and the destination tier. Plans without
+    peer ops, or caps without a peer row, are returned unchanged.
+    """
+    if plan.empty or "tier" not in tier_caps_df.columns:
+        return plan
+    link = tier_caps_df[tier_caps_df["tier"] == Tier.PEER.value]
+    peer = plan["tier_src"].to_numpy() == Tier.PEER.value
+    if link.empty or not peer.any():
+        return plan
+    link_bw = float(link["bandwidth_caps"].iloc[0])
+    rows = plan[peer]
+    dst_bw = rows["tier_dst"].map(tier_caps_df.set_index("tier")["bandwidth_caps"]).astype(float)
+    bw = np.minimum(dst_bw.fillna(link_bw).to_numpy(), link_bw)
+    est = rows["bytes"].to_numpy(dtype=float) / np.maximum(bw, 1.0) * float(window_ms)
+    lat = np.ones(len(rows))
+    if layer_lat_df is not None and len(layer_lat_df):
+        lat_ms = rows["layer"].map(layer_lat_df.drop_duplicates("layer", keep="last").set_index("layer")["lat_ms"])
+        lat = lat_ms.astype(float).fillna(1.0).to_numpy()
+    out = plan.copy()
+    out.loc[peer, "overlap"] = np.minimum(3, 1 + (est > lat) + (est > 2.0 * lat)).astype(out["overlap"].dtype)
+    if not enforce_tier_caps:
+        return out
+    by_deadline = rows.sort_values(by=["node", "deadline_ms"], kind="stable")
+    cum = by_deadline.groupby("node", sort=False)["bytes"].cumsum()
+    keep = np.ones(len(out), dtype=bool)
+    keep[np.flatnonzero(peer)] = (cum.reindex(rows.index) <= link_bw).to_numpy()
+    return out[keep].reset_index(drop=True)
+
+
+def merge_layer_runs(plan: pd.DataFrame) -> pd.DataFrame:
+    """Merge plan ops that read the same pages of consecutive layers into one op.
+
+    With a page-major segment (PackedSegmentBackend) pages [start_pid, end_pid] of
+    layers [layer, layer_end] are one sequential extent, so a prefix that touches many
+    layers becomes a single large read instead of one per layer. Ops chain when they
+    share node/tier_src/tier_dst/pcluster/start_pid/end_pid/page_bytes and their layers
+    are consecutive. Merged ops sum bytes and fanout, keep the earliest deadline, the
+    most urgent priority and the highest overlap, and take the position of their first
+    op. Adds `layer_end` (equal to `layer` for ops that did not merge).
+    """
+    out = plan.copy()
+    if out.empty:
+        out["layer_end"] = out["layer"]
+        return out
+    out["_pos"] = np.arange(len(out), dtype=np.int64)
+    key = ["node", "tier_src", "tier_dst", "pcluster", "start_pid", "end_pid", "page_bytes"]
+    out = out.sort_values(by=key + ["layer"], kind="mergesort").reset_index(drop=True)
+    same = (out[key].shift(1) == out[key]).all(axis=1)
+    chained = same & (out["layer"] == out["layer"].shift(1) + 1)
+    out["_chain"] = np.cumsum(~chained.to_numpy())
+    agg = {
+        "layer": ("layer", "min"),
+        "layer_end": ("layer", "max"),
+        "run_id": ("run_id", "first"),
+        "bytes": ("bytes", "sum"),
+        "deadline_ms": ("deadline_ms", "min"),
+        "fanout": ("fanout", "sum"),
+        "_pos": ("_pos", "min"),
+    }
+    if "overlap" in out.columns:
+        agg["overlap"] = ("overlap", "max")
+    if "priority" in out.columns:
+        agg["priority"] = ("priority", "min")
+    if "stored_page_bytes" in out.columns:
+        agg["stored_page_bytes"] = ("stored_page_bytes", "first")
+    merged = out.groupby(key + ["_chain"], sort=False).agg(**agg).reset_index()
+    cols = [c for c in plan.columns if c in merged.columns] + ["layer_end"]
+    merged = merged.sort_values("_pos", kind="mergesort")
+    return merged[cols].reset_index(drop=True)
@@ -2,6 +2,8 @@ from __future__ import annotations
 
 from typing import Iterable, List
 
+from .minhash import lsh_band_keys, minhash_signatures
+
 # Optional blake3 with fallback for environments without the library
 try:  # pragma: no cover - trivial import/fallback
     from blake3 import blake3 as _blake3_ctor  # type: ignore
@@ -25,7 +27,10 @@ def prefix_id(token_ids: Iterable[int], P: int = 128) -> str:
 
 
 def minhash_bucket(ngrams: List[int], bands: int = 16, rows: int = 4) -> int:
-    """Very simple minhash bucket placeholder for near-duplicate prefix grouping."""
-    # Not a true minhash; replace with proper LSH in production.
-    h = _blake_digest(bytes(ngrams))
-    return int.from_bytes(h[:4], "little")
+    """LSH bucket of an n-gram set: the first band key of its bands*rows MinHash signature.
+
+    Two sets with Jaccard similarity s share this bucket with probability s**rows; use
+    lsh_band_keys (or an LSH index) over all bands for the usual 1-(1-s**rows)**bands.
+    """
+    sig = minhash_signatures([list(ngrams)], num_hashes=bands * rows, k=1)
+    return int(lsh_band_keys(sig, bands, rows)[0, 0])
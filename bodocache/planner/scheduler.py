@@ -9,6 +9,7 @@ import pandas as pd
 # Optional Bodo dependency: provide a no-op fallback for tests/runtime without Bodo
 try:  # pragma: no cover - trivial import/fallback
     import bodo  # type: ignore
+    _HAVE_BODO = True
 except Exception:  # Bodo not available; define a minimal shim with a no-op jit decorator
     class _NoBodo:  # pragma: no cover - simple decorator shim
         def jit(self, func=None, **kwargs):
@@ -19,8 +20,24 @@ except Exception:  # Bodo not available; define a minimal shim with a no-op jit
             return func
 
     bodo = _NoBodo()  # type: ignore
-
-from .pipeline import score_and_filter, apply_tenant_caps, coalesce_intervals, apply_caps
+    _HAVE_BODO = False
+
+# Optional native coalesce/caps kernel (native/planner_kernel.cpp), used when Bodo is absent
+try:  # pragma: no cover - depends on the native build
+    import bodocache_planner_kernel as _planner_kernel  # type: ignore
+except Exception:
+    _planner_kernel = None
+
+from .pipeline import (
+    score_and_filter,
+    apply_tenant_caps,
+    coalesce_intervals,
+    apply_caps,
+    apply_peer_caps,
+    merge_layer_runs,
+    restore_page_bytes,
+    stored_page_view,
+)
 
 @bodo.jit
 def run_window_core(
@@ -204,6 +221,79 @@ def run_window_core_py(
     return plan
 
 
+def run_window_core_native(
+    requests_df: pd.DataFrame,
+    heat_df: pd.DataFrame,
+    tier_caps_df: pd.DataFrame,
+    tenant_caps_df: pd.DataFrame,
+    layer_lat_df: pd.DataFrame,
+    now_ms: int,
+    pmin: float,
+    umin: float,
+    min_io_bytes: int,
+    alpha: float,
+    beta: float,
+    window_ms: int,
+    max_ops_per_tier: int,
+    enforce_tier_caps: bool,
+) -> pd.DataFrame:
+    """Scoring in pandas, then tenant caps + coalescing + tier caps in one native call.
+
+    Returns the same columns, order and dtypes as run_window_core_py.
+    """
+    if _planner_kernel is None:
+        raise RuntimeError("bodocache_planner_kernel is not available")
+    cand = score_and_filter(requests_df, heat_df, now_ms, pmin, umin, alpha, beta)
+    # Sorted codes keep the kernel's integer order identical to pandas' string order
+    node_codes, node_uniques = pd.factorize(cand["node"], sort=True)
+    n = len(cand)
+    tenant_codes, _ = pd.factorize(
+        pd.concat([cand["tenant"], tenant_caps_df["tenant"]], ignore_index=True), sort=False
+    )
+
+    def col(df, name, dtype=np.int64):
+        return np.ascontiguousarray(df[name].to_numpy(dtype=dtype, na_value=-1 if dtype is np.int64 else np.nan))
+
+    out = _planner_kernel.plan_window(
+        node=node_codes.astype(np.int64),
+        tier_src=col(cand, "tier_src"),
+        tier_dst=col(cand, "tier_dst"),
+        pcluster=col(cand, "pcluster"),
+        layer=col(cand, "layer"),
+        page_start=col(cand, "page_start"),
+        page_end=col(cand, "page_end"),
+        page_bytes=col(cand, "page_bytes"),
+        deadline_ms=col(cand, "deadline_ms"),
+        urgency=col(cand, "urgency", np.float64),
+        tenant=tenant_codes[:n].astype(np.int64),
+        cap_tenant=tenant_codes[n:].astype(np.int64),
+        cap_tier=col(tenant_caps_df, "tier"),
+        cap_bytes=col(tenant_caps_df, "bandwidth_caps", np.float64),
+        tier=col(tier_caps_df, "tier"),
+        bandwidth_caps=col(tier_caps_df, "bandwidth_caps", np.float64),
+        free_bytes=col(tier_caps_df, "free_bytes", np.float64),
+        lat_layer=col(layer_lat_df, "layer"),
+        lat_ms=col(layer_lat_df, "lat_ms", np.float64),
+        min_io_bytes=int(min_io_bytes),
+        window_ms=float(window_ms),
+        max_ops_per_tier=int(max_ops_per_tier),
+        enforce_tier_caps=bool(enforce_tier_caps),
+    )
+    plan = pd.DataFrame({"node": np.asarray(node_uniques, dtype=object)[out["node"]]})
+    # Aggregated key/min/max columns keep the dtype of the candidate column they came from
+    src = {
+        "tier_src": "tier_src", "tier_dst": "tier_dst", "pcluster": "pcluster", "layer": "layer",
+        "deadline_ms": "deadline_ms", "start_pid": "page_start", "end_pid": "page_end", "page_bytes": "page_bytes",
+    }
+    for name in ["tier_src", "tier_dst", "pcluster", "layer", "run_id", "bytes", "deadline_ms", "fanout",
+                 "overlap", "priority", "start_pid", "end_pid", "page_bytes"]:
+        values = out[name]
+        if name in src:
+            values = values.astype(cand[src[name]].dtype, copy=False)
+        plan[name] = values
+    return plan
+
+
 def run_window(
     requests_df: pd.DataFrame,
     heat_df: pd.DataFrame,
@@ -221,73 +311,116 @@ def run_window(
     enable_admission: bool | np.bool_ = True,
     enable_eviction: bool | np.bool_ = True,
     enforce_tier_caps: bool | np.bool_ = True,
+    merge_layers: bool = False,
 ):
+    """Plan one window; returns (plan_df, evict_df, admission_df).
+
+    merge_layers=True folds ops that read the same pages of consecutive layers into
+    one op with a `layer_end` column (see pipeline.merge_layer_runs), for page-major
+    packed segments. Eviction and admission always see the per-layer plan.
+
+    An optional requests column `stored_page_bytes` (encoded pages on the source tier)
+    sizes `bytes`, caps and `est_copy_ms` by the stored size; the plan then carries
+    `stored_page_bytes` next to the logical page_bytes (see pipeline.stored_page_view).
+    """
+    requests_df = with_pclusters(requests_df)
+    core_requests, stored_pages = stored_page_view(requests_df)
+    force_py = pure_py_forced()
+    plan_df = plan_core(
+        core_requests,
+        heat_df,
+        tier_caps_df,
+        tenant_caps_df,
+        layer_lat_df,
+        now_ms,
+        pmin,
+        umin,
+        min_io_bytes,
+        alpha,
+        beta,
+        window_ms,
+        max_ops_per_tier,
+        bool(enforce_tier_caps),
+        force_py=force_py,
+    )
+    return finish_window(
+        plan_df, stored_pages, requests_df, heat_df, tier_caps_df,
+        enable_admission=enable_admission, enable_eviction=enable_eviction, merge_layers=merge_layers,
+        force_py=force_py, layer_lat_df=layer_lat_df, window_ms=window_ms, enforce_tier_caps=enforce_tier_caps,
+    )
+
+
+def with_pclusters(requests_df: pd.DataFrame) -> pd.DataFrame:
     # Ensure numeric prefix clusters for JIT-friendly fan-out grouping
     if "pcluster" not in requests_df.columns:
         codes, _ = pd.factorize(requests_df["prefix_id"], sort=False)
         requests_df = requests_df.copy()
         requests_df["pcluster"] = codes.astype(np.int64)
+    return requests_df
 
-    FORCE_PY = str(os.environ.get("BODOCACHE_PURE_PY", "")).lower() in ("1", "true", "yes")
-    if FORCE_PY:
-        plan_df = run_window_core_py(
-            requests_df,
-            heat_df,
-            tier_caps_df,
-            tenant_caps_df,
-            layer_lat_df,
-            now_ms,
-            pmin,
-            umin,
-            min_io_bytes,
-            alpha,
-            beta,
-            window_ms,
-            max_ops_per_tier,
-            bool(enforce_tier_caps),
-        )
-    else:
-        try:
-            plan_df = run_window_core(
-                requests_df,
-                heat_df,
-                tier_caps_df,
-                tenant_caps_df,
-                layer_lat_df,
-                now_ms,
-                pmin,
-                umin,
-                min_io_bytes,
-                alpha,
-                beta,
-                window_ms,
-                max_ops_per_tier,
-                bool(enforce_tier_caps),
-            )
-        except Exception:
-            # Fallback to pure-Python core if JIT compilation/execution fails
-            plan_df = run_window_core_py(
-                requests_df,
-                heat_df,
-                tier_caps_df,
-                tenant_caps_df,
-                layer_lat_df,
-                now_ms,
-                pmin,
-                umin,
-                min_io_bytes,
-                alpha,
-                beta,
-                window_ms,
-                max_ops_per_tier,
-                bool(enforce_tier_caps),
-            )
+
+def pure_py_forced() -> bool:
+    return str(os.environ.get("BODOCACHE_PURE_PY", "")).lower() in ("1", "true", "yes")
+
+
+def plan_core(
+    core_requests: pd.DataFrame,
+    heat_df: pd.DataFrame,
+    tier_caps_df: pd.DataFrame,
+    tenant_caps_df: pd.DataFrame,
+    layer_lat_df: pd.DataFrame,
+    now_ms: int,
+    pmin: float,
+    umin: float,
+    min_io_bytes: int,
+    alpha: float,
+    beta: float,
+    window_ms: int,
+    max_ops_per_tier: int,
+    enforce_tier_caps: bool,
+    force_py: bool = False,
+) -> pd.DataFrame:
+    """The planner core run_window picks: pandas when forced, else the native kernel
+    without Bodo or the Bodo JIT core, each falling back to pandas on failure."""
+    args = (
+        core_requests, heat_df, tier_caps_df, tenant_caps_df, layer_lat_df, now_ms,
+        pmin, umin, min_io_bytes, alpha, beta, window_ms, max_ops_per_tier, bool(enforce_tier_caps),
+    )
+    if force_py:
+        return run_window_core_py(*args)
+    core = run_window_core_native if (not _HAVE_BODO and _planner_kernel is not None) else run_window_core
+    try:
+        return core(*args)
+    except Exception:
+        # Fallback to pure-Python core if JIT compilation/execution or the kernel fails
+        return run_window_core_py(*args)
+
+
+def finish_window(
+    plan_df: pd.DataFrame,
+    stored_pages: pd.DataFrame | None,
+    requests_df: pd.DataFrame,
+    heat_df: pd.DataFrame,
+    tier_caps_df: pd.DataFrame,
+    enable_admission: bool | np.bool_ = True,
+    enable_eviction: bool | np.bool_ = True,
+    merge_layers: bool = False,
+    force_py: bool = False,
+    layer_lat_df: pd.DataFrame | None = None,
+    window_ms: int = 20,
+    enforce_tier_caps: bool | np.bool_ = True,
+):
+    """Everything run_window does after the core: peer link caps, page size restore,
+    eviction, admission and layer merging. Returns (plan_df, evict_df, admission_df)."""
+    plan_df = apply_peer_caps(plan_df, tier_caps_df, layer_lat_df, window_ms, bool(enforce_tier_caps))
+    if stored_pages is not None:
+        plan_df = restore_page_bytes(plan_df, stored_pages)
     # Prepare heat_df for JIT eviction (ensure size_bytes present)
     heat2 = heat_df.copy()
     if "size_bytes" not in heat2.columns:
         heat2["size_bytes"] = np.int64(256 * 1024)
     if bool(enable_eviction):
-        if FORCE_PY:
+        if force_py:
             evict = eviction_core_py(plan_df, heat2, tier_caps_df)
         else:
             try:
@@ -297,7 +430,7 @@ def run_window(
     else:
         evict = heat2[["layer", "page_id"]].head(0)
     if bool(enable_admission):
-        if FORCE_PY:
+        if force_py:
             admission = admission_core_py(requests_df, heat_df, reuse_threshold=10.0)
         else:
             try:
@@ -306,6 +439,8 @@ def run_window(
                 admission = admission_core_py(requests_df, heat_df, reuse_threshold=10.0)
     else:
         admission = heat_df[["layer", "page_id"]].head(0)
+    if merge_layers:
+        plan_df = merge_layer_runs(plan_df)
     return plan_df, evict, admission
 
 
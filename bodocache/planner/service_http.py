@@ -1,8 +1,8 @@
 from __future__ import annotations
 
 import json
-from http.server import BaseHTTPRequestHandler, HTTPServer
-from typing import Any, Dict, Tuple
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from typing import Any, Dict, List, Tuple
 
 import pandas as pd
 
@@ -15,17 +15,25 @@ def df_from_json(obj: Any, columns: list[str]) -> pd.DataFrame:
     return pd.DataFrame(obj, columns=columns)
 
 
-def plan_from_payload(payload: Dict[str, Any]) -> Tuple[pd.DataFrame, pd.DataFrame, pd.DataFrame]:
-    req = df_from_json(payload.get("requests"), [
-        "req_id","node","model_id","model_version","prefix_id","layer","page_start","page_end","tier_src","tier_dst","deadline_ms","page_bytes","tenant","est_fill_ms"
-    ])
-    heat = df_from_json(payload.get("heat"), ["layer","page_id","decay_hits","tenant_weight"])
-    tiers = df_from_json(payload.get("tier_caps"), ["tier","bandwidth_caps","free_bytes"])
-    tenant_caps = df_from_json(payload.get("tenant_caps"), ["tenant","tier","bandwidth_caps"])
-    lats = df_from_json(payload.get("layer_lat"), ["layer","lat_ms"])
-    now_ms = int(payload.get("now_ms", 0))
-    knobs = payload.get("knobs", {})
+REQUEST_COLUMNS = [
+    "req_id","node","model_id","model_version","prefix_id","layer","page_start","page_end","tier_src","tier_dst","deadline_ms","page_bytes","tenant","est_fill_ms"
+]
+HEAT_COLUMNS = ["layer","page_id","decay_hits","tenant_weight"]
+TIER_CAPS_COLUMNS = ["tier","bandwidth_caps","free_bytes"]
+TENANT_CAPS_COLUMNS = ["tenant","tier","bandwidth_caps"]
+LAYER_LAT_COLUMNS = ["layer","lat_ms"]
+
 
+def plan_from_frames(
+    req: pd.DataFrame,
+    heat: pd.DataFrame,
+    tiers: pd.DataFrame,
+    tenant_caps: pd.DataFrame,
+    lats: pd.DataFrame,
+    now_ms: int,
+    knobs: Dict[str, Any],
+) -> Tuple[pd.DataFrame, pd.DataFrame, pd.DataFrame]:
+    # Shared by the JSON endpoint and the binary RPC (service_rpc.py)
     plan_df, evict_df, admission_df = run_window(
         req, heat, tiers, tenant_caps, lats, now_ms,
         pmin=float(knobs.get("pmin", 1.0)),
@@ -42,6 +50,80 @@ def plan_from_payload(payload: Dict[str, Any]) -> Tuple[pd.DataFrame, pd.DataFra
     return plan_df, evict_df, admission_df
 
 
+def plan_from_payload(payload: Dict[str, Any]) -> Tuple[pd.DataFrame, pd.DataFrame, pd.DataFrame]:
+    req = df_from_json(payload.get("requests"), REQUEST_COLUMNS)
+    heat = df_from_json(payload.get("heat"), HEAT_COLUMNS)
+    tiers = df_from_json(payload.get("tier_caps"), TIER_CAPS_COLUMNS)
+    tenant_caps = df_from_json(payload.get("tenant_caps"), TENANT_CAPS_COLUMNS)
+    lats = df_from_json(payload.get("layer_lat"), LAYER_LAT_COLUMNS)
+    return plan_from_frames(req, heat, tiers, tenant_caps, lats, int(payload.get("now_ms", 0)), payload.get("knobs", {}))
+
+
+# Latest copy engine stats() snapshot per node, from POST /report {"node", "engine_stats"}
+ENGINE_REPORTS: Dict[str, Dict[str, Any]] = {}
+
+_PHASES = ("read", "queue_wait", "dma", "e2e")
+_QUANTILES = (("0.5", "p50_ns"), ("0.9", "p90_ns"), ("0.99", "p99_ns"), ("0.999", "p999_ns"))
+
+
+def _labels(**kv: Any) -> str:
+    def esc(v: Any) -> str:
+        return str(v).replace("\\", "\\\\").replace('"', '\\"').replace("\n", "\\n")
+
+    return "{" + ",".join(f'{k}="{esc(v)}"' for k, v in kv.items()) + "}"
+
+
+def prometheus_metrics(reports: Dict[str, Dict[str, Any]]) -> str:
+    """Render engine stats() snapshots (keyed by node) in the Prometheus text format."""
+    series: Dict[str, Tuple[str, str, List[str]]] = {}
+
+    def add(name: str, kind: str, help_: str, labels: str, value: Any) -> None:
+        v = float(value)
+        text = str(int(v)) if v.is_integer() else repr(v)
+        series.setdefault(name, (kind, help_, []))[2].append(f"bodocache_engine_{name}{labels} {text}")
+
+    for node, st in sorted(reports.items()):
+        for gpu, dev in sorted((st.get("devices") or {}).items(), key=lambda kv: str(kv[0])):
+            add("bytes_per_second", "gauge", "Completed copy bytes per second since the stats reset",
+                _labels(node=node, gpu=gpu), dev.get("bytes_per_s", 0))
+            for stream, ss in sorted((dev.get("streams") or {}).items(), key=lambda kv: str(kv[0])):
+                lbl = dict(node=node, gpu=gpu, stream=stream)
+                add("ops_total", "counter", "Completed copy ops", _labels(**lbl), ss.get("ops", 0))
+                add("bytes_total", "counter", "Completed copy bytes", _labels(**lbl), ss.get("bytes", 0))
+                add("deadline_misses_total", "counter", "Ops completed after their deadline",
+                    _labels(**lbl), ss.get("deadline_misses", 0))
+                add("failures_total", "counter", "Ops completed with a non-zero status",
+                    _labels(**lbl), ss.get("failures", 0))
+                for phase in _PHASES:
+                    h = ss.get(f"{phase}_ns") or {}
+                    if not h.get("count"):
+                        continue
+                    for q, key in _QUANTILES:
+                        add("latency_seconds", "summary", "Per-op latency by phase (read, queue_wait, dma, e2e)",
+                            _labels(**lbl, phase=phase, quantile=q), h.get(key, 0) / 1e9)
+                    add("latency_seconds_count", "", "", _labels(**lbl, phase=phase), h["count"])
+                    add("latency_seconds_sum", "", "", _labels(**lbl, phase=phase),
+                        h.get("mean_ns", 0.0) * h["count"] / 1e9)
+        for tier, t in sorted((st.get("tiers") or {}).items(), key=lambda kv: str(kv[0])):
+            add("tier_bytes_total", "counter", "Completed plan bytes by destination tier",
+                _labels(node=node, tier=tier), t.get("bytes", 0))
+            add("tier_bytes_per_second", "gauge", "Plan bytes per second by destination tier",
+                _labels(node=node, tier=tier), t.get("bytes_per_s", 0))
+        pool = st.get("pool") or {}
+        add("pool_bytes_in_use", "gauge", "Pinned pool bytes handed out", _labels(node=node), pool.get("bytes_in_use", 0))
+        add("pool_bytes_resident", "gauge", "Pinned pool bytes allocated", _labels(node=node),
+            pool.get("bytes_resident", 0))
+        add("pool_occupancy", "gauge", "Pinned pool bytes in use over bytes resident", _labels(node=node),
+            pool.get("occupancy", 0))
+    lines: List[str] = []
+    for name, (kind, help_, samples) in series.items():
+        if kind:
+            lines.append(f"# HELP bodocache_engine_{name} {help_}")
+            lines.append(f"# TYPE bodocache_engine_{name} {kind}")
+        lines.extend(samples)
+    return "\n".join(lines) + "\n"
+
+
 class PlannerHandler(BaseHTTPRequestHandler):
     def _send(self, code: int, body: Dict[str, Any]):
         data = json.dumps(body).encode("utf-8")
@@ -71,13 +153,28 @@ class PlannerHandler(BaseHTTPRequestHandler):
             except Exception as e:
                 self._send(500, {"error": str(e)})
         elif self.path == "/report":
-            # Accept perf counters and acknowledge
+            # Accept perf counters and acknowledge; engine stats() snapshots feed /metrics
+            if isinstance(payload.get("engine_stats"), dict):
+                ENGINE_REPORTS[str(payload.get("node", ""))] = payload["engine_stats"]
             self._send(200, {"ok": True})
         else:
             self._send(404, {"error": "not found"})
 
 
+    def do_GET(self):  # noqa: N802
+        if self.path != "/metrics":
+            self._send(404, {"error": "not found"})
+            return
+        data = prometheus_metrics(ENGINE_REPORTS).encode("utf-8")
+        self.send_response(200)
+        self.send_header("Content-Type", "text/plain; version=0.0.4")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+
 def serve(host: str = "0.0.0.0", port: int = 8080):
-    httpd = HTTPServer((host, port), PlannerHandler)
+    # One thread per connection, so a slow window for one agent does not stall the others
+    httpd = ThreadingHTTPServer((host, port), PlannerHandler)
     httpd.serve_forever()
 
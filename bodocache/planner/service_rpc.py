@@ -0,0 +1,337 @@
+from __future__ import annotations
+
+import hmac
+import json
+import socket
+import socketserver
+import struct
+import threading
+from multiprocessing import resource_tracker, shared_memory
+from typing import Any, Dict, List, Optional, Tuple
+
+import pandas as pd
+
+from bodocache.planner.service_http import (
+    HEAT_COLUMNS,
+    LAYER_LAT_COLUMNS,
+    REQUEST_COLUMNS,
+    TENANT_CAPS_COLUMNS,
+    TIER_CAPS_COLUMNS,
+    plan_from_frames,
+)
+
+try:  # Arrow IPC is the table encoding; install the "arrow" extra
+    import pyarrow as pa
+    _HAVE_ARROW = True
+except Exception:  # pragma: no cover - optional dependency
+    pa = None  # type: ignore
+    _HAVE_ARROW = False
+
+# Binary planner RPC: Arrow IPC tables over a persistent TCP or Unix-socket connection,
+# one request/reply per window, served by a thread per connection.
+#
+# Each message is a fixed header, a JSON meta block and a body:
+#   header  <4sIQ>  magic b"BCP1", kind (KIND_*), meta length
+#   meta    {"tables": [[name, offset, length], ...], "body_bytes": n, "shm": name?, ...}
+#   body    n bytes holding one Arrow IPC stream per table at its offset
+# With "shm" set the tables live at those offsets in that shared-memory segment instead
+# (same-host agents, AF_UNIX connections only) and body_bytes is 0. Tables are read
+# zero-copy from the received buffer or the mapped segment; numeric columns without nulls
+# reach run_window as views.
+#
+# Frames whose meta exceeds MAX_META_BYTES or whose body exceeds MAX_BODY_BYTES are
+# refused before anything is allocated for them. TCP servers bind loopback unless given
+# a host; with a token every request's meta must carry it (compared in constant time).
+MAGIC = b"BCP1"
+KIND_PLAN = 1
+KIND_REPLY = 2
+KIND_ERROR = 3
+MAX_META_BYTES = 1 << 20
+MAX_BODY_BYTES = 1 << 30
+_HEADER = struct.Struct("<4sIQ")
+_REQUEST_TABLES = {
+    "requests": REQUEST_COLUMNS,
+    "heat": HEAT_COLUMNS,
+    "tier_caps": TIER_CAPS_COLUMNS,
+    "tenant_caps": TENANT_CAPS_COLUMNS,
+    "layer_lat": LAYER_LAT_COLUMNS,
+}
+_REPLY_TABLES = ("plan", "evict", "admission")
+
+
+def _require_arrow() -> None:
+    if not _HAVE_ARROW:
+        raise RuntimeError("pyarrow is required for the binary planner RPC (pip install bodocache[arrow])")
+
+
+def encode_table(df: pd.DataFrame) -> "pa.Buffer":
+    _require_arrow()
+    table = pa.Table.from_pandas(df, preserve_index=False)
+    sink = pa.BufferOutputStream()
+    with pa.ipc.new_stream(sink, table.schema) as writer:
+        writer.write_table(table)
+    return sink.getvalue()
+
+
+def decode_table(buf: Any, columns: Optional[List[str]] = None) -> pd.DataFrame:
+    _require_arrow()
+    df = pa.ipc.open_stream(pa.py_buffer(buf)).read_all().to_pandas(split_blocks=True)
+    if columns is not None:
+        missing = [c for c in columns if c not in df.columns]
+        if missing and len(df):
+            raise ValueError(f"table is missing columns {missing}")
+        if missing:
+            df = pd.DataFrame(columns=columns)
+    return df
+
+
+def _recv_exact(sock: socket.socket, n: int) -> Optional[bytearray]:
+    buf = bytearray(n)
+    view = memoryview(buf)
+    got = 0
+    while got < n:
+        k = sock.recv_into(view[got:], n - got)
+        if k == 0:
+            if got == 0:
+                return None
+            raise ConnectionError("connection closed mid-message")
+        got += k
+    return buf
+
+
+def send_message(sock: socket.socket, kind: int, meta: Dict[str, Any], body: List[Any] = ()) -> None:
+    raw = json.dumps(meta).encode("utf-8")
+    sock.sendall(_HEADER.pack(MAGIC, kind, len(raw)) + raw)
+    for part in body:
+        sock.sendall(memoryview(part))
+
+
+def recv_message(sock: socket.socket) -> Optional[Tuple[int, Dict[str, Any], bytearray]]:
+    """(kind, meta, body) of the next message, or None when the peer closed cleanly."""
+    head = _recv_exact(sock, _HEADER.size)
+    if head is None:
+        return None
+    magic, kind, meta_len = _HEADER.unpack(head)
+    if magic != MAGIC:
+        raise ValueError(f"bad planner RPC magic {bytes(magic)!r}")
+    if meta_len > MAX_META_BYTES:
+        raise ValueError(f"planner RPC meta of {meta_len} bytes exceeds {MAX_META_BYTES}")
+    meta = json.loads(bytes(_recv_exact(sock, meta_len) or b"{}").decode("utf-8"))
+    n = int(meta.get("body_bytes", 0))
+    if not 0 <= n <= MAX_BODY_BYTES:
+        raise ValueError(f"planner RPC body of {n} bytes exceeds {MAX_BODY_BYTES}")
+    body = _recv_exact(sock, n) if n else bytearray()
+    return kind, meta, body or bytearray()
+
+
+def _layout(buffers: Dict[str, Any]) -> Tuple[List[List[Any]], int]:
+    tables, off = [], 0
+    for name, buf in buffers.items():
+        tables.append([name, off, buf.size])
+        off += buf.size
+    return tables, off
+
+
+def _attach_shm(name: str) -> shared_memory.SharedMemory:
+    # The client owns (and unlinks) the segment; keep the resource tracker out of it here
+    try:
+        return shared_memory.SharedMemory(name=name, track=False)
+    except TypeError:
+        shm = shared_memory.SharedMemory(name=name)
+        try:
+            resource_tracker.unregister(shm._name, "shared_memory")  # type: ignore[attr-defined]
+        except Exception:
+            pass
+        return shm
+
+
+def _close_shm(shm: Optional[shared_memory.SharedMemory]) -> None:
+    if shm is None:
+        return
+    try:
+        shm.close()
+    except BufferError:
+        pass  # a frame still views it; the mapping goes away with the last view
+
+
+class PlannerRPCHandler(socketserver.BaseRequestHandler):
+    def handle(self) -> None:
+        sock: socket.socket = self.request
+        local = sock.family == getattr(socket, "AF_UNIX", None)
+        if not local:
+            sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        shm: Optional[shared_memory.SharedMemory] = None
+        try:
+            token: Optional[str] = getattr(self.server, "token", None)
+            while True:
+                try:
+                    msg = recv_message(sock)
+                except ValueError as e:
+                    # Malformed or oversized frame: the rest of the stream cannot be trusted
+                    send_message(sock, KIND_ERROR, {"error": str(e)})
+                    return
+                if msg is None:
+                    return
+                kind, meta, body = msg
+                if token is not None and not hmac.compare_digest(str(meta.get("token", "")), token):
+                    send_message(sock, KIND_ERROR, {"error": "bad or missing token"})
+                    continue
+                if kind != KIND_PLAN:
+                    send_message(sock, KIND_ERROR, {"error": f"unexpected message kind {kind}"})
+                    continue
+                if meta.get("shm") and not local:
+                    # A TCP peer may be on another host; it must not name our segments
+                    send_message(sock, KIND_ERROR, {"error": "shared-memory requests need a unix: connection"})
+                    continue
+                try:
+                    if meta.get("shm"):
+                        if shm is None or shm.name.lstrip("/") != str(meta["shm"]).lstrip("/"):
+                            _close_shm(shm)
+                            shm = _attach_shm(str(meta["shm"]))
+                        src = shm.buf
+                    else:
+                        src = memoryview(body)
+                    frames = {name: pd.DataFrame(columns=cols) for name, cols in _REQUEST_TABLES.items()}
+                    for name, off, length in meta.get("tables", []):
+                        if name in _REQUEST_TABLES:
+                            frames[name] = decode_table(src[off:off + length], _REQUEST_TABLES[name])
+                    del src
+                    out = plan_from_frames(
+                        frames["requests"], frames["heat"], frames["tier_caps"], frames["tenant_caps"],
+                        frames["layer_lat"], int(meta.get("now_ms", 0)), meta.get("knobs", {}),
+                    )
+                    del frames
+                    buffers = {name: encode_table(df) for name, df in zip(_REPLY_TABLES, out)}
+                    tables, total = _layout(buffers)
+                    send_message(sock, KIND_REPLY, {"tables": tables, "body_bytes": total}, list(buffers.values()))
+                except Exception as e:
+                    send_message(sock, KIND_ERROR, {"error": str(e)})
+        finally:
+            _close_shm(shm)
+
+
+class ThreadingPlannerRPCServer(socketserver.ThreadingMixIn, socketserver.TCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+
+if hasattr(socketserver, "UnixStreamServer"):
+    class ThreadingPlannerRPCUnixServer(socketserver.ThreadingMixIn, socketserver.UnixStreamServer):
+        daemon_threads = True
+
+
+def _parse_address(address: str) -> Tuple[str, Any]:
+    # "unix:/path/to.sock" or "host:port"
+    if address.startswith("unix:"):
+        return "unix", address[len("unix:"):]
+    host, _, port = address.rpartition(":")
+    return "tcp", (host or "127.0.0.1", int(port))
+
+
+def make_rpc_server(address: str, token: Optional[str] = None) -> socketserver.BaseServer:
+    """Server on "host:port" (loopback when host is empty) or "unix:/path". With a token,
+    requests that do not carry it are answered with KIND_ERROR."""
+    _require_arrow()
+    family, addr = _parse_address(address)
+    if family == "unix":
+        server: socketserver.BaseServer = ThreadingPlannerRPCUnixServer(addr, PlannerRPCHandler)
+    else:
+        server = ThreadingPlannerRPCServer(addr, PlannerRPCHandler)
+    server.token = token  # type: ignore[attr-defined]
+    return server
+
+
+def serve_rpc(address: str = "127.0.0.1:8081", token: Optional[str] = None) -> None:
+    with make_rpc_server(address, token) as server:
+        server.serve_forever()
+
+
+class PlannerRPCClient:
+    """Persistent connection to a binary planner RPC server.
+
+    With use_shm=True (a unix: address only) request tables are written into a
+    shared-memory segment owned by this client, and only their offsets cross the socket.
+    token must match the server's token when it has one.
+    """
+
+    def __init__(self, address: str, use_shm: bool = False, timeout: Optional[float] = None,
+                 token: Optional[str] = None):
+        _require_arrow()
+        family, addr = _parse_address(address)
+        if use_shm and family != "unix":
+            raise ValueError("use_shm needs a unix: address; the server only attaches segments of local peers")
+        if family == "unix":
+            self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        else:
+            self._sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            self._sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self._sock.settimeout(timeout)
+        self._sock.connect(addr)
+        self._use_shm = bool(use_shm)
+        self._token = token
+        self._shm: Optional[shared_memory.SharedMemory] = None
+        self._lock = threading.Lock()
+
+    def _segment(self, nbytes: int) -> shared_memory.SharedMemory:
+        if self._shm is None or self._shm.size < nbytes:
+            self._release_shm()
+            # Grow geometrically so steady-state windows reuse one segment
+            self._shm = shared_memory.SharedMemory(create=True, size=max(nbytes * 2, 1 << 20))
+        return self._shm
+
+    def _release_shm(self) -> None:
+        if self._shm is not None:
+            self._shm.close()
+            self._shm.unlink()
+            self._shm = None
+
+    def get_plan(
+        self,
+        requests: pd.DataFrame,
+        heat: pd.DataFrame,
+        tier_caps: pd.DataFrame,
+        tenant_caps: pd.DataFrame,
+        layer_lat: pd.DataFrame,
+        now_ms: int,
+        knobs: Optional[Dict[str, Any]] = None,
+    ) -> Tuple[pd.DataFrame, pd.DataFrame, pd.DataFrame]:
+        """(plan_df, evict_df, admission_df) as run_window returns them."""
+        frames = {"requests": requests, "heat": heat, "tier_caps": tier_caps, "tenant_caps": tenant_caps,
+                  "layer_lat": layer_lat}
+        buffers = {name: encode_table(df) for name, df in frames.items()}
+        tables, total = _layout(buffers)
+        meta: Dict[str, Any] = {"tables": tables, "now_ms": int(now_ms), "knobs": dict(knobs or {})}
+        if self._token is not None:
+            meta["token"] = self._token
+        with self._lock:
+            if self._use_shm:
+                shm = self._segment(total)
+                for (_, off, length), buf in zip(tables, buffers.values()):
+                    shm.buf[off:off + length] = memoryview(buf)
+                meta.update(shm=shm.name, body_bytes=0)
+                send_message(self._sock, KIND_PLAN, meta)
+            else:
+                meta["body_bytes"] = total
+                send_message(self._sock, KIND_PLAN, meta, list(buffers.values()))
+            msg = recv_message(self._sock)
+        if msg is None:
+            raise ConnectionError("planner closed the connection")
+        kind, reply, body = msg
+        if kind == KIND_ERROR:
+            raise RuntimeError(f"planner error: {reply.get('error')}")
+        view = memoryview(body)
+        out = {name: decode_table(view[off:off + length]) for name, off, length in reply.get("tables", [])}
+        return tuple(out.get(name, pd.DataFrame()) for name in _REPLY_TABLES)  # type: ignore[return-value]
+
+    def close(self) -> None:
+        with self._lock:
+            try:
+                self._sock.close()
+            finally:
+                self._release_shm()
+
+    def __enter__(self) -> "PlannerRPCClient":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
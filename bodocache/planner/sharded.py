@@ -0,0 +1,166 @@
+from __future__ import annotations
+
+import os
+from concurrent.futures import ProcessPoolExecutor, ThreadPoolExecutor
+from typing import Any, Callable, List, Optional, Sequence, Tuple
+
+import numpy as np
+import pandas as pd
+
+from .pipeline import score_and_filter, stored_page_view
+from .scheduler import finish_window, plan_core, pure_py_forced, with_pclusters
+
+# Sharded planning. Every stage of the core groups by node first (tenant credit
+# cumsums by (node, tier_dst, tenant), coalescing by (node, tier_src, tier_dst, ...),
+# tier caps by (node, tier_src, tier_dst), op limits by (node, tier_dst)), so requests
+# split by (node, tier_dst) plan independently: each shard runs the same core
+# run_window would, and the shard plans concatenate into run_window's plan.
+#
+# With tenant_credit_scope="global" a tenant's per-tier credit is one cluster-wide
+# budget instead of one per node. That is the only cross-shard step: shards score their
+# requests in parallel, one ledger pass over (tier_dst, tenant, deadline_ms, bytes)
+# grants credits earliest-deadline-first across all nodes, and shards then plan the
+# admitted requests with tenant caps already applied.
+EXECUTORS = ("serial", "thread", "process", "mpi")
+TENANT_CREDIT_SCOPES = ("node", "global")
+_UNCAPPED = 9_223_372_036_854_775_807
+
+
+def _plan_shard(args: Tuple[Any, ...]) -> pd.DataFrame:
+    return plan_core(*args[:-1], force_py=args[-1])
+
+
+def _score_shard(args: Tuple[Any, ...]) -> pd.DataFrame:
+    shard, heat_df, now_ms, pmin, umin, alpha, beta = args
+    cand = score_and_filter(shard.assign(_row=np.arange(len(shard), dtype=np.int64)), heat_df, now_ms, pmin, umin,
+                            alpha, beta)
+    bytes_row = (cand["page_end"] - cand["page_start"] + 1).astype(np.int64) * cand["page_bytes"].astype(np.int64)
+    return pd.DataFrame({
+        "_row": cand["_row"].to_numpy(),
+        "node": cand["node"].to_numpy(),
+        "tier_dst": cand["tier_dst"].to_numpy(),
+        "tenant": cand["tenant"].to_numpy(),
+        "deadline_ms": cand["deadline_ms"].to_numpy(),
+        "bytes_row": bytes_row.to_numpy(),
+    })
+
+
+def _mpi_comm():
+    try:
+        from mpi4py import MPI  # type: ignore  # ships with Bodo
+    except Exception as e:  # pragma: no cover - optional dependency
+        raise RuntimeError("executor='mpi' needs mpi4py (launch with mpiexec, e.g. under Bodo)") from e
+    return MPI.COMM_WORLD
+
+
+def _map(fn: Callable[[Any], pd.DataFrame], items: List[Any], executor: str, max_workers: Optional[int]) -> List[pd.DataFrame]:
+    """fn over items in order. With 'mpi' each rank maps items[rank::size] and every
+    rank gets the full, ordered result."""
+    if executor == "serial" or len(items) <= 1:
+        return [fn(it) for it in items]
+    if executor == "thread":
+        with ThreadPoolExecutor(max_workers=max_workers) as pool:
+            return list(pool.map(fn, items))
+    if executor == "process":
+        with ProcessPoolExecutor(max_workers=max_workers) as pool:
+            return list(pool.map(fn, items, chunksize=max(1, len(items) // (4 * (max_workers or os.cpu_count() or 1)))))
+    comm = _mpi_comm()
+    rank, size = comm.Get_rank(), comm.Get_size()
+    mine = [(i, fn(items[i])) for i in range(rank, len(items), size)]
+    out: List[Optional[pd.DataFrame]] = [None] * len(items)
+    for part in comm.allgather(mine):
+        for i, df in part:
+            out[i] = df
+    return out  # type: ignore[return-value]
+
+
+def shard_requests(core_requests: pd.DataFrame, shard_by: Sequence[str] = ("node", "tier_dst")) -> List[pd.DataFrame]:
+    """Requests split by shard_by (sorted by key, rows in their original order)."""
+    return [g for _, g in core_requests.groupby(list(shard_by), sort=True)]
+
+
+def _global_tenant_admission(
+    shards: List[pd.DataFrame],
+    scored: List[pd.DataFrame],
+    tenant_caps_df: pd.DataFrame,
+) -> List[pd.DataFrame]:
+    # One ledger over every shard's candidates: cumulative bytes per (tier_dst, tenant)
+    # in deadline order (node, then request order, break ties), gated by the tenant cap
+    ledger = pd.concat([s.assign(_shard=np.int64(k)) for k, s in enumerate(scored)], ignore_index=True)
+    tcap = tenant_caps_df.rename(columns={"tier": "tier_dst", "bandwidth_caps": "tenant_cap"})
+    ledger = ledger.merge(tcap[["tenant", "tier_dst", "tenant_cap"]], on=["tenant", "tier_dst"], how="left")
+    ledger["tenant_cap"] = ledger["tenant_cap"].astype(float).where(ledger["tenant_cap"].notna(), _UNCAPPED)
+    ledger = ledger.sort_values(by=["tier_dst", "tenant", "deadline_ms", "node", "_shard", "_row"]).reset_index(drop=True)
+    ledger["cum_bytes_tenant"] = ledger.groupby(["tier_dst", "tenant"])["bytes_row"].cumsum()
+    granted = ledger[ledger["cum_bytes_tenant"] <= ledger["tenant_cap"]]
+    rows = granted.groupby("_shard")["_row"].apply(lambda r: np.sort(r.to_numpy()))
+    return [shards[k].iloc[rows[k]] if k in rows.index else shards[k].iloc[:0] for k in range(len(shards))]
+
+
+def run_window_sharded(
+    requests_df: pd.DataFrame,
+    heat_df: pd.DataFrame,
+    tier_caps_df: pd.DataFrame,
+    tenant_caps_df: pd.DataFrame,
+    layer_lat_df: pd.DataFrame,
+    now_ms: int,
+    pmin: float = 1.0,
+    umin: float = 0.0,
+    min_io_bytes: int = 512 * 1024,
+    alpha: float = 1.0,
+    beta: float = 0.0,
+    window_ms: int = 20,
+    max_ops_per_tier: int = 64,
+    enable_admission: bool | np.bool_ = True,
+    enable_eviction: bool | np.bool_ = True,
+    enforce_tier_caps: bool | np.bool_ = True,
+    merge_layers: bool = False,
+    shard_by: Sequence[str] = ("node", "tier_dst"),
+    executor: str = "thread",
+    max_workers: Optional[int] = None,
+    tenant_credit_scope: str = "node",
+):
+    """run_window with requests planned per (node, tier_dst) shard in parallel.
+
+    executor: 'thread' (the native kernel and much of pandas release the GIL),
+    'process' (pandas-bound cores, shards are pickled), 'mpi' (one shard subset per
+    rank, e.g. Bodo ranks under mpiexec; every rank returns the full result) or
+    'serial'. shard_by must start with 'node'; finer keys than (node, tier_dst) would
+    split groups the core caps together.
+
+    With tenant_credit_scope='node' the result equals run_window's. 'global' shares
+    each tenant's per-tier credit across nodes (see the module comment). Peer link caps,
+    eviction and admission run once on the merged plan, as in run_window.
+    """
+    if executor not in EXECUTORS:
+        raise ValueError(f"executor must be one of {EXECUTORS}")
+    if tenant_credit_scope not in TENANT_CREDIT_SCOPES:
+        raise ValueError(f"tenant_credit_scope must be one of {TENANT_CREDIT_SCOPES}")
+    shard_by = list(shard_by)
+    if not shard_by or shard_by[0] != "node" or not set(shard_by) <= {"node", "tier_dst"}:
+        raise ValueError("shard_by must be ('node',) or ('node', 'tier_dst')")
+    requests_df = with_pclusters(requests_df)
+    core_requests, stored_pages = stored_page_view(requests_df)
+    force_py = pure_py_forced()
+    shards = shard_requests(core_requests, shard_by) or [core_requests]
+
+    caps = tenant_caps_df
+    if tenant_credit_scope == "global":
+        scored = _map(_score_shard, [(s, heat_df, now_ms, pmin, umin, alpha, beta) for s in shards], executor,
+                      max_workers)
+        shards = _global_tenant_admission(shards, scored, tenant_caps_df)
+        shards = [s for s in shards if len(s)] or shards[:1]
+        caps = tenant_caps_df.head(0)
+    knobs = (now_ms, pmin, umin, min_io_bytes, alpha, beta, window_ms, max_ops_per_tier, bool(enforce_tier_caps))
+    plans = _map(_plan_shard, [(s, heat_df, tier_caps_df, caps, layer_lat_df, *knobs, force_py) for s in shards],
+                 executor, max_workers)
+    plan_df = pd.concat(plans, ignore_index=True) if len(plans) > 1 else plans[0]
+    if len(shard_by) > 1:
+        # Core plans are ordered by (node, tier_src, tier_dst, deadline_ms); shards were
+        # (node, tier_dst), so restore tier_src before tier_dst (stable, in-group order kept)
+        plan_df = plan_df.sort_values(by=["node", "tier_src", "tier_dst"], kind="stable").reset_index(drop=True)
+    return finish_window(
+        plan_df, stored_pages, requests_df, heat_df, tier_caps_df,
+        enable_admission=enable_admission, enable_eviction=enable_eviction, merge_layers=merge_layers,
+        force_py=force_py, layer_lat_df=layer_lat_df, window_ms=window_ms, enforce_tier_caps=enforce_tier_caps,
+    )
@@ -0,0 +1,323 @@
+from __future__ import annotations
+
+import json
+import os
+import time
+from dataclasses import dataclass, field
+from typing import Callable, Dict, Iterable, List, Optional, Sequence, Tuple
+
+import numpy as np
+import pandas as pd
+
+from bodocache.planner import scheduler
+from bodocache.planner.pipeline import (
+    apply_caps,
+    apply_tenant_caps,
+    coalesce_intervals,
+    score_and_filter,
+    stored_page_view,
+)
+from bodocache.sim.utils import (
+    synthetic_heat,
+    synthetic_layer_lat,
+    synthetic_tenant_caps,
+    synthetic_tier_caps,
+)
+
+# Planner trace replay: recorded (or synthetic) windows as columnar tables, timed per
+# pipeline stage and per planner backend, with scaling curves over request count.
+#
+# A trace is a directory holding requests and heat tables, optionally tier_caps,
+# tenant_caps and layer_lat, each as Parquet (.parquet), Arrow IPC/Feather (.arrow,
+# .feather; both need pyarrow) or CSV, with the columns run_window takes. meta.json may
+# carry the window's now_ms.
+TABLES = ("requests", "heat", "tier_caps", "tenant_caps", "layer_lat")
+FORMATS = {"parquet": ".parquet", "arrow": ".arrow", "feather": ".feather", "csv": ".csv"}
+STAGES = ("score_and_filter", "apply_tenant_caps", "coalesce_intervals", "apply_caps")
+# run_window's defaults
+DEFAULT_KNOBS = {
+    "pmin": 1.0,
+    "umin": 0.0,
+    "min_io_bytes": 512 * 1024,
+    "alpha": 1.0,
+    "beta": 0.0,
+    "window_ms": 20,
+    "max_ops_per_tier": 64,
+    "enforce_tier_caps": True,
+}
+_CREDITS_BYTES = 32 * 1024 * 1024
+
+
+def read_table(path: str) -> pd.DataFrame:
+    ext = os.path.splitext(path)[1].lower()
+    if ext == ".parquet":
+        return pd.read_parquet(path)
+    if ext in (".arrow", ".feather"):
+        return pd.read_feather(path)
+    if ext == ".csv":
+        return pd.read_csv(path)
+    raise ValueError(f"unsupported trace table format {ext!r}; expected one of {sorted(FORMATS.values())}")
+
+
+def write_table(df: pd.DataFrame, path: str) -> None:
+    ext = os.path.splitext(path)[1].lower()
+    if ext == ".parquet":
+        df.to_parquet(path, index=False)
+    elif ext in (".arrow", ".feather"):
+        df.reset_index(drop=True).to_feather(path)
+    elif ext == ".csv":
+        df.to_csv(path, index=False)
+    else:
+        raise ValueError(f"unsupported trace table format {ext!r}; expected one of {sorted(FORMATS.values())}")
+
+
+def trace_now_ms(requests: pd.DataFrame) -> int:
+    # Without meta.json: just before the earliest deadline, so every request is still live
+    if requests.empty:
+        return 0
+    return int(requests["deadline_ms"].min()) - 50
+
+
+def load_trace(root: str) -> Tuple[Dict[str, pd.DataFrame], int]:
+    """Tables of a trace directory plus its now_ms; missing optional tables get the
+    synthetic defaults (tier caps, 32 MiB tenant credits, per-layer latency)."""
+    tables: Dict[str, pd.DataFrame] = {}
+    for name in TABLES:
+        for ext in FORMATS.values():
+            path = os.path.join(root, name + ext)
+            if os.path.exists(path):
+                tables[name] = read_table(path)
+                break
+    for name in ("requests", "heat"):
+        if name not in tables:
+            raise FileNotFoundError(f"trace {root!r} has no {name} table")
+    req = tables["requests"]
+    tables.setdefault("tier_caps", synthetic_tier_caps())
+    tables.setdefault("tenant_caps", synthetic_tenant_caps(req["tenant"], _CREDITS_BYTES))
+    tables.setdefault("layer_lat", synthetic_layer_lat(int(req["layer"].max()) + 1 if len(req) else 1))
+    meta_path = os.path.join(root, "meta.json")
+    now_ms = trace_now_ms(req)
+    if os.path.exists(meta_path):
+        with open(meta_path) as f:
+            now_ms = int(json.load(f).get("now_ms", now_ms))
+    return tables, now_ms
+
+
+def save_trace(tables: Dict[str, pd.DataFrame], root: str, now_ms: Optional[int] = None, fmt: str = "parquet") -> None:
+    if fmt not in FORMATS:
+        raise ValueError(f"fmt must be one of {sorted(FORMATS)}")
+    os.makedirs(root, exist_ok=True)
+    for name in TABLES:
+        if name in tables:
+            df = tables[name]
+            if name == "requests" and "prefix_tokens" in df.columns:
+                df = df.drop(columns=["prefix_tokens"])  # list column; the planner does not read it
+            write_table(df, os.path.join(root, name + FORMATS[fmt]))
+    with open(os.path.join(root, "meta.json"), "w") as f:
+        json.dump({"now_ms": int(now_ms if now_ms is not None else trace_now_ms(tables["requests"]))}, f)
+
+
+def synthetic_trace(
+    n_req: int,
+    n_layers: int = 8,
+    n_nodes: int = 4,
+    n_tenants: int = 3,
+    pages: int = 1024,
+    now_ms: int = 1_000_000,
+    seed: int = 0,
+) -> Tuple[Dict[str, pd.DataFrame], int]:
+    """Vectorized trace with synthetic_requests' distributions, for millions of requests."""
+    rng = np.random.default_rng(seed)
+    base = rng.integers(0, 10, n_req)
+    delta = rng.integers(0, 4, n_req)
+    length = rng.choice(np.array([1, 2, 4, 8, 16]), n_req)
+    start = rng.integers(0, pages - length + 1)
+    tenants = np.array([chr(ord("A") + t) for t in range(n_tenants)], dtype=object)
+    req = pd.DataFrame({
+        "req_id": np.arange(n_req, dtype=np.int64),
+        "node": np.array([f"node-{i}" for i in range(n_nodes)], dtype=object)[rng.integers(0, n_nodes, n_req)],
+        "model_id": "m70b",
+        "model_version": "v1",
+        "prefix_id": np.char.add(np.char.add("pfx-", base.astype(str)), np.char.add("-", delta.astype(str))).astype(object),
+        "layer": rng.integers(0, n_layers, n_req),
+        "page_start": start,
+        "page_end": start + length - 1,
+        "tier_src": np.int64(0),
+        "tier_dst": np.int64(1),
+        "deadline_ms": now_ms + rng.integers(5, 61, n_req) * 10,
+        "page_bytes": rng.choice(np.array([128, 256, 512]), n_req) * 1024,
+        "tenant": tenants[rng.integers(0, n_tenants, n_req)],
+        "est_fill_ms": rng.choice(np.array([1, 2, 5, 10, 20]), n_req),
+    })
+    tables = {
+        "requests": req,
+        "heat": synthetic_heat(req),
+        "tier_caps": synthetic_tier_caps(),
+        "tenant_caps": synthetic_tenant_caps(req["tenant"], _CREDITS_BYTES),
+        "layer_lat": synthetic_layer_lat(n_layers),
+    }
+    return tables, now_ms
+
+
+def resize_requests(req: pd.DataFrame, n: int, seed: int = 0) -> pd.DataFrame:
+    """n requests drawn from a trace: a sample when smaller, repeated copies (fresh req_ids)
+    when larger."""
+    if n <= len(req):
+        return req.sample(n=n, random_state=seed).reset_index(drop=True)
+    reps = -(-n // max(len(req), 1))
+    out = pd.concat([req] * reps, ignore_index=True).iloc[:n].copy()
+    out["req_id"] = np.arange(n, dtype=np.int64)
+    return out
+
+
+def _core_requests(req: pd.DataFrame) -> pd.DataFrame:
+    # The planner core's view of requests, prepared the way run_window does it
+    if "pcluster" not in req.columns:
+        codes, _ = pd.factorize(req["prefix_id"], sort=False)
+        req = req.assign(pcluster=codes.astype(np.int64))
+    return stored_page_view(req)[0]
+
+
+def _best_ms(fn: Callable[[], object], repeat: int) -> Tuple[float, object]:
+    best, out = float("inf"), None
+    for _ in range(max(repeat, 1)):
+        t0 = time.perf_counter()
+        out = fn()
+        best = min(best, (time.perf_counter() - t0) * 1000.0)
+    return best, out
+
+
+def time_stages(tables: Dict[str, pd.DataFrame], now_ms: int, repeat: int = 3, **knobs) -> Dict[str, float]:
+    """Best-of-`repeat` milliseconds of each run_window_core_py stage, with row counts."""
+    k = dict(DEFAULT_KNOBS, **knobs)
+    req = _core_requests(tables["requests"])
+    out: Dict[str, float] = {"requests": len(req)}
+    ms, cand0 = _best_ms(
+        lambda: score_and_filter(req, tables["heat"], now_ms, k["pmin"], k["umin"], k["alpha"], k["beta"]), repeat
+    )
+    out["score_and_filter_ms"], out["candidates"] = ms, len(cand0)
+    ms, cand1 = _best_ms(lambda: apply_tenant_caps(cand0, tables["tenant_caps"]), repeat)
+    out["apply_tenant_caps_ms"], out["admitted"] = ms, len(cand1)
+    ms, runs = _best_ms(lambda: coalesce_intervals(cand1, min_io_bytes=k["min_io_bytes"]), repeat)
+    out["coalesce_intervals_ms"], out["runs"] = ms, len(runs)
+    ms, plan = _best_ms(
+        lambda: apply_caps(
+            runs, tier_caps_df=tables["tier_caps"], layer_lat_df=tables["layer_lat"], window_ms=k["window_ms"],
+            max_ops_per_tier=k["max_ops_per_tier"], enforce_tier_caps=bool(k["enforce_tier_caps"]),
+        ),
+        repeat,
+    )
+    out["apply_caps_ms"], out["ops"] = ms, len(plan)
+    out["total_ms"] = sum(out[f"{s}_ms"] for s in STAGES)
+    return out
+
+
+def available_backends() -> List[str]:
+    """Planner cores this process can run: pandas always, the native kernel and Bodo JIT when present."""
+    names = ["pandas"]
+    if scheduler._planner_kernel is not None:
+        names.append("native")
+    if scheduler._HAVE_BODO:
+        names.append("bodo")
+    return names
+
+
+def time_backends(
+    tables: Dict[str, pd.DataFrame],
+    now_ms: int,
+    repeat: int = 3,
+    backends: Optional[Iterable[str]] = None,
+    **knobs,
+) -> List[Dict[str, object]]:
+    """Best-of-`repeat` ms of each planner core and of the full run_window (admission and
+    eviction off). Bodo's first call (JIT compile) is reported separately as compile_ms."""
+    k = dict(DEFAULT_KNOBS, **knobs)
+    req = _core_requests(tables["requests"])
+    cores = {
+        "pandas": scheduler.run_window_core_py,
+        "native": scheduler.run_window_core_native,
+        "bodo": scheduler.run_window_core,
+    }
+    args = (req, tables["heat"], tables["tier_caps"], tables["tenant_caps"], tables["layer_lat"], now_ms)
+    kw = (k["pmin"], k["umin"], k["min_io_bytes"], k["alpha"], k["beta"], k["window_ms"], k["max_ops_per_tier"],
+          bool(k["enforce_tier_caps"]))
+    rows: List[Dict[str, object]] = []
+    for name in backends if backends is not None else available_backends():
+        if name not in cores:
+            raise ValueError(f"unknown planner backend {name!r}; expected one of {sorted(cores)}")
+        row: Dict[str, object] = {"backend": name, "requests": len(req)}
+        if name == "bodo":
+            row["compile_ms"], _ = _best_ms(lambda: cores[name](*args, *kw), 1)
+        row["ms"], plan = _best_ms(lambda: cores[name](*args, *kw), repeat)
+        row["ops"] = len(plan)
+        rows.append(row)
+    ms, (plan, _, _) = _best_ms(
+        lambda: scheduler.run_window(
+            tables["requests"], tables["heat"], tables["tier_caps"], tables["tenant_caps"], tables["layer_lat"],
+            now_ms, enable_admission=False, enable_eviction=False, **k,
+        ),
+        repeat,
+    )
+    rows.append({"backend": "run_window", "requests": len(req), "ms": ms, "ops": len(plan)})
+    return rows
+
+
+def scaling_curve(
+    sizes: Sequence[int],
+    layers: Sequence[int] = (8,),
+    trace: Optional[Tuple[Dict[str, pd.DataFrame], int]] = None,
+    repeat: int = 3,
+    backends: Optional[Iterable[str]] = None,
+    seed: int = 0,
+    **knobs,
+) -> pd.DataFrame:
+    """Per-stage and per-backend ms over request count (and layer count for synthetic
+    traces). With `trace`, each size resamples that trace's requests and `layers` is unused."""
+    rows: List[Dict[str, object]] = []
+    for n_layers in layers if trace is None else (None,):
+        for n in sizes:
+            if trace is None:
+                tables, now_ms = synthetic_trace(int(n), n_layers=int(n_layers), seed=seed)
+            else:
+                tables, now_ms = dict(trace[0]), trace[1]
+                tables["requests"] = resize_requests(trace[0]["requests"], int(n), seed=seed)
+            n_lay = int(tables["requests"]["layer"].nunique())
+            stages = time_stages(tables, now_ms, repeat=repeat, **knobs)
+            rows.append(dict(stages, backend="stages", layers=n_lay, ms=stages["total_ms"]))
+            for r in time_backends(tables, now_ms, repeat=repeat, backends=backends, **knobs):
+                rows.append(dict(r, layers=n_lay))
+    return pd.DataFrame(rows)
+
+
+@dataclass
+class PlannerCostModel:
+    """Planning time as fixed_ms + ms_per_request * n_requests per backend, fitted to a
+    scaling curve; replay_tuner uses it to cost configurations at production scale."""
+
+    coef: Dict[str, Tuple[float, float]] = field(default_factory=dict)
+
+    @classmethod
+    def fit(cls, curve: pd.DataFrame) -> "PlannerCostModel":
+        coef: Dict[str, Tuple[float, float]] = {}
+        for name, g in curve.groupby("backend"):
+            x = g["requests"].to_numpy(dtype=np.float64)
+            y = g["ms"].to_numpy(dtype=np.float64)
+            if len(np.unique(x)) < 2:
+                coef[str(name)] = (float(y.mean()), 0.0)
+                continue
+            slope, intercept = np.polyfit(x, y, 1)
+            coef[str(name)] = (max(float(intercept), 0.0), max(float(slope), 0.0))
+        return cls(coef)
+
+    def predict_ms(self, n_requests: int, backend: str = "run_window") -> float:
+        if backend not in self.coef:
+            raise KeyError(f"no cost fit for backend {backend!r}; have {sorted(self.coef)}")
+        fixed, per_req = self.coef[backend]
+        return fixed + per_req * float(n_requests)
+
+    def to_json(self) -> Dict[str, Dict[str, float]]:
+        return {b: {"fixed_ms": c[0], "ms_per_request": c[1]} for b, c in self.coef.items()}
+
+    @classmethod
+    def from_json(cls, obj: Dict[str, Dict[str, float]]) -> "PlannerCostModel":
+        return cls({b: (float(c["fixed_ms"]), float(c["ms_per_request"])) for b, c in obj.items()})
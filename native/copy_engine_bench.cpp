@@ -0,0 +1,328 @@
+// Copy engine / io_uring microbenchmark (target bodocache_copy_bench, -DUSE_BENCH=ON).
+//
+// Drives CopyEngineNative<Backend> and IoUringReader directly, with no Python in the timed
+// loops, and prints one JSON document with a bandwidth/latency matrix:
+//   "copy":    H2D submit_array() batches, swept over page size x ops per submit x streams
+//              x pinned/pageable host memory
+//   "storage": IoUringReader::read_ranges() batches of qd page-sized ranges, swept over page
+//              size x queue depth (USE_URING builds only)
+// Each point reports GB/s, p50/p99 latency (completion record t_done - t_submit for copies,
+// batch start to range completion for reads) and CPU cost per op: TSC cycles spent in the
+// submit call (ns where there is no TSC) and process CPU time over all threads.
+//
+//   bodocache_copy_bench [--device 0] [--page-bytes 65536,262144,1048576] [--ops 1,16,64]
+//                        [--streams 1,4] [--host pinned,pageable] [--qd 1,8,32]
+//                        [--bytes-per-point 268435456] [--file PATH] [--direct] [--out PATH]
+//
+// The engine's Python entry points take NumPy columns, so the harness embeds an interpreter
+// (NumPy must be importable) to build them once per point.
+
+#define BODOCACHE_NO_MODULE 1
+#if defined(USE_CUDA_BACKEND)
+#include "copy_engine_native_cuda.cu"
+using BenchBackend = CudaBackend;
+static const char* kBackendName = "cuda";
+#elif defined(USE_HIP_BACKEND)
+#include "copy_engine_native_hip.cpp"
+using BenchBackend = HipBackend;
+static const char* kBackendName = "hip";
+#elif defined(USE_L0_BACKEND)
+#include "copy_engine_native_l0.cpp"
+using BenchBackend = L0Backend;
+static const char* kBackendName = "l0";
+#else
+#error "copy_engine_bench needs a backend: USE_CUDA_BACKEND, USE_HIP_BACKEND or USE_L0_BACKEND"
+#endif
+
+#include <pybind11/embed.h>
+
+#include <cinttypes>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+using Engine = CopyEngineNative<BenchBackend>;
+
+struct Options {
+  int device{0};
+  std::vector<size_t> page_bytes{size_t(64) << 10, size_t(256) << 10, size_t(1) << 20};
+  std::vector<size_t> ops{1, 16, 64};
+  std::vector<size_t> streams{1, 4};
+  std::vector<std::string> host{"pinned", "pageable"};
+  std::vector<size_t> qd{1, 8, 32};
+  size_t bytes_per_point{size_t(256) << 20};
+  std::string file;
+  bool direct{false};
+  std::string out;
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+constexpr const char* kCycleSource = "tsc";
+inline uint64_t cycles() { return __rdtsc(); }
+#else
+constexpr const char* kCycleSource = "ns";
+inline uint64_t cycles() { return static_cast<uint64_t>(steady_now_ns()); }
+#endif
+
+int64_t cpu_now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Nearest-rank quantile of unsorted samples (sorted in place), in microseconds.
+double quantile_us(std::vector<int64_t>& ns, double q) {
+  if (ns.empty()) return 0.0;
+  std::sort(ns.begin(), ns.end());
+  size_t rank = static_cast<size_t>(q * static_cast<double>(ns.size()) + 0.5);
+  rank = std::min(std::max<size_t>(rank, 1), ns.size());
+  return static_cast<double>(ns[rank - 1]) / 1e3;
+}
+
+std::vector<size_t> parse_sizes(const char* arg) {
+  std::vector<size_t> out;
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) out.push_back(static_cast<size_t>(std::stoull(item)));
+  }
+  if (out.empty()) throw std::invalid_argument(std::string("empty list: ") + arg);
+  return out;
+}
+
+std::vector<std::string> parse_words(const char* arg) {
+  std::vector<std::string> out;
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item != "pinned" && item != "pageable") throw std::invalid_argument("--host takes pinned,pageable");
+    out.push_back(item);
+  }
+  return out;
+}
+
+Options parse_args(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    auto value = [&]() -> const char* {
+      if (i + 1 >= argc) throw std::invalid_argument(a + " needs a value");
+      return argv[++i];
+    };
+    if (a == "--device") {
+      o.device = std::stoi(value());
+    } else if (a == "--page-bytes") {
+      o.page_bytes = parse_sizes(value());
+    } else if (a == "--ops") {
+      o.ops = parse_sizes(value());
+    } else if (a == "--streams") {
+      o.streams = parse_sizes(value());
+    } else if (a == "--host") {
+      o.host = parse_words(value());
+    } else if (a == "--qd") {
+      o.qd = parse_sizes(value());
+    } else if (a == "--bytes-per-point") {
+      o.bytes_per_point = static_cast<size_t>(std::stoull(value()));
+    } else if (a == "--file") {
+      o.file = value();
+    } else if (a == "--direct") {
+      o.direct = true;
+    } else if (a == "--out") {
+      o.out = value();
+    } else {
+      throw std::invalid_argument("unknown argument " + a);
+    }
+  }
+  return o;
+}
+
+void* aligned_buffer(size_t bytes) {
+  void* p = nullptr;
+  if (posix_memalign(&p, 4096, std::max<size_t>(bytes, 4096)) != 0) throw std::bad_alloc();
+  std::memset(p, 0x5a, bytes);
+  return p;
+}
+
+// One H2D point: `submits` batches of `ops` page copies from one host region into one device
+// region (copies overwrite each other; only the transfer matters), all in flight at once.
+std::string bench_copy(Engine& eng, const Options& o, size_t page, size_t ops, size_t streams, bool pinned) {
+  const size_t batch_bytes = page * ops;
+  const size_t submits = std::max<size_t>(o.bytes_per_point / batch_bytes, 4);
+  void* host = aligned_buffer(batch_bytes);
+  void* dev = eng.backend().alloc_device(o.device, batch_bytes);
+  if (!dev) {
+    free(host);
+    throw std::runtime_error("device allocation of " + std::to_string(batch_bytes) + " bytes failed");
+  }
+  const uint64_t host_addr = reinterpret_cast<uintptr_t>(host);
+  const bool registered = pinned && eng.register_host(host_addr, batch_bytes);
+
+  carray<uint64_t> src(static_cast<py::ssize_t>(ops)), dst(static_cast<py::ssize_t>(ops)),
+      sizes(static_cast<py::ssize_t>(ops));
+  carray<int32_t> stream_id(static_cast<py::ssize_t>(ops)), gpu_id(static_cast<py::ssize_t>(ops));
+  for (size_t i = 0; i < ops; ++i) {
+    src.mutable_data()[i] = host_addr + i * page;
+    dst.mutable_data()[i] = reinterpret_cast<uintptr_t>(dev) + i * page;
+    sizes.mutable_data()[i] = page;
+    stream_id.mutable_data()[i] = static_cast<int32_t>(i % streams);
+    gpu_id.mutable_data()[i] = o.device;
+  }
+  const py::object none = py::none();
+  auto submit = [&]() {
+    eng.submit_array(src, dst, sizes, stream_id, gpu_id, none, none, none, none, none, none, none, none);
+  };
+  // Warm up streams, events and the registration
+  submit();
+  eng.drain(-1);
+
+  std::vector<int64_t> lat;
+  lat.reserve(submits * ops);
+  uint64_t submit_cycles = 0;
+  const int64_t cpu0 = cpu_now_ns();
+  const int64_t t0 = steady_now_ns();
+  for (size_t k = 0; k < submits; ++k) {
+    const uint64_t c0 = cycles();
+    submit();
+    submit_cycles += cycles() - c0;
+  }
+  py::array_t<CompletionRecord> recs = eng.drain(-1);
+  const int64_t wall = steady_now_ns() - t0;
+  const int64_t cpu = cpu_now_ns() - cpu0;
+  for (py::ssize_t i = 0; i < recs.size(); ++i) lat.push_back(recs.data()[i].t_done_ns - recs.data()[i].t_submit_ns);
+
+  if (registered) eng.unregister_host(host_addr);
+  eng.backend().free_device(o.device, dev);
+  free(host);
+
+  const double n_ops = static_cast<double>(submits * ops);
+  char buf[512];
+  snprintf(buf, sizeof(buf),
+           "{\"page_bytes\": %zu, \"ops_per_submit\": %zu, \"streams\": %zu, \"host\": \"%s\", \"ops\": %zu, "
+           "\"gbps\": %.3f, \"p50_us\": %.2f, \"p99_us\": %.2f, \"submit_cycles_per_op\": %.1f, "
+           "\"cpu_ns_per_op\": %.1f}",
+           page, ops, streams, registered ? "pinned" : "pageable", submits * ops,
+           static_cast<double>(submits * batch_bytes) / static_cast<double>(std::max<int64_t>(wall, 1)),
+           quantile_us(lat, 0.5), quantile_us(lat, 0.99), static_cast<double>(submit_cycles) / n_ops,
+           static_cast<double>(cpu) / n_ops);
+  return buf;
+}
+
+#ifdef BODOCACHE_WITH_URING
+// Sequential file of at least `bytes`, reused when it is already large enough.
+std::string storage_file(const Options& o) {
+  const std::string path = o.file.empty() ? "/tmp/bodocache_copy_bench.dat" : o.file;
+  struct stat st {};
+  if (stat(path.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) >= o.bytes_per_point) return path;
+  const int fd = open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+  if (fd < 0) throw std::runtime_error(path + ": cannot create: " + std::string(strerror(errno)));
+  std::vector<char> block(size_t(1) << 20, 0x5a);
+  for (size_t done = 0; done < o.bytes_per_point; done += block.size()) {
+    if (write(fd, block.data(), block.size()) != static_cast<ssize_t>(block.size())) {
+      close(fd);
+      throw std::runtime_error(path + ": write failed");
+    }
+  }
+  fsync(fd);
+  close(fd);
+  return path;
+}
+
+// One storage point: the file read as page-sized ranges, qd ranges per read_ranges() batch.
+std::string bench_storage(const Options& o, const std::string& path, size_t page, size_t qd) {
+  const size_t ranges = std::max<size_t>(o.bytes_per_point / page, 1);
+  IoUringReader reader(static_cast<unsigned>(qd), page, 4, o.direct, 4096);
+  char* buf = static_cast<char*>(aligned_buffer(page * qd));
+  std::vector<std::string> paths(qd, path);
+  std::vector<uint64_t> offsets(qd), sizes(qd, page);
+  std::vector<char*> dsts(qd);
+  for (size_t j = 0; j < qd; ++j) dsts[j] = buf + j * page;
+  std::vector<int64_t> lat;
+  lat.reserve(ranges);
+  size_t bytes = 0;
+  const int64_t cpu0 = cpu_now_ns();
+  const int64_t t0 = steady_now_ns();
+  for (size_t next = 0; next < ranges; next += qd) {
+    const size_t n = std::min(qd, ranges - next);
+    paths.resize(n);
+    dsts.resize(n);
+    for (size_t j = 0; j < n; ++j) offsets[j] = (next + j) * page;
+    const int64_t b0 = steady_now_ns();
+    reader.read_ranges(paths, offsets.data(), sizes.data(), dsts, [&](size_t, int64_t result) {
+      lat.push_back(steady_now_ns() - b0);
+      if (result > 0) bytes += static_cast<size_t>(result);
+    });
+  }
+  const int64_t wall = steady_now_ns() - t0;
+  const int64_t cpu = cpu_now_ns() - cpu0;
+  free(buf);
+  char out[384];
+  snprintf(out, sizeof(out),
+           "{\"page_bytes\": %zu, \"qd\": %zu, \"o_direct\": %s, \"ranges\": %zu, \"gbps\": %.3f, "
+           "\"p50_us\": %.2f, \"p99_us\": %.2f, \"cpu_ns_per_op\": %.1f}",
+           page, qd, o.direct ? "true" : "false", ranges,
+           static_cast<double>(bytes) / static_cast<double>(std::max<int64_t>(wall, 1)), quantile_us(lat, 0.5),
+           quantile_us(lat, 0.99), static_cast<double>(cpu) / static_cast<double>(ranges));
+  return out;
+}
+#endif
+
+std::string join(const std::vector<std::string>& rows) {
+  std::string s;
+  for (size_t i = 0; i < rows.size(); ++i) s += (i ? ",\n    " : "\n    ") + rows[i];
+  return rows.empty() ? "[]" : "[" + s + "\n  ]";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options o;
+  try {
+    o = parse_args(argc, argv);
+  } catch (const std::exception& e) {
+    fprintf(stderr, "bodocache_copy_bench: %s\n", e.what());
+    return 2;
+  }
+  py::scoped_interpreter interpreter{};
+  PYBIND11_NUMPY_DTYPE(CompletionRecord, op_id, gpu_id, stream_id, bytes, deadline_ms, t_submit_ns, t_done_ns, tag,
+                       direction, status);
+  std::vector<std::string> copy_rows, storage_rows;
+  try {
+    for (size_t streams : o.streams) {
+      // A fresh engine per stream count; completions only go to the ring (no callbacks)
+      Engine eng(o.device, static_cast<int>(streams));
+      for (size_t page : o.page_bytes) {
+        for (size_t ops : o.ops) {
+          for (const std::string& host : o.host) {
+            copy_rows.push_back(bench_copy(eng, o, page, ops, streams, host == "pinned"));
+          }
+        }
+      }
+    }
+#ifdef BODOCACHE_WITH_URING
+    const std::string path = storage_file(o);
+    for (size_t page : o.page_bytes) {
+      for (size_t qd : o.qd) storage_rows.push_back(bench_storage(o, path, page, qd));
+    }
+#endif
+  } catch (const std::exception& e) {
+    fprintf(stderr, "bodocache_copy_bench: %s\n", e.what());
+    return 1;
+  }
+  std::string doc = "{\n  \"backend\": \"" + std::string(kBackendName) + "\",\n  \"device\": " +
+                    std::to_string(o.device) + ",\n  \"cycle_source\": \"" + kCycleSource +
+                    "\",\n  \"copy\": " + join(copy_rows) + ",\n  \"storage\": " + join(storage_rows) + "\n}\n";
+  FILE* f = o.out.empty() ? stdout : fopen(o.out.c_str(), "w");
+  if (!f) {
+    fprintf(stderr, "bodocache_copy_bench: cannot write %s\n", o.out.c_str());
+    return 1;
+  }
+  fputs(doc.c_str(), f);
+  if (f != stdout) fclose(f);
+  return 0;
+}
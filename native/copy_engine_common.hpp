@@ -1,20 +1,44 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cctype>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 #include <pybind11/pybind11.h>
 #include <pybind11/functional.h>
 #include <pybind11/pytypes.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/numpy.h>
 
+#include "engine_telemetry.hpp"
+#include "page_codec.hpp"
+
+#ifdef BODOCACHE_WITH_URING
+#include "io_uring_reader.hpp"
+#endif
+
 namespace py = pybind11;
 
 struct HostBuf {
@@ -69,48 +93,738 @@ inline bool get_bytes_view(const py::handle& h, void** out_ptr, size_t* out_size
   return false;
 }
 
+// Backend::direct_read result asking the engine to fall back to the pinned bounce path.
+constexpr int64_t kDirectUnsupported = INT64_MIN;
+
+// Host-side completion hook enqueued on a stream behind each copy. Backends call
+// fn(arg) from a driver thread, so it must not call back into the device API.
+struct HostCallback {
+  void (*fn)(void*){nullptr};
+  void* arg{nullptr};
+};
+
+// How the worker learns that copies have finished.
+// - kCallback: block on a condition variable woken by per-op stream host callbacks
+// - kHostSync: block in the backend's event wait (with timeout) on the oldest op
+// - kPoll: legacy fixed-interval event queries
+enum class CompletionMode { kCallback, kHostSync, kPoll };
+
+inline CompletionMode parse_completion_mode(const std::string& mode, bool has_host_callback) {
+  if (mode == "callback") return has_host_callback ? CompletionMode::kCallback : CompletionMode::kHostSync;
+  if (mode == "sync") return CompletionMode::kHostSync;
+  if (mode == "poll") return CompletionMode::kPoll;
+  if (mode == "auto" || mode.empty()) return has_host_callback ? CompletionMode::kCallback : CompletionMode::kHostSync;
+  throw std::invalid_argument("completion_mode must be one of auto, callback, sync, poll");
+}
+
 // Backend-agnostic engine needs to provide these functions/types:
 // - using stream_t
+// - static constexpr bool kHasHostCallback
+// - static constexpr bool kBatchEvents
+//     record one event per stream per submit call, shared by that call's ops on the stream
+// - int device_count()
+//     number of devices visible to the process (engines built with device_id < 0 drive all)
 // - void init_device_streams(int device, int streams_per_dev)
+//     may be called once per device the engine drives
+// - int numa_node(int device)
+//     NUMA node closest to the device's PCIe root, or -1 if unknown
 // - stream_t get_stream(int device, int stream_id)
 // - void* alloc_pinned(size_t bytes)
 // - void free_pinned(void*)
 // - void memcpy_h2d_async(int device, void* dst_device, const void* src_host, size_t bytes, stream_t)
+// - void memcpy_d2h_async(int device, void* dst_host, const void* src_device, size_t bytes, stream_t)
+// - void memcpy_d2d_async(int device, void* dst, int dst_device, const void* src, size_t bytes, stream_t)
+//     src lives on `device`; peer copy when dst_device differs
 // - void record_event(stream_t, void** out_event)
 // - bool event_completed(void* event)
 // - void destroy_event(void* event)
+// - bool launch_host_callback(stream_t, HostCallback* cb)
+//     enqueue cb->fn(cb->arg) after prior work on the stream; return false if unsupported
+// - bool wait_event(void* event, uint64_t timeout_ns)
+//     block up to timeout_ns for the event; return true once it has completed
+// - stream_t get_priority_stream(int device)
+//     highest-priority stream of the device, used by the scheduler for urgent ops
+// Optional, with static constexpr bool kHasDecode = true (see page_codec.hpp):
+// - void* alloc_device(int device, size_t bytes) / void free_device(int device, void*)
+//     (also used by copy_engine_bench.cpp for its destinations)
+// - bool launch_decode(int device, stream_t, int32_t codec, const void* src, void* dst, size_t decoded_bytes)
+//     expand an encoded run already in device memory into dst, ordered after prior work on the stream
+// Optional, with static constexpr bool kHasBatchCopy = true:
+// - void memcpy_h2d_batch_async(int device, void** dsts, void** srcs, size_t* sizes, size_t count, stream_t)
+//     issue `count` independent H2D copies as one driver call (submit_scatter); without it
+//     the engine issues one memcpy_h2d_async per segment on the same stream
+// Optional (only needed by modules that bind submit_gds):
+// - int64_t direct_read(int device, const std::string& path, uint64_t offset, size_t size, void* dst_device)
+//     read file bytes straight into device memory; bytes read, -errno, or kDirectUnsupported
+//     when this range cannot go direct (the engine then bounces it through pinned memory)
+// Optional (only needed by modules that bind stream_wait_ops):
+// - void stream_wait_event(uintptr_t stream, void* event)
+//     make a caller-owned stream (raw handle) wait on the device for the event
+// Optional (only needed by modules that bind submit_peer):
+// - std::string peer_unique_id()
+//     opaque id rank 0 creates and every rank passes to peer_init
+// - void peer_init(int device, const std::string& uid, int nranks, int rank)
+// - bool peer_ready(int device)
+// - bool peer_register(int device, void* ptr, size_t bytes) / void peer_deregister(int device, void* ptr)
+//     register device buffers with the communicator for zero-copy transfers
+// - bool peer_transfer_batch(int device, const PeerTransfer* xfers, size_t count, stream_t)
+//     issue all sends/receives as one group on the stream; false if any could not be issued
+
+// NUMA node of a PCI device ("0000:3B:00.0") from sysfs, or -1 when unknown.
+inline int pci_numa_node(std::string bus_id) {
+  for (auto& c : bus_id) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  FILE* f = std::fopen(("/sys/bus/pci/devices/" + bus_id + "/numa_node").c_str(), "r");
+  if (!f) return -1;
+  int node = -1;
+  if (std::fscanf(f, "%d", &node) != 1) node = -1;
+  std::fclose(f);
+  return node;
+}
+
+// Prefers `node` for pages this thread allocates while in scope (set_mempolicy), then
+// restores the previous policy. Driver pinning calls fault their pages in on the calling
+// thread, so the buffer lands on that node. No-op for node < 0.
+class ScopedNumaPreference {
+ public:
+  explicit ScopedNumaPreference(int node) {
+#if defined(SYS_set_mempolicy) && defined(SYS_get_mempolicy)
+    if (node < 0 || node >= static_cast<int>(sizeof(unsigned long) * 8)) return;
+    if (syscall(SYS_get_mempolicy, &prev_mode_, &prev_mask_, sizeof(prev_mask_) * 8, nullptr, 0) != 0) return;
+    const unsigned long mask = 1UL << node;
+    active_ = syscall(SYS_set_mempolicy, kMpolPreferred, &mask, sizeof(mask) * 8) == 0;
+#else
+    (void)node;
+#endif
+  }
+
+  ~ScopedNumaPreference() {
+#if defined(SYS_set_mempolicy) && defined(SYS_get_mempolicy)
+    if (active_) syscall(SYS_set_mempolicy, prev_mode_, prev_mode_ ? &prev_mask_ : nullptr, sizeof(prev_mask_) * 8);
+#endif
+  }
+
+  ScopedNumaPreference(const ScopedNumaPreference&) = delete;
+  ScopedNumaPreference& operator=(const ScopedNumaPreference&) = delete;
+
+ private:
+  static constexpr int kMpolPreferred = 1;
+  int prev_mode_{0};
+  unsigned long prev_mask_{0};
+  bool active_{false};
+};
+
+// Size-classed pinned host buffer pool.
+//
+// Pinning memory (cudaHostAlloc / hipHostMalloc / zeMemAllocHost) costs
+// milliseconds and serializes in the driver, so buffers are rounded up to a
+// power-of-two class and recycled instead of being handed back to the driver
+// after every copy. `cap_bytes` bounds total resident pinned memory; once
+// resident bytes exceed `high_water_bytes`, released buffers are freed rather
+// than cached. A cap of 0 disables the limit. New buffers are placed on `numa_node`
+// (when >= 0), the node closest to the GPUs the pool serves. Buffers handed out are
+// tracked: ops that read one retain() it (by any address inside it), it goes back once
+// the last of them releases it, and releasing an idle buffer again is ignored.
+struct PinnedPoolStats {
+  uint64_t hits{0};
+  uint64_t misses{0};
+  uint64_t frees{0};
+  size_t bytes_resident{0};
+  size_t bytes_in_use{0};
+  size_t bytes_cached{0};
+  size_t peak_resident{0};
+};
+
+template <typename Backend>
+class PinnedSlabPool {
+ public:
+  static constexpr size_t kMinClassShift = 16;  // 64KB
+  static constexpr size_t kNumClasses = 48 - kMinClassShift;
+
+  PinnedSlabPool(Backend& backend, size_t cap_bytes, size_t high_water_bytes, int numa_node = -1)
+      : backend_(backend), cap_(cap_bytes), high_water_(high_water_bytes), numa_node_(numa_node), free_(kNumClasses) {}
+
+  ~PinnedSlabPool() { release_all(); }
+
+  PinnedSlabPool(const PinnedSlabPool&) = delete;
+  PinnedSlabPool& operator=(const PinnedSlabPool&) = delete;
+
+  static size_t class_index(size_t bytes) {
+    size_t idx = 0;
+    size_t sz = size_t(1) << kMinClassShift;
+    while (sz < bytes && idx + 1 < kNumClasses) {
+      sz <<= 1;
+      ++idx;
+    }
+    return idx;
+  }
+
+  static size_t class_bytes(size_t idx) { return size_t(1) << (idx + kMinClassShift); }
+
+  // Returns a pinned buffer of at least `bytes`, or nullptr if the cap would be exceeded
+  // or the driver allocation fails.
+  void* acquire(size_t bytes) {
+    const size_t idx = class_index(bytes);
+    const size_t cls = class_bytes(idx);
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      auto& fl = free_[idx];
+      if (!fl.empty()) {
+        void* p = fl.back();
+        fl.pop_back();
+        stats_.hits++;
+        stats_.bytes_cached -= cls;
+        stats_.bytes_in_use += cls;
+        in_use_[reinterpret_cast<uintptr_t>(p)] = 0;
+        return p;
+      }
+      stats_.misses++;
+      // Make room under the cap by dropping cached buffers of other classes.
+      if (cap_ > 0 && stats_.bytes_resident + cls > cap_) evict_cached_locked(stats_.bytes_resident + cls - cap_);
+      if (cap_ > 0 && stats_.bytes_resident + cls > cap_) return nullptr;
+      // Reserve before dropping the lock so concurrent misses respect the cap.
+      stats_.bytes_resident += cls;
+      stats_.bytes_in_use += cls;
+    }
+    void* p = nullptr;
+    {
+      ScopedNumaPreference near(numa_node_);
+      p = backend_.alloc_pinned(cls);
+    }
+    std::lock_guard<std::mutex> g(mu_);
+    if (!p) {
+      stats_.bytes_resident -= cls;
+      stats_.bytes_in_use -= cls;
+      return nullptr;
+    }
+    class_of_[p] = idx;
+    in_use_[reinterpret_cast<uintptr_t>(p)] = 0;
+    stats_.peak_resident = std::max(stats_.peak_resident, stats_.bytes_resident);
+    return p;
+  }
+
+  bool owns(void* p) {
+    std::lock_guard<std::mutex> g(mu_);
+    return class_of_.count(p) != 0;
+  }
+
+  // Count one more op reading the handed-out buffer that contains `p`. False if no
+  // handed-out buffer of this pool contains it.
+  bool retain(void* p) {
+    std::lock_guard<std::mutex> g(mu_);
+    auto it = in_use_locked(p);
+    if (it == in_use_.end()) return false;
+    ++it->second;
+    return true;
+  }
+
+  // Hand back the buffer containing `p`; it returns to the pool once no retained op still
+  // reads it. Returns false if `p` does not belong to this pool.
+  bool release(void* p) {
+    void* to_free = nullptr;
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      auto use = in_use_locked(p);
+      if (use == in_use_.end()) return owns_locked(p);  // already idle: ignore the repeat
+      if (use->second > 1) {
+        --use->second;
+        return true;
+      }
+      p = reinterpret_cast<void*>(use->first);
+      in_use_.erase(use);
+      auto it = class_of_.find(p);
+      const size_t cls = class_bytes(it->second);
+      stats_.bytes_in_use -= cls;
+      if (high_water_ > 0 && stats_.bytes_resident > high_water_) {
+        class_of_.erase(it);
+        stats_.bytes_resident -= cls;
+        stats_.frees++;
+        to_free = p;
+      } else {
+        free_[it->second].push_back(p);
+        stats_.bytes_cached += cls;
+      }
+    }
+    if (to_free) backend_.free_pinned(to_free);
+    return true;
+  }
+
+  // Pre-register `count` buffers of the class covering `bytes` so the first window
+  // does not pay for pinning. Stops early at the cap.
+  size_t prewarm(size_t bytes, size_t count) {
+    std::vector<void*> got;
+    got.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      void* p = acquire(bytes);
+      if (!p) break;
+      got.push_back(p);
+    }
+    for (void* p : got) release(p);
+    return got.size();
+  }
+
+  // Return all cached (idle) buffers to the driver.
+  void trim() {
+    std::vector<void*> drop;
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      for (size_t idx = 0; idx < kNumClasses; ++idx) {
+        for (void* p : free_[idx]) {
+          class_of_.erase(p);
+          stats_.bytes_resident -= class_bytes(idx);
+          stats_.bytes_cached -= class_bytes(idx);
+          stats_.frees++;
+          drop.push_back(p);
+        }
+        free_[idx].clear();
+      }
+    }
+    for (void* p : drop) backend_.free_pinned(p);
+  }
+
+  PinnedPoolStats stats() {
+    std::lock_guard<std::mutex> g(mu_);
+    return stats_;
+  }
+
+  int numa_node() const { return numa_node_; }
+
+ private:
+  // The handed-out buffer whose range contains `p`.
+  std::map<uintptr_t, uint32_t>::iterator in_use_locked(void* p) {
+    const uintptr_t a = reinterpret_cast<uintptr_t>(p);
+    auto it = in_use_.upper_bound(a);
+    if (it == in_use_.begin()) return in_use_.end();
+    --it;
+    auto cls = class_of_.find(reinterpret_cast<void*>(it->first));
+    return a < it->first + class_bytes(cls->second) ? it : in_use_.end();
+  }
+
+  bool owns_locked(void* p) const { return class_of_.count(p) != 0; }
+
+  void evict_cached_locked(size_t need) {
+    size_t freed = 0;
+    for (size_t idx = kNumClasses; idx-- > 0 && freed < need;) {
+      auto& fl = free_[idx];
+      while (!fl.empty() && freed < need) {
+        void* p = fl.back();
+        fl.pop_back();
+        class_of_.erase(p);
+        const size_t cls = class_bytes(idx);
+        stats_.bytes_resident -= cls;
+        stats_.bytes_cached -= cls;
+        stats_.frees++;
+        freed += cls;
+        backend_.free_pinned(p);
+      }
+    }
+  }
+
+  void release_all() {
+    std::lock_guard<std::mutex> g(mu_);
+    for (auto& kv : class_of_) backend_.free_pinned(kv.first);
+    class_of_.clear();
+    in_use_.clear();
+    for (auto& fl : free_) fl.clear();
+    stats_.bytes_resident = stats_.bytes_in_use = stats_.bytes_cached = 0;
+  }
+
+  Backend& backend_;
+  size_t cap_{0};
+  size_t high_water_{0};
+  int numa_node_{-1};
+  std::mutex mu_;
+  std::vector<std::vector<void*>> free_;   // [class] -> idle buffers
+  std::unordered_map<void*, size_t> class_of_;  // every resident buffer -> class
+  std::map<uintptr_t, uint32_t> in_use_;        // handed-out buffer -> retained ops reading it
+  PinnedPoolStats stats_{};
+};
+
+inline py::dict pool_stats_dict(const PinnedPoolStats& s) {
+  py::dict d;
+  d["hits"] = py::int_(s.hits);
+  d["misses"] = py::int_(s.misses);
+  d["frees"] = py::int_(s.frees);
+  d["bytes_resident"] = py::int_(s.bytes_resident);
+  d["bytes_in_use"] = py::int_(s.bytes_in_use);
+  d["bytes_cached"] = py::int_(s.bytes_cached);
+  d["peak_resident"] = py::int_(s.peak_resident);
+  return d;
+}
+
+inline py::dict histogram_dict(const LatencyHistogram& h) {
+  py::dict d;
+  const uint64_t n = h.count();
+  d["count"] = py::int_(n);
+  d["mean_ns"] = py::float_(n ? static_cast<double>(h.sum()) / static_cast<double>(n) : 0.0);
+  d["max_ns"] = py::int_(h.max());
+  d["p50_ns"] = py::int_(h.quantile(0.5));
+  d["p90_ns"] = py::int_(h.quantile(0.9));
+  d["p99_ns"] = py::int_(h.quantile(0.99));
+  d["p999_ns"] = py::int_(h.quantile(0.999));
+  return d;
+}
+
+inline py::dict telemetry_dict(const StreamTelemetry& st, double secs) {
+  py::dict d;
+  const uint64_t bytes = st.bytes.load(std::memory_order_relaxed);
+  d["ops"] = py::int_(st.ops.load(std::memory_order_relaxed));
+  d["bytes"] = py::int_(bytes);
+  d["bytes_per_s"] = py::float_(static_cast<double>(bytes) / secs);
+  d["deadline_misses"] = py::int_(st.deadline_misses.load(std::memory_order_relaxed));
+  d["failures"] = py::int_(st.failures.load(std::memory_order_relaxed));
+  d["read_ns"] = histogram_dict(st.read);
+  d["queue_wait_ns"] = histogram_dict(st.queue_wait);
+  d["dma_ns"] = histogram_dict(st.dma);
+  d["e2e_ns"] = histogram_dict(st.e2e);
+  return d;
+}
+
+inline int64_t steady_now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Wall-clock milliseconds, the time base of planner deadlines (deadline_ms).
+inline int64_t wall_now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// Copy direction of an op (CopyDescriptor.direction / CopyOp.direction). Peer ops only
+// come from submit_peer() and show up in completion records.
+enum CopyDirection : int32_t { kH2D = 0, kD2H = 1, kD2D = 2, kPeerRecv = 3, kPeerSend = 4 };
+
+// One entry of a submit_peer() call: device memory at ptr sent to, or received from,
+// rank `peer` of the engine's peer communicator.
+struct PeerTransfer {
+  void* ptr;
+  size_t bytes;
+  int peer;
+  bool send;
+};
+
+// One finished copy as seen from Python. Registered as a NumPy structured dtype in each
+// backend module (PYBIND11_NUMPY_DTYPE), so batches cross the boundary without per-op objects.
+struct CompletionRecord {
+  uint64_t op_id;
+  int32_t gpu_id;
+  int32_t stream_id;
+  uint64_t bytes;
+  int64_t deadline_ms;
+  int64_t t_submit_ns;
+  int64_t t_done_ns;
+  uint64_t tag;  // caller value from CopyDescriptor.tag, echoed back untouched
+  int32_t direction;
+  int32_t status;  // 0, or -errno if a writeback to storage failed or an encoded op could not be decoded
+};
+
+// Fixed-layout copy request for submit_array(); also registered as a NumPy dtype so a
+// whole plan window can be handed over as one structured array. Pointers are raw
+// addresses; which side is host memory follows `direction`.
+struct CopyDescriptor {
+  uint64_t src_ptr;
+  uint64_t dst_ptr;
+  uint64_t bytes;
+  int32_t stream_id;
+  int32_t gpu_id;
+  int64_t deadline_ms;
+  uint64_t tag;
+  int32_t direction;   // CopyDirection
+  int32_t dst_gpu_id;  // destination device of a D2D copy
+  int32_t priority;    // EDF tie-break among equal deadlines; lower issues first
+};
+
+template <typename T>
+using carray = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+// Optional descriptor column: None -> nullptr, otherwise a contiguous array of length n.
+template <typename T>
+const T* optional_column(const py::object& obj, carray<T>& holder, size_t n, const char* name) {
+  if (obj.is_none()) return nullptr;
+  holder = obj.cast<carray<T>>();
+  if (static_cast<size_t>(holder.size()) != n) {
+    throw std::invalid_argument(std::string(name) + " must have the same length as src_ptr");
+  }
+  return holder.data();
+}
+
+// Preallocated FIFO of completion records filled by the worker without the GIL and
+// drained by poll()/drain(). Grows by doubling only if a consumer falls behind.
+class CompletionRing {
+ public:
+  explicit CompletionRing(size_t capacity) : buf_(std::max<size_t>(capacity, 1)) {}
+
+  void push(const CompletionRecord* recs, size_t n) {
+    std::lock_guard<std::mutex> g(mu_);
+    if (size_ + n > buf_.size()) grow_locked(size_ + n);
+    for (size_t i = 0; i < n; ++i) {
+      buf_[(head_ + size_) % buf_.size()] = recs[i];
+      ++size_;
+    }
+  }
+
+  size_t pop_into(CompletionRecord* out, size_t max) {
+    std::lock_guard<std::mutex> g(mu_);
+    const size_t n = std::min(max, size_);
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = buf_[head_];
+      head_ = (head_ + 1) % buf_.size();
+    }
+    size_ -= n;
+    return n;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> g(mu_);
+    return size_;
+  }
+
+  uint64_t grows() {
+    std::lock_guard<std::mutex> g(mu_);
+    return grows_;
+  }
+
+ private:
+  void grow_locked(size_t need) {
+    size_t cap = buf_.size();
+    while (cap < need) cap *= 2;
+    std::vector<CompletionRecord> next(cap);
+    for (size_t i = 0; i < size_; ++i) next[i] = buf_[(head_ + i) % buf_.size()];
+    buf_.swap(next);
+    head_ = 0;
+    ++grows_;
+  }
+
+  std::mutex mu_;
+  std::vector<CompletionRecord> buf_;
+  size_t head_{0};
+  size_t size_{0};
+  uint64_t grows_{0};
+};
+
+// A plan row fanned out over several ops (execute_plan). The ops share the row's op_id and
+// its staging buffer; the last one to finish releases the buffer and emits the row's
+// single completion record.
+struct PlanRow {
+  std::atomic<size_t> pieces_left{0};
+  std::atomic<int32_t> status{0};
+  void* buffer{nullptr};
+  size_t bytes{0};
+  int32_t tier{0};
+  int32_t stream_id{0};
+  int64_t t_submit_ns{0};
+  int64_t read_ns{0};
+};
+
+// One execute_plan() window waiting for (or being run by) the plan thread.
+struct PlanJob {
+  struct Row {
+    int32_t file{0};
+    uint64_t offset{0};
+    size_t bytes{0};
+    char* dst{nullptr};
+    int32_t overlap{1};
+    int32_t stream_id{0};
+    int device{0};
+    int64_t deadline_ms{0};
+    uint64_t tag{0};
+    int32_t priority{0};
+    int32_t tier{0};
+    void* buffer{nullptr};  // pinned staging, owned by the row's PlanRow once issued
+    int64_t result{0};      // bytes read or -errno
+    int64_t t_read_ns{0};   // when its read was started
+  };
+  std::vector<std::string> files;
+  std::vector<Row> rows;
+  std::unordered_map<int32_t, size_t> caps;  // tier -> in-flight byte bound
+  uint64_t first_op_id{0};
+  int64_t t_submit_ns{0};
+};
+
+// One piece of a scatter op: bytes from src + src_offset land at dst.
+struct ScatterSegment {
+  void* dst{nullptr};
+  size_t src_offset{0};
+  size_t bytes{0};
+};
 
 struct PendingOp {
+  uint64_t op_id{0};
+  uint64_t tag{0};
   int device{0};
-  void* dst_device{nullptr};
-  void* src_host{nullptr};
+  int dst_device_id{0};  // D2D only
+  int32_t direction{kH2D};
+  int32_t status{0};
+  int32_t priority{0};
+  bool urgent{false};  // issued on the device's priority stream
+  void* dst{nullptr};
+  void* src{nullptr};
   size_t bytes{0};
   int stream_id{0};
   int64_t deadline_ms{0};
+  int64_t t_submit_ns{0};
+  int64_t t_issue_ns{0};  // copy issued on its stream (0: never issued by issue_copy)
+  int64_t read_ns{0};     // storage read between submit and issue, for telemetry
   void* event{nullptr};
+  // False for ops sharing a later op's event (kBatchEvents); only the owner destroys it
+  bool owns_event{true};
+  // Encoded H2D: `bytes` of PageCodec data expand on the device into decoded_bytes at dst
+  int32_t codec{kCodecNone};
+  size_t decoded_bytes{0};
+  // Scatter H2D: `src` is fanned out to these device ranges (dst is the first one)
+  std::vector<ScatterSegment> segments;
+  // Piece of an execute_plan() row; completes as part of that row
+  std::shared_ptr<PlanRow> plan_row;
+  // Writeback target: a finished D2H op is written here before it completes
+  std::string wb_path;
+  uint64_t wb_offset{0};
+  // The host side lies in a pool buffer handed to the engine (an H2D source from
+  // acquire_host_buffer, retained per op, or engine staging); the op releases it when it
+  // finishes. D2H destinations the caller passed in stay with the caller.
+  bool owns_host_buffer{false};
+
+  void* host_buffer() const { return direction == kH2D ? src : direction == kD2H ? dst : nullptr; }
 };
 
+// Heap order of the EDF scheduler: true when `a` should issue after `b`. Earliest deadline
+// first (0 = none, after every deadline), then lower priority, then submission order.
+inline bool edf_later(const PendingOp& a, const PendingOp& b) {
+  if ((a.deadline_ms > 0) != (b.deadline_ms > 0)) return a.deadline_ms <= 0;
+  if (a.deadline_ms != b.deadline_ms) return a.deadline_ms > b.deadline_ms;
+  if (a.priority != b.priority) return a.priority > b.priority;
+  return a.op_id > b.op_id;
+}
+
 template <typename Backend>
 class CopyEngineNative {
+  struct Lane;
+
  public:
-  CopyEngineNative(int device_id, int streams_per_device)
-      : device_(device_id), streams_per_dev_(streams_per_device) {
-    backend_.init_device_streams(device_, streams_per_dev_);
+  // device_id < 0 drives every visible device from one engine. Each device gets its own
+  // streams, completion worker and a pinned pool on its NUMA node (devices sharing a node
+  // share the pool; the caps are split evenly between pools). Ops are routed by gpu_id;
+  // ops without one go to the first device.
+  CopyEngineNative(int device_id, int streams_per_device, size_t pool_cap_bytes = size_t(1) << 30,
+                   size_t pool_high_water_bytes = size_t(768) << 20, const std::string& completion_mode = "auto",
+                   size_t completion_ring_capacity = 65536, size_t io_queue_depth = 32, bool io_o_direct = false)
+      : streams_per_dev_(streams_per_device),
+        stream_slots_(static_cast<size_t>(std::max(1, streams_per_device))),
+        ring_(completion_ring_capacity) {
+    if (device_id < 0) {
+      const int n = backend_.device_count();
+      if (n <= 0) throw std::runtime_error("no devices visible to the copy engine");
+      for (int d = 0; d < n; ++d) devices_.push_back(d);
+    } else {
+      devices_.push_back(device_id);
+    }
+    device_ = devices_.front();
+    mode_ = parse_completion_mode(completion_mode, Backend::kHasHostCallback);
+    if (io_queue_depth == 0) throw std::invalid_argument("io_queue_depth must be positive");
+    io_depth_ = io_queue_depth;
+    io_direct_ = io_o_direct;
+
+    std::vector<int> nodes(devices_.size());
+    std::vector<int> distinct;
+    for (size_t i = 0; i < devices_.size(); ++i) {
+      backend_.init_device_streams(devices_[i], streams_per_dev_);
+      nodes[i] = backend_.numa_node(devices_[i]);
+      if (std::find(distinct.begin(), distinct.end(), nodes[i]) == distinct.end()) distinct.push_back(nodes[i]);
+    }
+    for (int node : distinct) {
+      pools_.emplace_back(new PinnedSlabPool<Backend>(backend_, pool_cap_bytes / distinct.size(),
+                                                      pool_high_water_bytes / distinct.size(), node));
+    }
+    lanes_.resize(static_cast<size_t>(*std::max_element(devices_.begin(), devices_.end())) + 1);
+    for (size_t i = 0; i < devices_.size(); ++i) {
+      std::unique_ptr<Lane> lane(new Lane());
+      lane->engine = this;
+      lane->device = devices_[i];
+      lane->pool = pools_[std::find(distinct.begin(), distinct.end(), nodes[i]) - distinct.begin()].get();
+      // One FIFO per stream plus one for the priority stream
+      lane->queues.resize(stream_slots_ + 1);
+      lane->telemetry.reset(new StreamTelemetry[stream_slots_ + 1]());
+      lane->host_cb.fn = &CopyEngineNative::on_stream_progress;
+      lane->host_cb.arg = lane.get();
+      lanes_[devices_[i]] = std::move(lane);
+    }
+  }
+
+  ~CopyEngineNative() {
+    stop_worker();
+    free_scratch();
+    for (auto& kv : host_ranges_) backend_.host_unregister(reinterpret_cast<void*>(kv.first));
+  }
+
+  py::list devices() const {
+    py::list out;
+    for (int d : devices_) out.append(py::int_(d));
+    return out;
   }
 
-  ~CopyEngineNative() { stop_worker(); }
+  // For native harnesses (copy_engine_bench.cpp) that need device memory from the backend.
+  Backend& backend() { return backend_; }
 
-  py::memoryview acquire_host_buffer(size_t bytes) {
-    void* p = backend_.alloc_pinned(bytes);
+  // gpu_id picks the pool on that device's NUMA node (None: the first device).
+  py::memoryview acquire_host_buffer(size_t bytes, py::object gpu_id) {
+    const int device = gpu_id.is_none() ? device_ : gpu_id.cast<int>();
+    if (!owns_device(device)) throw std::invalid_argument(device_error(device));
+    // Recycled from the pinned pool; the worker hands it back when the copy completes.
+    void* p = lanes_[device]->pool->acquire(bytes);
     if (!p) throw std::bad_alloc();
-    std::lock_guard<std::mutex> g(mu_);
-    live_buffers_.push_back(p);
     // Expose as writable 1D uint8 buffer
     return py::memoryview(py::buffer_info(
         p, sizeof(uint8_t), py::format_descriptor<uint8_t>::format(), 1, {bytes}, {sizeof(uint8_t)}));
   }
 
-  void submit(py::list ops, py::function callback) {
+  // Returns a buffer from acquire_host_buffer that the engine did not take back, e.g. a D2H
+  // destination once its data has been consumed. False if no pool owns it.
+  bool release_host_buffer(py::object buf) {
+    void* p = nullptr;
+    size_t n = 0;
+    if (!get_bytes_view(buf, &p, &n)) throw std::invalid_argument("buf must support the buffer protocol");
+    for (auto& pool : pools_) {
+      if (pool->release(p)) return true;
+    }
+    return false;
+  }
+
+  // Prewarms `count` buffers in every pool; returns the total.
+  size_t prewarm_pool(size_t bytes, size_t count) {
+    size_t got = 0;
+    for (auto& pool : pools_) got += pool->prewarm(bytes, count);
+    return got;
+  }
+
+  void trim_pool() {
+    for (auto& pool : pools_) pool->trim();
+  }
+
+  // Totals over all pools, plus each pool's stats under "numa_nodes" keyed by node (-1: unknown).
+  py::dict pool_stats() {
+    PinnedPoolStats total;
+    py::dict by_node;
+    for (auto& pool : pools_) {
+      const PinnedPoolStats st = pool->stats();
+      total.hits += st.hits;
+      total.misses += st.misses;
+      total.frees += st.frees;
+      total.bytes_resident += st.bytes_resident;
+      total.bytes_in_use += st.bytes_in_use;
+      total.bytes_cached += st.bytes_cached;
+      total.peak_resident += st.peak_resident;
+      by_node[py::int_(pool->numa_node())] = pool_stats_dict(st);
+    }
+    py::dict d = pool_stats_dict(total);
+    d["numa_nodes"] = by_node;
+    return d;
+  }
+
+  // Enqueue a batch of copies and return the op_id of the first one; the batch occupies
+  // consecutive ids. With callback=None (and no batch callback) completions are only
+  // recorded for poll()/drain().
+  uint64_t submit(py::list ops, py::object callback) {
     std::vector<PendingOp> batch;
     batch.reserve(py::len(ops));
 
@@ -127,124 +841,1827 @@ class CopyEngineNative {
       size_t bytes = get_attr("bytes").cast<size_t>();
       int stream_id = 0;
       if (PyObject_HasAttrString(op.ptr(), "stream_id")) stream_id = op.attr("stream_id").cast<int>();
-      int device = 0;
+      int device = device_;
       if (PyObject_HasAttrString(op.ptr(), "gpu_id")) device = op.attr("gpu_id").cast<int>();
       int64_t deadline_ms = 0;
       if (PyObject_HasAttrString(op.ptr(), "deadline_ms")) deadline_ms = op.attr("deadline_ms").cast<int64_t>();
+      int32_t direction = kH2D;
+      if (PyObject_HasAttrString(op.ptr(), "direction")) direction = op.attr("direction").cast<int32_t>();
+      int dst_device_id = device;
+      if (PyObject_HasAttrString(op.ptr(), "dst_gpu_id")) dst_device_id = op.attr("dst_gpu_id").cast<int>();
+      int32_t priority = 0;
+      if (PyObject_HasAttrString(op.ptr(), "priority")) priority = op.attr("priority").cast<int32_t>();
 
-      void* src_ptr = nullptr;
-      size_t src_size = 0;
-      if (!get_bytes_view(src_obj, &src_ptr, &src_size)) {
-        throw std::runtime_error("src must be a writable buffer or bytes");
-      }
-      if (src_size < bytes) {
-        throw std::runtime_error("src buffer too small");
+      // Host sides are buffers, device sides are capsules / int addresses.
+      auto host_side = [&](py::object obj, const char* name) -> void* {
+        void* p = nullptr;
+        size_t n = 0;
+        if (!get_bytes_view(obj, &p, &n)) throw std::runtime_error(std::string(name) + " must be a writable buffer or bytes");
+        if (n < bytes) throw std::runtime_error(std::string(name) + " buffer too small");
+        return p;
+      };
+      auto device_side = [&](py::object obj, const char* name) -> void* {
+        void* p = capsule_to_ptr(obj);
+        if (!p) throw std::runtime_error(std::string(name) + " must be a device pointer capsule or int address");
+        return p;
+      };
+      if (direction != kH2D && direction != kD2H && direction != kD2D) {
+        throw std::invalid_argument("direction must be 0 (H2D), 1 (D2H) or 2 (D2D)");
       }
-      void* dst_ptr = capsule_to_ptr(dst_obj);
-      if (!dst_ptr) throw std::runtime_error("dst must be a device pointer capsule or int address");
+      void* src_ptr = direction == kH2D ? host_side(src_obj, "src") : device_side(src_obj, "src");
+      void* dst_ptr = direction == kD2H ? host_side(dst_obj, "dst") : device_side(dst_obj, "dst");
 
       PendingOp po;
       po.device = device;
-      po.dst_device = dst_ptr;
-      po.src_host = src_ptr;
+      po.dst_device_id = dst_device_id;
+      po.direction = direction;
+      po.dst = dst_ptr;
+      po.src = src_ptr;
       po.bytes = bytes;
       po.stream_id = stream_id;
       po.deadline_ms = deadline_ms;
+      po.priority = priority;
       batch.push_back(po);
     }
 
-    // Submit copies
-    for (auto& po : batch) {
-      auto stream = backend_.get_stream(po.device, po.stream_id);
-      backend_.memcpy_h2d_async(po.device, po.dst_device, po.src_host, po.bytes, stream);
-      backend_.record_event(stream, &po.event);
+    set_op_callback(callback);
+    retain_sources(batch);
+    return enqueue(batch);
+  }
+
+  // Fast path: submit a plan window from contiguous columns (uint64 src/dst addresses and
+  // byte counts, optional int32 stream/gpu ids, int64 deadlines, uint64 tags). No per-op
+  // Python objects are touched and the GIL is released for the whole enqueue loop.
+  //
+  // codec (int32 PageCodec, 0 = plain copy) with decoded_bytes marks H2D ops whose source
+  // holds encoded pages: `bytes` are copied into a per-stream device scratch buffer and
+  // decoded into dst on the same stream, so the completion event covers the decode.
+  uint64_t submit_array(carray<uint64_t> src_ptr, carray<uint64_t> dst_ptr, carray<uint64_t> bytes,
+                        py::object stream_id, py::object gpu_id, py::object deadline_ms, py::object tag,
+                        py::object callback, py::object direction, py::object dst_gpu_id, py::object priority,
+                        py::object codec, py::object decoded_bytes) {
+    const size_t n = static_cast<size_t>(src_ptr.size());
+    if (static_cast<size_t>(dst_ptr.size()) != n || static_cast<size_t>(bytes.size()) != n) {
+      throw std::invalid_argument("src_ptr, dst_ptr and bytes must have the same length");
+    }
+    carray<int32_t> stream_h, gpu_h;
+    carray<int64_t> deadline_h;
+    carray<uint64_t> tag_h;
+    const int32_t* streams = optional_column(stream_id, stream_h, n, "stream_id");
+    const int32_t* gpus = optional_column(gpu_id, gpu_h, n, "gpu_id");
+    const int64_t* deadlines = optional_column(deadline_ms, deadline_h, n, "deadline_ms");
+    const uint64_t* tags = optional_column(tag, tag_h, n, "tag");
+    carray<int32_t> dir_h, dst_gpu_h;
+    const int32_t* dirs = optional_column(direction, dir_h, n, "direction");
+    const int32_t* dst_gpus = optional_column(dst_gpu_id, dst_gpu_h, n, "dst_gpu_id");
+    carray<int32_t> prio_h;
+    const int32_t* prios = optional_column(priority, prio_h, n, "priority");
+    carray<int32_t> codec_h;
+    carray<uint64_t> decoded_h;
+    const int32_t* codecs = optional_column(codec, codec_h, n, "codec");
+    const uint64_t* decoded = optional_column(decoded_bytes, decoded_h, n, "decoded_bytes");
+    if (codecs && !decoded) throw std::invalid_argument("codec needs decoded_bytes");
+    const uint64_t* src = src_ptr.data();
+    const uint64_t* dst = dst_ptr.data();
+    const uint64_t* nbytes = bytes.data();
+
+    set_op_callback(callback);
+    py::gil_scoped_release nogil;
+    std::vector<PendingOp> batch(n);
+    for (size_t i = 0; i < n; ++i) {
+      if (!src[i] || !dst[i]) throw std::invalid_argument("src_ptr/dst_ptr entries must be non-null addresses");
+      if (dirs && (dirs[i] < kH2D || dirs[i] > kD2D)) throw std::invalid_argument("direction must be 0, 1 or 2");
+      PendingOp& po = batch[i];
+      po.src = reinterpret_cast<void*>(static_cast<uintptr_t>(src[i]));
+      po.dst = reinterpret_cast<void*>(static_cast<uintptr_t>(dst[i]));
+      po.bytes = static_cast<size_t>(nbytes[i]);
+      po.stream_id = streams ? streams[i] : 0;
+      po.device = gpus ? gpus[i] : device_;
+      po.deadline_ms = deadlines ? deadlines[i] : 0;
+      po.tag = tags ? tags[i] : 0;
+      po.direction = dirs ? dirs[i] : kH2D;
+      po.dst_device_id = dst_gpus ? dst_gpus[i] : po.device;
+      po.priority = prios ? prios[i] : 0;
+      if (codecs && codecs[i] != kCodecNone) {
+        po.codec = codecs[i];
+        po.decoded_bytes = static_cast<size_t>(decoded[i]);
+        check_codec(po);
+      }
+    }
+    retain_sources(batch);
+    return enqueue(batch);
+  }
+
+  // Scatter H2D: op i copies its pinned source src_ptr[i] into the device ranges
+  // seg_index[i]..seg_index[i+1] of the segment columns, each seg_bytes[j] bytes from
+  // src_ptr[i] + seg_src_offset[j] to seg_dst[j]. A coalesced storage read (one page run)
+  // thus lands in non-contiguous KV blocks as one op with one completion event; `bytes` in
+  // its record is the sum of its segments.
+  uint64_t submit_scatter(carray<uint64_t> src_ptr, carray<uint64_t> seg_index, carray<uint64_t> seg_dst,
+                          carray<uint64_t> seg_src_offset, carray<uint64_t> seg_bytes, py::object stream_id,
+                          py::object gpu_id, py::object deadline_ms, py::object tag, py::object callback,
+                          py::object priority) {
+    const size_t n = static_cast<size_t>(src_ptr.size());
+    const size_t m = static_cast<size_t>(seg_dst.size());
+    if (static_cast<size_t>(seg_index.size()) != n + 1) throw std::invalid_argument("seg_index must have len(src_ptr) + 1 entries");
+    if (static_cast<size_t>(seg_src_offset.size()) != m || static_cast<size_t>(seg_bytes.size()) != m) {
+      throw std::invalid_argument("seg_dst, seg_src_offset and seg_bytes must have the same length");
+    }
+    carray<int32_t> stream_h, gpu_h, prio_h;
+    carray<int64_t> deadline_h;
+    carray<uint64_t> tag_h;
+    const int32_t* streams = optional_column(stream_id, stream_h, n, "stream_id");
+    const int32_t* gpus = optional_column(gpu_id, gpu_h, n, "gpu_id");
+    const int64_t* deadlines = optional_column(deadline_ms, deadline_h, n, "deadline_ms");
+    const uint64_t* tags = optional_column(tag, tag_h, n, "tag");
+    const int32_t* prios = optional_column(priority, prio_h, n, "priority");
+    const uint64_t* src = src_ptr.data();
+    const uint64_t* index = seg_index.data();
+    const uint64_t* dst = seg_dst.data();
+    const uint64_t* off = seg_src_offset.data();
+    const uint64_t* nbytes = seg_bytes.data();
+    if (index[0] != 0 || index[n] != m) throw std::invalid_argument("seg_index must run from 0 to len(seg_dst)");
+
+    set_op_callback(callback);
+    py::gil_scoped_release nogil;
+    std::vector<PendingOp> batch(n);
+    for (size_t i = 0; i < n; ++i) {
+      if (index[i + 1] <= index[i]) throw std::invalid_argument("every scatter op needs at least one segment");
+      if (!src[i]) throw std::invalid_argument("src_ptr entries must be non-null addresses");
+      PendingOp& po = batch[i];
+      po.src = reinterpret_cast<void*>(static_cast<uintptr_t>(src[i]));
+      po.segments.reserve(static_cast<size_t>(index[i + 1] - index[i]));
+      for (uint64_t j = index[i]; j < index[i + 1]; ++j) {
+        if (!dst[j]) throw std::invalid_argument("seg_dst entries must be non-null addresses");
+        po.segments.push_back({reinterpret_cast<void*>(static_cast<uintptr_t>(dst[j])), static_cast<size_t>(off[j]),
+                               static_cast<size_t>(nbytes[j])});
+        po.bytes += static_cast<size_t>(nbytes[j]);
+      }
+      po.dst = po.segments.front().dst;
+      po.stream_id = streams ? streams[i] : 0;
+      po.device = gpus ? gpus[i] : device_;
+      po.deadline_ms = deadlines ? deadlines[i] : 0;
+      po.tag = tags ? tags[i] : 0;
+      po.priority = prios ? prios[i] : 0;
     }
+    retain_sources(batch);
+    return enqueue(batch);
+  }
 
-    // Start worker thread if not running
-    ensure_worker();
+  // Plan executor: runs a whole plan window (one storage range per row) off the calling
+  // thread. files/file_index name each row's segment file; offsets/sizes its byte range and
+  // dst_ptr the device destination. Rows are read into pooled pinned buffers (io_uring
+  // batches when built with USE_URING, pread otherwise), and each row's H2D copy is issued
+  // the moment its read lands, split into `overlap` pieces on consecutive streams from
+  // stream_id. tier_inflight_bytes ({tier: bytes}) bounds the bytes a tier may have read or
+  // in flight; rows wait in plan order for credit (a row larger than the bound runs alone).
+  // Row i completes as op first_op_id + i with one record (tag defaults to i); a failed
+  // read completes it with status -errno and nothing copied. Returns at once.
+  uint64_t execute_plan(std::vector<std::string> files, carray<int32_t> file_index, carray<uint64_t> offsets,
+                        carray<uint64_t> sizes, carray<uint64_t> dst_ptr, py::object overlap, py::object stream_id,
+                        py::object gpu_id, py::object deadline_ms, py::object tag, py::object priority,
+                        py::object tier, py::dict tier_inflight_bytes, py::object callback) {
+    const size_t n = static_cast<size_t>(file_index.size());
+    if (static_cast<size_t>(offsets.size()) != n || static_cast<size_t>(sizes.size()) != n ||
+        static_cast<size_t>(dst_ptr.size()) != n) {
+      throw std::invalid_argument("file_index, offsets, sizes and dst_ptr must have the same length");
+    }
+    carray<int32_t> overlap_h, stream_h, gpu_h, prio_h, tier_h;
+    carray<int64_t> deadline_h;
+    carray<uint64_t> tag_h;
+    const int32_t* fan = optional_column(overlap, overlap_h, n, "overlap");
+    const int32_t* streams = optional_column(stream_id, stream_h, n, "stream_id");
+    const int32_t* gpus = optional_column(gpu_id, gpu_h, n, "gpu_id");
+    const int64_t* deadlines = optional_column(deadline_ms, deadline_h, n, "deadline_ms");
+    const uint64_t* tags = optional_column(tag, tag_h, n, "tag");
+    const int32_t* prios = optional_column(priority, prio_h, n, "priority");
+    const int32_t* tiers = optional_column(tier, tier_h, n, "tier");
 
+    std::unique_ptr<PlanJob> job(new PlanJob());
+    job->files = std::move(files);
+    for (auto item : tier_inflight_bytes) job->caps[item.first.cast<int32_t>()] = item.second.cast<size_t>();
+    job->rows.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      PlanJob::Row& r = job->rows[i];
+      const int32_t f = file_index.data()[i];
+      if (f < 0 || static_cast<size_t>(f) >= job->files.size()) throw std::invalid_argument("file_index out of range");
+      if (!dst_ptr.data()[i]) throw std::invalid_argument("dst_ptr entries must be non-null addresses");
+      r.file = f;
+      r.offset = offsets.data()[i];
+      r.bytes = static_cast<size_t>(sizes.data()[i]);
+      r.dst = reinterpret_cast<char*>(static_cast<uintptr_t>(dst_ptr.data()[i]));
+      r.overlap = fan ? std::max(1, fan[i]) : 1;
+      r.stream_id = streams ? streams[i] : 0;
+      r.device = gpus ? gpus[i] : device_;
+      if (!owns_device(r.device)) throw std::invalid_argument(device_error(r.device));
+      r.deadline_ms = deadlines ? deadlines[i] : 0;
+      r.tag = tags ? tags[i] : i;
+      r.priority = prios ? prios[i] : 0;
+      r.tier = tiers ? tiers[i] : 0;
+    }
+    set_op_callback(callback);
+    job->first_op_id = next_op_id_.fetch_add(n);
+    job->t_submit_ns = steady_now_ns();
+    const uint64_t first_op_id = job->first_op_id;
     {
       std::lock_guard<std::mutex> g(mu_);
-      for (auto& po : batch) pending_.push_back(std::move(po));
-      // Update the active callback (single callback used for all ops)
-      active_callback_ = callback;
+      // Not-yet-issued rows count as finishing so drain() waits for them.
+      finishing_ += n;
+      plan_rows_queued_ += n;
+      plan_jobs_.push_back(std::move(job));
+      if (!plan_running_) {
+        plan_running_ = true;
+        plan_thread_ = std::thread([this]() { this->plan_loop(); });
+      }
     }
+    plan_cv_.notify_all();
+    return first_op_id;
   }
 
- private:
-  void ensure_worker() {
-    bool expected = false;
-    if (running_.compare_exchange_strong(expected, true)) {
-      worker_ = std::thread([this]() { this->worker_loop(); });
+  py::dict plan_stats() {
+    std::lock_guard<std::mutex> g(mu_);
+    py::dict d;
+    d["rows"] = py::int_(plan_rows_);
+    d["pieces"] = py::int_(plan_pieces_);
+    d["bytes"] = py::int_(plan_bytes_);
+    d["read_failures"] = py::int_(plan_read_failures_);
+    d["credit_waits"] = py::int_(plan_credit_waits_);
+    d["queued_rows"] = py::int_(plan_rows_queued_);
+    py::dict tiers;
+    for (auto& kv : plan_inflight_) tiers[py::int_(kv.first)] = py::int_(kv.second);
+    d["tier_inflight_bytes"] = tiers;
+    return d;
+  }
+
+  py::dict scatter_stats() {
+    py::dict d;
+    d["scatter_ops"] = py::int_(scatter_ops_.load());
+    d["scatter_segments"] = py::int_(scatter_segments_.load());
+    d["batched"] = py::bool_(Backend::kHasBatchCopy);
+    return d;
+  }
+
+  // Codecs submit_array() can decode on this backend (see page_codec.hpp).
+  py::list decode_codecs() const {
+    py::list out;
+    if (Backend::kHasDecode) {
+      out.append("fp8");
+      out.append("int4");
     }
+    return out;
   }
 
-  void stop_worker() {
-    bool was_running = running_.exchange(false);
-    if (was_running && worker_.joinable()) worker_.join();
+  py::dict decode_stats() {
+    py::dict d;
+    d["decode_ops"] = py::int_(decode_ops_.load());
+    d["decode_failures"] = py::int_(decode_failures_.load());
+    d["encoded_bytes"] = py::int_(encoded_bytes_.load());
+    d["decoded_bytes"] = py::int_(decoded_bytes_.load());
+    size_t scratch = 0;
+    {
+      std::lock_guard<std::mutex> g(decode_mu_);
+      for (auto& kv : scratch_) scratch += kv.second.bytes;
+    }
+    d["scratch_bytes"] = py::int_(scratch);
+    return d;
   }
 
-  void worker_loop() {
-    while (running_.load()) {
-      std::vector<PendingOp> done;
-      py::function cb;
-      {
-        std::lock_guard<std::mutex> g(mu_);
-        for (auto it = pending_.begin(); it != pending_.end();) {
-          if (backend_.event_completed(it->event)) {
-            done.push_back(*it);
-            backend_.destroy_event(it->event);
-            it = pending_.erase(it);
-          } else {
-            ++it;
-          }
-        }
-        if (!active_callback_.is_none()) cb = active_callback_.cast<py::function>();
-      }
-
-      // Fire callbacks and free host buffers (if we own them)
-      if (!done.empty()) {
-        // Identify any engine-owned host buffers to free
-        {
-          std::lock_guard<std::mutex> g(mu_);
-          for (auto& po : done) {
-            // If src_host is one of our live buffers, free it
-            auto it = std::find(live_buffers_.begin(), live_buffers_.end(), po.src_host);
-            if (it != live_buffers_.end()) {
-              backend_.free_pinned(po.src_host);
-              live_buffers_.erase(it);
-            }
-          }
+  // Same as above from one CopyDescriptor structured array.
+  uint64_t submit_descriptors(py::array_t<CopyDescriptor, py::array::c_style> descriptors, py::object callback) {
+    const size_t n = static_cast<size_t>(descriptors.size());
+    const CopyDescriptor* d = descriptors.data();
+    set_op_callback(callback);
+    py::gil_scoped_release nogil;
+    std::vector<PendingOp> batch(n);
+    for (size_t i = 0; i < n; ++i) {
+      if (!d[i].src_ptr || !d[i].dst_ptr) throw std::invalid_argument("src_ptr/dst_ptr entries must be non-null addresses");
+      if (d[i].direction < kH2D || d[i].direction > kD2D) throw std::invalid_argument("direction must be 0, 1 or 2");
+      PendingOp& po = batch[i];
+      po.src = reinterpret_cast<void*>(static_cast<uintptr_t>(d[i].src_ptr));
+      po.dst = reinterpret_cast<void*>(static_cast<uintptr_t>(d[i].dst_ptr));
+      po.bytes = static_cast<size_t>(d[i].bytes);
+      po.stream_id = d[i].stream_id;
+      po.device = d[i].gpu_id;
+      po.deadline_ms = d[i].deadline_ms;
+      po.tag = d[i].tag;
+      po.direction = d[i].direction;
+      po.dst_device_id = d[i].dst_gpu_id;
+      po.priority = d[i].priority;
+    }
+    retain_sources(batch);
+    return enqueue(batch);
+  }
+
+  // Page-locks an existing host range (e.g. a segment mmap) so submit_array copies from
+  // it DMA straight out of the page cache. Returns false when the backend cannot pin
+  // foreign memory; the range still works as a pageable source. Registering an address
+  // twice is a no-op. Ranges stay registered until unregister_host() or engine teardown.
+  bool register_host(uint64_t ptr, size_t bytes) {
+    if (!ptr || bytes == 0) throw std::invalid_argument("register_host needs a non-null address and size");
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      if (host_ranges_.count(ptr)) return true;
+    }
+    bool ok;
+    {
+      py::gil_scoped_release nogil;
+      ok = backend_.host_register(reinterpret_cast<void*>(static_cast<uintptr_t>(ptr)), bytes);
+    }
+    if (!ok) return false;
+    std::lock_guard<std::mutex> g(mu_);
+    host_ranges_.emplace(ptr, bytes);
+    return true;
+  }
+
+  // Releases a range from register_host(); the caller must not unmap it while copies
+  // from it are in flight. Returns false if the address was not registered.
+  bool unregister_host(uint64_t ptr) {
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      if (!host_ranges_.erase(ptr)) return false;
+    }
+    backend_.host_unregister(reinterpret_cast<void*>(static_cast<uintptr_t>(ptr)));
+    return true;
+  }
+
+  // Raw address of a writable buffer (e.g. one from acquire_host_buffer) for submit_array.
+  uintptr_t buffer_address(py::object buf) {
+    void* p = nullptr;
+    size_t n = 0;
+    if (!get_bytes_view(buf, &p, &n)) throw std::invalid_argument("buf must support the buffer protocol");
+    return reinterpret_cast<uintptr_t>(p);
+  }
+
+#ifdef BODOCACHE_WITH_URING
+  // Storage->device streaming: read each (path, offset, size) range through a ring of
+  // `depth` pinned staging chunks of chunk_bytes and start the H2D copy of a chunk as soon
+  // as its io_uring read lands, so disk and PCIe overlap within a range. Each range is one
+  // op whose completion event is recorded behind its last chunk. Returns the first op_id;
+  // the call itself returns once every chunk has been read and its copy enqueued.
+  uint64_t submit_stream(std::vector<std::string> paths, carray<uint64_t> offsets, carray<uint64_t> sizes,
+                         carray<uint64_t> dst_ptr, py::object stream_id, py::object gpu_id, py::object deadline_ms,
+                         py::object tag, size_t chunk_bytes, size_t depth, py::object callback) {
+    const size_t n = paths.size();
+    if (static_cast<size_t>(offsets.size()) != n || static_cast<size_t>(sizes.size()) != n ||
+        static_cast<size_t>(dst_ptr.size()) != n) {
+      throw std::invalid_argument("paths, offsets, sizes and dst_ptr must have the same length");
+    }
+    if (chunk_bytes == 0 || depth == 0) throw std::invalid_argument("chunk_bytes and depth must be positive");
+    carray<int32_t> stream_h, gpu_h;
+    carray<int64_t> deadline_h;
+    carray<uint64_t> tag_h;
+    const int32_t* streams = optional_column(stream_id, stream_h, n, "stream_id");
+    const int32_t* gpus = optional_column(gpu_id, gpu_h, n, "gpu_id");
+    const int64_t* deadlines = optional_column(deadline_ms, deadline_h, n, "deadline_ms");
+    const uint64_t* tags = optional_column(tag, tag_h, n, "tag");
+    const uint64_t* off = offsets.data();
+    const uint64_t* sz = sizes.data();
+    const uint64_t* dst = dst_ptr.data();
+
+    set_op_callback(callback);
+    py::gil_scoped_release nogil;
+    std::vector<PendingOp> batch(n);
+    std::vector<size_t> chunks_left(n, 0);
+    const uint64_t first_op_id = next_op_id_.fetch_add(n);
+    for (size_t i = 0; i < n; ++i) {
+      if (!dst[i]) throw std::invalid_argument("dst_ptr entries must be non-null addresses");
+      PendingOp& po = batch[i];
+      po.op_id = first_op_id + i;
+      po.dst = reinterpret_cast<void*>(static_cast<uintptr_t>(dst[i]));
+      po.bytes = static_cast<size_t>(sz[i]);
+      po.stream_id = streams ? streams[i] : 0;
+      po.device = gpus ? gpus[i] : device_;
+      if (!owns_device(po.device)) throw std::invalid_argument(device_error(po.device));
+      po.deadline_ms = deadlines ? deadlines[i] : 0;
+      po.tag = tags ? tags[i] : 0;
+      po.t_submit_ns = steady_now_ns();
+      chunks_left[i] = (po.bytes + chunk_bytes - 1) / chunk_bytes;
+    }
+
+    IoUringReader& reader = stream_reader();
+    // Staging chunks come from the pool near the first range's device.
+    PinnedSlabPool<Backend>& pool = *lanes_[n ? batch[0].device : device_]->pool;
+    std::vector<char*> slots;
+    std::vector<void*> slot_events(depth, nullptr);
+    for (size_t k = 0; k < depth; ++k) {
+      void* p = pool.acquire(chunk_bytes);
+      if (!p) break;
+      slots.push_back(static_cast<char*>(p));
+    }
+    auto wait_slot = [&](size_t k) {
+      if (!slot_events[k]) return;
+      while (!backend_.wait_event(slot_events[k], kHostSyncTimeoutNs)) std::this_thread::yield();
+      backend_.destroy_event(slot_events[k]);
+      slot_events[k] = nullptr;
+    };
+    auto seal = [&](PendingOp& po) {
+      // Chunk reads and copies overlap; the read phase ends with the last chunk's copy
+      po.t_issue_ns = steady_now_ns();
+      po.read_ns = po.t_issue_ns - po.t_submit_ns;
+      auto stream = backend_.get_stream(po.device, po.stream_id);
+      backend_.record_event(stream, &po.event);
+      if (mode_ == CompletionMode::kCallback && !backend_.launch_host_callback(stream, &lanes_[po.device]->host_cb)) {
+        mode_ = CompletionMode::kHostSync;
+      }
+    };
+    auto release_slots = [&]() {
+      for (size_t k = 0; k < slots.size(); ++k) {
+        wait_slot(k);
+        pool.release(slots[k]);
+      }
+    };
+    auto discard = [&]() { discard_batch(batch); };
+    if (slots.empty()) throw std::bad_alloc();
+
+    std::vector<int64_t> results;
+    try {
+      results = reader.stream_ranges(
+          paths, off, sz, slots, chunk_bytes, wait_slot,
+          [&](size_t r, uint64_t range_off, size_t k, size_t len) {
+            PendingOp& po = batch[r];
+            auto stream = backend_.get_stream(po.device, po.stream_id);
+            backend_.memcpy_h2d_async(po.device, static_cast<char*>(po.dst) + range_off, slots[k], len,
+                                      stream);
+            backend_.record_event(stream, &slot_events[k]);
+            // Chunks of a range share its stream, so an event behind the last one covers all.
+            if (--chunks_left[r] == 0) seal(po);
+          });
+    } catch (...) {
+      release_slots();
+      discard();
+      throw;
+    }
+    release_slots();
+    for (size_t i = 0; i < n; ++i) {
+      if (batch[i].bytes == 0) seal(batch[i]);
+      if (results[i] != static_cast<int64_t>(batch[i].bytes)) {
+        discard();
+        if (results[i] < 0) {
+          throw std::runtime_error(paths[i] + ": read failed: errno " + std::to_string(-results[i]));
         }
+        throw std::runtime_error(paths[i] + ": short read, range extends past end of file");
+      }
+    }
+    hand_off(batch);
+    return first_op_id;
+  }
+#endif
+
+  // Direct storage->device reads (GPUDirect Storage on CUDA). Each (path, offset, size)
+  // range is read from its file straight into dst via Backend::direct_read; ranges the
+  // backend declines (unaligned, filesystem without GDS support) fall back per op to a read
+  // into a pooled pinned buffer plus an async H2D copy. Each range is one op.
+  uint64_t submit_direct(std::vector<std::string> paths, carray<uint64_t> offsets, carray<uint64_t> sizes,
+                         carray<uint64_t> dst_ptr, py::object stream_id, py::object gpu_id, py::object deadline_ms,
+                         py::object tag, py::object callback) {
+    const size_t n = paths.size();
+    if (static_cast<size_t>(offsets.size()) != n || static_cast<size_t>(sizes.size()) != n ||
+        static_cast<size_t>(dst_ptr.size()) != n) {
+      throw std::invalid_argument("paths, offsets, sizes and dst_ptr must have the same length");
+    }
+    carray<int32_t> stream_h, gpu_h;
+    carray<int64_t> deadline_h;
+    carray<uint64_t> tag_h;
+    const int32_t* streams = optional_column(stream_id, stream_h, n, "stream_id");
+    const int32_t* gpus = optional_column(gpu_id, gpu_h, n, "gpu_id");
+    const int64_t* deadlines = optional_column(deadline_ms, deadline_h, n, "deadline_ms");
+    const uint64_t* tags = optional_column(tag, tag_h, n, "tag");
+    const uint64_t* off = offsets.data();
+    const uint64_t* sz = sizes.data();
+    const uint64_t* dst = dst_ptr.data();
+
+    set_op_callback(callback);
+    py::gil_scoped_release nogil;
+    std::vector<PendingOp> batch;
+    batch.reserve(n);
+    const uint64_t first_op_id = next_op_id_.fetch_add(n);
+    for (size_t i = 0; i < n; ++i) {
+      if (!dst[i]) {
+        discard_batch(batch);
+        throw std::invalid_argument("dst_ptr entries must be non-null addresses");
+      }
+      batch.emplace_back();
+      PendingOp& po = batch.back();
+      po.op_id = first_op_id + i;
+      po.dst = reinterpret_cast<void*>(static_cast<uintptr_t>(dst[i]));
+      po.bytes = static_cast<size_t>(sz[i]);
+      po.stream_id = streams ? streams[i] : 0;
+      po.device = gpus ? gpus[i] : device_;
+      if (!owns_device(po.device)) {
+        batch.pop_back();
+        discard_batch(batch);
+        throw std::invalid_argument(device_error(po.device));
+      }
+      po.deadline_ms = deadlines ? deadlines[i] : 0;
+      po.tag = tags ? tags[i] : 0;
+      po.t_submit_ns = steady_now_ns();
+      auto stream = backend_.get_stream(po.device, po.stream_id);
 
-        if (cb) {
-          py::gil_scoped_acquire ag;
-          for (auto& po : done) {
-            try {
-              py::dict info;
-              info["gpu_id"] = po.device;
-              info["bytes"] = py::int_(po.bytes);
-              info["deadline_ms"] = py::int_(po.deadline_ms);
-              cb(info);
-            } catch (...) {
-              // Swallow exceptions to keep worker alive
-            }
-          }
+      int64_t got = po.bytes == 0 ? 0 : backend_.direct_read(po.device, paths[i], off[i], po.bytes, po.dst);
+      if (got == kDirectUnsupported) {
+        ++direct_fallbacks_;
+        po.src = lanes_[po.device]->pool->acquire(po.bytes);
+        po.owns_host_buffer = true;
+        if (!po.src) {
+          discard_batch(batch);
+          throw std::bad_alloc();
         }
+        got = pread_full(paths[i], off[i], po.bytes, po.src);
+        if (got == static_cast<int64_t>(po.bytes)) {
+          backend_.memcpy_h2d_async(po.device, po.dst, po.src, po.bytes, stream);
+        }
+      } else {
+        ++direct_ops_;
+      }
+      if (got != static_cast<int64_t>(po.bytes)) {
+        discard_batch(batch);
+        if (got < 0) throw std::runtime_error(paths[i] + ": read failed: errno " + std::to_string(-got));
+        throw std::runtime_error(paths[i] + ": short read, range extends past end of file");
       }
+      po.t_issue_ns = steady_now_ns();
+      po.read_ns = po.t_issue_ns - po.t_submit_ns;
+      // Direct reads are synchronous, so this event only orders the op on its stream.
+      record_completion(stream, po);
+    }
+    hand_off(batch);
+    return first_op_id;
+  }
 
-      // Sleep a bit
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  // Eviction/writeback: copy each device range (src_ptr, bytes) D2H into a pooled pinned
+  // buffer, then write it to (path, offset) from the writeback thread (io_uring when built
+  // with USE_URING, pwrite otherwise). The op completes, with `status` set, once the data
+  // is in the file; the staging buffer then goes back to the pool.
+  uint64_t submit_writeback(carray<uint64_t> src_ptr, carray<uint64_t> bytes, std::vector<std::string> paths,
+                            carray<uint64_t> offsets, py::object stream_id, py::object gpu_id,
+                            py::object deadline_ms, py::object tag, py::object callback) {
+    const size_t n = paths.size();
+    if (static_cast<size_t>(src_ptr.size()) != n || static_cast<size_t>(bytes.size()) != n ||
+        static_cast<size_t>(offsets.size()) != n) {
+      throw std::invalid_argument("src_ptr, bytes, paths and offsets must have the same length");
     }
+    carray<int32_t> stream_h, gpu_h;
+    carray<int64_t> deadline_h;
+    carray<uint64_t> tag_h;
+    const int32_t* streams = optional_column(stream_id, stream_h, n, "stream_id");
+    const int32_t* gpus = optional_column(gpu_id, gpu_h, n, "gpu_id");
+    const int64_t* deadlines = optional_column(deadline_ms, deadline_h, n, "deadline_ms");
+    const uint64_t* tags = optional_column(tag, tag_h, n, "tag");
+    const uint64_t* src = src_ptr.data();
+    const uint64_t* nbytes = bytes.data();
+    const uint64_t* off = offsets.data();
+
+    set_op_callback(callback);
+    py::gil_scoped_release nogil;
+    std::vector<PendingOp> batch(n);
+    for (size_t i = 0; i < n; ++i) {
+      PendingOp& po = batch[i];
+      if (!src[i]) {
+        discard_batch(batch);
+        throw std::invalid_argument("src_ptr entries must be non-null addresses");
+      }
+      po.direction = kD2H;
+      po.src = reinterpret_cast<void*>(static_cast<uintptr_t>(src[i]));
+      po.bytes = static_cast<size_t>(nbytes[i]);
+      po.device = gpus ? gpus[i] : device_;
+      if (!owns_device(po.device)) {
+        discard_batch(batch);
+        throw std::invalid_argument(device_error(po.device));
+      }
+      po.dst = lanes_[po.device]->pool->acquire(po.bytes);
+      po.owns_host_buffer = true;
+      if (!po.dst) {
+        discard_batch(batch);
+        throw std::bad_alloc();
+      }
+      po.stream_id = streams ? streams[i] : 0;
+      po.deadline_ms = deadlines ? deadlines[i] : 0;
+      po.tag = tags ? tags[i] : 0;
+      po.wb_path = paths[i];
+      po.wb_offset = off[i];
+    }
+    return enqueue(batch);
+  }
+
+  py::dict direct_stats() {
+    py::dict d;
+    d["direct_ops"] = py::int_(direct_ops_.load());
+    d["fallback_ops"] = py::int_(direct_fallbacks_.load());
+    return d;
   }
 
+  // Cross-node peer transfers over the communicator set up by peer_init(). Each
+  // (ptr, bytes, peer) entry is one op that sends the device range at ptr to rank `peer`
+  // (send != 0) or receives into it. A call's ops go out as one group on one stream of
+  // gpu_id and bypass the EDF queue: both ranks of a pair must submit matching calls in
+  // the same order, which reordering would break. Ops complete once the group has drained.
+  uint64_t submit_peer(carray<uint64_t> ptr, carray<uint64_t> bytes, carray<int32_t> peer, py::object send,
+                       int stream_id, py::object gpu_id, py::object deadline_ms, py::object tag,
+                       py::object callback) {
+    const size_t n = static_cast<size_t>(ptr.size());
+    if (static_cast<size_t>(bytes.size()) != n || static_cast<size_t>(peer.size()) != n) {
+      throw std::invalid_argument("ptr, bytes and peer must have the same length");
+    }
+    carray<int32_t> send_h;
+    carray<int64_t> deadline_h;
+    carray<uint64_t> tag_h;
+    const int32_t* sends = optional_column(send, send_h, n, "send");
+    const int64_t* deadlines = optional_column(deadline_ms, deadline_h, n, "deadline_ms");
+    const uint64_t* tags = optional_column(tag, tag_h, n, "tag");
+    const int device = gpu_id.is_none() ? device_ : gpu_id.cast<int>();
+    if (!owns_device(device)) throw std::invalid_argument(device_error(device));
+    if (!backend_.peer_ready(device)) throw std::runtime_error("peer transport is not initialized (call peer_init)");
+    const uint64_t* p = ptr.data();
+    const uint64_t* sz = bytes.data();
+    const int32_t* ranks = peer.data();
+
+    set_op_callback(callback);
+    py::gil_scoped_release nogil;
+    std::vector<PendingOp> batch(n);
+    std::vector<PeerTransfer> xfers(n);
+    const uint64_t first_op_id = next_op_id_.fetch_add(n);
+    const int64_t now = steady_now_ns();
+    for (size_t i = 0; i < n; ++i) {
+      if (!p[i]) throw std::invalid_argument("ptr entries must be non-null addresses");
+      PendingOp& po = batch[i];
+      po.op_id = first_op_id + i;
+      po.device = device;
+      po.stream_id = stream_id;
+      po.bytes = static_cast<size_t>(sz[i]);
+      po.direction = sends && sends[i] ? kPeerSend : kPeerRecv;
+      (po.direction == kPeerSend ? po.src : po.dst) = reinterpret_cast<void*>(static_cast<uintptr_t>(p[i]));
+      po.deadline_ms = deadlines ? deadlines[i] : 0;
+      po.tag = tags ? tags[i] : 0;
+      po.t_submit_ns = now;
+      xfers[i] = PeerTransfer{reinterpret_cast<void*>(static_cast<uintptr_t>(p[i])), po.bytes, ranks[i],
+                              po.direction == kPeerSend};
+    }
+    auto stream = backend_.get_stream(device, stream_id);
+    if (!backend_.peer_transfer_batch(device, xfers.data(), n, stream)) {
+      throw std::runtime_error("peer transfer could not be issued");
+    }
+    for (auto& po : batch) {
+      po.t_issue_ns = steady_now_ns();
+      record_completion(stream, po);
+      peer_bytes_ += po.bytes;
+    }
+    peer_ops_ += n;
+    hand_off(batch);
+    return first_op_id;
+  }
+
+  py::bytes peer_unique_id() { return py::bytes(backend_.peer_unique_id()); }
+
+  // Joins the peer communicator as `rank` of nranks; every rank passes rank 0's peer_unique_id().
+  void peer_init(py::bytes uid, int nranks, int rank, py::object gpu_id) {
+    const int device = gpu_id.is_none() ? device_ : gpu_id.cast<int>();
+    if (!owns_device(device)) throw std::invalid_argument(device_error(device));
+    if (nranks < 1 || rank < 0 || rank >= nranks) throw std::invalid_argument("rank must be in [0, nranks)");
+    std::string id = uid;
+    py::gil_scoped_release nogil;
+    backend_.peer_init(device, id, nranks, rank);
+  }
+
+  // Registers a device buffer (e.g. the KV pool) with the communicator so transfers from
+  // and into it skip the transport's internal staging. False when the transport cannot.
+  bool register_peer_buffer(uint64_t ptr, size_t bytes, py::object gpu_id) {
+    if (!ptr || bytes == 0) throw std::invalid_argument("register_peer_buffer needs a non-null address and size");
+    const int device = gpu_id.is_none() ? device_ : gpu_id.cast<int>();
+    if (!owns_device(device)) throw std::invalid_argument(device_error(device));
+    py::gil_scoped_release nogil;
+    return backend_.peer_register(device, reinterpret_cast<void*>(static_cast<uintptr_t>(ptr)), bytes);
+  }
+
+  void unregister_peer_buffer(uint64_t ptr, py::object gpu_id) {
+    const int device = gpu_id.is_none() ? device_ : gpu_id.cast<int>();
+    if (!owns_device(device)) throw std::invalid_argument(device_error(device));
+    backend_.peer_deregister(device, reinterpret_cast<void*>(static_cast<uintptr_t>(ptr)));
+  }
+
+  py::dict peer_stats() {
+    py::dict d;
+    d["peer_ops"] = py::int_(peer_ops_.load());
+    d["peer_bytes"] = py::int_(peer_bytes_.load());
+    return d;
+  }
+
+  // Per-layer readiness on the device: makes `stream`, a raw stream handle the caller owns
+  // (e.g. the model's compute stream), wait for ops op_ids without blocking the host, so a
+  // layer's compute starts as soon as its copies land rather than after the whole window.
+  // Copies on a stream retire in order, so each engine stream needs one wait, on the event
+  // of its last listed op; ops no longer in flight need none. Call after the submitting
+  // call has returned. Returns how many ops could not be fenced because they have not
+  // reached a stream yet (held by the scheduler, or execute_plan rows still being read);
+  // the caller waits for those on the host.
+  size_t stream_wait_ops(carray<uint64_t> op_ids, uint64_t stream, py::object gpu_id) {
+    const int device = gpu_id.is_none() ? device_ : gpu_id.cast<int>();
+    if (!owns_device(device)) throw std::invalid_argument(device_error(device));
+    if (!stream) throw std::invalid_argument("stream must be a non-null stream handle");
+    std::vector<uint64_t> want(op_ids.data(), op_ids.data() + op_ids.size());
+    std::sort(want.begin(), want.end());
+    want.erase(std::unique(want.begin(), want.end()), want.end());
+    if (want.empty()) return 0;
+    auto listed = [&](uint64_t id) { return std::binary_search(want.begin(), want.end(), id); };
+
+    py::gil_scoped_release nogil;
+    std::lock_guard<std::mutex> g(mu_);
+    Lane& lane = *lanes_[device];
+    std::vector<uint64_t> fenced;
+    size_t queued = 0;
+    for (auto& q : lane.queues) {
+      queued += q.size();
+      void* last = nullptr;
+      for (auto& po : q) {
+        if (!listed(po.op_id)) continue;
+        fenced.push_back(po.op_id);
+        if (po.event) last = po.event;
+      }
+      // Events are destroyed only after their op leaves the queue, which needs mu_
+      if (last) backend_.stream_wait_event(static_cast<uintptr_t>(stream), last);
+    }
+    size_t unfenced = 0;
+    for (auto& po : lane.heap) unfenced += listed(po.op_id) ? 1 : 0;
+    // Ops taken by the scheduler but not queued yet, or plan rows still being read, cannot
+    // be told apart from completed ones: every listed op not found counts as unfenced then.
+    if (lane.issued > queued || plan_rows_queued_ > 0) {
+      std::sort(fenced.begin(), fenced.end());
+      fenced.erase(std::unique(fenced.begin(), fenced.end()), fenced.end());
+      unfenced = want.size() - fenced.size();
+    }
+    return unfenced;
+  }
+
+  // EDF submission scheduling. With max_inflight > 0, submitted ops wait in a per-device
+  // queue ordered by deadline (then priority) and are issued only while fewer than
+  // max_inflight ops are on that device's streams, so a late urgent op overtakes queued
+  // bulk prefetch. Ops whose deadline is within urgent_slack_ms of now when issued (or
+  // already past) go on the device's priority stream; negative disables that. 0 issues at
+  // submit, in submission order (the default).
+  void set_scheduler(size_t max_inflight, int64_t urgent_slack_ms) {
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      sched_depth_ = max_inflight;
+      urgent_slack_ms_ = urgent_slack_ms;
+    }
+    py::gil_scoped_release nogil;
+    dispatch_ready();
+  }
+
+  py::dict scheduler_stats() {
+    py::dict d;
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      d["max_inflight"] = py::int_(sched_depth_);
+      d["urgent_slack_ms"] = py::int_(urgent_slack_ms_);
+      d["queued"] = py::int_(held_);
+      d["urgent_ops"] = py::int_(urgent_ops_);
+    }
+    d["deadline_ops"] = py::int_(deadline_ops_.load());
+    d["deadline_misses"] = py::int_(deadline_misses_.load());
+    return d;
+  }
+
+  // Telemetry since construction or reset_stats(). Per device: completed ops, bytes,
+  // bytes/s, deadline misses and failures, and per stream slot (the urgent stream is
+  // "priority") the same counters plus read, queue_wait, dma and e2e (submit -> ready)
+  // latency summaries in ns; execute_plan() bytes and bytes/s per tier; pinned pool
+  // occupancy. Reads the lanes' lock-free counters, so it is cheap enough to poll.
+  py::dict stats() {
+    const int64_t now = steady_now_ns();
+    const double secs = std::max(1e-9, static_cast<double>(now - stats_since_ns_.load()) / 1e9);
+    py::dict devices;
+    for (auto& lp : lanes_) {
+      if (!lp) continue;
+      uint64_t ops = 0, bytes = 0, misses = 0, failures = 0;
+      py::dict streams;
+      for (size_t k = 0; k <= stream_slots_; ++k) {
+        const StreamTelemetry& st = lp->telemetry[k];
+        const uint64_t n = st.ops.load(std::memory_order_relaxed);
+        if (n == 0) continue;
+        py::dict sd = telemetry_dict(st, secs);
+        ops += n;
+        bytes += st.bytes.load(std::memory_order_relaxed);
+        misses += st.deadline_misses.load(std::memory_order_relaxed);
+        failures += st.failures.load(std::memory_order_relaxed);
+        if (k == stream_slots_) {
+          streams["priority"] = sd;
+        } else {
+          streams[py::int_(k)] = sd;
+        }
+      }
+      py::dict dd;
+      dd["ops"] = py::int_(ops);
+      dd["bytes"] = py::int_(bytes);
+      dd["bytes_per_s"] = py::float_(static_cast<double>(bytes) / secs);
+      dd["deadline_misses"] = py::int_(misses);
+      dd["failures"] = py::int_(failures);
+      dd["streams"] = streams;
+      devices[py::int_(lp->device)] = dd;
+    }
+    py::dict tiers;
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      for (auto& kv : tier_bytes_) {
+        py::dict td;
+        td["bytes"] = py::int_(kv.second);
+        td["bytes_per_s"] = py::float_(static_cast<double>(kv.second) / secs);
+        tiers[py::int_(kv.first)] = td;
+      }
+    }
+    size_t in_use = 0, resident = 0;
+    for (auto& pool : pools_) {
+      const PinnedPoolStats st = pool->stats();
+      in_use += st.bytes_in_use;
+      resident += st.bytes_resident;
+    }
+    py::dict pool;
+    pool["bytes_in_use"] = py::int_(in_use);
+    pool["bytes_resident"] = py::int_(resident);
+    pool["occupancy"] = py::float_(resident ? static_cast<double>(in_use) / static_cast<double>(resident) : 0.0);
+    py::dict d;
+    d["uptime_s"] = py::float_(secs);
+    d["devices"] = devices;
+    d["tiers"] = tiers;
+    d["pool"] = pool;
+    d["deadline_ops"] = py::int_(deadline_ops_.load());
+    d["deadline_misses"] = py::int_(deadline_misses_.load());
+    return d;
+  }
+
+  // Zero the stats() counters and histograms and restart its rate clock.
+  void reset_stats() {
+    for (auto& lp : lanes_) {
+      if (!lp) continue;
+      for (size_t k = 0; k <= stream_slots_; ++k) lp->telemetry[k].reset();
+    }
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      tier_bytes_.clear();
+    }
+    stats_since_ns_ = steady_now_ns();
+  }
+
+  // Deliver completions once per worker sweep as a CompletionRecord array instead of one
+  // dict per op. Takes precedence over the per-op submit() callback; None disables it.
+  void set_batch_callback(py::object callback) {
+    std::lock_guard<std::mutex> g(mu_);
+    batch_callback_ = callback;
+    has_batch_callback_ = !callback.is_none();
+  }
+
+  // Move up to max_records (0 = all) buffered completions into a new structured array.
+  py::array_t<CompletionRecord> poll(size_t max_records) {
+    size_t n = ring_.size();
+    if (max_records > 0) n = std::min(n, max_records);
+    py::array_t<CompletionRecord> out(static_cast<py::ssize_t>(n));
+    size_t got = ring_.pop_into(out.mutable_data(), n);
+    if (got < n) out.resize({static_cast<py::ssize_t>(got)});
+    return out;
+  }
+
+  // Zero-allocation variant: fill a caller-owned CompletionRecord array, return the count.
+  size_t poll_into(py::array_t<CompletionRecord, py::array::c_style> out) {
+    return ring_.pop_into(out.mutable_data(), static_cast<size_t>(out.size()));
+  }
+
+  // Block (without the GIL) until every submitted op has completed or timeout_ms elapses
+  // (negative waits forever), then return the buffered completions.
+  py::array_t<CompletionRecord> drain(int64_t timeout_ms) {
+    {
+      py::gil_scoped_release nogil;
+      std::unique_lock<std::mutex> lk(mu_);
+      auto idle = [&]() { return inflight_ == 0 && finishing_ == 0; };
+      if (timeout_ms < 0) {
+        idle_cv_.wait(lk, idle);
+      } else {
+        idle_cv_.wait_for(lk, std::chrono::milliseconds(timeout_ms), idle);
+      }
+    }
+    return poll(0);
+  }
+
+  size_t inflight() {
+    std::lock_guard<std::mutex> g(mu_);
+    return inflight_ + finishing_;
+  }
+
+  std::string completion_mode() const {
+    switch (mode_.load()) {
+      case CompletionMode::kCallback: return "callback";
+      case CompletionMode::kHostSync: return "sync";
+      default: return "poll";
+    }
+  }
+
+ private:
+  void set_op_callback(const py::object& callback) {
+    std::lock_guard<std::mutex> g(mu_);
+    // Update the active callback (single callback used for all ops)
+    active_callback_ = callback;
+    has_op_callback_ = !callback.is_none();
+  }
+
+  // Issue a parsed batch to the backend and hand it to the worker. Does not touch Python
+  // objects, so callers may release the GIL around it.
+  // assign_ids=false keeps op_ids the caller reserved (plan rows).
+  uint64_t enqueue(std::vector<PendingOp>& batch, bool assign_ids = true) {
+    const uint64_t first_op_id = assign_ids ? next_op_id_.fetch_add(batch.size()) : batch.empty() ? 0 : batch[0].op_id;
+    if (assign_ids) {
+      for (size_t i = 0; i < batch.size(); ++i) batch[i].op_id = first_op_id + i;
+    }
+
+    for (auto& po : batch) {
+      if (!owns_device(po.device)) {
+        const int bad = po.device;
+        discard_batch(batch);
+        throw std::invalid_argument(device_error(bad));
+      }
+    }
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      if (sched_depth_ > 0) {
+        const int64_t now_ns = steady_now_ns();
+        for (auto& po : batch) {
+          po.t_submit_ns = now_ns;
+          Lane& lane = *lanes_[po.device];
+          lane.heap.push_back(std::move(po));
+          std::push_heap(lane.heap.begin(), lane.heap.end(), edf_later);
+          ++lane.inflight;
+          ensure_worker_locked(lane);
+        }
+        held_ += batch.size();
+        inflight_ += batch.size();
+        batch.clear();
+      }
+    }
+    if (batch.empty()) {
+      dispatch_ready();
+      return first_op_id;
+    }
+    issue_batch(batch);
+    hand_off(batch);
+    return first_op_id;
+  }
+
+  void issue_batch(std::vector<PendingOp>& batch) {
+    if (Backend::kBatchEvents) {
+      enqueue_shared_events(batch);
+      return;
+    }
+    // Submit copies
+    for (auto& po : batch) {
+      if (!po.t_submit_ns) po.t_submit_ns = steady_now_ns();
+      auto stream = stream_of(po);
+      issue_copy(po, stream);
+      record_completion(stream, po);
+    }
+  }
+
+  // Pop scheduled ops while their device has room under sched_depth_ (all of them once
+  // scheduling is off), marking the ones close to their deadline urgent.
+  // Only `only`'s device when given.
+  void take_ready_locked(std::vector<PendingOp>& out, Lane* only = nullptr) {
+    if (held_ == 0) return;
+    const int64_t now_ms = wall_now_ms();
+    for (auto& lp : lanes_) {
+      if (!lp || (only && lp.get() != only)) continue;
+      Lane& rq = *lp;
+      while (!rq.heap.empty() && (sched_depth_ == 0 || rq.issued < sched_depth_)) {
+        std::pop_heap(rq.heap.begin(), rq.heap.end(), edf_later);
+        PendingOp po = std::move(rq.heap.back());
+        rq.heap.pop_back();
+        po.urgent = urgent_slack_ms_ >= 0 && po.deadline_ms > 0 && po.deadline_ms - now_ms <= urgent_slack_ms_;
+        if (po.urgent) ++urgent_ops_;
+        ++rq.issued;  // counted now so concurrent dispatchers respect the depth
+        --held_;
+        out.push_back(std::move(po));
+      }
+    }
+  }
+
+  // Issue whatever the scheduler may release now. Called without mu_ held.
+  void dispatch_ready() {
+    std::vector<PendingOp> ready;
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      take_ready_locked(ready);
+    }
+    if (ready.empty()) return;
+    issue_batch(ready);
+    queue_issued(ready, /*counted=*/true);
+  }
+
+  typename Backend::stream_t stream_of(const PendingOp& po) {
+    return po.urgent ? backend_.get_priority_stream(po.device) : backend_.get_stream(po.device, po.stream_id);
+  }
+
+  size_t slot_of(const PendingOp& po) const { return po.urgent ? stream_slots_ : stream_slot(po.stream_id); }
+
+  bool owns_device(int device) const {
+    return device >= 0 && static_cast<size_t>(device) < lanes_.size() && lanes_[device] != nullptr;
+  }
+
+  static std::string device_error(int device) {
+    return "gpu_id " + std::to_string(device) + " is not driven by this engine";
+  }
+
+  // An H2D source inside a pool buffer: the op holds it until it finishes.
+  bool retain_host(void* p) {
+    for (auto& pool : pools_) {
+      if (pool->retain(p)) return true;
+    }
+    return false;
+  }
+
+  // Called once every row of a caller batch has been validated, so a bad row never leaves
+  // earlier rows holding their buffers; enqueue() releases them if it rejects the batch.
+  void retain_sources(std::vector<PendingOp>& batch) {
+    for (auto& po : batch) po.owns_host_buffer = po.direction == kH2D && retain_host(po.src);
+  }
+
+  void release_host(void* p) {
+    if (!p) return;
+    for (auto& pool : pools_) {
+      if (pool->release(p)) return;
+    }
+  }
+
+  void record_completion(typename Backend::stream_t stream, PendingOp& po) {
+    backend_.record_event(stream, &po.event);
+    if (mode_ == CompletionMode::kCallback && !backend_.launch_host_callback(stream, &lanes_[po.device]->host_cb)) {
+      mode_ = CompletionMode::kHostSync;
+    }
+  }
+
+  // Issue every copy first, then one event per stream after its last op in the batch.
+  // Streams retire in order, so earlier ops on that stream complete no later than the
+  // event and can share it. Streams are per device: ops of another device on the same
+  // slot need their own event, retired by their own lane.
+  void enqueue_shared_events(std::vector<PendingOp>& batch) {
+    std::map<std::pair<int, size_t>, size_t> last;  // (device, stream slot) -> index of its last op
+    for (size_t i = 0; i < batch.size(); ++i) {
+      PendingOp& po = batch[i];
+      if (!po.t_submit_ns) po.t_submit_ns = steady_now_ns();
+      issue_copy(po, stream_of(po));
+      last[{po.device, slot_of(po)}] = i;
+    }
+    for (auto& kv : last) {
+      PendingOp& owner = batch[kv.second];
+      record_completion(stream_of(owner), owner);
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+      const size_t owner = last[{batch[i].device, slot_of(batch[i])}];
+      if (owner == i) continue;
+      batch[i].event = batch[owner].event;
+      batch[i].owns_event = false;
+    }
+  }
+
+  static void check_codec(const PendingOp& po) {
+    if (!Backend::kHasDecode) throw std::invalid_argument("this backend cannot decode encoded pages");
+    if (!codec_valid(po.codec)) throw std::invalid_argument("unknown codec " + std::to_string(po.codec));
+    if (po.direction != kH2D) throw std::invalid_argument("encoded ops must be H2D");
+    if (po.decoded_bytes == 0 || codec_encoded_bytes(po.codec, po.decoded_bytes) != po.bytes) {
+      throw std::invalid_argument("bytes must be the encoded size of decoded_bytes (whole 128-element groups)");
+    }
+  }
+
+  void issue_copy(PendingOp& po, typename Backend::stream_t stream) {
+    po.t_issue_ns = steady_now_ns();
+    // Failed before issue (plan row read error): only its event is recorded
+    if (po.status < 0) return;
+    if (po.codec != kCodecNone) {
+      if constexpr (Backend::kHasDecode) issue_decode(po, stream);
+      return;
+    }
+    if (!po.segments.empty()) {
+      issue_scatter(po, stream);
+      return;
+    }
+    switch (po.direction) {
+      case kD2H: backend_.memcpy_d2h_async(po.device, po.dst, po.src, po.bytes, stream); break;
+      case kD2D: backend_.memcpy_d2d_async(po.device, po.dst, po.dst_device_id, po.src, po.bytes, stream); break;
+      default: backend_.memcpy_h2d_async(po.device, po.dst, po.src, po.bytes, stream); break;
+    }
+  }
+
+  // All segments go on the op's stream, so the single event recorded after them covers
+  // the whole scatter.
+  void issue_scatter(PendingOp& po, typename Backend::stream_t stream) {
+    char* base = static_cast<char*>(po.src);
+    if constexpr (Backend::kHasBatchCopy) {
+      const size_t k = po.segments.size();
+      std::vector<void*> dsts(k), srcs(k);
+      std::vector<size_t> sizes(k);
+      for (size_t j = 0; j < k; ++j) {
+        dsts[j] = po.segments[j].dst;
+        srcs[j] = base + po.segments[j].src_offset;
+        sizes[j] = po.segments[j].bytes;
+      }
+      backend_.memcpy_h2d_batch_async(po.device, dsts.data(), srcs.data(), sizes.data(), k, stream);
+    } else {
+      for (const auto& seg : po.segments) {
+        backend_.memcpy_h2d_async(po.device, seg.dst, base + seg.src_offset, seg.bytes, stream);
+      }
+    }
+    ++scatter_ops_;
+    scatter_segments_ += po.segments.size();
+  }
+
+  // Encoded H2D: copy into the stream's scratch buffer, then decode into dst. Both are
+  // stream ordered, so the next encoded op on the stream reuses the scratch only after
+  // this decode has read it; decode_mu_ keeps concurrent issuers from interleaving
+  // their copy/decode pairs on one stream. A scratch buffer that has to grow is retired,
+  // not freed, as earlier decodes may still read it.
+  void issue_decode(PendingOp& po, typename Backend::stream_t stream) {
+    std::lock_guard<std::mutex> g(decode_mu_);
+    Scratch& sc = scratch_[std::make_pair(po.device, reinterpret_cast<uintptr_t>(stream))];
+    if (sc.bytes < po.bytes) {
+      if (sc.ptr) retired_scratch_.emplace_back(po.device, sc.ptr);
+      const size_t want = std::max(po.bytes, sc.bytes * 2);
+      sc.ptr = backend_.alloc_device(po.device, want);
+      sc.bytes = sc.ptr ? want : 0;
+    }
+    bool ok = sc.ptr != nullptr;
+    if (ok) {
+      backend_.memcpy_h2d_async(po.device, sc.ptr, po.src, po.bytes, stream);
+      ok = backend_.launch_decode(po.device, stream, po.codec, sc.ptr, po.dst, po.decoded_bytes);
+    }
+    if (!ok) {
+      // Completes with the error in its record; dst is left untouched
+      po.status = -ENOMEM;
+      ++decode_failures_;
+      return;
+    }
+    ++decode_ops_;
+    encoded_bytes_ += po.bytes;
+    decoded_bytes_ += po.decoded_bytes;
+  }
+
+  void free_scratch() {
+    if constexpr (Backend::kHasDecode) {
+      for (auto& kv : scratch_) {
+        if (kv.second.ptr) backend_.free_device(kv.first.first, kv.second.ptr);
+      }
+      for (auto& r : retired_scratch_) backend_.free_device(r.first, r.second);
+    }
+    scratch_.clear();
+    retired_scratch_.clear();
+  }
+
+  // Tear down ops that will never reach the worker: wait for any copy still reading their
+  // staging buffer, then drop events and buffers.
+  void discard_batch(std::vector<PendingOp>& batch) {
+    for (auto& po : batch) {
+      if (po.event && po.owns_event) {
+        while (!backend_.wait_event(po.event, kHostSyncTimeoutNs)) std::this_thread::yield();
+        backend_.destroy_event(po.event);
+      }
+      po.event = nullptr;
+      if (po.owns_host_buffer) release_host(po.host_buffer());
+    }
+  }
+
+  // pread the whole range (buffered); bytes read or -errno.
+  static int64_t pread_full(const std::string& path, uint64_t offset, size_t size, void* dst) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return -errno;
+    size_t done = 0;
+    while (done < size) {
+      ssize_t r = ::pread(fd, static_cast<char*>(dst) + done, size - done, static_cast<off_t>(offset + done));
+      if (r < 0 && errno == EINTR) continue;
+      if (r < 0) {
+        int err = errno;
+        ::close(fd);
+        return -err;
+      }
+      if (r == 0) break;
+      done += static_cast<size_t>(r);
+    }
+    ::close(fd);
+    return static_cast<int64_t>(done);
+  }
+
+  // Queue ops whose copies and completion events have been issued for the worker.
+  void hand_off(std::vector<PendingOp>& batch) { queue_issued(batch, /*counted=*/false); }
+
+  // Queue issued ops on their device lanes (starting lane workers as needed). `counted` ops
+  // were already added to the in-flight and issued counts when the scheduler took them.
+  void queue_issued(std::vector<PendingOp>& batch, bool counted) {
+    std::vector<Lane*> touched;
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      for (auto& po : batch) {
+        Lane& lane = *lanes_[po.device];
+        if (!counted) {
+          ++inflight_;
+          ++lane.inflight;
+          ++lane.issued;
+        }
+        lane.queues[slot_of(po)].push_back(std::move(po));
+        if (std::find(touched.begin(), touched.end(), &lane) == touched.end()) touched.push_back(&lane);
+      }
+      for (Lane* lane : touched) {
+        ensure_worker_locked(*lane);
+        // A host callback may have fired before the ops were queued; count the push as progress.
+        ++lane->signals;
+      }
+    }
+    for (Lane* lane : touched) lane->cv.notify_one();
+  }
+
+#ifdef BODOCACHE_WITH_URING
+  // One ring serves submit_stream(), plan rows and writeback; its depth and O_DIRECT mode
+  // come from the constructor so whichever path runs first does not decide them.
+  IoUringReader& stream_reader() {
+    std::lock_guard<std::mutex> g(mu_);
+    if (!reader_) {
+      reader_.reset(new IoUringReader(static_cast<unsigned>(io_depth_), size_t(1) << 20, 256, io_direct_, 4096));
+    }
+    return *reader_;
+  }
+#endif
+
+  static void on_stream_progress(void* arg) {
+    auto* lane = static_cast<Lane*>(arg);
+    {
+      std::lock_guard<std::mutex> g(lane->engine->mu_);
+      ++lane->signals;
+    }
+    lane->cv.notify_one();
+  }
+
+  size_t stream_slot(int stream_id) const {
+    // Mirrors Backend::get_stream so ops on one stream share a FIFO.
+    if (stream_id < 0) stream_id = 0;
+    return static_cast<size_t>(stream_id) % stream_slots_;
+  }
+
+  void ensure_worker_locked(Lane& lane) {
+    if (!lane.running) {
+      lane.running = true;
+      lane.worker = std::thread([this, &lane]() { this->worker_loop(lane); });
+    }
+  }
+
+  // Workers drain in-flight ops and may need the GIL to deliver their callbacks.
+  static void join_without_gil(std::thread& t) {
+    if (!t.joinable()) return;
+    if (PyGILState_Check()) {
+      py::gil_scoped_release nogil;
+      t.join();
+    } else {
+      t.join();
+    }
+  }
+
+  void stop_worker() {
+    // The plan thread issues every queued row before it exits; lane workers retire them.
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      plan_stop_ = true;
+    }
+    plan_cv_.notify_all();
+    join_without_gil(plan_thread_);
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      stop_requested_ = true;
+    }
+    for (auto& lane : lanes_) {
+      if (lane) lane->cv.notify_one();
+    }
+    for (auto& lane : lanes_) {
+      if (lane) join_without_gil(lane->worker);
+    }
+    // The workers have handed over every writeback by now; let that stage drain and exit.
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      wb_stop_ = true;
+    }
+    wb_cv_.notify_one();
+    join_without_gil(wb_thread_);
+  }
+
+  // Pop completed ops from the head of each stream FIFO. Copies on a stream retire
+  // in order, so the scan stops at the first unfinished op per stream.
+  void collect_completed_locked(Lane& lane, std::vector<PendingOp>& done) {
+    for (auto& q : lane.queues) {
+      while (!q.empty() && backend_.event_completed(q.front().event)) {
+        done.push_back(std::move(q.front()));
+        q.pop_front();
+        --lane.issued;
+        --lane.inflight;
+        --inflight_;
+      }
+    }
+  }
+
+  static void* oldest_event_locked(const Lane& lane) {
+    for (auto& q : lane.queues) {
+      if (!q.empty()) return q.front().event;
+    }
+    return nullptr;
+  }
+
+  void wait_for_progress(std::unique_lock<std::mutex>& lk, Lane& lane) {
+    switch (mode_.load()) {
+      case CompletionMode::kCallback: {
+        const uint64_t seen = lane.signals;
+        // Timeout is only a safety net in case a host callback could not be enqueued.
+        lane.cv.wait_for(lk, std::chrono::milliseconds(10), [&]() { return lane.signals != seen; });
+        break;
+      }
+      case CompletionMode::kHostSync: {
+        void* ev = oldest_event_locked(lane);
+        const uint64_t seen = lane.signals;
+        lk.unlock();
+        // Events are only destroyed by this lane's worker, so the handle stays valid unlocked.
+        bool ready = ev != nullptr && backend_.wait_event(ev, kHostSyncTimeoutNs);
+        lk.lock();
+        if (!ready && lane.signals == seen) {
+          lane.cv.wait_for(lk, std::chrono::microseconds(50), [&]() { return lane.signals != seen; });
+        }
+        break;
+      }
+      case CompletionMode::kPoll:
+        lane.cv.wait_for(lk, std::chrono::milliseconds(1));
+        break;
+    }
+  }
+
+  // One per device: retires that device's ops so a slow GPU never holds up another's
+  // completions.
+  void worker_loop(Lane& lane) {
+    std::unique_lock<std::mutex> lk(mu_);
+    std::vector<CompletionRecord> records;  // this worker's finish_ops scratch
+    while (true) {
+      if (lane.inflight == 0) {
+        if (stop_requested_) break;
+        // Nothing in flight: sleep until submit() or shutdown.
+        lane.cv.wait(lk, [&]() { return lane.inflight > 0 || stop_requested_; });
+        continue;
+      }
+      std::vector<PendingOp> done;
+      collect_completed_locked(lane, done);
+      if (done.empty()) {
+        wait_for_progress(lk, lane);
+        continue;
+      }
+      finishing_ += done.size();
+      if (held_ > 0) {
+        // Completions freed stream slots: release the next scheduled ops before finishing.
+        std::vector<PendingOp> ready;
+        take_ready_locked(ready, &lane);
+        lk.unlock();
+        issue_batch(ready);
+        queue_issued(ready, /*counted=*/true);
+        lk.lock();
+      }
+      // Finished D2H copies with a storage target continue to the writeback stage.
+      auto wb = std::stable_partition(done.begin(), done.end(),
+                                      [](const PendingOp& po) { return po.wb_path.empty(); });
+      if (wb != done.end()) {
+        for (auto it = wb; it != done.end(); ++it) wb_queue_.push_back(std::move(*it));
+        done.erase(wb, done.end());
+        ensure_writeback_locked();
+        wb_cv_.notify_one();
+        if (done.empty()) continue;
+      }
+      const bool batch_cb = has_batch_callback_;
+      const bool op_cb = has_op_callback_;
+      lk.unlock();
+      finish_ops(done, batch_cb, op_cb, records);
+      lk.lock();
+      finishing_ -= done.size();
+      if (inflight_ == 0 && finishing_ == 0) idle_cv_.notify_all();
+    }
+  }
+
+  // Drains plan_jobs_ in submission order.
+  void plan_loop() {
+    std::unique_lock<std::mutex> lk(mu_);
+    while (true) {
+      plan_cv_.wait(lk, [&]() { return !plan_jobs_.empty() || plan_stop_; });
+      if (plan_jobs_.empty()) break;
+      std::unique_ptr<PlanJob> job = std::move(plan_jobs_.front());
+      plan_jobs_.pop_front();
+      lk.unlock();
+      run_plan(*job);
+      lk.lock();
+    }
+  }
+
+  bool plan_fits_locked(const PlanJob& job, size_t i) const {
+    const auto& r = job.rows[i];
+    auto cap = job.caps.find(r.tier);
+    if (cap == job.caps.end() || cap->second == 0) return true;
+    auto used = plan_inflight_.find(r.tier);
+    const size_t inflight = used == plan_inflight_.end() ? 0 : used->second;
+    return inflight == 0 || inflight + r.bytes <= cap->second;
+  }
+
+  // Admit rows in waves as tier credit allows; each wave's reads go to the ring together and
+  // a row is issued as soon as its own read completes, so reads of later rows overlap the
+  // copies of earlier ones.
+  void run_plan(PlanJob& job) {
+    static constexpr size_t kPlanWave = 64;
+    const size_t n = job.rows.size();
+    size_t next = 0;
+    while (next < n) {
+      std::vector<size_t> wave;
+      {
+        std::unique_lock<std::mutex> lk(mu_);
+        if (!plan_fits_locked(job, next)) {
+          ++plan_credit_waits_;
+          plan_cv_.wait(lk, [&]() { return plan_fits_locked(job, next); });
+        }
+        while (next < n && wave.size() < kPlanWave && plan_fits_locked(job, next)) {
+          plan_inflight_[job.rows[next].tier] += job.rows[next].bytes;
+          wave.push_back(next++);
+        }
+      }
+      for (size_t i : wave) {
+        PlanJob::Row& r = job.rows[i];
+        r.buffer = r.bytes ? lanes_[r.device]->pool->acquire(r.bytes) : nullptr;
+        r.result = r.bytes && !r.buffer ? -ENOMEM : 0;
+        r.t_read_ns = steady_now_ns();
+      }
+      read_wave(job, wave);
+    }
+  }
+
+  void read_wave(PlanJob& job, const std::vector<size_t>& wave) {
+    std::vector<size_t> todo;
+    for (size_t i : wave) {
+      if (job.rows[i].bytes && job.rows[i].buffer) {
+        todo.push_back(i);
+      } else {
+        issue_plan_row(job, i);
+      }
+    }
+#ifdef BODOCACHE_WITH_URING
+    std::vector<std::string> paths;
+    std::vector<uint64_t> offsets, sizes;
+    std::vector<char*> dsts;
+    for (size_t i : todo) {
+      const PlanJob::Row& r = job.rows[i];
+      paths.push_back(job.files[r.file]);
+      offsets.push_back(r.offset);
+      sizes.push_back(r.bytes);
+      dsts.push_back(static_cast<char*>(r.buffer));
+    }
+    std::vector<bool> issued(todo.size(), false);
+    try {
+      stream_reader().read_ranges(paths, offsets.data(), sizes.data(), dsts, [&](size_t k, int64_t result) {
+        job.rows[todo[k]].result = result;
+        issued[k] = true;
+        issue_plan_row(job, todo[k]);
+      });
+    } catch (const std::exception&) {
+      // Ring failure: finish the rest of the wave with plain reads
+      for (size_t k = 0; k < todo.size(); ++k) {
+        if (issued[k]) continue;
+        PlanJob::Row& r = job.rows[todo[k]];
+        r.result = pread_full(job.files[r.file], r.offset, r.bytes, r.buffer);
+        issue_plan_row(job, todo[k]);
+      }
+    }
+#else
+    for (size_t i : todo) {
+      PlanJob::Row& r = job.rows[i];
+      r.result = pread_full(job.files[r.file], r.offset, r.bytes, r.buffer);
+      issue_plan_row(job, i);
+    }
+#endif
+  }
+
+  // Split a read row (or one that failed) into its stream pieces and enqueue them.
+  void issue_plan_row(PlanJob& job, size_t i) {
+    PlanJob::Row& r = job.rows[i];
+    auto row = std::make_shared<PlanRow>();
+    row->buffer = r.buffer;
+    row->bytes = r.bytes;
+    row->tier = r.tier;
+    row->stream_id = r.stream_id;
+    // Submit -> ready covers the plan thread's queueing and the read
+    row->t_submit_ns = job.t_submit_ns;
+    row->read_ns = r.bytes && r.buffer ? steady_now_ns() - r.t_read_ns : 0;
+    const bool ok = r.bytes == 0 || r.result == static_cast<int64_t>(r.bytes);
+    if (!ok) row->status = static_cast<int32_t>(r.result < 0 ? r.result : -EIO);
+    // Pieces stay page aligned so O_DIRECT-sized rows split cleanly
+    const size_t fan = ok ? static_cast<size_t>(r.overlap) : 1;
+    const size_t piece = std::max<size_t>(((r.bytes + fan - 1) / fan + 4095) & ~size_t(4095), 1);
+    std::vector<PendingOp> pieces;
+    for (size_t off = 0, j = 0; j == 0 || off < r.bytes; off += piece, ++j) {
+      PendingOp po;
+      po.op_id = job.first_op_id + i;
+      po.tag = r.tag;
+      po.device = r.device;
+      po.dst_device_id = r.device;
+      po.src = static_cast<char*>(r.buffer) + off;
+      po.dst = r.dst + off;
+      po.bytes = ok ? std::min(piece, r.bytes - off) : r.bytes;
+      po.stream_id = r.stream_id + static_cast<int>(j);
+      po.deadline_ms = r.deadline_ms;
+      po.priority = r.priority;
+      po.status = row->status;
+      po.plan_row = row;
+      pieces.push_back(std::move(po));
+      if (!ok) break;
+    }
+    const size_t n_pieces = pieces.size();
+    row->pieces_left = n_pieces;
+    enqueue(pieces, /*assign_ids=*/false);
+    std::lock_guard<std::mutex> g(mu_);
+    ++plan_rows_;
+    plan_pieces_ += n_pieces;
+    plan_bytes_ += r.bytes;
+    if (!ok) ++plan_read_failures_;
+    --plan_rows_queued_;
+    --finishing_;
+    if (inflight_ == 0 && finishing_ == 0) idle_cv_.notify_all();
+  }
+
+  void ensure_writeback_locked() {
+    if (!wb_running_) {
+      wb_running_ = true;
+      wb_thread_ = std::thread([this]() { this->writeback_loop(); });
+    }
+  }
+
+  // Drains wb_queue_: writes each staged buffer to its file, then completes the ops. Ops in
+  // the queue are counted in finishing_, so drain() waits for them.
+  void writeback_loop() {
+    std::unique_lock<std::mutex> lk(mu_);
+    std::vector<CompletionRecord> records;  // this thread's finish_ops scratch
+    while (true) {
+      wb_cv_.wait(lk, [&]() { return !wb_queue_.empty() || wb_stop_; });
+      if (wb_queue_.empty()) break;
+      std::vector<PendingOp> batch(std::make_move_iterator(wb_queue_.begin()),
+                                   std::make_move_iterator(wb_queue_.end()));
+      wb_queue_.clear();
+      const bool batch_cb = has_batch_callback_;
+      const bool op_cb = has_op_callback_;
+      lk.unlock();
+      write_out(batch);
+      finish_ops(batch, batch_cb, op_cb, records);
+      lk.lock();
+      finishing_ -= batch.size();
+      if (inflight_ == 0 && finishing_ == 0) idle_cv_.notify_all();
+    }
+  }
+
+  void write_out(std::vector<PendingOp>& batch) {
+#ifdef BODOCACHE_WITH_URING
+    std::vector<std::string> paths;
+    std::vector<uint64_t> offsets, sizes;
+    std::vector<const char*> srcs;
+    for (auto& po : batch) {
+      paths.push_back(po.wb_path);
+      offsets.push_back(po.wb_offset);
+      sizes.push_back(po.bytes);
+      srcs.push_back(static_cast<const char*>(po.dst));
+    }
+    std::vector<int64_t> res;
+    try {
+      res = stream_reader().write_ranges(paths, offsets.data(), sizes.data(), srcs);
+    } catch (const std::exception&) {
+      res.assign(batch.size(), -EIO);
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+      const int64_t r = res[i];
+      batch[i].status = r == static_cast<int64_t>(batch[i].bytes) ? 0 : static_cast<int32_t>(r < 0 ? r : -EIO);
+    }
+#else
+    for (auto& po : batch) {
+      const int64_t r = pwrite_full(po.wb_path, po.wb_offset, po.bytes, po.dst);
+      po.status = r == static_cast<int64_t>(po.bytes) ? 0 : static_cast<int32_t>(r < 0 ? r : -EIO);
+    }
+#endif
+  }
+
+  // pwrite the whole range, creating the file if needed; bytes written or -errno.
+  static int64_t pwrite_full(const std::string& path, uint64_t offset, size_t size, const void* src) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) return -errno;
+    size_t done = 0;
+    while (done < size) {
+      ssize_t w = ::pwrite(fd, static_cast<const char*>(src) + done, size - done, static_cast<off_t>(offset + done));
+      if (w < 0 && errno == EINTR) continue;
+      if (w <= 0) {
+        int err = w < 0 ? errno : EIO;
+        ::close(fd);
+        return -err;
+      }
+      done += static_cast<size_t>(w);
+    }
+    ::close(fd);
+    return static_cast<int64_t>(done);
+  }
+
+  // Fire callbacks and recycle host buffers (if we own them)
+  // Record a completed op in its stream's telemetry.
+  void observe(const PendingOp& po, int64_t t_done, bool missed) {
+    StreamTelemetry& st = lanes_[po.device]->telemetry[slot_of(po)];
+    const int64_t issued = po.t_issue_ns ? po.t_issue_ns : po.t_submit_ns;
+    st.ops.fetch_add(1, std::memory_order_relaxed);
+    st.bytes.fetch_add(po.bytes, std::memory_order_relaxed);
+    if (missed) st.deadline_misses.fetch_add(1, std::memory_order_relaxed);
+    if (po.status) st.failures.fetch_add(1, std::memory_order_relaxed);
+    if (po.read_ns > 0) st.read.record(po.read_ns);
+    st.queue_wait.record(issued - po.t_submit_ns - po.read_ns);
+    st.dma.record(t_done - issued);
+    st.e2e.record(t_done - po.t_submit_ns);
+  }
+
+  void finish_ops(std::vector<PendingOp>& done, bool batch_cb, bool op_cb, std::vector<CompletionRecord>& records) {
+    const int64_t t_done = steady_now_ns();
+    const int64_t done_ms = wall_now_ms();
+    records.clear();
+    std::vector<std::pair<int32_t, size_t>> credit;  // plan bytes no longer in flight, by tier
+    std::vector<std::pair<int32_t, size_t>> tier_done;  // completed plan rows' bytes, by tier
+    for (auto& po : done) {
+      if (po.event && po.owns_event) backend_.destroy_event(po.event);
+      if (po.plan_row) {
+        PlanRow& row = *po.plan_row;
+        credit.emplace_back(row.tier, po.bytes);
+        if (po.status) row.status = po.status;
+        if (--row.pieces_left > 0) continue;
+        tier_done.emplace_back(row.tier, row.bytes);
+        release_host(row.buffer);
+        po.bytes = row.bytes;
+        po.status = row.status;
+        po.stream_id = row.stream_id;
+        po.t_submit_ns = row.t_submit_ns;
+        po.read_ns = row.read_ns;
+      } else {
+        // Buffers handed to the engine go back to the pinned pool; the caller keeps the rest
+        if (po.owns_host_buffer) release_host(po.host_buffer());
+      }
+      const bool missed = po.deadline_ms > 0 && done_ms > po.deadline_ms;
+      if (po.deadline_ms > 0) {
+        ++deadline_ops_;
+        if (missed) ++deadline_misses_;
+      }
+      observe(po, t_done, missed);
+      records.push_back(CompletionRecord{po.op_id, po.device, po.stream_id, static_cast<uint64_t>(po.bytes),
+                                          po.deadline_ms, po.t_submit_ns, t_done, po.tag, po.direction, po.status});
+    }
+
+    if (!credit.empty()) {
+      {
+        std::lock_guard<std::mutex> g(mu_);
+        for (auto& c : credit) plan_inflight_[c.first] -= c.second;
+        for (auto& t : tier_done) tier_bytes_[t.first] += t.second;
+      }
+      plan_cv_.notify_all();
+    }
+
+    // Nobody is listening: buffer for poll()/drain() without touching the GIL.
+    if (!batch_cb && !op_cb) {
+      ring_.push(records.data(), records.size());
+      return;
+    }
+
+    py::gil_scoped_acquire ag;
+    if (batch_cb) {
+      py::object cb;
+      {
+        std::lock_guard<std::mutex> g(mu_);
+        cb = batch_callback_;
+      }
+      if (cb.is_none()) {
+        // Cleared since the worker looked: keep the records for poll()/drain()
+        py::gil_scoped_release nogil;
+        ring_.push(records.data(), records.size());
+        return;
+      }
+      py::array_t<CompletionRecord> arr(static_cast<py::ssize_t>(records.size()));
+      std::copy(records.begin(), records.end(), arr.mutable_data());
+      try {
+        cb(arr);
+      } catch (...) {
+        // Swallow exceptions to keep worker alive
+      }
+      return;
+    }
+
+    py::object cb;
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      cb = active_callback_;
+    }
+    if (cb.is_none()) {
+      py::gil_scoped_release nogil;
+      ring_.push(records.data(), records.size());
+      return;
+    }
+    for (auto& rec : records) {
+      try {
+        py::dict info;
+        info["op_id"] = py::int_(rec.op_id);
+        info["gpu_id"] = rec.gpu_id;
+        info["bytes"] = py::int_(rec.bytes);
+        info["deadline_ms"] = py::int_(rec.deadline_ms);
+        info["tag"] = py::int_(rec.tag);
+        info["direction"] = rec.direction;
+        info["status"] = rec.status;
+        cb(info);
+      } catch (...) {
+        // Swallow exceptions to keep worker alive
+      }
+    }
+  }
+
+  static constexpr uint64_t kHostSyncTimeoutNs = 200 * 1000;  // 200us
+
+  // Device staging for encoded H2D ops, one per (device, stream)
+  struct Scratch {
+    void* ptr{nullptr};
+    size_t bytes{0};
+  };
+
+  // Per-device completion lane. State is guarded by mu_; the worker waits on the lane's
+  // own events and condition variable.
+  struct Lane {
+    CopyEngineNative* engine{nullptr};
+    int device{0};
+    PinnedSlabPool<Backend>* pool{nullptr};             // on the device's NUMA node
+    std::vector<std::deque<PendingOp>> queues;          // [stream slot] -> in-order pending ops
+    std::vector<PendingOp> heap;                        // held by the scheduler, edf_later order
+    size_t issued{0};                                   // on the device's streams, not completed
+    size_t inflight{0};                                 // issued + held
+    uint64_t signals{0};
+    std::condition_variable cv;
+    std::thread worker{};
+    bool running{false};
+    HostCallback host_cb{};
+    std::unique_ptr<StreamTelemetry[]> telemetry;       // [stream slot], lock-free
+  };
+
   Backend backend_{};
-  int device_{0};
+  int device_{0};  // default for ops without a gpu_id
+  std::vector<int> devices_;
   int streams_per_dev_{4};
-  std::atomic<bool> running_{false};
-  std::thread worker_{};
+  size_t stream_slots_{4};
+  std::atomic<CompletionMode> mode_{CompletionMode::kCallback};
   std::mutex mu_;
-  std::vector<void*> live_buffers_;
-  std::vector<PendingOp> pending_;
+  std::condition_variable idle_cv_;
+  std::vector<std::unique_ptr<PinnedSlabPool<Backend>>> pools_;  // one per NUMA node
+  std::vector<std::unique_ptr<Lane>> lanes_;                     // [device id], null if not driven
+  CompletionRing ring_;
+  std::deque<PendingOp> wb_queue_;              // D2H done, waiting to be written to storage
+  std::condition_variable wb_cv_;
+  std::thread wb_thread_{};
+  bool wb_running_{false};
+  bool wb_stop_{false};
+  size_t inflight_{0};
+  size_t finishing_{0};
+  std::atomic<uint64_t> next_op_id_{0};
+  bool stop_requested_{false};
+  bool has_op_callback_{false};
+  bool has_batch_callback_{false};
   py::object active_callback_ = py::none();
+  py::object batch_callback_ = py::none();
+  // EDF scheduler (set_scheduler); ops are issued at submit while sched_depth_ == 0
+  size_t sched_depth_{0};
+  int64_t urgent_slack_ms_{-1};
+  size_t held_{0};
+  uint64_t urgent_ops_{0};
+  std::atomic<uint64_t> deadline_ops_{0};
+  std::atomic<uint64_t> deadline_misses_{0};
+  std::atomic<uint64_t> direct_ops_{0};
+  std::atomic<uint64_t> direct_fallbacks_{0};
+  std::atomic<uint64_t> peer_ops_{0};
+  std::atomic<uint64_t> peer_bytes_{0};
+#ifdef BODOCACHE_WITH_URING
+  std::unique_ptr<IoUringReader> reader_;  // lazily created by stream_reader()
+#endif
+  size_t io_depth_{32};    // io_uring queue depth for reader_
+  bool io_direct_{false};  // open reader_ files with O_DIRECT
+  std::unordered_map<uint64_t, size_t> host_ranges_;  // register_host(): address -> bytes
+  std::mutex decode_mu_;
+  std::map<std::pair<int, uintptr_t>, Scratch> scratch_;
+  std::vector<std::pair<int, void*>> retired_scratch_;
+  std::atomic<uint64_t> decode_ops_{0};
+  std::atomic<uint64_t> decode_failures_{0};
+  std::atomic<uint64_t> encoded_bytes_{0};
+  std::atomic<uint64_t> decoded_bytes_{0};
+  std::atomic<uint64_t> scatter_ops_{0};
+  std::atomic<uint64_t> scatter_segments_{0};
+  // Plan executor (execute_plan); guarded by mu_
+  std::deque<std::unique_ptr<PlanJob>> plan_jobs_;
+  std::condition_variable plan_cv_;
+  std::thread plan_thread_{};
+  bool plan_running_{false};
+  bool plan_stop_{false};
+  std::unordered_map<int32_t, size_t> plan_inflight_;  // tier -> bytes read or in flight
+  size_t plan_rows_queued_{0};
+  uint64_t plan_rows_{0};
+  uint64_t plan_pieces_{0};
+  uint64_t plan_bytes_{0};
+  uint64_t plan_read_failures_{0};
+  uint64_t plan_credit_waits_{0};
+  // Telemetry (stats()); tier totals are guarded by mu_, everything else is in the lanes
+  std::unordered_map<int32_t, uint64_t> tier_bytes_;
+  std::atomic<int64_t> stats_since_ns_{steady_now_ns()};
 };
@@ -4,9 +4,40 @@
 
 #include <cuda_runtime.h>
 
+#include <cstring>
+
+// cudaMemcpyBatchAsync: 12.8 added it, 13.0 changed its signature
+#if CUDART_VERSION >= 12080 && CUDART_VERSION < 13000
+#define BODOCACHE_CUDA_BATCH_COPY 1
+#else
+#define BODOCACHE_CUDA_BATCH_COPY 0
+#endif
+
+#ifdef BODOCACHE_WITH_GDS
+#include <cufile.h>
+#endif
+#ifdef BODOCACHE_WITH_NCCL
+#include <nccl.h>
+#endif
+
 struct CudaBackend {
   using stream_t = cudaStream_t;
+  static constexpr bool kHasHostCallback = true;
+  // Events are cheap; keep per-op completion granularity.
+  static constexpr bool kBatchEvents = false;
+  // Encoded pages are expanded by codec_decode_kernel (page_codec.hpp) on the copy stream.
+  static constexpr bool kHasDecode = true;
+  // Scatter segments go out as one cudaMemcpyBatchAsync where the runtime has it;
+  // otherwise the engine issues one copy per segment (scatter_stats()["batched"] is false).
+  static constexpr bool kHasBatchCopy = BODOCACHE_CUDA_BATCH_COPY != 0;
   std::vector<std::vector<stream_t>> streams_; // [device][stream_id]
+  std::vector<stream_t> priority_streams_;  // [device], greatest stream priority
+
+  int device_count() {
+    int n = 0;
+    if (cudaGetDeviceCount(&n) != cudaSuccess) return 0;
+    return n;
+  }
 
   void init_device_streams(int device, int streams_per_dev) {
     int device_count = 0;
@@ -15,12 +46,17 @@ struct CudaBackend {
       throw std::runtime_error("invalid CUDA device id");
     }
     cudaSetDevice(device);
-    streams_.resize(device + 1);
+    if (streams_.size() <= static_cast<size_t>(device)) streams_.resize(device + 1);
     auto& vec = streams_[device];
     vec.resize(streams_per_dev);
     for (int i = 0; i < streams_per_dev; ++i) {
       cudaStreamCreateWithFlags(&vec[i], cudaStreamNonBlocking);
     }
+    // Lower numbers are higher priorities; urgent ops get the device's greatest.
+    int least = 0, greatest = 0;
+    cudaDeviceGetStreamPriorityRange(&least, &greatest);
+    if (priority_streams_.size() <= static_cast<size_t>(device)) priority_streams_.resize(device + 1, nullptr);
+    cudaStreamCreateWithPriority(&priority_streams_[device], cudaStreamNonBlocking, greatest);
   }
 
   stream_t get_stream(int device, int stream_id) {
@@ -30,6 +66,14 @@ struct CudaBackend {
     return vec[stream_id % static_cast<int>(vec.size())];
   }
 
+  int numa_node(int device) {
+    char bus_id[64] = {0};
+    if (cudaDeviceGetPCIBusId(bus_id, sizeof(bus_id), device) != cudaSuccess) return -1;
+    return pci_numa_node(bus_id);
+  }
+
+  stream_t get_priority_stream(int device) { return priority_streams_.at(device); }
+
   void* alloc_pinned(size_t bytes) {
     void* p = nullptr;
     cudaError_t st = cudaHostAlloc(&p, bytes, cudaHostAllocDefault);
@@ -39,11 +83,65 @@ struct CudaBackend {
 
   void free_pinned(void* p) { cudaFreeHost(p); }
 
+  // Page-locks foreign host memory (e.g. a read-only mmap of a segment file) in place.
+  bool host_register(void* p, size_t bytes) {
+    return cudaHostRegister(p, bytes, cudaHostRegisterPortable | cudaHostRegisterReadOnly) == cudaSuccess;
+  }
+
+  void host_unregister(void* p) { cudaHostUnregister(p); }
+
+  void* alloc_device(int device, size_t bytes) {
+    cudaSetDevice(device);
+    void* p = nullptr;
+    if (cudaMalloc(&p, bytes) != cudaSuccess) return nullptr;
+    return p;
+  }
+
+  void free_device(int device, void* p) {
+    cudaSetDevice(device);
+    cudaFree(p);
+  }
+
+  bool launch_decode(int device, stream_t s, int32_t codec, const void* src, void* dst, size_t decoded_bytes) {
+    cudaSetDevice(device);
+    codec_decode_async(codec, src, dst, decoded_bytes, s);
+    return cudaGetLastError() == cudaSuccess;
+  }
+
   void memcpy_h2d_async(int device, void* dst_device, const void* src_host, size_t bytes, stream_t s) {
     cudaSetDevice(device);
     cudaMemcpyAsync(dst_device, src_host, bytes, cudaMemcpyHostToDevice, s);
   }
 
+#if BODOCACHE_CUDA_BATCH_COPY
+  void memcpy_h2d_batch_async(int device, void** dsts, void** srcs, size_t* sizes, size_t count, stream_t s) {
+    cudaSetDevice(device);
+    cudaMemcpyAttributes attr{};
+    attr.srcAccessOrder = cudaMemcpySrcAccessOrderStream;
+    attr.flags = cudaMemcpyFlagPreferOverlapWithCompute;
+    size_t attr_idx = 0, fail_idx = 0;
+    if (cudaMemcpyBatchAsync(dsts, srcs, sizes, count, &attr, &attr_idx, 1, &fail_idx, s) == cudaSuccess) return;
+    // Nothing was enqueued past fail_idx; issue the rest one by one
+    cudaGetLastError();
+    if (fail_idx > count) fail_idx = 0;
+    for (size_t j = fail_idx; j < count; ++j) cudaMemcpyAsync(dsts[j], srcs[j], sizes[j], cudaMemcpyHostToDevice, s);
+  }
+#endif
+
+  void memcpy_d2h_async(int device, void* dst_host, const void* src_device, size_t bytes, stream_t s) {
+    cudaSetDevice(device);
+    cudaMemcpyAsync(dst_host, src_device, bytes, cudaMemcpyDeviceToHost, s);
+  }
+
+  void memcpy_d2d_async(int device, void* dst, int dst_device, const void* src, size_t bytes, stream_t s) {
+    cudaSetDevice(device);
+    if (dst_device == device) {
+      cudaMemcpyAsync(dst, src, bytes, cudaMemcpyDeviceToDevice, s);
+    } else {
+      cudaMemcpyPeerAsync(dst, dst_device, src, device, bytes, s);
+    }
+  }
+
   void record_event(stream_t s, void** out_event) {
     cudaEvent_t ev;
     cudaEventCreateWithFlags(&ev, cudaEventDisableTiming);
@@ -61,16 +159,280 @@ struct CudaBackend {
     cudaEvent_t ev = reinterpret_cast<cudaEvent_t>(event);
     cudaEventDestroy(ev);
   }
+
+  bool launch_host_callback(stream_t s, HostCallback* cb) {
+    auto tramp = [](void* p) {
+      auto* hc = static_cast<HostCallback*>(p);
+      hc->fn(hc->arg);
+    };
+    return cudaLaunchHostFunc(s, tramp, cb) == cudaSuccess;
+  }
+
+  // CUDA has no timed event wait; callback mode is the blocking path on this backend.
+  bool wait_event(void* event, uint64_t /*timeout_ns*/) { return event_completed(event); }
+
+  // Device-side wait: work enqueued on `stream` (a caller's raw cudaStream_t) after this
+  // call runs once the event has completed; the host does not block.
+  void stream_wait_event(uintptr_t stream, void* event) {
+    cudaStreamWaitEvent(reinterpret_cast<cudaStream_t>(stream), reinterpret_cast<cudaEvent_t>(event), 0);
+  }
+
+#ifdef BODOCACHE_WITH_GDS
+  // GPUDirect Storage: segment files are opened O_DIRECT and registered with cuFile once,
+  // then read straight into device memory. Anything cuFile cannot take (unaligned ranges,
+  // no driver, filesystem without GDS support) reports kDirectUnsupported so the engine
+  // bounces that op through pinned memory instead.
+  struct GdsFile {
+    int fd{-1};
+    CUfileHandle_t handle{};
+    bool ok{false};
+  };
+  static constexpr uint64_t kGdsAlign = 4096;
+  std::mutex gds_mu_;
+  std::unordered_map<std::string, GdsFile> gds_files_;
+  bool gds_tried_{false};
+  bool gds_driver_{false};
+
+  GdsFile& gds_file(const std::string& path) {
+    std::lock_guard<std::mutex> g(gds_mu_);
+    if (!gds_tried_) {
+      gds_tried_ = true;
+      gds_driver_ = cuFileDriverOpen().err == CU_FILE_SUCCESS;
+    }
+    auto it = gds_files_.find(path);
+    if (it != gds_files_.end()) return it->second;
+    GdsFile f;
+    if (gds_driver_) f.fd = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+    if (f.fd >= 0) {
+      CUfileDescr_t descr{};
+      descr.handle.fd = f.fd;
+      descr.type = CU_FILE_HANDLE_TYPE_OPAQUE_FD;
+      f.ok = cuFileHandleRegister(&f.handle, &descr).err == CU_FILE_SUCCESS;
+      if (!f.ok) {
+        ::close(f.fd);
+        f.fd = -1;
+      }
+    }
+    // Failures are cached too, so unsupported files go straight to the bounce path.
+    return gds_files_.emplace(path, f).first->second;
+  }
+
+  int64_t direct_read(int device, const std::string& path, uint64_t offset, size_t size, void* dst_device) {
+    if (((offset | size | reinterpret_cast<uintptr_t>(dst_device)) & (kGdsAlign - 1)) != 0) {
+      return kDirectUnsupported;
+    }
+    GdsFile& f = gds_file(path);
+    if (!f.ok) return kDirectUnsupported;
+    cudaSetDevice(device);
+    size_t done = 0;
+    while (done < size) {
+      ssize_t r = cuFileRead(f.handle, dst_device, size - done, static_cast<off_t>(offset + done),
+                             static_cast<off_t>(done));
+      if (r < 0) return done == 0 ? kDirectUnsupported : (r == -1 ? -errno : -EIO);
+      if (r == 0) break;
+      done += static_cast<size_t>(r);
+    }
+    return static_cast<int64_t>(done);
+  }
+
+#endif
+
+#ifdef BODOCACHE_WITH_NCCL
+  // Peer tier: one NCCL communicator per device across the nodes' engines (rank per
+  // node/device, set up by peer_init), point-to-point ncclSend/ncclRecv of KV page runs
+  // over NVLink/InfiniBand. Buffers registered with ncclCommRegister go zero-copy.
+  std::mutex peer_mu_;
+  std::vector<ncclComm_t> peer_comms_;  // [device], nullptr until peer_init
+  std::map<std::pair<int, void*>, void*> peer_handles_;  // (device, ptr) -> registration
+
+  ncclComm_t peer_comm(int device) {
+    std::lock_guard<std::mutex> g(peer_mu_);
+    return static_cast<size_t>(device) < peer_comms_.size() ? peer_comms_[device] : nullptr;
+  }
+
+  std::string peer_unique_id() {
+    ncclUniqueId id;
+    if (ncclGetUniqueId(&id) != ncclSuccess) throw std::runtime_error("ncclGetUniqueId failed");
+    return std::string(id.internal, sizeof(id.internal));
+  }
+
+  void peer_init(int device, const std::string& uid, int nranks, int rank) {
+    ncclUniqueId id;
+    if (uid.size() != sizeof(id.internal)) throw std::invalid_argument("peer unique id has the wrong size");
+    std::memcpy(id.internal, uid.data(), sizeof(id.internal));
+    cudaSetDevice(device);
+    ncclComm_t comm = nullptr;
+    ncclResult_t st = ncclCommInitRank(&comm, nranks, id, rank);
+    if (st != ncclSuccess) throw std::runtime_error(std::string("ncclCommInitRank: ") + ncclGetErrorString(st));
+    std::lock_guard<std::mutex> g(peer_mu_);
+    if (peer_comms_.size() <= static_cast<size_t>(device)) peer_comms_.resize(device + 1, nullptr);
+    if (peer_comms_[device]) ncclCommDestroy(peer_comms_[device]);
+    peer_comms_[device] = comm;
+  }
+
+  bool peer_ready(int device) { return peer_comm(device) != nullptr; }
+
+  bool peer_register(int device, void* ptr, size_t bytes) {
+#if NCCL_VERSION_CODE >= NCCL_VERSION(2, 19, 0)
+    ncclComm_t comm = peer_comm(device);
+    if (!comm) return false;
+    void* handle = nullptr;
+    if (ncclCommRegister(comm, ptr, bytes, &handle) != ncclSuccess) return false;
+    std::lock_guard<std::mutex> g(peer_mu_);
+    peer_handles_[{device, ptr}] = handle;
+    return true;
+#else
+    (void)device, (void)ptr, (void)bytes;
+    return false;
+#endif
+  }
+
+  void peer_deregister(int device, void* ptr) {
+#if NCCL_VERSION_CODE >= NCCL_VERSION(2, 19, 0)
+    void* handle = nullptr;
+    {
+      std::lock_guard<std::mutex> g(peer_mu_);
+      auto it = peer_handles_.find({device, ptr});
+      if (it == peer_handles_.end()) return;
+      handle = it->second;
+      peer_handles_.erase(it);
+    }
+    if (ncclComm_t comm = peer_comm(device)) ncclCommDeregister(comm, handle);
+#else
+    (void)device, (void)ptr;
+#endif
+  }
+
+  bool peer_transfer_batch(int device, const PeerTransfer* xfers, size_t count, stream_t s) {
+    ncclComm_t comm = peer_comm(device);
+    if (!comm) return false;
+    cudaSetDevice(device);
+    bool ok = ncclGroupStart() == ncclSuccess;
+    for (size_t i = 0; ok && i < count; ++i) {
+      const PeerTransfer& x = xfers[i];
+      ok = (x.send ? ncclSend(x.ptr, x.bytes, ncclChar, x.peer, comm, s)
+                   : ncclRecv(x.ptr, x.bytes, ncclChar, x.peer, comm, s)) == ncclSuccess;
+    }
+    return ncclGroupEnd() == ncclSuccess && ok;
+  }
+#endif
+
+  ~CudaBackend() {
+#ifdef BODOCACHE_WITH_GDS
+    for (auto& kv : gds_files_) {
+      if (!kv.second.ok) continue;
+      cuFileHandleDeregister(kv.second.handle);
+      ::close(kv.second.fd);
+    }
+    if (gds_driver_) cuFileDriverClose();
+#endif
+#ifdef BODOCACHE_WITH_NCCL
+    for (auto& kv : peer_handles_) {
+      if (ncclComm_t comm = peer_comm(kv.first.first)) ncclCommDeregister(comm, kv.second);
+    }
+    for (ncclComm_t comm : peer_comms_) {
+      if (comm) ncclCommDestroy(comm);
+    }
+#endif
+  }
 };
 
 using CopyEngineCuda = CopyEngineNative<CudaBackend>;
 
+// copy_engine_bench.cpp includes this file for the backend alone.
+#ifndef BODOCACHE_NO_MODULE
 PYBIND11_MODULE(bodocache_agent_copy_engine, m) {
+  PYBIND11_NUMPY_DTYPE(CompletionRecord, op_id, gpu_id, stream_id, bytes, deadline_ms, t_submit_ns, t_done_ns, tag,
+                       direction, status);
+  PYBIND11_NUMPY_DTYPE(CopyDescriptor, src_ptr, dst_ptr, bytes, stream_id, gpu_id, deadline_ms, tag, direction,
+                       dst_gpu_id, priority);
+  m.attr("COMPLETION_RECORD_DTYPE") = py::dtype::of<CompletionRecord>();
+  m.attr("COPY_DESCRIPTOR_DTYPE") = py::dtype::of<CopyDescriptor>();
+  m.attr("H2D") = static_cast<int>(kH2D);
+  m.attr("D2H") = static_cast<int>(kD2H);
+  m.attr("D2D") = static_cast<int>(kD2D);
+  m.attr("PEER_RECV") = static_cast<int>(kPeerRecv);
+  m.attr("PEER_SEND") = static_cast<int>(kPeerSend);
+  m.attr("CODEC_FP8") = static_cast<int>(kCodecFp8);
+  m.attr("CODEC_INT4") = static_cast<int>(kCodecInt4);
+  m.attr("CODEC_BF16") = static_cast<int>(kCodecBf16);
   py::class_<CopyEngineCuda>(m, "CopyEngine")
-      .def(py::init<int, int>(), py::arg("device_id") = 0, py::arg("streams_per_device") = 4)
-      .def("acquire_host_buffer", &CopyEngineCuda::acquire_host_buffer, py::arg("bytes"))
-      .def("submit", &CopyEngineCuda::submit, py::arg("ops"), py::arg("callback"));
+      .def(py::init<int, int, size_t, size_t, const std::string&, size_t, size_t, bool>(), py::arg("device_id") = 0,
+           py::arg("streams_per_device") = 4, py::arg("pool_cap_bytes") = size_t(1) << 30,
+           py::arg("pool_high_water_bytes") = size_t(768) << 20, py::arg("completion_mode") = "auto",
+           py::arg("completion_ring_capacity") = 65536, py::arg("io_queue_depth") = 32,
+           py::arg("io_o_direct") = false)
+      .def("acquire_host_buffer", &CopyEngineCuda::acquire_host_buffer, py::arg("bytes"), py::arg("gpu_id") = py::none())
+      .def("devices", &CopyEngineCuda::devices)
+      .def("release_host_buffer", &CopyEngineCuda::release_host_buffer, py::arg("buf"))
+      .def("prewarm_pool", &CopyEngineCuda::prewarm_pool, py::arg("bytes"), py::arg("count"))
+      .def("trim_pool", &CopyEngineCuda::trim_pool)
+      .def("pool_stats", &CopyEngineCuda::pool_stats)
+      .def("submit", &CopyEngineCuda::submit, py::arg("ops"), py::arg("callback") = py::none())
+      .def("submit_array", &CopyEngineCuda::submit_descriptors, py::arg("descriptors"), py::arg("callback") = py::none())
+      .def("submit_array", &CopyEngineCuda::submit_array, py::arg("src_ptr"), py::arg("dst_ptr"), py::arg("bytes"),
+           py::arg("stream_id") = py::none(), py::arg("gpu_id") = py::none(), py::arg("deadline_ms") = py::none(),
+           py::arg("tag") = py::none(), py::arg("callback") = py::none(), py::arg("direction") = py::none(),
+           py::arg("dst_gpu_id") = py::none(), py::arg("priority") = py::none(),
+           py::arg("codec") = py::none(), py::arg("decoded_bytes") = py::none())
+      .def("submit_scatter", &CopyEngineCuda::submit_scatter, py::arg("src_ptr"), py::arg("seg_index"), py::arg("seg_dst"),
+           py::arg("seg_src_offset"), py::arg("seg_bytes"), py::arg("stream_id") = py::none(),
+           py::arg("gpu_id") = py::none(), py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(),
+           py::arg("callback") = py::none(), py::arg("priority") = py::none())
+      .def("scatter_stats", &CopyEngineCuda::scatter_stats)
+      .def("execute_plan", &CopyEngineCuda::execute_plan, py::arg("files"), py::arg("file_index"), py::arg("offsets"),
+           py::arg("sizes"), py::arg("dst_ptr"), py::arg("overlap") = py::none(), py::arg("stream_id") = py::none(),
+           py::arg("gpu_id") = py::none(), py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(),
+           py::arg("priority") = py::none(), py::arg("tier") = py::none(), py::arg("tier_inflight_bytes") = py::dict(),
+           py::arg("callback") = py::none())
+      .def("plan_stats", &CopyEngineCuda::plan_stats)
+      .def("submit_writeback", &CopyEngineCuda::submit_writeback, py::arg("src_ptr"), py::arg("bytes"), py::arg("paths"),
+           py::arg("offsets"), py::arg("stream_id") = py::none(), py::arg("gpu_id") = py::none(),
+           py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(), py::arg("callback") = py::none())
+      .def("buffer_address", &CopyEngineCuda::buffer_address, py::arg("buf"))
+      .def("decode_codecs", &CopyEngineCuda::decode_codecs)
+      .def("decode_stats", &CopyEngineCuda::decode_stats)
+      .def("register_host", &CopyEngineCuda::register_host, py::arg("ptr"), py::arg("bytes"))
+      .def("unregister_host", &CopyEngineCuda::unregister_host, py::arg("ptr"))
+#ifdef BODOCACHE_WITH_GDS
+      .def("submit_gds", &CopyEngineCuda::submit_direct, py::arg("paths"), py::arg("offsets"), py::arg("sizes"),
+           py::arg("dst_ptr"), py::arg("stream_id") = py::none(), py::arg("gpu_id") = py::none(),
+           py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(), py::arg("callback") = py::none())
+      .def("gds_stats", &CopyEngineCuda::direct_stats)
+#endif
+#ifdef BODOCACHE_WITH_NCCL
+      .def("submit_peer", &CopyEngineCuda::submit_peer, py::arg("ptr"), py::arg("bytes"), py::arg("peer"),
+           py::arg("send") = py::none(), py::arg("stream_id") = 0, py::arg("gpu_id") = py::none(),
+           py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(), py::arg("callback") = py::none())
+      .def("peer_unique_id", &CopyEngineCuda::peer_unique_id)
+      .def("peer_init", &CopyEngineCuda::peer_init, py::arg("unique_id"), py::arg("nranks"), py::arg("rank"),
+           py::arg("gpu_id") = py::none())
+      .def("register_peer_buffer", &CopyEngineCuda::register_peer_buffer, py::arg("ptr"), py::arg("bytes"),
+           py::arg("gpu_id") = py::none())
+      .def("unregister_peer_buffer", &CopyEngineCuda::unregister_peer_buffer, py::arg("ptr"),
+           py::arg("gpu_id") = py::none())
+      .def("peer_stats", &CopyEngineCuda::peer_stats)
+#endif
+#ifdef BODOCACHE_WITH_URING
+      .def("submit_stream", &CopyEngineCuda::submit_stream, py::arg("paths"), py::arg("offsets"), py::arg("sizes"),
+           py::arg("dst_ptr"), py::arg("stream_id") = py::none(), py::arg("gpu_id") = py::none(),
+           py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(), py::arg("chunk_bytes") = 4 << 20,
+           py::arg("depth") = 3, py::arg("callback") = py::none())
+#endif
+      .def("set_scheduler", &CopyEngineCuda::set_scheduler, py::arg("max_inflight"), py::arg("urgent_slack_ms") = 5)
+      .def("scheduler_stats", &CopyEngineCuda::scheduler_stats)
+      .def("stats", &CopyEngineCuda::stats)
+      .def("reset_stats", &CopyEngineCuda::reset_stats)
+      .def("set_batch_callback", &CopyEngineCuda::set_batch_callback, py::arg("callback"))
+      .def("poll", &CopyEngineCuda::poll, py::arg("max_records") = 0)
+      .def("poll_into", &CopyEngineCuda::poll_into, py::arg("out"))
+      .def("drain", &CopyEngineCuda::drain, py::arg("timeout_ms") = -1)
+      .def("stream_wait_ops", &CopyEngineCuda::stream_wait_ops, py::arg("op_ids"), py::arg("stream"),
+           py::arg("gpu_id") = py::none())
+      .def("inflight", &CopyEngineCuda::inflight)
+      .def("completion_mode", &CopyEngineCuda::completion_mode);
 }
+#endif  // BODOCACHE_NO_MODULE
 
 #endif // USE_CUDA_BACKEND
 
@@ -6,7 +6,21 @@
 
 struct HipBackend {
   using stream_t = hipStream_t;
+  static constexpr bool kHasHostCallback = true;
+  // Events are cheap; keep per-op completion granularity.
+  static constexpr bool kBatchEvents = false;
+  // Encoded pages are expanded by codec_decode_kernel (page_codec.hpp) on the copy stream.
+  static constexpr bool kHasDecode = true;
+  // Scatter segments are issued one copy each on the op's stream.
+  static constexpr bool kHasBatchCopy = false;
   std::vector<std::vector<stream_t>> streams_;
+  std::vector<stream_t> priority_streams_;  // [device], greatest stream priority
+
+  int device_count() {
+    int n = 0;
+    if (hipGetDeviceCount(&n) != hipSuccess) return 0;
+    return n;
+  }
 
   void init_device_streams(int device, int streams_per_dev) {
     int device_count = 0;
@@ -15,12 +29,17 @@ struct HipBackend {
       throw std::runtime_error("invalid HIP device id");
     }
     hipSetDevice(device);
-    streams_.resize(device + 1);
+    if (streams_.size() <= static_cast<size_t>(device)) streams_.resize(device + 1);
     auto& vec = streams_[device];
     vec.resize(streams_per_dev);
     for (int i = 0; i < streams_per_dev; ++i) {
       hipStreamCreateWithFlags(&vec[i], hipStreamNonBlocking);
     }
+    // Lower numbers are higher priorities; urgent ops get the device's greatest.
+    int least = 0, greatest = 0;
+    hipDeviceGetStreamPriorityRange(&least, &greatest);
+    if (priority_streams_.size() <= static_cast<size_t>(device)) priority_streams_.resize(device + 1, nullptr);
+    hipStreamCreateWithPriority(&priority_streams_[device], hipStreamNonBlocking, greatest);
   }
 
   stream_t get_stream(int device, int stream_id) {
@@ -30,6 +49,14 @@ struct HipBackend {
     return vec[stream_id % static_cast<int>(vec.size())];
   }
 
+  int numa_node(int device) {
+    char bus_id[64] = {0};
+    if (hipDeviceGetPCIBusId(bus_id, sizeof(bus_id), device) != hipSuccess) return -1;
+    return pci_numa_node(bus_id);
+  }
+
+  stream_t get_priority_stream(int device) { return priority_streams_.at(device); }
+
   void* alloc_pinned(size_t bytes) {
     void* p = nullptr;
     hipError_t st = hipHostMalloc(&p, bytes, hipHostMallocDefault);
@@ -39,11 +66,50 @@ struct HipBackend {
 
   void free_pinned(void* p) { hipHostFree(p); }
 
+  // Page-locks foreign host memory (e.g. a read-only mmap of a segment file) in place.
+  bool host_register(void* p, size_t bytes) {
+    return hipHostRegister(p, bytes, hipHostRegisterPortable | hipHostRegisterReadOnly) == hipSuccess;
+  }
+
+  void host_unregister(void* p) { hipHostUnregister(p); }
+
+  void* alloc_device(int device, size_t bytes) {
+    hipSetDevice(device);
+    void* p = nullptr;
+    if (hipMalloc(&p, bytes) != hipSuccess) return nullptr;
+    return p;
+  }
+
+  void free_device(int device, void* p) {
+    hipSetDevice(device);
+    hipFree(p);
+  }
+
+  bool launch_decode(int device, stream_t s, int32_t codec, const void* src, void* dst, size_t decoded_bytes) {
+    hipSetDevice(device);
+    codec_decode_async(codec, src, dst, decoded_bytes, s);
+    return hipGetLastError() == hipSuccess;
+  }
+
   void memcpy_h2d_async(int device, void* dst_device, const void* src_host, size_t bytes, stream_t s) {
     hipSetDevice(device);
     hipMemcpyAsync(dst_device, src_host, bytes, hipMemcpyHostToDevice, s);
   }
 
+  void memcpy_d2h_async(int device, void* dst_host, const void* src_device, size_t bytes, stream_t s) {
+    hipSetDevice(device);
+    hipMemcpyAsync(dst_host, src_device, bytes, hipMemcpyDeviceToHost, s);
+  }
+
+  void memcpy_d2d_async(int device, void* dst, int dst_device, const void* src, size_t bytes, stream_t s) {
+    hipSetDevice(device);
+    if (dst_device == device) {
+      hipMemcpyAsync(dst, src, bytes, hipMemcpyDeviceToDevice, s);
+    } else {
+      hipMemcpyPeerAsync(dst, dst_device, src, device, bytes, s);
+    }
+  }
+
   void record_event(stream_t s, void** out_event) {
     hipEvent_t ev;
     hipEventCreateWithFlags(&ev, hipEventDisableTiming);
@@ -61,16 +127,100 @@ struct HipBackend {
     hipEvent_t ev = reinterpret_cast<hipEvent_t>(event);
     hipEventDestroy(ev);
   }
+
+  bool launch_host_callback(stream_t s, HostCallback* cb) {
+    auto tramp = [](hipStream_t, hipError_t, void* p) {
+      auto* hc = static_cast<HostCallback*>(p);
+      hc->fn(hc->arg);
+    };
+    return hipStreamAddCallback(s, tramp, cb, 0) == hipSuccess;
+  }
+
+  // HIP has no timed event wait; callback mode is the blocking path on this backend.
+  bool wait_event(void* event, uint64_t /*timeout_ns*/) { return event_completed(event); }
+
+  // Device-side wait: work enqueued on `stream` (a caller's raw hipStream_t) after this
+  // call runs once the event has completed; the host does not block.
+  void stream_wait_event(uintptr_t stream, void* event) {
+    hipStreamWaitEvent(reinterpret_cast<hipStream_t>(stream), reinterpret_cast<hipEvent_t>(event), 0);
+  }
 };
 
 using CopyEngineHip = CopyEngineNative<HipBackend>;
 
+// copy_engine_bench.cpp includes this file for the backend alone.
+#ifndef BODOCACHE_NO_MODULE
 PYBIND11_MODULE(bodocache_agent_copy_engine, m) {
+  PYBIND11_NUMPY_DTYPE(CompletionRecord, op_id, gpu_id, stream_id, bytes, deadline_ms, t_submit_ns, t_done_ns, tag,
+                       direction, status);
+  PYBIND11_NUMPY_DTYPE(CopyDescriptor, src_ptr, dst_ptr, bytes, stream_id, gpu_id, deadline_ms, tag, direction,
+                       dst_gpu_id, priority);
+  m.attr("COMPLETION_RECORD_DTYPE") = py::dtype::of<CompletionRecord>();
+  m.attr("COPY_DESCRIPTOR_DTYPE") = py::dtype::of<CopyDescriptor>();
+  m.attr("H2D") = static_cast<int>(kH2D);
+  m.attr("D2H") = static_cast<int>(kD2H);
+  m.attr("D2D") = static_cast<int>(kD2D);
+  m.attr("CODEC_FP8") = static_cast<int>(kCodecFp8);
+  m.attr("CODEC_INT4") = static_cast<int>(kCodecInt4);
+  m.attr("CODEC_BF16") = static_cast<int>(kCodecBf16);
   py::class_<CopyEngineHip>(m, "CopyEngine")
-      .def(py::init<int, int>(), py::arg("device_id") = 0, py::arg("streams_per_device") = 4)
-      .def("acquire_host_buffer", &CopyEngineHip::acquire_host_buffer, py::arg("bytes"))
-      .def("submit", &CopyEngineHip::submit, py::arg("ops"), py::arg("callback"));
+      .def(py::init<int, int, size_t, size_t, const std::string&, size_t, size_t, bool>(), py::arg("device_id") = 0,
+           py::arg("streams_per_device") = 4, py::arg("pool_cap_bytes") = size_t(1) << 30,
+           py::arg("pool_high_water_bytes") = size_t(768) << 20, py::arg("completion_mode") = "auto",
+           py::arg("completion_ring_capacity") = 65536, py::arg("io_queue_depth") = 32,
+           py::arg("io_o_direct") = false)
+      .def("acquire_host_buffer", &CopyEngineHip::acquire_host_buffer, py::arg("bytes"), py::arg("gpu_id") = py::none())
+      .def("devices", &CopyEngineHip::devices)
+      .def("release_host_buffer", &CopyEngineHip::release_host_buffer, py::arg("buf"))
+      .def("prewarm_pool", &CopyEngineHip::prewarm_pool, py::arg("bytes"), py::arg("count"))
+      .def("trim_pool", &CopyEngineHip::trim_pool)
+      .def("pool_stats", &CopyEngineHip::pool_stats)
+      .def("submit", &CopyEngineHip::submit, py::arg("ops"), py::arg("callback") = py::none())
+      .def("submit_array", &CopyEngineHip::submit_descriptors, py::arg("descriptors"), py::arg("callback") = py::none())
+      .def("submit_array", &CopyEngineHip::submit_array, py::arg("src_ptr"), py::arg("dst_ptr"), py::arg("bytes"),
+           py::arg("stream_id") = py::none(), py::arg("gpu_id") = py::none(), py::arg("deadline_ms") = py::none(),
+           py::arg("tag") = py::none(), py::arg("callback") = py::none(), py::arg("direction") = py::none(),
+           py::arg("dst_gpu_id") = py::none(), py::arg("priority") = py::none(),
+           py::arg("codec") = py::none(), py::arg("decoded_bytes") = py::none())
+      .def("submit_scatter", &CopyEngineHip::submit_scatter, py::arg("src_ptr"), py::arg("seg_index"), py::arg("seg_dst"),
+           py::arg("seg_src_offset"), py::arg("seg_bytes"), py::arg("stream_id") = py::none(),
+           py::arg("gpu_id") = py::none(), py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(),
+           py::arg("callback") = py::none(), py::arg("priority") = py::none())
+      .def("scatter_stats", &CopyEngineHip::scatter_stats)
+      .def("execute_plan", &CopyEngineHip::execute_plan, py::arg("files"), py::arg("file_index"), py::arg("offsets"),
+           py::arg("sizes"), py::arg("dst_ptr"), py::arg("overlap") = py::none(), py::arg("stream_id") = py::none(),
+           py::arg("gpu_id") = py::none(), py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(),
+           py::arg("priority") = py::none(), py::arg("tier") = py::none(), py::arg("tier_inflight_bytes") = py::dict(),
+           py::arg("callback") = py::none())
+      .def("plan_stats", &CopyEngineHip::plan_stats)
+      .def("submit_writeback", &CopyEngineHip::submit_writeback, py::arg("src_ptr"), py::arg("bytes"), py::arg("paths"),
+           py::arg("offsets"), py::arg("stream_id") = py::none(), py::arg("gpu_id") = py::none(),
+           py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(), py::arg("callback") = py::none())
+      .def("buffer_address", &CopyEngineHip::buffer_address, py::arg("buf"))
+      .def("decode_codecs", &CopyEngineHip::decode_codecs)
+      .def("decode_stats", &CopyEngineHip::decode_stats)
+      .def("register_host", &CopyEngineHip::register_host, py::arg("ptr"), py::arg("bytes"))
+      .def("unregister_host", &CopyEngineHip::unregister_host, py::arg("ptr"))
+#ifdef BODOCACHE_WITH_URING
+      .def("submit_stream", &CopyEngineHip::submit_stream, py::arg("paths"), py::arg("offsets"), py::arg("sizes"),
+           py::arg("dst_ptr"), py::arg("stream_id") = py::none(), py::arg("gpu_id") = py::none(),
+           py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(), py::arg("chunk_bytes") = 4 << 20,
+           py::arg("depth") = 3, py::arg("callback") = py::none())
+#endif
+      .def("set_scheduler", &CopyEngineHip::set_scheduler, py::arg("max_inflight"), py::arg("urgent_slack_ms") = 5)
+      .def("scheduler_stats", &CopyEngineHip::scheduler_stats)
+      .def("stats", &CopyEngineHip::stats)
+      .def("reset_stats", &CopyEngineHip::reset_stats)
+      .def("set_batch_callback", &CopyEngineHip::set_batch_callback, py::arg("callback"))
+      .def("poll", &CopyEngineHip::poll, py::arg("max_records") = 0)
+      .def("poll_into", &CopyEngineHip::poll_into, py::arg("out"))
+      .def("drain", &CopyEngineHip::drain, py::arg("timeout_ms") = -1)
+      .def("stream_wait_ops", &CopyEngineHip::stream_wait_ops, py::arg("op_ids"), py::arg("stream"),
+           py::arg("gpu_id") = py::none())
+      .def("inflight", &CopyEngineHip::inflight)
+      .def("completion_mode", &CopyEngineHip::completion_mode);
 }
+#endif  // BODOCACHE_NO_MODULE
 
 #endif // USE_HIP_BACKEND
 
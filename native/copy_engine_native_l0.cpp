@@ -4,58 +4,90 @@
 
 #include <level_zero/ze_api.h>
 
+#include <memory>
+
 struct L0Backend {
-  using stream_t = ze_command_queue_handle_t;
-  ze_context_handle_t context_{nullptr};
-  ze_device_handle_t device_{nullptr};
-  ze_event_pool_handle_t event_pool_{nullptr};
-  std::vector<stream_t> queues_;
+  // One in-order immediate command list per stream: appends go straight to the device
+  // without the create/close/execute/destroy round trip of regular lists. Immediate lists
+  // are not thread-safe, so each carries its own lock.
+  struct Stream {
+    ze_command_list_handle_t list{nullptr};
+    std::mutex mu;
+  };
+  using stream_t = Stream*;
+  // Level Zero has no stream host callbacks; the engine blocks in zeEventHostSynchronize instead.
+  static constexpr bool kHasHostCallback = false;
+  // Events cost more than appends here: one signal event per stream per submit call.
+  static constexpr bool kBatchEvents = true;
+  // No device decode kernel for Level Zero; encoded pages are decoded on the host.
+  static constexpr bool kHasDecode = false;
+  // Scatter segments are issued one copy each on the op's stream.
+  static constexpr bool kHasBatchCopy = false;
+  // Events per pool; the free list grows by another pool when it runs dry.
+  static constexpr uint32_t kEventsPerPool = 256;
+  // Streams of one device
+  struct DeviceStreams {
+    std::vector<std::unique_ptr<Stream>> streams;
+    std::unique_ptr<Stream> priority;  // high-priority list for urgent ops
+  };
+  ze_driver_handle_t driver_{nullptr};
+  ze_context_handle_t context_{nullptr};  // shared by every device of the driver
+  std::vector<ze_device_handle_t> devices_;
+  std::vector<DeviceStreams> streams_;  // [device]
+  std::mutex event_mu_;
+  std::vector<ze_event_pool_handle_t> event_pools_;
+  std::vector<ze_event_handle_t> all_events_;
+  std::vector<ze_event_handle_t> free_events_;
 
-  void init_device_streams(int device_index, int streams_per_dev) {
-    zeInit(0);
-    uint32_t nDrivers = 0;
-    zeDriverGet(&nDrivers, nullptr);
-    if (nDrivers == 0) throw std::runtime_error("No Level Zero drivers found");
-    std::vector<ze_driver_handle_t> drivers(nDrivers);
-    zeDriverGet(&nDrivers, drivers.data());
+  ~L0Backend() {
+    for (auto ev : all_events_) zeEventDestroy(ev);
+    for (auto pool : event_pools_) zeEventPoolDestroy(pool);
+    for (auto& dev : streams_) {
+      for (auto& s : dev.streams) {
+        if (s->list) zeCommandListDestroy(s->list);
+      }
+      if (dev.priority && dev.priority->list) zeCommandListDestroy(dev.priority->list);
+    }
+  }
 
-    // Choose first driver; enumerate devices
-    uint32_t nDevices = 0;
-    zeDeviceGet(drivers[0], &nDevices, nullptr);
-    if (nDevices == 0) throw std::runtime_error("No Level Zero devices found");
-    std::vector<ze_device_handle_t> devices(nDevices);
-    zeDeviceGet(drivers[0], &nDevices, devices.data());
-    if (device_index < 0 || (uint32_t)device_index >= nDevices) throw std::runtime_error("Invalid device index");
-    device_ = devices[device_index];
+  int device_count() {
+    ensure_driver();
+    return static_cast<int>(devices_.size());
+  }
 
-    ze_context_desc_t cdesc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC, nullptr, 0};
-    zeContextCreate(drivers[0], &cdesc, &context_);
+  void init_device_streams(int device_index, int streams_per_dev) {
+    ensure_driver();
+    if (device_index < 0 || (size_t)device_index >= devices_.size()) throw std::runtime_error("Invalid device index");
+    DeviceStreams& dev = streams_[device_index];
 
-    // Create command queues (streams)
-    queues_.resize(streams_per_dev);
+    // Create immediate command lists (streams)
     for (int i = 0; i < streams_per_dev; ++i) {
-      ze_command_queue_desc_t qdesc = {ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC};
-      qdesc.ordinal = 0;
-      qdesc.flags = 0;
-      qdesc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
-      qdesc.priority = ZE_COMMAND_QUEUE_PRIORITY_NORMAL;
-      zeCommandQueueCreate(context_, device_, &qdesc, &queues_[i]);
+      dev.streams.push_back(create_stream(device_index, ZE_COMMAND_QUEUE_PRIORITY_NORMAL));
     }
+    dev.priority = create_stream(device_index, ZE_COMMAND_QUEUE_PRIORITY_PRIORITY_HIGH);
 
-    // Create an event pool
-    ze_event_pool_desc_t pdesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC};
-    pdesc.count = 1024;
-    pdesc.flags = ZE_EVENT_POOL_FLAG_HOST_VISIBLE;
-    zeCommandListCreate(context_, device_, nullptr, nullptr); // warmup
-    zeEventPoolCreate(context_, &pdesc, 0, nullptr, &event_pool_);
+    std::lock_guard<std::mutex> g(event_mu_);
+    if (event_pools_.empty()) grow_events_locked();
+  }
+
+  int numa_node(int device) {
+    ze_pci_ext_properties_t props = {ZE_STRUCTURE_TYPE_PCI_EXT_PROPERTIES};
+    if (zeDevicePciGetPropertiesExt(devices_.at(device), &props) != ZE_RESULT_SUCCESS) return -1;
+    char bus_id[32];
+    std::snprintf(bus_id, sizeof(bus_id), "%04x:%02x:%02x.%x", props.address.domain, props.address.bus,
+                  props.address.device, props.address.function);
+    return pci_numa_node(bus_id);
   }
 
-  stream_t get_stream(int /*device*/, int stream_id) {
-    if (queues_.empty()) throw std::runtime_error("queues not initialized");
+  stream_t get_stream(int device, int stream_id) {
+    auto& vec = streams_.at(device).streams;
+    if (vec.empty()) throw std::runtime_error("queues not initialized");
     if (stream_id < 0) stream_id = 0;
-    return queues_[stream_id % static_cast<int>(queues_.size())];
+    return vec[stream_id % static_cast<int>(vec.size())].get();
   }
 
+  stream_t get_priority_stream(int device) { return streams_.at(device).priority.get(); }
+
   void* alloc_pinned(size_t bytes) {
     ze_host_mem_alloc_desc_t hdesc = {ZE_STRUCTURE_TYPE_HOST_MEM_ALLOC_DESC};
     void* p = nullptr;
@@ -66,35 +98,49 @@ struct L0Backend {
 
   void free_pinned(void* p) { zeMemFree(context_, p); }
 
-  void memcpy_h2d_async(int /*device*/, void* dst_device, const void* src_host, size_t bytes, stream_t q) {
-    ze_command_list_handle_t cl;
-    ze_command_list_desc_t ldesc = {ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC};
-    zeCommandListCreate(context_, device_, &ldesc, &cl);
-    zeEventHostSynchronize(nullptr, 0); // no-op safety
-    zeCommandListAppendMemoryCopy(cl, dst_device, src_host, bytes, /*signal*/ nullptr, 0, nullptr);
-    zeCommandListClose(cl);
-    zeCommandQueueExecuteCommandLists(q, 1, &cl, nullptr);
-    // We don't synchronize here; events handled separately via record_event()
-    // Hold the command list reference implicitly until event signals; user should flush queue
-    zeCommandListDestroy(cl); // Allow driver to reclaim after execution
-  }
-
-  void record_event(stream_t q, void** out_event) {
-    ze_event_handle_t ev;
-    ze_event_desc_t edesc = {ZE_STRUCTURE_TYPE_EVENT_DESC};
-    static std::atomic<uint32_t> next{1};
-    edesc.index = next.fetch_add(1);
-    edesc.signal = 0;
-    edesc.wait = 0;
-    zeEventCreate(event_pool_, &edesc, &ev);
-    // Emit a barrier to signal the event after prior enqueued ops
-    ze_command_list_handle_t cl;
-    ze_command_list_desc_t ldesc = {ZE_STRUCTURE_TYPE_COMMAND_LIST_DESC};
-    zeCommandListCreate(context_, device_, &ldesc, &cl);
-    zeCommandListAppendBarrier(cl, ev, 0, nullptr);
-    zeCommandListClose(cl);
-    zeCommandQueueExecuteCommandLists(q, 1, &cl, nullptr);
-    zeCommandListDestroy(cl);
+  // Device memory is only needed by copy_engine_bench; there is no decode kernel here.
+  void* alloc_device(int device, size_t bytes) {
+    ze_device_mem_alloc_desc_t ddesc = {ZE_STRUCTURE_TYPE_DEVICE_MEM_ALLOC_DESC};
+    void* p = nullptr;
+    ze_result_t r = zeMemAllocDevice(context_, &ddesc, bytes, /*alignment*/ 64, devices_.at(device), &p);
+    if (r != ZE_RESULT_SUCCESS) return nullptr;
+    return p;
+  }
+
+  void free_device(int /*device*/, void* p) { zeMemFree(context_, p); }
+
+  // No core Level Zero API pins foreign memory; mapped sources stay pageable.
+  bool host_register(void*, size_t) { return false; }
+
+  void host_unregister(void*) {}
+
+  void memcpy_h2d_async(int /*device*/, void* dst_device, const void* src_host, size_t bytes, stream_t s) {
+    memcpy_async(dst_device, src_host, bytes, s);
+  }
+
+  void memcpy_d2h_async(int /*device*/, void* dst_host, const void* src_device, size_t bytes, stream_t s) {
+    memcpy_async(dst_host, src_device, bytes, s);
+  }
+
+  // Device pointers of the shared context are addressable from every device's lists, so
+  // peers need no special path here.
+  void memcpy_d2d_async(int /*device*/, void* dst, int /*dst_device*/, const void* src, size_t bytes, stream_t s) {
+    memcpy_async(dst, src, bytes, s);
+  }
+
+  // zeCommandListAppendMemoryCopy infers the direction from the pointers.
+  void memcpy_async(void* dst, const void* src, size_t bytes, stream_t s) {
+    std::lock_guard<std::mutex> g(s->mu);
+    zeCommandListAppendMemoryCopy(s->list, dst, src, bytes, /*signal*/ nullptr, 0, nullptr);
+  }
+
+  void record_event(stream_t s, void** out_event) {
+    ze_event_handle_t ev = acquire_event();
+    {
+      // Barrier signals the event after everything appended to the list so far
+      std::lock_guard<std::mutex> g(s->mu);
+      zeCommandListAppendBarrier(s->list, ev, 0, nullptr);
+    }
     *out_event = reinterpret_cast<void*>(ev);
   }
 
@@ -104,20 +150,160 @@ struct L0Backend {
     return r == ZE_RESULT_SUCCESS;
   }
 
+  // Events are reset and recycled rather than destroyed; the pools live as long as the backend.
   void destroy_event(void* event) {
     ze_event_handle_t ev = reinterpret_cast<ze_event_handle_t>(event);
-    zeEventDestroy(ev);
+    zeEventHostReset(ev);
+    std::lock_guard<std::mutex> g(event_mu_);
+    free_events_.push_back(ev);
+  }
+
+  bool launch_host_callback(stream_t /*s*/, HostCallback* /*cb*/) { return false; }
+
+  bool wait_event(void* event, uint64_t timeout_ns) {
+    ze_event_handle_t ev = reinterpret_cast<ze_event_handle_t>(event);
+    return zeEventHostSynchronize(ev, timeout_ns) == ZE_RESULT_SUCCESS;
+  }
+
+ private:
+  // First driver, all of its devices, one context.
+  void ensure_driver() {
+    if (driver_) return;
+    zeInit(0);
+    uint32_t nDrivers = 0;
+    zeDriverGet(&nDrivers, nullptr);
+    if (nDrivers == 0) throw std::runtime_error("No Level Zero drivers found");
+    std::vector<ze_driver_handle_t> drivers(nDrivers);
+    zeDriverGet(&nDrivers, drivers.data());
+
+    uint32_t nDevices = 0;
+    zeDeviceGet(drivers[0], &nDevices, nullptr);
+    if (nDevices == 0) throw std::runtime_error("No Level Zero devices found");
+    devices_.resize(nDevices);
+    zeDeviceGet(drivers[0], &nDevices, devices_.data());
+    streams_.resize(nDevices);
+
+    ze_context_desc_t cdesc = {ZE_STRUCTURE_TYPE_CONTEXT_DESC, nullptr, 0};
+    zeContextCreate(drivers[0], &cdesc, &context_);
+    driver_ = drivers[0];
+  }
+
+  std::unique_ptr<Stream> create_stream(int device, ze_command_queue_priority_t priority) {
+    ze_command_queue_desc_t qdesc = {ZE_STRUCTURE_TYPE_COMMAND_QUEUE_DESC};
+    qdesc.ordinal = 0;
+    qdesc.flags = ZE_COMMAND_QUEUE_FLAG_IN_ORDER;
+    qdesc.mode = ZE_COMMAND_QUEUE_MODE_ASYNCHRONOUS;
+    qdesc.priority = priority;
+    auto s = std::make_unique<Stream>();
+    if (zeCommandListCreateImmediate(context_, devices_[device], &qdesc, &s->list) != ZE_RESULT_SUCCESS) {
+      throw std::runtime_error("zeCommandListCreateImmediate failed");
+    }
+    return s;
+  }
+
+  ze_event_handle_t acquire_event() {
+    std::lock_guard<std::mutex> g(event_mu_);
+    if (free_events_.empty()) grow_events_locked();
+    ze_event_handle_t ev = free_events_.back();
+    free_events_.pop_back();
+    return ev;
+  }
+
+  void grow_events_locked() {
+    ze_event_pool_desc_t pdesc = {ZE_STRUCTURE_TYPE_EVENT_POOL_DESC};
+    pdesc.count = kEventsPerPool;
+    pdesc.flags = ZE_EVENT_POOL_FLAG_HOST_VISIBLE;
+    ze_event_pool_handle_t pool;
+    if (zeEventPoolCreate(context_, &pdesc, 0, nullptr, &pool) != ZE_RESULT_SUCCESS) {
+      throw std::runtime_error("zeEventPoolCreate failed");
+    }
+    event_pools_.push_back(pool);
+    for (uint32_t i = 0; i < kEventsPerPool; ++i) {
+      ze_event_desc_t edesc = {ZE_STRUCTURE_TYPE_EVENT_DESC};
+      edesc.index = i;
+      edesc.signal = ZE_EVENT_SCOPE_FLAG_HOST;
+      edesc.wait = ZE_EVENT_SCOPE_FLAG_HOST;
+      ze_event_handle_t ev;
+      if (zeEventCreate(pool, &edesc, &ev) != ZE_RESULT_SUCCESS) throw std::runtime_error("zeEventCreate failed");
+      all_events_.push_back(ev);
+      free_events_.push_back(ev);
+    }
   }
 };
 
 using CopyEngineL0 = CopyEngineNative<L0Backend>;
 
+// copy_engine_bench.cpp includes this file for the backend alone.
+#ifndef BODOCACHE_NO_MODULE
 PYBIND11_MODULE(bodocache_agent_copy_engine, m) {
+  PYBIND11_NUMPY_DTYPE(CompletionRecord, op_id, gpu_id, stream_id, bytes, deadline_ms, t_submit_ns, t_done_ns, tag,
+                       direction, status);
+  PYBIND11_NUMPY_DTYPE(CopyDescriptor, src_ptr, dst_ptr, bytes, stream_id, gpu_id, deadline_ms, tag, direction,
+                       dst_gpu_id, priority);
+  m.attr("COMPLETION_RECORD_DTYPE") = py::dtype::of<CompletionRecord>();
+  m.attr("COPY_DESCRIPTOR_DTYPE") = py::dtype::of<CopyDescriptor>();
+  m.attr("H2D") = static_cast<int>(kH2D);
+  m.attr("D2H") = static_cast<int>(kD2H);
+  m.attr("D2D") = static_cast<int>(kD2D);
+  m.attr("CODEC_FP8") = static_cast<int>(kCodecFp8);
+  m.attr("CODEC_INT4") = static_cast<int>(kCodecInt4);
+  m.attr("CODEC_BF16") = static_cast<int>(kCodecBf16);
   py::class_<CopyEngineL0>(m, "CopyEngine")
-      .def(py::init<int, int>(), py::arg("device_id") = 0, py::arg("streams_per_device") = 4)
-      .def("acquire_host_buffer", &CopyEngineL0::acquire_host_buffer, py::arg("bytes"))
-      .def("submit", &CopyEngineL0::submit, py::arg("ops"), py::arg("callback"));
+      .def(py::init<int, int, size_t, size_t, const std::string&, size_t, size_t, bool>(), py::arg("device_id") = 0,
+           py::arg("streams_per_device") = 4, py::arg("pool_cap_bytes") = size_t(1) << 30,
+           py::arg("pool_high_water_bytes") = size_t(768) << 20, py::arg("completion_mode") = "auto",
+           py::arg("completion_ring_capacity") = 65536, py::arg("io_queue_depth") = 32,
+           py::arg("io_o_direct") = false)
+      .def("acquire_host_buffer", &CopyEngineL0::acquire_host_buffer, py::arg("bytes"), py::arg("gpu_id") = py::none())
+      .def("devices", &CopyEngineL0::devices)
+      .def("release_host_buffer", &CopyEngineL0::release_host_buffer, py::arg("buf"))
+      .def("prewarm_pool", &CopyEngineL0::prewarm_pool, py::arg("bytes"), py::arg("count"))
+      .def("trim_pool", &CopyEngineL0::trim_pool)
+      .def("pool_stats", &CopyEngineL0::pool_stats)
+      .def("submit", &CopyEngineL0::submit, py::arg("ops"), py::arg("callback") = py::none())
+      .def("submit_array", &CopyEngineL0::submit_descriptors, py::arg("descriptors"), py::arg("callback") = py::none())
+      .def("submit_array", &CopyEngineL0::submit_array, py::arg("src_ptr"), py::arg("dst_ptr"), py::arg("bytes"),
+           py::arg("stream_id") = py::none(), py::arg("gpu_id") = py::none(), py::arg("deadline_ms") = py::none(),
+           py::arg("tag") = py::none(), py::arg("callback") = py::none(), py::arg("direction") = py::none(),
+           py::arg("dst_gpu_id") = py::none(), py::arg("priority") = py::none(),
+           py::arg("codec") = py::none(), py::arg("decoded_bytes") = py::none())
+      .def("submit_scatter", &CopyEngineL0::submit_scatter, py::arg("src_ptr"), py::arg("seg_index"), py::arg("seg_dst"),
+           py::arg("seg_src_offset"), py::arg("seg_bytes"), py::arg("stream_id") = py::none(),
+           py::arg("gpu_id") = py::none(), py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(),
+           py::arg("callback") = py::none(), py::arg("priority") = py::none())
+      .def("scatter_stats", &CopyEngineL0::scatter_stats)
+      .def("execute_plan", &CopyEngineL0::execute_plan, py::arg("files"), py::arg("file_index"), py::arg("offsets"),
+           py::arg("sizes"), py::arg("dst_ptr"), py::arg("overlap") = py::none(), py::arg("stream_id") = py::none(),
+           py::arg("gpu_id") = py::none(), py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(),
+           py::arg("priority") = py::none(), py::arg("tier") = py::none(), py::arg("tier_inflight_bytes") = py::dict(),
+           py::arg("callback") = py::none())
+      .def("plan_stats", &CopyEngineL0::plan_stats)
+      .def("submit_writeback", &CopyEngineL0::submit_writeback, py::arg("src_ptr"), py::arg("bytes"), py::arg("paths"),
+           py::arg("offsets"), py::arg("stream_id") = py::none(), py::arg("gpu_id") = py::none(),
+           py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(), py::arg("callback") = py::none())
+      .def("buffer_address", &CopyEngineL0::buffer_address, py::arg("buf"))
+      .def("decode_codecs", &CopyEngineL0::decode_codecs)
+      .def("decode_stats", &CopyEngineL0::decode_stats)
+      .def("register_host", &CopyEngineL0::register_host, py::arg("ptr"), py::arg("bytes"))
+      .def("unregister_host", &CopyEngineL0::unregister_host, py::arg("ptr"))
+#ifdef BODOCACHE_WITH_URING
+      .def("submit_stream", &CopyEngineL0::submit_stream, py::arg("paths"), py::arg("offsets"), py::arg("sizes"),
+           py::arg("dst_ptr"), py::arg("stream_id") = py::none(), py::arg("gpu_id") = py::none(),
+           py::arg("deadline_ms") = py::none(), py::arg("tag") = py::none(), py::arg("chunk_bytes") = 4 << 20,
+           py::arg("depth") = 3, py::arg("callback") = py::none())
+#endif
+      .def("set_scheduler", &CopyEngineL0::set_scheduler, py::arg("max_inflight"), py::arg("urgent_slack_ms") = 5)
+      .def("scheduler_stats", &CopyEngineL0::scheduler_stats)
+      .def("stats", &CopyEngineL0::stats)
+      .def("reset_stats", &CopyEngineL0::reset_stats)
+      .def("set_batch_callback", &CopyEngineL0::set_batch_callback, py::arg("callback"))
+      .def("poll", &CopyEngineL0::poll, py::arg("max_records") = 0)
+      .def("poll_into", &CopyEngineL0::poll_into, py::arg("out"))
+      .def("drain", &CopyEngineL0::drain, py::arg("timeout_ms") = -1)
+      .def("inflight", &CopyEngineL0::inflight)
+      .def("completion_mode", &CopyEngineL0::completion_mode);
 }
+#endif  // BODOCACHE_NO_MODULE
 
 #endif // USE_L0_BACKEND
 
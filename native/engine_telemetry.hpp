@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free copy engine telemetry: HDR-style latency histograms and per-stream counters.
+// Recording is a handful of relaxed atomic increments, so completion workers, the plan
+// thread and submitters record concurrently; snapshots read the counters racily (a
+// snapshot taken mid-update may be one op behind on some fields).
+
+// Log-linear histogram of nanosecond values: values below 2^kSubBits get one bucket each,
+// every power of two above is split into 2^kSubBits linear sub-buckets, so a quantile is
+// off by at most 1/2^kSubBits (about 3%) of its value. Values are clamped to [0, kMaxValue].
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBits = 5;
+  static constexpr int kMaxBits = 40;  // ~18 minutes
+  static constexpr uint64_t kMaxValue = (uint64_t(1) << kMaxBits) - 1;
+  static constexpr size_t kSubBuckets = size_t(1) << kSubBits;
+  static constexpr size_t kBuckets = size_t(kMaxBits - kSubBits + 1) << kSubBits;
+
+  static size_t index_of(uint64_t v) {
+    if (v > kMaxValue) v = kMaxValue;
+    if (v < kSubBuckets) return static_cast<size_t>(v);
+    int msb = 63;
+    while (!(v >> msb)) --msb;
+    const int shift = msb - kSubBits;
+    return (static_cast<size_t>(shift + 1) << kSubBits) + static_cast<size_t>((v >> shift) - kSubBuckets);
+  }
+
+  // Smallest value and width of bucket idx.
+  static uint64_t bucket_low(size_t idx) {
+    if (idx < kSubBuckets) return idx;
+    const int shift = static_cast<int>(idx >> kSubBits) - 1;
+    return (kSubBuckets + (idx & (kSubBuckets - 1))) << shift;
+  }
+  static uint64_t bucket_width(size_t idx) {
+    return idx < kSubBuckets ? 1 : uint64_t(1) << (static_cast<int>(idx >> kSubBits) - 1);
+  }
+
+  void record(int64_t ns) {
+    const uint64_t v = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+    counts_[index_of(v)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(v, std::memory_order_relaxed);
+    uint64_t prev = max_.load(std::memory_order_relaxed);
+    while (v > prev && !max_.compare_exchange_weak(prev, v, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+  // Value at quantile q in [0, 1]: the midpoint of the bucket holding that rank, capped
+  // by the largest recorded value. 0 when empty.
+  uint64_t quantile(double q) const {
+    uint64_t total = 0;
+    for (auto& c : counts_) total += c.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+    const double clamped = q < 0 ? 0 : q > 1 ? 1 : q;
+    uint64_t rank = static_cast<uint64_t>(clamped * static_cast<double>(total) + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+      seen += counts_[i].load(std::memory_order_relaxed);
+      if (seen >= rank) {
+        const uint64_t mid = bucket_low(i) + bucket_width(i) / 2;
+        return mid < max() ? mid : max();
+      }
+    }
+    return max();
+  }
+
+  void reset() {
+    for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+// Completed ops of one (device, stream slot). Phases of an op, from its submit time:
+//   read:       storage read into staging (plan rows, streamed and direct reads only)
+//   queue_wait: waiting for the scheduler or plan thread, issue time minus submit and read
+//   dma:        copy issued on the device stream until the worker saw it complete
+//   e2e:        submit until the completion record was emitted
+struct StreamTelemetry {
+  LatencyHistogram read;
+  LatencyHistogram queue_wait;
+  LatencyHistogram dma;
+  LatencyHistogram e2e;
+  std::atomic<uint64_t> ops{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> deadline_misses{0};
+  std::atomic<uint64_t> failures{0};
+
+  void reset() {
+    read.reset();
+    queue_wait.reset();
+    dma.reset();
+    e2e.reset();
+    ops.store(0, std::memory_order_relaxed);
+    bytes.store(0, std::memory_order_relaxed);
+    deadline_misses.store(0, std::memory_order_relaxed);
+    failures.store(0, std::memory_order_relaxed);
+  }
+};
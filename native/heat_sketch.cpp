@@ -0,0 +1,408 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BODOCACHE_HEAT_X86 1
+#endif
+
+namespace py = pybind11;
+
+template <typename T>
+using carray = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+// Page keys pack (layer, page_id) as layer:16 | page_id:48, matching heat_df's key columns.
+inline uint64_t page_key(int64_t layer, int64_t page_id) {
+  return (static_cast<uint64_t>(layer) << 48) | (static_cast<uint64_t>(page_id) & ((1ull << 48) - 1));
+}
+
+// MurmurHash3 64-bit finalizer.
+inline uint64_t fmix64(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdull;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ull;
+  k ^= k >> 33;
+  return k;
+}
+
+// Page-keyed heat sketch: Count-Min over a flat table plus a sharded SpaceSaving top-k.
+//
+// The Count-Min table is one 64-byte aligned block of uint32 counters with
+// depth rows of width counters each. Width is a power of two. Row r of a key
+// uses slot (h1 + r*h2) & (width-1) (Kirsch-Mitzenmacher double hashing over one
+// murmur fmix64). On AVX2 hosts the row slots are computed 8 at a time and queries
+// use a gather + min reduction; increments are relaxed atomic adds, so concurrent
+// add_batch() calls (the GIL is released) never lose counts. SpaceSaving is split
+// into `shards` min-heaps indexed by a key->slot map, each behind its own mutex, so an
+// eviction is O(log k) instead of a scan and threads touching different shards don't
+// contend. Batches are bucketed by shard and take each shard lock once.
+class HeatSketchNative {
+ public:
+  static constexpr size_t kMaxDepth = 16;
+
+  HeatSketchNative(size_t width, size_t depth, size_t k, double decay_lambda, size_t shards, uint64_t seed)
+      : depth_(depth), decay_lambda_(decay_lambda), seed_(seed), last_decay_(std::chrono::steady_clock::now()) {
+    if (depth_ == 0 || depth_ > kMaxDepth) throw std::invalid_argument("depth must be in [1, 16]");
+    if (k == 0) throw std::invalid_argument("k must be positive");
+    width_ = 16;
+    while (width_ < width) width_ <<= 1;
+    if (width_ * depth_ > (size_t(1) << 28)) throw std::invalid_argument("width*depth too large");
+    mask_ = static_cast<uint32_t>(width_ - 1);
+    size_t bytes = width_ * depth_ * sizeof(uint32_t);
+    table_.reset(static_cast<uint32_t*>(std::aligned_alloc(64, bytes)));
+    if (!table_) throw std::bad_alloc();
+    std::fill(table_.get(), table_.get() + width_ * depth_, 0u);
+    size_t n = std::max<size_t>(1, std::min(shards, k));
+    shards_.reserve(n);
+    for (size_t i = 0; i < n; ++i) shards_.emplace_back(new Shard((k + n - 1) / n));
+#ifdef BODOCACHE_HEAT_X86
+    avx2_ = __builtin_cpu_supports("avx2");
+#endif
+  }
+
+  void add(int64_t layer, int64_t page_id, uint64_t count) {
+    const uint64_t h = hash(page_key(layer, page_id));
+    bump(h, count);
+    Shard& s = *shards_[shard_of(h)];
+    std::lock_guard<std::mutex> lk(s.mu);
+    s.offer(page_key(layer, page_id), count);
+  }
+
+  void add_batch(carray<int64_t> layer, carray<int64_t> page_id, py::object counts) {
+    const size_t n = static_cast<size_t>(layer.size());
+    if (static_cast<size_t>(page_id.size()) != n) throw std::invalid_argument("page_id must have the same length as layer");
+    carray<int64_t> counts_h;
+    const int64_t* c = nullptr;
+    if (!counts.is_none()) {
+      counts_h = counts.cast<carray<int64_t>>();
+      if (static_cast<size_t>(counts_h.size()) != n) throw std::invalid_argument("counts must have the same length as layer");
+      c = counts_h.data();
+    }
+    const int64_t* l = layer.data();
+    const int64_t* p = page_id.data();
+    py::gil_scoped_release nogil;
+    std::vector<uint64_t> keys(n), hashes(n);
+    for (size_t i = 0; i < n; ++i) {
+      keys[i] = page_key(l[i], p[i]);
+      hashes[i] = hash(keys[i]);
+      bump(hashes[i], c ? static_cast<uint64_t>(std::max<int64_t>(c[i], 0)) : 1);
+    }
+    // Bucket rows by shard so each shard lock is taken once per batch
+    const size_t ns = shards_.size();
+    std::vector<size_t> start(ns + 1, 0);
+    for (size_t i = 0; i < n; ++i) ++start[shard_of(hashes[i]) + 1];
+    for (size_t s = 0; s < ns; ++s) start[s + 1] += start[s];
+    std::vector<uint32_t> order(n);
+    {
+      std::vector<size_t> fill(start.begin(), start.end() - 1);
+      for (size_t i = 0; i < n; ++i) order[fill[shard_of(hashes[i])]++] = static_cast<uint32_t>(i);
+    }
+    for (size_t s = 0; s < ns; ++s) {
+      if (start[s] == start[s + 1]) continue;
+      Shard& sh = *shards_[s];
+      std::lock_guard<std::mutex> lk(sh.mu);
+      for (size_t j = start[s]; j < start[s + 1]; ++j) {
+        const uint32_t i = order[j];
+        sh.offer(keys[i], c ? static_cast<uint64_t>(std::max<int64_t>(c[i], 0)) : 1);
+      }
+    }
+  }
+
+  uint64_t estimate(int64_t layer, int64_t page_id) {
+    const uint64_t key = page_key(layer, page_id);
+    const uint64_t h = hash(key);
+    uint64_t est = query(h);
+    Shard& s = *shards_[shard_of(h)];
+    std::lock_guard<std::mutex> lk(s.mu);
+    auto it = s.pos.find(key);
+    if (it != s.pos.end()) est = std::min(est, s.heap[it->second].count);
+    return est;
+  }
+
+  py::array_t<uint64_t> estimate_batch(carray<int64_t> layer, carray<int64_t> page_id) {
+    const size_t n = static_cast<size_t>(layer.size());
+    if (static_cast<size_t>(page_id.size()) != n) throw std::invalid_argument("page_id must have the same length as layer");
+    py::array_t<uint64_t> out(static_cast<py::ssize_t>(n));
+    uint64_t* o = out.mutable_data();
+    const int64_t* l = layer.data();
+    const int64_t* p = page_id.data();
+    py::gil_scoped_release nogil;
+    for (size_t i = 0; i < n; ++i) {
+      const uint64_t key = page_key(l[i], p[i]);
+      const uint64_t h = hash(key);
+      o[i] = query(h);
+      Shard& s = *shards_[shard_of(h)];
+      std::lock_guard<std::mutex> lk(s.mu);
+      auto it = s.pos.find(key);
+      if (it != s.pos.end()) o[i] = std::min(o[i], s.heap[it->second].count);
+    }
+    return out;
+  }
+
+  // Decays every counter by exp(-decay_lambda * seconds since the last decay).
+  void decay() {
+    auto now = std::chrono::steady_clock::now();
+    double dt = std::chrono::duration<double>(now - last_decay_).count();
+    last_decay_ = now;
+    scale(std::exp(-decay_lambda_ * std::max(0.0, dt)));
+  }
+
+  void scale(double f) {
+    if (!(f >= 0.0)) throw std::invalid_argument("scale factor must be non-negative");
+    py::gil_scoped_release nogil;
+    for (size_t i = 0; i < width_ * depth_; ++i) {
+      uint32_t* slot = table_.get() + i;
+      uint32_t old = __atomic_load_n(slot, __ATOMIC_RELAXED);
+      while (old != 0 && !__atomic_compare_exchange_n(slot, &old, static_cast<uint32_t>(old * f), true,
+                                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      }
+    }
+    // Uniform scaling keeps each heap ordered
+    for (auto& s : shards_) {
+      std::lock_guard<std::mutex> lk(s->mu);
+      for (auto& e : s->heap) {
+        e.count = static_cast<uint64_t>(e.count * f);
+        e.err = static_cast<uint64_t>(e.err * f);
+      }
+    }
+  }
+
+  // Top-k pages as heat_df columns (layer, page_id, decay_hits, tenant_weight), hottest first.
+  py::dict export_heat() {
+    std::vector<Entry> all;
+    {
+      py::gil_scoped_release nogil;
+      for (auto& s : shards_) {
+        std::lock_guard<std::mutex> lk(s->mu);
+        for (const auto& e : s->heap) {
+          if (e.count) all.push_back(e);
+        }
+      }
+      std::sort(all.begin(), all.end(), [](const Entry& a, const Entry& b) {
+        return a.count != b.count ? a.count > b.count : a.key < b.key;
+      });
+    }
+    const py::ssize_t n = static_cast<py::ssize_t>(all.size());
+    py::array_t<int64_t> layer(n), page_id(n), hits(n);
+    py::array_t<double> weight(n);
+    int64_t* l = layer.mutable_data();
+    int64_t* p = page_id.mutable_data();
+    int64_t* h = hits.mutable_data();
+    double* w = weight.mutable_data();
+    for (py::ssize_t i = 0; i < n; ++i) {
+      l[i] = static_cast<int64_t>(all[i].key >> 48);
+      p[i] = static_cast<int64_t>(all[i].key & ((1ull << 48) - 1));
+      h[i] = static_cast<int64_t>(all[i].count);
+      w[i] = 1.0;
+    }
+    py::dict d;
+    d["layer"] = layer;
+    d["page_id"] = page_id;
+    d["decay_hits"] = hits;
+    d["tenant_weight"] = weight;
+    return d;
+  }
+
+  py::dict stats() {
+    size_t tracked = 0, capacity = 0;
+    for (auto& s : shards_) {
+      std::lock_guard<std::mutex> lk(s->mu);
+      tracked += s->heap.size();
+      capacity += s->cap;
+    }
+    py::dict d;
+    d["width"] = width_;
+    d["depth"] = depth_;
+    d["k"] = capacity;
+    d["shards"] = shards_.size();
+    d["tracked"] = tracked;
+    d["adds"] = adds_.load(std::memory_order_relaxed);
+    d["simd"] = avx2_ ? "avx2" : "scalar";
+    return d;
+  }
+
+ private:
+  struct Entry {
+    uint64_t key;
+    uint64_t count;
+    uint64_t err;
+  };
+
+  // One SpaceSaving summary: a min-heap on count with a key -> heap slot index.
+  struct Shard {
+    explicit Shard(size_t capacity) : cap(capacity) {
+      heap.reserve(cap);
+      pos.reserve(cap * 2);
+    }
+
+    void offer(uint64_t key, uint64_t c) {
+      auto it = pos.find(key);
+      if (it != pos.end()) {
+        heap[it->second].count += c;
+        sift_down(it->second);
+      } else if (heap.size() < cap) {
+        heap.push_back({key, c, 0});
+        pos[key] = static_cast<uint32_t>(heap.size() - 1);
+        sift_up(heap.size() - 1);
+      } else {
+        // Replace the minimum; its count becomes the newcomer's error bound
+        const Entry root = heap[0];
+        pos.erase(root.key);
+        heap[0] = {key, root.count + c, root.count};
+        pos[key] = 0;
+        sift_down(0);
+      }
+    }
+
+    void place(size_t i, const Entry& e) {
+      heap[i] = e;
+      pos[e.key] = static_cast<uint32_t>(i);
+    }
+
+    void sift_up(size_t i) {
+      Entry e = heap[i];
+      while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap[parent].count <= e.count) break;
+        place(i, heap[parent]);
+        i = parent;
+      }
+      place(i, e);
+    }
+
+    void sift_down(size_t i) {
+      Entry e = heap[i];
+      const size_t n = heap.size();
+      for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && heap[child + 1].count < heap[child].count) ++child;
+        if (heap[child].count >= e.count) break;
+        place(i, heap[child]);
+        i = child;
+      }
+      place(i, e);
+    }
+
+    alignas(64) std::mutex mu;
+    size_t cap;
+    std::vector<Entry> heap;
+    std::unordered_map<uint64_t, uint32_t> pos;
+  };
+
+  struct FreeDeleter {
+    void operator()(uint32_t* p) const { std::free(p); }
+  };
+
+  uint64_t hash(uint64_t key) const { return fmix64(key ^ seed_); }
+  size_t shard_of(uint64_t h) const { return static_cast<size_t>((h >> 40) % shards_.size()); }
+
+  // Flat table offsets of the depth_ counters for a key hash.
+  void slots(uint64_t h, uint32_t* out) const {
+    const uint32_t h1 = static_cast<uint32_t>(h);
+    const uint32_t h2 = static_cast<uint32_t>(h >> 32) | 1u;
+#ifdef BODOCACHE_HEAT_X86
+    if (avx2_) {
+      slots_avx2(h1, h2, out);
+      return;
+    }
+#endif
+    for (size_t r = 0; r < depth_; ++r) {
+      out[r] = static_cast<uint32_t>(r * width_) + ((h1 + static_cast<uint32_t>(r) * h2) & mask_);
+    }
+  }
+
+  void bump(uint64_t h, uint64_t count) {
+    uint32_t idx[kMaxDepth];
+    slots(h, idx);
+    const uint32_t c = static_cast<uint32_t>(std::min<uint64_t>(count, UINT32_MAX));
+    for (size_t r = 0; r < depth_; ++r) __atomic_fetch_add(table_.get() + idx[r], c, __ATOMIC_RELAXED);
+    adds_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint64_t query(uint64_t h) const {
+#ifdef BODOCACHE_HEAT_X86
+    if (avx2_) return query_avx2(static_cast<uint32_t>(h), static_cast<uint32_t>(h >> 32) | 1u);
+#endif
+    uint32_t idx[kMaxDepth];
+    slots(h, idx);
+    uint32_t m = UINT32_MAX;
+    for (size_t r = 0; r < depth_; ++r) m = std::min(m, __atomic_load_n(table_.get() + idx[r], __ATOMIC_RELAXED));
+    return m;
+  }
+
+#ifdef BODOCACHE_HEAT_X86
+  __attribute__((target("avx2"))) __m256i slot_vec(uint32_t h1, uint32_t h2, size_t r0) const {
+    const __m256i rows = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                          _mm256_set1_epi32(static_cast<int>(r0)));
+    __m256i idx = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(h1)),
+                                   _mm256_mullo_epi32(rows, _mm256_set1_epi32(static_cast<int>(h2))));
+    idx = _mm256_and_si256(idx, _mm256_set1_epi32(static_cast<int>(mask_)));
+    return _mm256_add_epi32(idx, _mm256_mullo_epi32(rows, _mm256_set1_epi32(static_cast<int>(width_))));
+  }
+
+  __attribute__((target("avx2"))) void slots_avx2(uint32_t h1, uint32_t h2, uint32_t* out) const {
+    alignas(32) uint32_t tmp[8];
+    for (size_t r0 = 0; r0 < depth_; r0 += 8) {
+      _mm256_store_si256(reinterpret_cast<__m256i*>(tmp), slot_vec(h1, h2, r0));
+      std::copy(tmp, tmp + std::min<size_t>(8, depth_ - r0), out + r0);
+    }
+  }
+
+  __attribute__((target("avx2"))) uint64_t query_avx2(uint32_t h1, uint32_t h2) const {
+    __m256i m = _mm256_set1_epi32(-1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (size_t r0 = 0; r0 < depth_; r0 += 8) {
+      const int live = static_cast<int>(std::min<size_t>(8, depth_ - r0));
+      const __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(live), lanes);
+      const __m256i v = _mm256_mask_i32gather_epi32(_mm256_set1_epi32(-1), reinterpret_cast<const int*>(table_.get()),
+                                                    slot_vec(h1, h2, r0), valid, 4);
+      m = _mm256_min_epu32(m, v);
+    }
+    __m128i x = _mm_min_epu32(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+    x = _mm_min_epu32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+    x = _mm_min_epu32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(x));
+  }
+#endif
+
+  size_t width_ = 0;
+  size_t depth_;
+  uint32_t mask_ = 0;
+  double decay_lambda_;
+  uint64_t seed_;
+  bool avx2_ = false;
+  std::chrono::steady_clock::time_point last_decay_;
+  std::unique_ptr<uint32_t, FreeDeleter> table_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<uint64_t> adds_{0};
+};
+
+PYBIND11_MODULE(bodocache_heat_sketch, m) {
+  py::class_<HeatSketchNative>(m, "HeatSketch")
+      .def(py::init<size_t, size_t, size_t, double, size_t, uint64_t>(), py::arg("width") = 4096, py::arg("depth") = 4,
+           py::arg("k") = 4096, py::arg("decay_lambda") = 0.01, py::arg("shards") = 8, py::arg("seed") = 1337)
+      .def("add", &HeatSketchNative::add, py::arg("layer"), py::arg("page_id"), py::arg("count") = 1)
+      .def("add_batch", &HeatSketchNative::add_batch, py::arg("layer"), py::arg("page_id"),
+           py::arg("counts") = py::none())
+      .def("estimate", &HeatSketchNative::estimate, py::arg("layer"), py::arg("page_id"))
+      .def("estimate_batch", &HeatSketchNative::estimate_batch, py::arg("layer"), py::arg("page_id"))
+      .def("decay", &HeatSketchNative::decay)
+      .def("scale", &HeatSketchNative::scale, py::arg("factor"))
+      .def("export_heat", &HeatSketchNative::export_heat)
+      .def("stats", &HeatSketchNative::stats);
+}
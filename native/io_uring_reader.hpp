@@ -0,0 +1,631 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+#include <pybind11/pytypes.h>
+#include <pybind11/functional.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <liburing.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace py = pybind11;
+
+// Writable view of out_buf. The returned buffer_info must outlive any use of the pointer.
+inline py::buffer_info writable_view(py::object out_buf, void** dst, size_t* nbytes) {
+  if (!PyObject_CheckBuffer(out_buf.ptr())) throw std::runtime_error("out_buf must support buffer protocol");
+  py::buffer buf = py::reinterpret_borrow<py::buffer>(out_buf);
+  py::buffer_info info = buf.request(true);
+  if (info.readonly) throw std::runtime_error("buffer must be writable");
+  *dst = info.ptr;
+  *nbytes = (size_t)info.size * (size_t)info.itemsize;
+  return info;
+}
+
+// Long-lived io_uring reader for segment files.
+//
+// A single ring is kept for the lifetime of the object and files stay open in a small
+// cache keyed by path (registered as fixed files when the kernel allows it). A read is
+// split into chunk_bytes pieces and up to queue_depth of them are kept in flight, so one
+// caller thread can keep several NVMe devices busy. Buffers registered with
+// register_buffers() are read with READ_FIXED, and with o_direct=True reads whose
+// offset, length and destination are aligned bypass the page cache. The GIL is released
+// while I/O is outstanding.
+class IoUringReader {
+ public:
+  // Member alias so this header can be included next to copy_engine_common.hpp.
+  template <typename T>
+  using carray = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+  IoUringReader(unsigned queue_depth, size_t chunk_bytes, size_t max_open_files, bool o_direct, size_t alignment)
+      : qd_(queue_depth ? queue_depth : 1),
+        chunk_(chunk_bytes ? chunk_bytes : (1u << 20)),
+        max_files_(max_open_files ? max_open_files : 1),
+        o_direct_(o_direct),
+        align_(alignment ? alignment : 4096) {
+    if (o_direct_ && (align_ & (align_ - 1)) != 0) throw std::invalid_argument("alignment must be a power of two");
+    int ret = io_uring_queue_init(qd_, &ring_, 0);
+    if (ret < 0) throw std::runtime_error("io_uring_queue_init failed: " + std::string(strerror(-ret)));
+    // Sparse fixed-file table; slots are filled as files are opened. Older kernels reject
+    // sparse registration, in which case plain fds are used.
+    file_table_.assign(max_files_, -1);
+    fixed_files_ = io_uring_register_files(&ring_, file_table_.data(), (unsigned)file_table_.size()) == 0;
+  }
+
+  ~IoUringReader() {
+    close_all();
+    io_uring_queue_exit(&ring_);
+  }
+
+  ssize_t read_range_into(const std::string& path, uint64_t offset, size_t size, py::object out_buf) {
+    if (size == 0) return 0;
+    void* dst = nullptr;
+    size_t nbytes = 0;
+    py::buffer_info view = writable_view(out_buf, &dst, &nbytes);
+    if (nbytes < size) throw std::runtime_error("out_buf too small");
+
+    py::gil_scoped_release nogil;
+    std::lock_guard<std::mutex> g(mu_);
+    std::vector<std::string> paths{path};
+    std::vector<char*> dsts{static_cast<char*>(dst)};
+    const uint64_t sizes[1] = {size};
+    std::vector<Range> ranges;
+    std::deque<Chunk> todo;
+    plan_batch(paths, &offset, sizes, dsts, ranges, todo);
+    run_batch(ranges, todo, [](size_t) {});
+    const int64_t res = ranges[0].result;
+    if (res < 0 && ranges[0].fd < 0) throw std::runtime_error("open failed: " + std::string(strerror(-res)));
+    if (res < 0) throw std::runtime_error("read failed: errno " + std::to_string(-res));
+    return static_cast<ssize_t>(res);
+  }
+
+  // Read many (path, offset, size) ranges into their own buffers with one shared ring
+  // pipeline. Returns an int64 array with bytes read per range or -errno on failure.
+  // callback(index, result), if given, runs as each range completes (in completion order).
+  py::array_t<int64_t> read_batch(std::vector<std::string> paths, carray<uint64_t> offsets, carray<uint64_t> sizes,
+                                  py::list out_bufs, py::object callback) {
+    const size_t n = paths.size();
+    if (static_cast<size_t>(offsets.size()) != n || static_cast<size_t>(sizes.size()) != n ||
+        static_cast<size_t>(py::len(out_bufs)) != n) {
+      throw std::invalid_argument("paths, offsets, sizes and out_bufs must have the same length");
+    }
+    const uint64_t* off = offsets.data();
+    const uint64_t* sz = sizes.data();
+    std::vector<py::buffer_info> views;
+    std::vector<char*> dsts(n);
+    views.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+      void* p = nullptr;
+      size_t nbytes = 0;
+      views.push_back(writable_view(out_bufs[i], &p, &nbytes));
+      if (nbytes < sz[i]) throw std::invalid_argument("out_bufs[" + std::to_string(i) + "] too small");
+      dsts[i] = static_cast<char*>(p);
+    }
+
+    py::array_t<int64_t> out(static_cast<py::ssize_t>(n));
+    int64_t* results = out.mutable_data();
+    const bool has_cb = !callback.is_none();
+    std::exception_ptr cb_error;
+    {
+      py::gil_scoped_release nogil;
+      std::lock_guard<std::mutex> g(mu_);
+      std::vector<Range> ranges;
+      std::deque<Chunk> todo;
+      plan_batch(paths, off, sz, dsts, ranges, todo);
+      auto on_done = [&](size_t i) {
+        results[i] = ranges[i].result;
+        if (!has_cb) return;
+        // Nobody takes mu_ while holding the GIL, so acquiring it here cannot deadlock.
+        py::gil_scoped_acquire gil;
+        if (cb_error) return;
+        try {
+          callback(py::int_(i), py::int_(ranges[i].result));
+        } catch (...) {
+          cb_error = std::current_exception();  // rethrown once the batch has drained
+        }
+      };
+      // Empty and unopenable ranges never enter the ring; report them up front.
+      for (size_t i = 0; i < n; ++i) {
+        if (ranges[i].pending == 0) on_done(i);
+      }
+      run_batch(ranges, todo, on_done);
+    }
+    if (cb_error) std::rethrow_exception(cb_error);
+    return out;
+  }
+
+  // Write (path, offset, size) ranges from host buffers (files are created if missing).
+  // Same pipeline as read_batch(); returns bytes written per range or -errno.
+  std::vector<int64_t> write_ranges(const std::vector<std::string>& paths, const uint64_t* offsets,
+                                    const uint64_t* sizes, const std::vector<const char*>& srcs) {
+    std::lock_guard<std::mutex> g(mu_);
+    std::vector<char*> bufs;
+    bufs.reserve(srcs.size());
+    for (const char* p : srcs) bufs.push_back(const_cast<char*>(p));  // only ever read from
+    std::vector<Range> ranges;
+    std::deque<Chunk> todo;
+    plan_batch(paths, offsets, sizes, bufs, ranges, todo, /*write=*/true);
+    run_batch(ranges, todo, [](size_t) {});
+    std::vector<int64_t> out(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) out[i] = ranges[i].result;
+    return out;
+  }
+
+  py::array_t<int64_t> write_batch(std::vector<std::string> paths, carray<uint64_t> offsets, carray<uint64_t> sizes,
+                                   py::list bufs) {
+    const size_t n = paths.size();
+    if (static_cast<size_t>(offsets.size()) != n || static_cast<size_t>(sizes.size()) != n ||
+        static_cast<size_t>(py::len(bufs)) != n) {
+      throw std::invalid_argument("paths, offsets, sizes and bufs must have the same length");
+    }
+    std::vector<py::buffer_info> views;
+    std::vector<const char*> srcs(n);
+    for (size_t i = 0; i < n; ++i) {
+      py::buffer buf = py::reinterpret_borrow<py::buffer>(bufs[i]);
+      views.push_back(buf.request());
+      if (static_cast<uint64_t>(views.back().size * views.back().itemsize) < sizes.data()[i]) {
+        throw std::invalid_argument("bufs[" + std::to_string(i) + "] too small");
+      }
+      srcs[i] = static_cast<const char*>(views.back().ptr);
+    }
+    std::vector<int64_t> res;
+    {
+      py::gil_scoped_release nogil;
+      res = write_ranges(paths, offsets.data(), sizes.data(), srcs);
+    }
+    py::array_t<int64_t> out(static_cast<py::ssize_t>(n));
+    std::copy(res.begin(), res.end(), out.mutable_data());
+    return out;
+  }
+
+  // Native streaming entry point for the copy engine; takes no Python objects, so the
+  // caller need not hold the GIL. Ranges are cut into pieces of at most slot_bytes and read
+  // into the caller's staging slots, up to one piece per slot in flight. reuse(slot) runs
+  // before a slot is refilled (the caller waits there for the DMA still reading it) and
+  // on_chunk(range, range_offset, slot, len) as soon as a piece has landed. Returns bytes
+  // read per range, or -errno.
+  template <typename Reuse, typename OnChunk>
+  std::vector<int64_t> stream_ranges(const std::vector<std::string>& paths, const uint64_t* offsets,
+                                     const uint64_t* sizes, const std::vector<char*>& slots, size_t slot_bytes,
+                                     Reuse&& reuse, OnChunk&& on_chunk) {
+    struct Piece {
+      size_t range;
+      uint64_t range_off;
+      size_t len;
+      size_t done;
+      bool direct;
+    };
+    std::lock_guard<std::mutex> g(mu_);
+    const size_t n = paths.size();
+    std::vector<int64_t> results(n, 0);
+    std::vector<FileSlot*> files(n, nullptr);
+    const uint64_t epoch = clock_ + 1;
+    for (size_t i = 0; i < n; ++i) {
+      if (sizes[i] == 0) continue;
+      files[i] = file_for(paths[i], epoch);
+      if (!files[i]) results[i] = -errno;
+      ++stats_.reads;
+    }
+
+    std::vector<Piece> pieces(slots.size());
+    std::vector<size_t> free_slots;
+    for (size_t k = slots.size(); k-- > 0;) free_slots.push_back(k);
+    size_t cur = 0;        // next range to cut
+    uint64_t cur_off = 0;  // next offset within it
+    unsigned inflight = 0;
+
+    auto queue_piece = [&](size_t k) -> bool {
+      io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+      if (!sqe) return false;
+      const Piece& pc = pieces[k];
+      FileSlot* f = files[pc.range];
+      const int fd = pc.direct ? f->direct_fd : f->fd;
+      const int fixed = pc.direct ? f->direct_fixed : f->fixed;
+      const int buf_index = registered_index(slots[k], slot_bytes);
+      char* dst = slots[k] + pc.done;
+      const uint64_t off = offsets[pc.range] + pc.range_off + pc.done;
+      const unsigned len = static_cast<unsigned>(pc.len - pc.done);
+      if (buf_index >= 0) {
+        io_uring_prep_read_fixed(sqe, fixed >= 0 ? fixed : fd, dst, len, off, buf_index);
+        ++stats_.fixed_buffer_sqes;
+      } else {
+        io_uring_prep_read(sqe, fixed >= 0 ? fixed : fd, dst, len, off);
+      }
+      if (fixed >= 0) io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+      io_uring_sqe_set_data64(sqe, k);
+      ++stats_.sqes;
+      ++inflight;
+      return true;
+    };
+
+    for (;;) {
+      // Cut the next pieces into free slots.
+      while (!free_slots.empty() && inflight < qd_) {
+        while (cur < n && (results[cur] < 0 || cur_off >= sizes[cur])) {
+          ++cur;
+          cur_off = 0;
+        }
+        if (cur >= n) break;
+        const size_t k = free_slots.back();
+        reuse(k);
+        const size_t len = sizes[cur] - cur_off < slot_bytes ? sizes[cur] - cur_off : slot_bytes;
+        const bool direct = files[cur]->direct_fd >= 0 && aligned(offsets[cur] + cur_off, len, slots[k]);
+        pieces[k] = Piece{cur, cur_off, len, 0, direct};
+        if (!queue_piece(k)) break;
+        if (direct) ++stats_.direct_reads;
+        free_slots.pop_back();
+        cur_off += len;
+      }
+      if (inflight == 0) break;
+      int ret = io_uring_submit_and_wait(&ring_, 1);
+      if (ret < 0 && ret != -EINTR && ret != -EAGAIN) {
+        throw std::runtime_error("io_uring_submit failed: " + std::string(strerror(-ret)));
+      }
+
+      io_uring_cqe* cqe = nullptr;
+      while (inflight > 0 && io_uring_peek_cqe(&ring_, &cqe) == 0 && cqe) {
+        const size_t k = static_cast<size_t>(io_uring_cqe_get_data64(cqe));
+        const int res = cqe->res;
+        io_uring_cqe_seen(&ring_, cqe);
+        cqe = nullptr;
+        --inflight;
+        Piece& pc = pieces[k];
+        if (res == -EAGAIN || res == -EINTR) {
+          if (queue_piece(k)) continue;
+          results[pc.range] = -EAGAIN;
+        } else if (res < 0) {
+          results[pc.range] = res;
+        } else if (results[pc.range] >= 0) {
+          pc.done += static_cast<size_t>(res);
+          results[pc.range] += res;
+          stats_.bytes += static_cast<uint64_t>(res);
+          // Short read: resubmit the remainder unless at end of file.
+          if (res > 0 && pc.done < pc.len && !pc.direct && queue_piece(k)) continue;
+          if (pc.done > 0) on_chunk(pc.range, pc.range_off, k, pc.done);
+        }
+        free_slots.push_back(k);
+      }
+    }
+    return results;
+  }
+
+  // Native batch read for the copy engine's plan executor: read_batch() without Python
+  // objects. on_done(index, result) runs as each range completes, with bytes read or -errno.
+  template <typename OnDone>
+  void read_ranges(const std::vector<std::string>& paths, const uint64_t* offsets, const uint64_t* sizes,
+                   const std::vector<char*>& dsts, OnDone&& on_done) {
+    std::lock_guard<std::mutex> g(mu_);
+    std::vector<Range> ranges;
+    std::deque<Chunk> todo;
+    plan_batch(paths, offsets, sizes, dsts, ranges, todo);
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      if (ranges[i].pending == 0) on_done(i, ranges[i].result);
+    }
+    run_batch(ranges, todo, [&](size_t i) { on_done(i, ranges[i].result); });
+  }
+
+  // Register pinned buffers (e.g. from CopyEngine.acquire_host_buffer) for READ_FIXED.
+  // Replaces any previous registration; pass an empty list to unregister.
+  size_t register_buffers(py::list bufs) {
+    std::vector<iovec> iovs;
+    std::vector<py::buffer_info> views;
+    for (auto item : bufs) {
+      void* p = nullptr;
+      size_t n = 0;
+      views.push_back(writable_view(py::reinterpret_borrow<py::object>(item), &p, &n));
+      iovs.push_back(iovec{p, n});
+    }
+    py::gil_scoped_release nogil;
+    std::lock_guard<std::mutex> g(mu_);
+    if (!registered_.empty()) {
+      io_uring_unregister_buffers(&ring_);
+      registered_.clear();
+    }
+    if (iovs.empty()) return 0;
+    int ret = io_uring_register_buffers(&ring_, iovs.data(), (unsigned)iovs.size());
+    if (ret < 0) throw std::runtime_error("io_uring_register_buffers failed: " + std::string(strerror(-ret)));
+    registered_ = std::move(iovs);
+    return registered_.size();
+  }
+
+  // Close every cached file (e.g. after segments are rewritten).
+  void close_files() {
+    py::gil_scoped_release nogil;
+    std::lock_guard<std::mutex> g(mu_);
+    close_all();
+  }
+
+  py::dict stats() {
+    Stats s;
+    size_t open_files = 0, registered = 0;
+    {
+      py::gil_scoped_release nogil;
+      std::lock_guard<std::mutex> g(mu_);
+      s = stats_;
+      open_files = files_.size();
+      registered = registered_.size();
+    }
+    py::dict d;
+    d["reads"] = py::int_(s.reads);
+    d["writes"] = py::int_(s.writes);
+    d["bytes"] = py::int_(s.bytes);
+    d["sqes"] = py::int_(s.sqes);
+    d["fixed_buffer_sqes"] = py::int_(s.fixed_buffer_sqes);
+    d["direct_reads"] = py::int_(s.direct_reads);
+    d["fd_hits"] = py::int_(s.fd_hits);
+    d["fd_misses"] = py::int_(s.fd_misses);
+    d["open_files"] = py::int_(open_files);
+    d["registered_buffers"] = py::int_(registered);
+    d["fixed_files"] = py::bool_(fixed_files_);
+    d["queue_depth"] = py::int_(qd_);
+    return d;
+  }
+
+ private:
+  struct FileSlot {
+    int fd{-1};
+    int direct_fd{-1};
+    int fixed{-1};         // slot in the registered file table for fd, -1 if none
+    int direct_fixed{-1};  // slot for direct_fd
+    int write_fd{-1};      // opened on first write_ranges() to the file
+    int write_fixed{-1};
+    uint64_t last_use{0};
+  };
+
+  struct Chunk {
+    char* dst;
+    uint64_t offset;
+    size_t len;
+    size_t range;  // index into the batch
+  };
+
+  struct Stats {
+    uint64_t reads{0}, writes{0}, bytes{0}, sqes{0}, fixed_buffer_sqes{0}, direct_reads{0}, fd_hits{0}, fd_misses{0};
+  };
+
+  bool aligned(uint64_t offset, size_t size, const void* dst) const {
+    const uint64_t mask = align_ - 1;
+    return (offset & mask) == 0 && (size & mask) == 0 && (reinterpret_cast<uintptr_t>(dst) & mask) == 0;
+  }
+
+  int take_fixed_slot(int fd) {
+    if (!fixed_files_ || fd < 0) return -1;
+    for (size_t i = 0; i < file_table_.size(); ++i) {
+      if (file_table_[i] != -1) continue;
+      if (io_uring_register_files_update(&ring_, (unsigned)i, &fd, 1) < 0) return -1;
+      file_table_[i] = fd;
+      return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  void drop_fixed_slot(int slot) {
+    if (slot < 0) return;
+    int none = -1;
+    io_uring_register_files_update(&ring_, (unsigned)slot, &none, 1);
+    file_table_[slot] = -1;
+  }
+
+  void close_slot(FileSlot& s) {
+    drop_fixed_slot(s.fixed);
+    drop_fixed_slot(s.direct_fixed);
+    drop_fixed_slot(s.write_fixed);
+    if (s.fd >= 0) ::close(s.fd);
+    if (s.direct_fd >= 0) ::close(s.direct_fd);
+    if (s.write_fd >= 0) ::close(s.write_fd);
+  }
+
+  void close_all() {
+    for (auto& kv : files_) close_slot(kv.second);
+    files_.clear();
+  }
+
+  // Cached file for path, opening it on a miss; nullptr (errno set) if open fails. Files
+  // used at or after pin_epoch belong to the current batch and are never evicted.
+  FileSlot* file_for(const std::string& path, uint64_t pin_epoch, bool create = false) {
+    auto it = files_.find(path);
+    if (it != files_.end()) {
+      ++stats_.fd_hits;
+      it->second.last_use = ++clock_;
+      return &it->second;
+    }
+    ++stats_.fd_misses;
+    // Evict the least recently used file (each may hold three fixed slots). A batch that
+    // touches more files than the cache holds temporarily overflows it instead.
+    while (files_.size() * 3 >= max_files_ && !files_.empty()) {
+      auto lru = files_.begin();
+      for (auto j = files_.begin(); j != files_.end(); ++j) {
+        if (j->second.last_use < lru->second.last_use) lru = j;
+      }
+      if (lru->second.last_use >= pin_epoch) break;
+      close_slot(lru->second);
+      files_.erase(lru);
+    }
+    FileSlot s;
+    s.fd = create ? ::open(path.c_str(), O_RDONLY | O_CREAT, 0644) : ::open(path.c_str(), O_RDONLY);
+    if (s.fd < 0) return nullptr;
+    if (o_direct_) {
+      // Filesystems without O_DIRECT support (tmpfs) simply use the buffered fd.
+      s.direct_fd = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+    }
+    s.fixed = take_fixed_slot(s.fd);
+    s.direct_fixed = take_fixed_slot(s.direct_fd);
+    s.last_use = ++clock_;
+    return &files_.emplace(path, s).first->second;
+  }
+
+  int registered_index(const char* p, size_t len) const {
+    for (size_t i = 0; i < registered_.size(); ++i) {
+      const char* base = static_cast<const char*>(registered_[i].iov_base);
+      if (p >= base && p + len <= base + registered_[i].iov_len) return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  // One range of a batch, resolved to an fd and buffer slot.
+  struct Range {
+    int fd{-1};
+    int fixed{-1};
+    int buf_index{-1};
+    bool direct{false};
+    bool write{false};
+    size_t pending{0};  // chunks not yet completed
+    int64_t result{0};  // bytes transferred, or -errno
+  };
+
+  // Run every range through the ring together, keeping up to qd_ chunks in flight across
+  // all of them. on_done(i) fires as soon as range i has no outstanding chunks.
+  template <typename OnDone>
+  void run_batch(std::vector<Range>& ranges, std::deque<Chunk>& todo, OnDone&& on_done) {
+    std::deque<Chunk> slots;  // stable addresses for in-flight user_data
+    unsigned inflight = 0;
+    auto finish_chunk = [&](size_t idx) {
+      if (--ranges[idx].pending == 0) {
+        if (ranges[idx].result > 0) stats_.bytes += static_cast<uint64_t>(ranges[idx].result);
+        on_done(idx);
+      }
+    };
+
+    while (inflight > 0 || !todo.empty()) {
+      // Fill the submission queue up to the configured depth.
+      unsigned queued = 0;
+      while (!todo.empty() && inflight < qd_) {
+        Chunk next = todo.front();
+        Range& r = ranges[next.range];
+        if (r.result < 0) {  // range already failed; drop the rest of it
+          todo.pop_front();
+          finish_chunk(next.range);
+          continue;
+        }
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+        if (!sqe) break;
+        todo.pop_front();
+        slots.push_back(next);
+        Chunk* c = &slots.back();
+        const int target = r.fixed >= 0 ? r.fixed : r.fd;
+        if (r.write && r.buf_index >= 0) {
+          io_uring_prep_write_fixed(sqe, target, c->dst, (unsigned)c->len, c->offset, r.buf_index);
+          ++stats_.fixed_buffer_sqes;
+        } else if (r.write) {
+          io_uring_prep_write(sqe, target, c->dst, (unsigned)c->len, c->offset);
+        } else if (r.buf_index >= 0) {
+          io_uring_prep_read_fixed(sqe, target, c->dst, (unsigned)c->len, c->offset, r.buf_index);
+          ++stats_.fixed_buffer_sqes;
+        } else {
+          io_uring_prep_read(sqe, target, c->dst, (unsigned)c->len, c->offset);
+        }
+        if (r.fixed >= 0) io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+        io_uring_sqe_set_data(sqe, c);
+        ++inflight;
+        ++queued;
+      }
+      if (inflight == 0) continue;
+      stats_.sqes += queued;
+      int ret = io_uring_submit_and_wait(&ring_, 1);
+      if (ret < 0 && ret != -EINTR && ret != -EAGAIN) {
+        throw std::runtime_error("io_uring_submit failed: " + std::string(strerror(-ret)));
+      }
+
+      // Reap everything that is ready.
+      io_uring_cqe* cqe = nullptr;
+      while (inflight > 0 && io_uring_peek_cqe(&ring_, &cqe) == 0 && cqe) {
+        Chunk* c = static_cast<Chunk*>(io_uring_cqe_get_data(cqe));
+        const int res = cqe->res;
+        io_uring_cqe_seen(&ring_, cqe);
+        cqe = nullptr;
+        --inflight;
+        Range& r = ranges[c->range];
+        if (res == -EAGAIN || res == -EINTR) {
+          todo.push_front(*c);
+          continue;
+        }
+        if (res < 0) {
+          r.result = res;
+        } else if (res == 0 && r.write) {
+          r.result = -EIO;  // a write that makes no progress will not make any later
+        } else if (r.result >= 0) {
+          r.result += res;
+          // Short read: resubmit the remainder unless at end of file (O_DIRECT only
+          // comes up short there, and an unaligned retry would fail anyway).
+          if (res > 0 && static_cast<size_t>(res) < c->len && !r.direct) {
+            todo.push_front(Chunk{c->dst + res, c->offset + res, c->len - res, c->range});
+            continue;
+          }
+        }
+        finish_chunk(c->range);
+      }
+    }
+  }
+
+  // Resolve ranges and split them into chunks. Files opened for this batch are pinned in
+  // the cache until it finishes.
+  void plan_batch(const std::vector<std::string>& paths, const uint64_t* offsets, const uint64_t* sizes,
+                  const std::vector<char*>& dsts, std::vector<Range>& ranges, std::deque<Chunk>& todo,
+                  bool write = false) {
+    const uint64_t epoch = clock_ + 1;
+    ranges.resize(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+      Range& r = ranges[i];
+      if (sizes[i] == 0) continue;
+      FileSlot* f = file_for(paths[i], epoch, write);
+      if (!f) {
+        r.result = -errno;
+        continue;
+      }
+      r.buf_index = registered_index(dsts[i], sizes[i]);
+      if (write) {
+        if (f->write_fd < 0) {
+          f->write_fd = ::open(paths[i].c_str(), O_WRONLY | O_CREAT, 0644);
+          if (f->write_fd < 0) {
+            r.result = -errno;
+            continue;
+          }
+          f->write_fixed = take_fixed_slot(f->write_fd);
+        }
+        r.write = true;
+        r.fd = f->write_fd;
+        r.fixed = f->write_fixed;
+        ++stats_.writes;
+      } else {
+        r.direct = f->direct_fd >= 0 && aligned(offsets[i], sizes[i], dsts[i]);
+        r.fd = r.direct ? f->direct_fd : f->fd;
+        r.fixed = r.direct ? f->direct_fixed : f->fixed;
+        ++stats_.reads;
+        if (r.direct) ++stats_.direct_reads;
+      }
+      for (uint64_t done = 0; done < sizes[i]; done += chunk_) {
+        size_t len = sizes[i] - done < chunk_ ? sizes[i] - done : chunk_;
+        todo.push_back(Chunk{dsts[i] + done, offsets[i] + done, len, i});
+        ++r.pending;
+      }
+    }
+  }
+
+  unsigned qd_;
+  size_t chunk_;
+  size_t max_files_;
+  bool o_direct_;
+  size_t align_;
+  io_uring ring_{};
+  bool fixed_files_{false};
+  std::vector<int> file_table_;
+  std::unordered_map<std::string, FileSlot> files_;
+  std::vector<iovec> registered_;
+  uint64_t clock_{0};
+  Stats stats_;
+  std::mutex mu_;
+};
@@ -0,0 +1,270 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BODOCACHE_MINHASH_X86 1
+#endif
+
+namespace py = pybind11;
+
+template <typename T>
+using carray = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+// MinHash signatures over token k-shingles and a persistent LSH band index.
+//
+// Hash definitions are shared bit for bit with bodocache/planner/minhash.py, which is
+// the NumPy fallback, so either path yields the same signatures and cluster ids:
+//   shingle   x = fold32(h), h = seed; h = fmix64(h ^ (token + kGolden)) per token
+//   perm i    a_i = lo32(fmix64(seed + 2i + 1)) | 1, b_i = lo32(fmix64(seed + 2i + 2))
+//   sig_i     = min over shingles of lo32(a_i * x + b_i)
+//   band b    h = fmix64(seed ^ (b << 32) ^ kBandSalt); h = fmix64(h ^ sig) per row
+// Sequences shorter than k form one shingle; empty sequences get an all-0xffffffff
+// signature, which the index never buckets.
+
+constexpr uint64_t kGolden = 0x9e3779b97f4a7c15ull;
+constexpr uint64_t kBandSalt = 0x51ed270b27a3c2d1ull;
+constexpr uint32_t kEmpty = 0xffffffffu;
+
+inline uint64_t fmix64(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdull;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ull;
+  k ^= k >> 33;
+  return k;
+}
+
+static void perm_coeffs(size_t num_hashes, uint64_t seed, std::vector<uint32_t>& a, std::vector<uint32_t>& b) {
+  a.resize(num_hashes);
+  b.resize(num_hashes);
+  for (size_t i = 0; i < num_hashes; ++i) {
+    a[i] = static_cast<uint32_t>(fmix64(seed + 2 * i + 1)) | 1u;
+    b[i] = static_cast<uint32_t>(fmix64(seed + 2 * i + 2));
+  }
+}
+
+static void shingle_hashes(const int64_t* toks, size_t len, size_t k, uint64_t seed, std::vector<uint32_t>& out) {
+  out.clear();
+  if (len == 0) return;
+  const size_t width = std::min(k, len);
+  const size_t count = len - width + 1;
+  out.reserve(count);
+  for (size_t s = 0; s < count; ++s) {
+    uint64_t h = seed;
+    for (size_t j = 0; j < width; ++j) h = fmix64(h ^ (static_cast<uint64_t>(toks[s + j]) + kGolden));
+    out.push_back(static_cast<uint32_t>(h ^ (h >> 32)));
+  }
+}
+
+static void min_scalar(const uint32_t* xs, size_t nx, const uint32_t* a, const uint32_t* b, size_t nh, uint32_t* sig) {
+  for (size_t i = 0; i < nh; ++i) sig[i] = kEmpty;
+  for (size_t s = 0; s < nx; ++s) {
+    const uint32_t x = xs[s];
+    for (size_t i = 0; i < nh; ++i) sig[i] = std::min(sig[i], a[i] * x + b[i]);
+  }
+}
+
+#ifdef BODOCACHE_MINHASH_X86
+// Eight permutations per vector: lo32(a*x + b) is exactly _mm256_mullo_epi32 + add.
+__attribute__((target("avx2"))) static void min_avx2(const uint32_t* xs, size_t nx, const uint32_t* a,
+                                                      const uint32_t* b, size_t nh, uint32_t* sig) {
+  size_t i = 0;
+  for (; i + 8 <= nh; i += 8) {
+    const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i m = _mm256_set1_epi32(-1);
+    for (size_t s = 0; s < nx; ++s) {
+      const __m256i vx = _mm256_set1_epi32(static_cast<int>(xs[s]));
+      m = _mm256_min_epu32(m, _mm256_add_epi32(_mm256_mullo_epi32(va, vx), vb));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sig + i), m);
+  }
+  if (i < nh) min_scalar(xs, nx, a + i, b + i, nh - i, sig + i);
+}
+#endif
+
+static bool have_avx2() {
+#ifdef BODOCACHE_MINHASH_X86
+  static const bool ok = __builtin_cpu_supports("avx2");
+  return ok;
+#else
+  return false;
+#endif
+}
+
+// tokens: all sequences concatenated; offsets: n+1 boundaries. Returns (n, num_hashes) uint32.
+static py::array_t<uint32_t> signatures(carray<int64_t> tokens, carray<int64_t> offsets, size_t num_hashes, size_t k,
+                                        uint64_t seed) {
+  if (num_hashes == 0) throw std::invalid_argument("num_hashes must be positive");
+  if (k == 0) throw std::invalid_argument("k must be positive");
+  if (offsets.size() < 1) throw std::invalid_argument("offsets must have n+1 entries");
+  const size_t n = static_cast<size_t>(offsets.size()) - 1;
+  const int64_t* off = offsets.data();
+  const int64_t* tok = tokens.data();
+  const int64_t total = static_cast<int64_t>(tokens.size());
+  for (size_t r = 0; r < n; ++r) {
+    if (off[r] < 0 || off[r + 1] < off[r] || off[r + 1] > total) throw std::invalid_argument("offsets out of range");
+  }
+  py::array_t<uint32_t> out({static_cast<py::ssize_t>(n), static_cast<py::ssize_t>(num_hashes)});
+  uint32_t* sig = out.mutable_data();
+  {
+    py::gil_scoped_release nogil;
+    std::vector<uint32_t> a, b, xs;
+    perm_coeffs(num_hashes, seed, a, b);
+    const bool avx2 = have_avx2();
+    for (size_t r = 0; r < n; ++r) {
+      shingle_hashes(tok + off[r], static_cast<size_t>(off[r + 1] - off[r]), k, seed, xs);
+      uint32_t* row = sig + r * num_hashes;
+#ifdef BODOCACHE_MINHASH_X86
+      if (avx2) {
+        min_avx2(xs.data(), xs.size(), a.data(), b.data(), num_hashes, row);
+        continue;
+      }
+#endif
+      (void)avx2;
+      min_scalar(xs.data(), xs.size(), a.data(), b.data(), num_hashes, row);
+    }
+  }
+  return out;
+}
+
+static uint64_t band_key(const uint32_t* sig, size_t band, size_t rows, uint64_t seed) {
+  uint64_t h = fmix64(seed ^ (static_cast<uint64_t>(band) << 32) ^ kBandSalt);
+  for (size_t j = 0; j < rows; ++j) h = fmix64(h ^ sig[band * rows + j]);
+  return h;
+}
+
+static void check_sigs(const carray<uint32_t>& sigs, size_t width) {
+  if (sigs.ndim() != 2 || static_cast<size_t>(sigs.shape(1)) != width) {
+    throw std::invalid_argument("signatures must have shape (n, bands*rows)");
+  }
+}
+
+// (n, bands) uint64 band keys of a signature matrix.
+static py::array_t<uint64_t> band_keys(carray<uint32_t> sigs, size_t bands, size_t rows, uint64_t seed) {
+  check_sigs(sigs, bands * rows);
+  const size_t n = static_cast<size_t>(sigs.shape(0));
+  py::array_t<uint64_t> out({static_cast<py::ssize_t>(n), static_cast<py::ssize_t>(bands)});
+  uint64_t* o = out.mutable_data();
+  const uint32_t* s = sigs.data();
+  py::gil_scoped_release nogil;
+  for (size_t r = 0; r < n; ++r) {
+    for (size_t bnd = 0; bnd < bands; ++bnd) o[r * bands + bnd] = band_key(s + r * bands * rows, bnd, rows, seed);
+  }
+  return out;
+}
+
+// Persistent LSH index: band key -> cluster, clusters merged with union-find so any
+// shared band puts rows (in this or earlier batches) in one cluster. Ids are issued
+// in first-seen order and a merge keeps the smaller id, so a cluster keeps its id
+// across windows unless it is merged into an older one.
+class LshIndex {
+ public:
+  LshIndex(size_t bands, size_t rows, uint64_t seed) : bands_(bands), rows_(rows), seed_(seed) {
+    if (bands_ == 0 || rows_ == 0) throw std::invalid_argument("bands and rows must be positive");
+  }
+
+  py::array_t<int64_t> assign(carray<uint32_t> sigs) {
+    check_sigs(sigs, bands_ * rows_);
+    const size_t n = static_cast<size_t>(sigs.shape(0));
+    py::array_t<int64_t> out(static_cast<py::ssize_t>(n));
+    int64_t* o = out.mutable_data();
+    const uint32_t* s = sigs.data();
+    py::gil_scoped_release nogil;
+    // Taken without the GIL: the threaded planner service assigns from several threads
+    std::lock_guard<std::mutex> g(mu_);
+    std::vector<uint64_t> keys(bands_);
+    for (size_t r = 0; r < n; ++r) {
+      const uint32_t* sig = s + r * bands_ * rows_;
+      if (std::all_of(sig, sig + bands_ * rows_, [](uint32_t v) { return v == kEmpty; })) {
+        o[r] = new_cluster();
+        continue;
+      }
+      int64_t root = -1;
+      for (size_t b = 0; b < bands_; ++b) {
+        keys[b] = band_key(sig, b, rows_, seed_);
+        auto it = buckets_.find(keys[b]);
+        if (it == buckets_.end()) continue;
+        int64_t c = find(it->second);
+        root = root < 0 ? c : unite(root, c);
+      }
+      if (root < 0) root = new_cluster();
+      for (size_t b = 0; b < bands_; ++b) buckets_.emplace(keys[b], root);
+      o[r] = root;
+    }
+    // Later rows may have merged clusters handed out earlier in the batch
+    for (size_t r = 0; r < n; ++r) o[r] = find(o[r]);
+    return out;
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> g(mu_);
+    buckets_.clear();
+    parent_.clear();
+  }
+
+  py::dict stats() const {
+    size_t buckets, clusters;
+    {
+      std::lock_guard<std::mutex> g(mu_);
+      buckets = buckets_.size();
+      clusters = parent_.size();
+    }
+    py::dict d;
+    d["bands"] = bands_;
+    d["rows"] = rows_;
+    d["buckets"] = buckets;
+    d["clusters"] = clusters;
+    d["simd"] = have_avx2() ? "avx2" : "scalar";
+    return d;
+  }
+
+ private:
+  int64_t new_cluster() {
+    parent_.push_back(static_cast<int64_t>(parent_.size()));
+    return parent_.back();
+  }
+
+  int64_t find(int64_t c) {
+    while (parent_[c] != c) {
+      parent_[c] = parent_[parent_[c]];
+      c = parent_[c];
+    }
+    return c;
+  }
+
+  int64_t unite(int64_t a, int64_t b) {
+    a = find(a);
+    b = find(b);
+    if (a == b) return a;
+    if (b < a) std::swap(a, b);
+    parent_[b] = a;
+    return a;
+  }
+
+  size_t bands_, rows_;
+  uint64_t seed_;
+  std::unordered_map<uint64_t, int64_t> buckets_;
+  std::vector<int64_t> parent_;
+  mutable std::mutex mu_;  // guards buckets_ and parent_ (find() compresses paths)
+};
+
+PYBIND11_MODULE(bodocache_minhash, m) {
+  m.def("signatures", &signatures, py::arg("tokens"), py::arg("offsets"), py::arg("num_hashes") = 32,
+        py::arg("k") = 5, py::arg("seed") = 0);
+  m.def("band_keys", &band_keys, py::arg("signatures"), py::arg("bands"), py::arg("rows"), py::arg("seed") = 0);
+  py::class_<LshIndex>(m, "LshIndex")
+      .def(py::init<size_t, size_t, uint64_t>(), py::arg("bands") = 8, py::arg("rows") = 4, py::arg("seed") = 0)
+      .def("assign", &LshIndex::assign, py::arg("signatures"))
+      .def("clear", &LshIndex::clear)
+      .def("stats", &LshIndex::stats);
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Fixed-ratio KV page encodings decoded on the device right after their H2D copy.
+//
+// A decoded page is an array of 16-bit KV elements (fp16, or bf16 with kCodecBf16).
+// Encoded data is a sequence of groups of kCodecGroup elements, each stored as
+//   [float32 scale][payload]
+// with payload kCodecGroup e4m3 bytes (kCodecFp8) or kCodecGroup/2 bytes of 4-bit
+// values q + 8, q in [-7, 7], low nibble first (kCodecInt4). The element is
+// payload_value * scale, rounded to the output type (round to nearest even).
+// Groups never straddle pages (page_bytes is a multiple of kCodecGroup * 2), so a run of
+// pages is a run of groups and its encoded size is a fixed function of its decoded size.
+// bodocache/adapters/page_codec.py is the NumPy encoder/decoder of the same format.
+
+#if defined(__CUDACC__) || defined(__HIPCC__)
+#define BODOCACHE_HD __host__ __device__
+#else
+#define BODOCACHE_HD
+#endif
+
+enum PageCodec : int32_t { kCodecNone = 0, kCodecFp8 = 1, kCodecInt4 = 2 };
+// OR'd into a codec: decode to bf16 instead of fp16
+constexpr int32_t kCodecBf16 = 0x100;
+constexpr size_t kCodecGroup = 128;
+
+inline int32_t codec_kind(int32_t codec) { return codec & 0xff; }
+
+inline bool codec_valid(int32_t codec) {
+  const int32_t kind = codec_kind(codec);
+  return (codec & ~(0xff | kCodecBf16)) == 0 && (kind == kCodecFp8 || kind == kCodecInt4);
+}
+
+// Encoded bytes of one group, or 0 for an unknown codec.
+inline size_t codec_group_bytes(int32_t codec) {
+  switch (codec_kind(codec)) {
+    case kCodecFp8: return 4 + kCodecGroup;
+    case kCodecInt4: return 4 + kCodecGroup / 2;
+    default: return 0;
+  }
+}
+
+// Encoded size of decoded_bytes of KV data, or 0 when it is not a whole number of groups.
+inline size_t codec_encoded_bytes(int32_t codec, size_t decoded_bytes) {
+  const size_t group_bytes = kCodecGroup * sizeof(uint16_t);
+  if (decoded_bytes % group_bytes) return 0;
+  return decoded_bytes / group_bytes * codec_group_bytes(codec);
+}
+
+BODOCACHE_HD inline float e4m3_to_float(uint8_t c) {
+  const uint32_t e = (c >> 3) & 15u, m = c & 7u;
+  // Subnormals are m * 2^-9; normals (1 + m/8) * 2^(e-7), built from the exponent bits
+  float v = static_cast<float>(m) * (1.0f / 512.0f);
+  if (e != 0) {
+    const uint32_t bits = ((e + 120u) << 23) | (m << 20);
+    memcpy(&v, &bits, sizeof(v));
+  }
+  return (c & 0x80u) ? -v : v;
+}
+
+BODOCACHE_HD inline uint16_t float_to_half_bits(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  const uint32_t sign = (x >> 16) & 0x8000u;
+  x &= 0x7fffffffu;
+  if (x >= 0x7f800000u) return static_cast<uint16_t>(sign | 0x7c00u | (x > 0x7f800000u ? 0x200u : 0u));
+  if (x >= 0x477ff000u) return static_cast<uint16_t>(sign | 0x7c00u);  // rounds past 65504
+  if (x < 0x38800000u) {
+    // Half subnormal: m * 2^-24
+    if (x < 0x33000000u) return static_cast<uint16_t>(sign);
+    const uint32_t shift = 126u - (x >> 23);
+    const uint32_t mant = (x & 0x7fffffu) | 0x800000u;
+    uint32_t q = mant >> shift;
+    const uint32_t rem = mant & ((1u << shift) - 1u), half = 1u << (shift - 1u);
+    if (rem > half || (rem == half && (q & 1u))) ++q;
+    return static_cast<uint16_t>(sign | q);
+  }
+  uint32_t r = x - 0x38000000u;  // rebias the exponent from 127 to 15
+  r += 0xfffu + ((r >> 13) & 1u);
+  return static_cast<uint16_t>(sign | (r >> 13));
+}
+
+BODOCACHE_HD inline uint16_t float_to_bf16_bits(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  if ((x & 0x7fffffffu) > 0x7f800000u) return static_cast<uint16_t>((x >> 16) | 0x40u);
+  x += 0x7fffu + ((x >> 16) & 1u);
+  return static_cast<uint16_t>(x >> 16);
+}
+
+// Element i of an encoded run.
+BODOCACHE_HD inline uint16_t codec_decode_element(int32_t codec, const uint8_t* src, size_t i) {
+  const size_t g = i / kCodecGroup, j = i % kCodecGroup;
+  const bool fp8 = (codec & 0xff) == kCodecFp8;
+  const uint8_t* rec = src + g * (fp8 ? 4 + kCodecGroup : 4 + kCodecGroup / 2);
+  float scale;
+  memcpy(&scale, rec, sizeof(scale));
+  float v;
+  if (fp8) {
+    v = e4m3_to_float(rec[4 + j]);
+  } else {
+    const uint8_t b = rec[4 + j / 2];
+    v = static_cast<float>(static_cast<int>((j & 1) ? (b >> 4) : (b & 15u)) - 8);
+  }
+  v *= scale;
+  return (codec & kCodecBf16) ? float_to_bf16_bits(v) : float_to_half_bits(v);
+}
+
+// Host reference of the device decode (tests, CPU fallbacks).
+inline void codec_decode_host(int32_t codec, const void* src, void* dst, size_t decoded_bytes) {
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+  uint16_t* d = static_cast<uint16_t*>(dst);
+  const size_t n = decoded_bytes / sizeof(uint16_t);
+  for (size_t i = 0; i < n; ++i) d[i] = codec_decode_element(codec, s, i);
+}
+
+#if defined(__CUDACC__) || defined(__HIPCC__)
+// One thread per output element; a group's scale is read by its 128 threads from cache.
+__global__ void codec_decode_kernel(int32_t codec, const uint8_t* src, uint16_t* dst, size_t n) {
+  const size_t i = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+  if (i < n) dst[i] = codec_decode_element(codec, src, i);
+}
+
+// Decode decoded_bytes of output from src (device memory) into dst on stream s.
+template <typename Stream>
+inline void codec_decode_async(int32_t codec, const void* src, void* dst, size_t decoded_bytes, Stream s) {
+  const size_t n = decoded_bytes / sizeof(uint16_t);
+  if (n == 0) return;
+  constexpr unsigned kThreads = 256;
+  const unsigned blocks = static_cast<unsigned>((n + kThreads - 1) / kThreads);
+  codec_decode_kernel<<<blocks, kThreads, 0, s>>>(codec, static_cast<const uint8_t*>(src),
+                                                  static_cast<uint16_t*>(dst), n);
+}
+#endif
@@ -0,0 +1,404 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace py = pybind11;
+
+template <typename T>
+using carray = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+// Packed page keys: model:16 | layer:16 | page_id:32. `model` is a small code the
+// Python wrapper interns per (model_id, model_version, dtype, n_kv_heads, d_head);
+// the all-ones key is reserved as the empty slot marker.
+constexpr uint64_t kEmptyKey = ~0ull;
+constexpr int64_t kMaxModel = 0xfffe;
+constexpr int64_t kMaxLayer = 0xffff;
+constexpr int64_t kMaxPage = 0xffffffffll;
+constexpr int64_t kMaxNode = 0xfffffe;  // node codes are 24-bit; 0xffffff means "no node"
+constexpr uint32_t kNoNode = 0xffffff;
+
+inline uint64_t fmix64(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdull;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ull;
+  k ^= k >> 33;
+  return k;
+}
+
+inline uint64_t pack_key(int64_t model, int64_t layer, int64_t page_id) {
+  if (model < 0 || model > kMaxModel) throw std::invalid_argument("model code out of range [0, 65534]");
+  if (layer < 0 || layer > kMaxLayer) throw std::invalid_argument("layer out of range [0, 65535]");
+  if (page_id < 0 || page_id > kMaxPage) throw std::invalid_argument("page_id out of range [0, 2^32)");
+  return (static_cast<uint64_t>(model) << 48) | (static_cast<uint64_t>(layer) << 32) | static_cast<uint64_t>(page_id);
+}
+
+// 8-byte location record; tier is the models.Tier value, -1 gpu means none.
+struct Record {
+  int8_t tier;
+  int8_t pad;
+  int16_t gpu;
+  uint32_t node;  // 24-bit node code, kNoNode if unset
+};
+static_assert(sizeof(Record) == 8, "Record must stay 8 bytes");
+
+// Dense residency bitmap over page ids of one (model, layer, tier, node).
+struct Bitmap {
+  std::vector<uint64_t> words;
+  size_t count = 0;
+
+  void set(uint32_t p) {
+    const size_t w = p >> 6;
+    if (w >= words.size()) words.resize(std::max(w + 1, words.size() * 2), 0);
+    const uint64_t bit = 1ull << (p & 63);
+    if (!(words[w] & bit)) {
+      words[w] |= bit;
+      ++count;
+    }
+  }
+
+  void clear(uint32_t p) {
+    const size_t w = p >> 6;
+    if (w >= words.size()) return;
+    const uint64_t bit = 1ull << (p & 63);
+    if (words[w] & bit) {
+      words[w] &= ~bit;
+      --count;
+    }
+  }
+};
+
+// First set (or, with invert, clear) bit at or after p; words.size()*64 if none.
+static size_t next_bit(const std::vector<uint64_t>& words, size_t p, bool invert) {
+  const size_t nw = words.size();
+  size_t i = p >> 6;
+  if (i >= nw) return nw * 64;
+  uint64_t w = (invert ? ~words[i] : words[i]) & (~0ull << (p & 63));
+  while (w == 0) {
+    if (++i == nw) return nw * 64;
+    w = invert ? ~words[i] : words[i];
+  }
+  return i * 64 + static_cast<size_t>(__builtin_ctzll(w));
+}
+
+static void append_runs(const std::vector<uint64_t>& words, int64_t layer, std::vector<int64_t>& out_layer,
+                        std::vector<int64_t>& out_start, std::vector<int64_t>& out_end) {
+  const size_t limit = words.size() * 64;
+  size_t p = next_bit(words, 0, false);
+  while (p < limit) {
+    const size_t q = next_bit(words, p, true);
+    out_layer.push_back(layer);
+    out_start.push_back(static_cast<int64_t>(p));
+    out_end.push_back(static_cast<int64_t>(q) - 1);
+    p = next_bit(words, q, false);
+  }
+}
+
+template <typename T>
+static py::array_t<T> to_array(const std::vector<T>& v) {
+  py::array_t<T> out(static_cast<py::ssize_t>(v.size()));
+  if (!v.empty()) std::copy(v.begin(), v.end(), out.mutable_data());
+  return out;
+}
+
+// Compact page table: open addressing (linear probing, backward-shift deletion) over
+// packed keys with 8-byte records, i.e. 16 bytes per slot at <= 0.7 load instead of a
+// Python string key plus a dataclass per page. Next to the hash, a residency bitmap per
+// (model, layer, tier, node) answers "contiguous runs resident in tier X" by scanning
+// words with ctz, without touching the hash. Batch calls release the GIL and take a
+// shared (reads) or exclusive (writes) lock, so lookups from several threads overlap.
+class PageTableNative {
+ public:
+  explicit PageTableNative(size_t capacity) {
+    size_t cap = 16;
+    while (cap * 7 < capacity * 10) cap <<= 1;
+    keys_.assign(cap, kEmptyKey);
+    vals_.resize(cap);
+    mask_ = cap - 1;
+  }
+
+  void bulk_set(carray<uint64_t> keys, carray<int64_t> tier, carray<int64_t> node, carray<int64_t> gpu) {
+    const size_t n = static_cast<size_t>(keys.size());
+    if (static_cast<size_t>(tier.size()) != n || static_cast<size_t>(node.size()) != n ||
+        static_cast<size_t>(gpu.size()) != n) {
+      throw std::invalid_argument("keys, tier, node and gpu must have the same length");
+    }
+    const uint64_t* k = keys.data();
+    const int64_t* t = tier.data();
+    const int64_t* nd = node.data();
+    const int64_t* g = gpu.data();
+    for (size_t i = 0; i < n; ++i) {
+      if (k[i] == kEmptyKey) throw std::invalid_argument("reserved page key");
+      if (t[i] < 0 || t[i] > 127) throw std::invalid_argument("tier out of range [0, 127]");
+      if (nd[i] < -1 || nd[i] > kMaxNode) throw std::invalid_argument("node code out of range");
+      if (g[i] < -1 || g[i] > 32767) throw std::invalid_argument("gpu id out of range");
+    }
+    py::gil_scoped_release nogil;
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    for (size_t i = 0; i < n; ++i) {
+      Record r;
+      r.tier = static_cast<int8_t>(t[i]);
+      r.pad = 0;
+      r.gpu = static_cast<int16_t>(g[i]);
+      r.node = nd[i] < 0 ? kNoNode : static_cast<uint32_t>(nd[i]);
+      upsert(k[i], r);
+    }
+  }
+
+  // Returns (tier, node, gpu) int64 arrays; missing keys have tier -1, node/gpu -1.
+  py::tuple bulk_get(carray<uint64_t> keys) const {
+    const size_t n = static_cast<size_t>(keys.size());
+    py::array_t<int64_t> tier(static_cast<py::ssize_t>(n)), node(static_cast<py::ssize_t>(n)),
+        gpu(static_cast<py::ssize_t>(n));
+    const uint64_t* k = keys.data();
+    int64_t* t = tier.mutable_data();
+    int64_t* nd = node.mutable_data();
+    int64_t* g = gpu.mutable_data();
+    {
+      py::gil_scoped_release nogil;
+      std::shared_lock<std::shared_mutex> lk(mu_);
+      constexpr size_t kAhead = 8;
+      for (size_t i = 0; i < n; ++i) {
+        // Probes are random access; warm the home slot a few keys ahead
+        if (i + kAhead < n) {
+          const size_t h = home(k[i + kAhead]);
+          __builtin_prefetch(&keys_[h]);
+          __builtin_prefetch(&vals_[h]);
+        }
+        const size_t s = find(k[i]);
+        if (s == kNotFound) {
+          t[i] = nd[i] = g[i] = -1;
+          continue;
+        }
+        const Record& r = vals_[s];
+        t[i] = r.tier;
+        nd[i] = r.node == kNoNode ? -1 : static_cast<int64_t>(r.node);
+        g[i] = r.gpu;
+      }
+    }
+    return py::make_tuple(tier, node, gpu);
+  }
+
+  // Removes keys; returns the number that were present.
+  size_t erase(carray<uint64_t> keys) {
+    const size_t n = static_cast<size_t>(keys.size());
+    const uint64_t* k = keys.data();
+    py::gil_scoped_release nogil;
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    size_t removed = 0;
+    for (size_t i = 0; i < n; ++i) removed += remove(k[i]) ? 1 : 0;
+    return removed;
+  }
+
+  // Maximal runs of consecutive page ids of `model` resident in `tier` (on `node`, or
+  // any node when -1) for each of `layers` (all layers when empty). Returns a dict of
+  // int64 columns layer/start_pid/end_pid with inclusive bounds, sorted by layer then
+  // start.
+  py::dict runs(int64_t model, carray<int64_t> layers, int64_t tier, int64_t node) const {
+    if (model < 0 || model > kMaxModel) throw std::invalid_argument("model code out of range [0, 65534]");
+    if (tier < 0 || tier > 127) throw std::invalid_argument("tier out of range [0, 127]");
+    if (node < -1 || node > kMaxNode) throw std::invalid_argument("node code out of range");
+    std::vector<int64_t> want(layers.data(), layers.data() + layers.size());
+    std::vector<int64_t> out_layer, out_start, out_end;
+    {
+      py::gil_scoped_release nogil;
+      std::shared_lock<std::shared_mutex> lk(mu_);
+      if (want.empty()) {
+        for (const auto& kv : groups_) {
+          if ((kv.first >> 24) == static_cast<uint64_t>(model) && (kv.first & 0xff) == static_cast<uint64_t>(tier)) {
+            want.push_back(static_cast<int64_t>((kv.first >> 8) & 0xffff));
+          }
+        }
+      }
+      std::sort(want.begin(), want.end());
+      want.erase(std::unique(want.begin(), want.end()), want.end());
+      std::vector<uint64_t> merged;
+      for (int64_t layer : want) {
+        if (layer < 0 || layer > kMaxLayer) continue;
+        auto g = groups_.find(group_key(static_cast<uint64_t>(model), static_cast<uint64_t>(layer), tier));
+        if (g == groups_.end()) continue;
+        if (node >= 0) {
+          auto b = bitmaps_.find(bitmap_key(g->first, static_cast<uint32_t>(node)));
+          if (b != bitmaps_.end()) append_runs(b->second.words, layer, out_layer, out_start, out_end);
+          continue;
+        }
+        // Any node: OR the per-node bitmaps of this (model, layer, tier)
+        merged.clear();
+        for (uint32_t nd : g->second) {
+          const auto& words = bitmaps_.at(bitmap_key(g->first, nd)).words;
+          if (words.size() > merged.size()) merged.resize(words.size(), 0);
+          for (size_t w = 0; w < words.size(); ++w) merged[w] |= words[w];
+        }
+        append_runs(merged, layer, out_layer, out_start, out_end);
+      }
+    }
+    py::dict d;
+    d["layer"] = to_array(out_layer);
+    d["start_pid"] = to_array(out_start);
+    d["end_pid"] = to_array(out_end);
+    return d;
+  }
+
+  size_t size() const {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    return size_;
+  }
+
+  void clear() {
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    std::fill(keys_.begin(), keys_.end(), kEmptyKey);
+    size_ = 0;
+    bitmaps_.clear();
+    groups_.clear();
+  }
+
+  py::dict stats() const {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    size_t bitmap_bytes = 0;
+    for (const auto& kv : bitmaps_) bitmap_bytes += kv.second.words.capacity() * sizeof(uint64_t);
+    py::dict d;
+    d["size"] = size_;
+    d["capacity"] = keys_.size();
+    d["load"] = static_cast<double>(size_) / static_cast<double>(keys_.size());
+    d["table_bytes"] = keys_.size() * (sizeof(uint64_t) + sizeof(Record));
+    d["bitmap_bytes"] = bitmap_bytes;
+    d["bitmaps"] = bitmaps_.size();
+    return d;
+  }
+
+ private:
+  static constexpr size_t kNotFound = ~size_t(0);
+
+  size_t home(uint64_t key) const { return static_cast<size_t>(fmix64(key)) & mask_; }
+
+  size_t find(uint64_t key) const {
+    for (size_t s = home(key);; s = (s + 1) & mask_) {
+      if (keys_[s] == key) return s;
+      if (keys_[s] == kEmptyKey) return kNotFound;
+    }
+  }
+
+  // group: model:16 | layer:16 | tier:8; bitmap: group | node:24
+  static uint64_t group_key(uint64_t model, uint64_t layer, int64_t tier) {
+    return (model << 24) | (layer << 8) | static_cast<uint64_t>(tier & 0xff);
+  }
+  static uint64_t group_of(uint64_t key, int8_t tier) { return group_key(key >> 48, (key >> 32) & 0xffff, tier); }
+  static uint64_t bitmap_key(uint64_t group, uint32_t node) { return (group << 24) | node; }
+
+  void mark(uint64_t key, const Record& r) {
+    const uint64_t g = group_of(key, r.tier);
+    Bitmap& b = bitmaps_[bitmap_key(g, r.node)];
+    if (b.count == 0) groups_[g].push_back(r.node);
+    b.set(static_cast<uint32_t>(key));
+  }
+
+  void unmark(uint64_t key, const Record& r) {
+    const uint64_t g = group_of(key, r.tier);
+    auto it = bitmaps_.find(bitmap_key(g, r.node));
+    if (it == bitmaps_.end()) return;
+    it->second.clear(static_cast<uint32_t>(key));
+    if (it->second.count != 0) return;
+    bitmaps_.erase(it);
+    auto& nodes = groups_[g];
+    nodes.erase(std::remove(nodes.begin(), nodes.end(), r.node), nodes.end());
+    if (nodes.empty()) groups_.erase(g);
+  }
+
+  void upsert(uint64_t key, const Record& r) {
+    size_t s = find(key);
+    if (s != kNotFound) {
+      const Record old = vals_[s];
+      vals_[s] = r;
+      if (old.tier != r.tier || old.node != r.node) {
+        unmark(key, old);
+        mark(key, r);
+      }
+      return;
+    }
+    reserve(size_ + 1);
+    for (s = home(key); keys_[s] != kEmptyKey; s = (s + 1) & mask_) {
+    }
+    keys_[s] = key;
+    vals_[s] = r;
+    ++size_;
+    mark(key, r);
+  }
+
+  bool remove(uint64_t key) {
+    size_t i = find(key);
+    if (i == kNotFound) return false;
+    unmark(key, vals_[i]);
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    for (size_t j = (i + 1) & mask_; keys_[j] != kEmptyKey; j = (j + 1) & mask_) {
+      const size_t h = home(keys_[j]);
+      const bool movable = (j > i) ? (h <= i || h > j) : (h <= i && h > j);
+      if (movable) {
+        keys_[i] = keys_[j];
+        vals_[i] = vals_[j];
+        i = j;
+      }
+    }
+    keys_[i] = kEmptyKey;
+    --size_;
+    return true;
+  }
+
+  void reserve(size_t want) {
+    if (want * 10 <= keys_.size() * 7) return;
+    size_t cap = keys_.size();
+    while (want * 10 > cap * 7) cap <<= 1;
+    std::vector<uint64_t> old_keys(cap, kEmptyKey);
+    std::vector<Record> old_vals(cap);
+    old_keys.swap(keys_);
+    old_vals.swap(vals_);
+    mask_ = cap - 1;
+    for (size_t s = 0; s < old_keys.size(); ++s) {
+      if (old_keys[s] == kEmptyKey) continue;
+      size_t d = home(old_keys[s]);
+      while (keys_[d] != kEmptyKey) d = (d + 1) & mask_;
+      keys_[d] = old_keys[s];
+      vals_[d] = old_vals[s];
+    }
+  }
+
+  std::vector<uint64_t> keys_;
+  std::vector<Record> vals_;
+  size_t mask_ = 0;
+  size_t size_ = 0;
+  std::unordered_map<uint64_t, Bitmap> bitmaps_;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> groups_;  // group -> nodes with a bitmap
+  mutable std::shared_mutex mu_;
+};
+
+static py::array_t<uint64_t> pack_keys(carray<int64_t> model, carray<int64_t> layer, carray<int64_t> page_id) {
+  const size_t n = static_cast<size_t>(page_id.size());
+  if (static_cast<size_t>(layer.size()) != n || (model.size() != 1 && static_cast<size_t>(model.size()) != n)) {
+    throw std::invalid_argument("model (scalar or per row), layer and page_id must have matching lengths");
+  }
+  py::array_t<uint64_t> out(static_cast<py::ssize_t>(n));
+  uint64_t* o = out.mutable_data();
+  const int64_t* m = model.data();
+  const bool scalar = model.size() == 1;
+  for (size_t i = 0; i < n; ++i) o[i] = pack_key(scalar ? m[0] : m[i], layer.data()[i], page_id.data()[i]);
+  return out;
+}
+
+PYBIND11_MODULE(bodocache_page_table, m) {
+  m.def("pack_keys", &pack_keys, py::arg("model"), py::arg("layer"), py::arg("page_id"));
+  py::class_<PageTableNative>(m, "PageTable")
+      .def(py::init<size_t>(), py::arg("capacity") = 1024)
+      .def("bulk_set", &PageTableNative::bulk_set, py::arg("keys"), py::arg("tier"), py::arg("node"), py::arg("gpu"))
+      .def("bulk_get", &PageTableNative::bulk_get, py::arg("keys"))
+      .def("erase", &PageTableNative::erase, py::arg("keys"))
+      .def("runs", &PageTableNative::runs, py::arg("model"), py::arg("layers"), py::arg("tier"), py::arg("node") = -1)
+      .def("clear", &PageTableNative::clear)
+      .def("stats", &PageTableNative::stats)
+      .def("__len__", &PageTableNative::size);
+}
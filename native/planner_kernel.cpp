@@ -0,0 +1,109 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <string>
+
+#include "planner_kernel.hpp"
+
+namespace py = pybind11;
+
+template <typename T>
+using carray = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+template <typename T>
+static const T* column(const carray<T>& a, size_t n, const char* name) {
+  if (static_cast<size_t>(a.size()) != n) throw std::invalid_argument(std::string(name) + " must have the same length as node");
+  return a.data();
+}
+
+template <typename T>
+static py::array_t<T> to_array(const std::vector<T>& v) {
+  py::array_t<T> out(static_cast<py::ssize_t>(v.size()));
+  if (!v.empty()) std::memcpy(out.mutable_data(), v.data(), v.size() * sizeof(T));
+  return out;
+}
+
+template <typename K>
+static void fill_table(std::unordered_map<K, double>& m, const K* keys, const double* vals, size_t n) {
+  // First row wins for duplicate keys.
+  for (size_t i = 0; i < n; ++i) m.emplace(keys[i], vals[i]);
+}
+
+// Columnar entry point behind bodocache.planner.scheduler.run_window_core_native.
+// node/tenant/cap_tenant are integer codes (see the wrapper); returns a dict of plan
+// columns with node as codes.
+static py::dict plan_window(carray<int64_t> node, carray<int64_t> tier_src, carray<int64_t> tier_dst,
+                            carray<int64_t> pcluster, carray<int64_t> layer, carray<int64_t> page_start,
+                            carray<int64_t> page_end, carray<int64_t> page_bytes, carray<int64_t> deadline_ms,
+                            carray<double> urgency, carray<int64_t> tenant, carray<int64_t> cap_tenant,
+                            carray<int64_t> cap_tier, carray<double> cap_bytes, carray<int64_t> tier,
+                            carray<double> bandwidth_caps, carray<double> free_bytes, carray<int64_t> lat_layer,
+                            carray<double> lat_ms, int64_t min_io_bytes, double window_ms, int64_t max_ops_per_tier,
+                            bool enforce_tier_caps) {
+  PlanInputs in;
+  in.n = static_cast<size_t>(node.size());
+  in.node = node.data();
+  in.tier_src = column(tier_src, in.n, "tier_src");
+  in.tier_dst = column(tier_dst, in.n, "tier_dst");
+  in.pcluster = column(pcluster, in.n, "pcluster");
+  in.layer = column(layer, in.n, "layer");
+  in.page_start = column(page_start, in.n, "page_start");
+  in.page_end = column(page_end, in.n, "page_end");
+  in.page_bytes = column(page_bytes, in.n, "page_bytes");
+  in.deadline_ms = column(deadline_ms, in.n, "deadline_ms");
+  in.urgency = column(urgency, in.n, "urgency");
+  in.tenant = column(tenant, in.n, "tenant");
+  if (cap_tier.size() != cap_tenant.size() || cap_bytes.size() != cap_tenant.size()) {
+    throw std::invalid_argument("cap_tenant, cap_tier and cap_bytes must have the same length");
+  }
+  if (bandwidth_caps.size() != tier.size() || free_bytes.size() != tier.size()) {
+    throw std::invalid_argument("tier, bandwidth_caps and free_bytes must have the same length");
+  }
+  if (lat_ms.size() != lat_layer.size()) throw std::invalid_argument("lat_layer and lat_ms must have the same length");
+
+  PlanParams params;
+  params.min_io_bytes = min_io_bytes;
+  params.window_ms = window_ms;
+  params.max_ops_per_tier = max_ops_per_tier;
+  params.enforce_tier_caps = enforce_tier_caps;
+
+  PlanRuns out;
+  {
+    py::gil_scoped_release nogil;
+    PlanTables tables;
+    for (py::ssize_t i = 0; i < cap_tenant.size(); ++i) {
+      tables.tenant_cap.emplace(pair_key(cap_tenant.data()[i], cap_tier.data()[i]), cap_bytes.data()[i]);
+    }
+    fill_table(tables.bandwidth, tier.data(), bandwidth_caps.data(), static_cast<size_t>(tier.size()));
+    fill_table(tables.free_bytes, tier.data(), free_bytes.data(), static_cast<size_t>(tier.size()));
+    fill_table(tables.lat_ms, lat_layer.data(), lat_ms.data(), static_cast<size_t>(lat_layer.size()));
+    plan_window_kernel(in, tables, params, out);
+  }
+
+  py::dict d;
+  d["node"] = to_array(out.node);
+  d["tier_src"] = to_array(out.tier_src);
+  d["tier_dst"] = to_array(out.tier_dst);
+  d["pcluster"] = to_array(out.pcluster);
+  d["layer"] = to_array(out.layer);
+  d["run_id"] = to_array(out.run_id);
+  d["bytes"] = to_array(out.bytes);
+  d["deadline_ms"] = to_array(out.deadline_ms);
+  d["fanout"] = to_array(out.fanout);
+  d["overlap"] = to_array(out.overlap);
+  d["priority"] = to_array(out.priority);
+  d["start_pid"] = to_array(out.start_pid);
+  d["end_pid"] = to_array(out.end_pid);
+  d["page_bytes"] = to_array(out.page_bytes);
+  d["est_copy_ms"] = to_array(out.est_copy_ms);
+  return d;
+}
+
+PYBIND11_MODULE(bodocache_planner_kernel, m) {
+  m.def("plan_window", &plan_window, py::arg("node"), py::arg("tier_src"), py::arg("tier_dst"), py::arg("pcluster"),
+        py::arg("layer"), py::arg("page_start"), py::arg("page_end"), py::arg("page_bytes"), py::arg("deadline_ms"),
+        py::arg("urgency"), py::arg("tenant"), py::arg("cap_tenant"), py::arg("cap_tier"), py::arg("cap_bytes"),
+        py::arg("tier"), py::arg("bandwidth_caps"), py::arg("free_bytes"), py::arg("lat_layer"), py::arg("lat_ms"),
+        py::arg("min_io_bytes") = 512 * 1024, py::arg("window_ms") = 20.0, py::arg("max_ops_per_tier") = 64,
+        py::arg("enforce_tier_caps") = true);
+}
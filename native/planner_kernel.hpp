@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+// Native hot path of the window planner: tenant caps, interval union/coalescing,
+// min_io_bytes filter, tier caps, max_ops_per_tier and the overlap hint, i.e.
+// apply_tenant_caps + coalesce_intervals + apply_caps from bodocache/planner/pipeline.py.
+//
+// Candidates come in as borrowed columns (one row per scored request). The three sorts
+// the pandas path does are stable LSD radix sorts of a row permutation on keys packed
+// into as few 64-bit words as the value ranges allow; each stage after a sort is a
+// single linear scan. Results match the pandas stages row for row, including their
+// quirks (a run breaks on the previous row's page_end, not the running max; run ids
+// start at 1 when the first interval of a group starts past page 0).
+
+constexpr double kUncappedBytes = 9.223372036854775807e18;  // pandas fillna(INT64_MAX)
+
+// Borrowed candidate columns. node/tenant are dense codes; rows with a negative code
+// are ignored (pandas drops NaN keys from groupby).
+struct PlanInputs {
+  size_t n = 0;
+  const int64_t* node = nullptr;
+  const int64_t* tier_src = nullptr;
+  const int64_t* tier_dst = nullptr;
+  const int64_t* pcluster = nullptr;
+  const int64_t* layer = nullptr;
+  const int64_t* page_start = nullptr;
+  const int64_t* page_end = nullptr;
+  const int64_t* page_bytes = nullptr;
+  const int64_t* deadline_ms = nullptr;
+  const int64_t* tenant = nullptr;
+  const double* urgency = nullptr;
+};
+
+inline uint64_t pair_key(int64_t a, int64_t b) {
+  return (static_cast<uint64_t>(a) << 32) ^ static_cast<uint64_t>(b & 0xffffffff);
+}
+
+// Lookup tables joined onto the candidates. Missing keys behave like a left merge
+// followed by the pandas fillna defaults; NaN values are treated as missing.
+struct PlanTables {
+  std::unordered_map<uint64_t, double> tenant_cap;  // pair_key(tenant, tier) -> bytes
+  std::unordered_map<int64_t, double> bandwidth;    // tier -> bytes per window
+  std::unordered_map<int64_t, double> free_bytes;   // tier -> bytes
+  std::unordered_map<int64_t, double> lat_ms;       // layer -> ms
+};
+
+struct PlanParams {
+  int64_t min_io_bytes = 512 * 1024;
+  double window_ms = 20.0;
+  int64_t max_ops_per_tier = 64;
+  bool enforce_tier_caps = true;
+};
+
+// Output plan, one entry per op, in the order the pandas path returns them.
+struct PlanRuns {
+  std::vector<int64_t> node, tier_src, tier_dst, pcluster, layer, run_id, bytes, deadline_ms, fanout, overlap,
+      start_pid, end_pid, page_bytes;
+  std::vector<double> priority, est_copy_ms;
+
+  size_t size() const { return node.size(); }
+};
+
+// Stable LSD radix sort of (key, value) pairs over the low `bits` bits of the keys,
+// one byte per pass. Passes whose digit is the same for every key are skipped.
+inline void radix_sort_pairs(std::vector<uint64_t>& keys, std::vector<uint32_t>& vals, int bits) {
+  const size_t n = keys.size();
+  if (n < 2) return;
+  std::vector<uint64_t> k2(n);
+  std::vector<uint32_t> v2(n);
+  for (int shift = 0; shift < bits; shift += 8) {
+    size_t count[257] = {0};
+    for (size_t i = 0; i < n; ++i) ++count[((keys[i] >> shift) & 0xff) + 1];
+    if (count[((keys[0] >> shift) & 0xff) + 1] == n) continue;
+    for (int d = 0; d < 256; ++d) count[d + 1] += count[d];
+    for (size_t i = 0; i < n; ++i) {
+      size_t pos = count[(keys[i] >> shift) & 0xff]++;
+      k2[pos] = keys[i];
+      v2[pos] = vals[i];
+    }
+    keys.swap(k2);
+    vals.swap(v2);
+  }
+}
+
+// Stably reorders `perm` (row ids) by the given columns, most significant first.
+// Each column is rebased to its minimum over the rows and packed into 64-bit words
+// starting from the least significant column; words are then radix sorted from the
+// least significant one up, so wide keys cost one extra pass set instead of a
+// comparison sort.
+inline void sort_rows(std::vector<uint32_t>& perm, const std::vector<const int64_t*>& cols) {
+  const size_t n = perm.size();
+  if (n < 2) return;
+  struct Field {
+    const int64_t* col;
+    uint64_t base;
+    int width;
+  };
+  std::vector<Field> fields;  // least significant first
+  for (auto it = cols.rbegin(); it != cols.rend(); ++it) {
+    const int64_t* col = *it;
+    int64_t lo = col[perm[0]], hi = lo;
+    for (uint32_t r : perm) {
+      lo = std::min(lo, col[r]);
+      hi = std::max(hi, col[r]);
+    }
+    uint64_t range = static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo);
+    if (range == 0) continue;
+    fields.push_back({col, static_cast<uint64_t>(lo), 64 - __builtin_clzll(range)});
+  }
+  std::vector<uint64_t> keys(n);
+  size_t f = 0;
+  while (f < fields.size()) {
+    size_t end = f;
+    int bits = 0;
+    while (end < fields.size() && bits + fields[end].width <= 64) bits += fields[end++].width;
+    for (size_t i = 0; i < n; ++i) {
+      uint64_t k = 0;
+      int shift = 0;
+      for (size_t j = f; j < end; ++j) {
+        k |= (static_cast<uint64_t>(fields[j].col[perm[i]]) - fields[j].base) << shift;
+        shift += fields[j].width;
+      }
+      keys[i] = k;
+    }
+    radix_sort_pairs(keys, perm, bits);
+    f = end;
+  }
+}
+
+inline double lookup_or(const std::unordered_map<int64_t, double>& m, int64_t key, double dflt) {
+  auto it = m.find(key);
+  return (it == m.end() || std::isnan(it->second)) ? dflt : it->second;
+}
+
+inline void plan_window_kernel(const PlanInputs& in, const PlanTables& tables, const PlanParams& params,
+                               PlanRuns& out) {
+  if (in.n > std::numeric_limits<uint32_t>::max()) throw std::invalid_argument("too many candidate rows");
+  std::vector<uint32_t> perm;
+  perm.reserve(in.n);
+  for (size_t i = 0; i < in.n; ++i) {
+    if (in.node[i] >= 0 && in.tenant[i] >= 0) perm.push_back(static_cast<uint32_t>(i));
+  }
+
+  // Stage 1: cumulative bytes per (node, tier_dst, tenant) in deadline order gated by the tenant cap.
+  sort_rows(perm, {in.node, in.tier_dst, in.tenant, in.deadline_ms});
+  std::vector<uint32_t> kept;
+  kept.reserve(perm.size());
+  {
+    int64_t cum = 0;
+    double cap = kUncappedBytes;
+    for (size_t i = 0; i < perm.size(); ++i) {
+      uint32_t r = perm[i];
+      bool head = i == 0 || in.node[r] != in.node[perm[i - 1]] || in.tier_dst[r] != in.tier_dst[perm[i - 1]] ||
+                  in.tenant[r] != in.tenant[perm[i - 1]];
+      if (head) {
+        cum = 0;
+        auto it = tables.tenant_cap.find(pair_key(in.tenant[r], in.tier_dst[r]));
+        cap = (it == tables.tenant_cap.end() || std::isnan(it->second)) ? kUncappedBytes : it->second;
+      }
+      cum += (in.page_end[r] - in.page_start[r] + 1) * in.page_bytes[r];
+      if (static_cast<double>(cum) <= cap) kept.push_back(r);
+    }
+  }
+
+  // Stage 2: interval union per (node, tier_src, tier_dst, pcluster, layer) and run coalescing.
+  sort_rows(kept, {in.node, in.tier_src, in.tier_dst, in.pcluster, in.layer, in.page_start, in.page_end});
+  PlanRuns runs;
+  {
+    int64_t run_id = 0, prev_end = -1, cummax = -1, pages = 0;
+    int64_t dl = 0, fanout = 0, start = 0, end = 0, pbytes = 0;
+    double urg = std::numeric_limits<double>::quiet_NaN();
+    uint32_t lead = 0;
+    bool open = false;
+    auto flush = [&]() {
+      if (!open) return;
+      int64_t bytes = pages * pbytes;
+      if (bytes < params.min_io_bytes) return;
+      runs.node.push_back(in.node[lead]);
+      runs.tier_src.push_back(in.tier_src[lead]);
+      runs.tier_dst.push_back(in.tier_dst[lead]);
+      runs.pcluster.push_back(in.pcluster[lead]);
+      runs.layer.push_back(in.layer[lead]);
+      runs.run_id.push_back(run_id);
+      runs.bytes.push_back(bytes);
+      runs.deadline_ms.push_back(dl);
+      runs.fanout.push_back(fanout);
+      runs.priority.push_back(urg);
+      runs.start_pid.push_back(start);
+      runs.end_pid.push_back(end);
+      runs.page_bytes.push_back(pbytes);
+    };
+    for (size_t i = 0; i < kept.size(); ++i) {
+      uint32_t r = kept[i];
+      bool head = i == 0;
+      if (!head) {
+        uint32_t p = kept[i - 1];
+        head = in.node[r] != in.node[p] || in.tier_src[r] != in.tier_src[p] || in.tier_dst[r] != in.tier_dst[p] ||
+               in.pcluster[r] != in.pcluster[p] || in.layer[r] != in.layer[p];
+      }
+      if (head) {
+        flush();
+        open = false;
+        prev_end = -1;
+        run_id = 0;
+      }
+      const int64_t ps = in.page_start[r], pe = in.page_end[r];
+      if (ps > prev_end + 1) {
+        flush();
+        open = false;
+        ++run_id;
+      }
+      if (!open) {
+        open = true;
+        lead = r;
+        cummax = -1;
+        pages = 0;
+        fanout = 0;
+        dl = in.deadline_ms[r];
+        start = ps;
+        end = pe;
+        pbytes = in.page_bytes[r];
+        urg = std::numeric_limits<double>::quiet_NaN();
+      }
+      const int64_t eff_start = std::max(ps, cummax + 1);
+      pages += std::max<int64_t>(0, pe - eff_start + 1);
+      cummax = std::max(cummax, pe);
+      dl = std::min(dl, in.deadline_ms[r]);
+      ++fanout;
+      urg = std::fmin(urg, in.urgency[r]);
+      start = std::min(start, ps);
+      end = std::max(end, pe);
+      pbytes = std::max(pbytes, in.page_bytes[r]);
+      prev_end = pe;
+    }
+    flush();
+  }
+
+  // Stage 3: per-(node, tier_src, tier_dst) cumulative tier caps in deadline order, then
+  // at most max_ops_per_tier ops per (node, tier_dst) and the overlap depth hint.
+  std::vector<uint32_t> order(runs.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<uint32_t>(i);
+  sort_rows(order, {runs.node.data(), runs.tier_src.data(), runs.tier_dst.data(), runs.deadline_ms.data()});
+  std::unordered_map<uint64_t, int64_t> op_rank;
+  int64_t cum = 0;
+  for (size_t i = 0; i < order.size(); ++i) {
+    uint32_t r = order[i];
+    if (i == 0 || runs.node[r] != runs.node[order[i - 1]] || runs.tier_src[r] != runs.tier_src[order[i - 1]] ||
+        runs.tier_dst[r] != runs.tier_dst[order[i - 1]]) {
+      cum = 0;
+    }
+    cum += runs.bytes[r];
+    const int64_t tier = runs.tier_dst[r];
+    const double bw = lookup_or(tables.bandwidth, tier, std::numeric_limits<double>::quiet_NaN());
+    if (params.enforce_tier_caps) {
+      const double eff_cap = std::min(std::isnan(bw) ? kUncappedBytes : bw,
+                                      lookup_or(tables.free_bytes, tier, kUncappedBytes));
+      if (static_cast<double>(cum) > eff_cap) continue;
+    }
+    int64_t rank = ++op_rank[pair_key(runs.node[r], tier)];
+    if (rank > params.max_ops_per_tier) continue;
+    const double denom = (bw > 0) ? std::max(bw, 1.0) : 1.0;
+    const double est = static_cast<double>(runs.bytes[r]) / denom * params.window_ms;
+    const double lat = lookup_or(tables.lat_ms, runs.layer[r], 1.0);
+    out.node.push_back(runs.node[r]);
+    out.tier_src.push_back(runs.tier_src[r]);
+    out.tier_dst.push_back(tier);
+    out.pcluster.push_back(runs.pcluster[r]);
+    out.layer.push_back(runs.layer[r]);
+    out.run_id.push_back(runs.run_id[r]);
+    out.bytes.push_back(runs.bytes[r]);
+    out.deadline_ms.push_back(runs.deadline_ms[r]);
+    out.fanout.push_back(runs.fanout[r]);
+    out.overlap.push_back(1 + (est > lat ? 1 : 0) + (est > 2.0 * lat ? 1 : 0));
+    out.priority.push_back(runs.priority[r]);
+    out.start_pid.push_back(runs.start_pid[r]);
+    out.end_pid.push_back(runs.end_pid[r]);
+    out.page_bytes.push_back(runs.page_bytes[r]);
+    out.est_copy_ms.push_back(est);
+  }
+}
@@ -0,0 +1,127 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace py = pybind11;
+
+template <typename T>
+using carray = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+// Multistream plan simulator behind bodocache.agent.sim_node.simulate_plan_streams.
+//
+// Rows arrive sorted and grouped by (node, tier_dst); a group is N equal-bandwidth
+// streams, each op goes to the earliest-available stream (lowest index on ties, via a
+// min-heap of (available_ms, stream)) and finishes after
+//   bytes / min(max(overlap, 1), N) / max(bandwidth / N, 1) * window_ms
+// with the same double arithmetic as the Python path, so both give identical times.
+// A batch is many cases (plan x knob setting) concatenated; groups are independent and
+// are spread over threads with the GIL released.
+
+struct Case {
+  int64_t streams;
+  bool use_overlap;
+  double window_ms;
+};
+
+static void simulate_group(const double* bytes, const int64_t* overlap, size_t begin, size_t end, double bw_total,
+                           const Case& c, double* finish) {
+  const int64_t n_streams = std::max<int64_t>(1, c.streams);
+  double bw_per = bw_total / static_cast<double>(n_streams);
+  if (!(bw_per >= 1.0)) bw_per = 1.0;  // also catches a NaN cap (tier missing from tier_caps)
+  auto duration = [&](size_t i) {
+    const int64_t ov = c.use_overlap ? overlap[i] : 1;
+    const int64_t eff = std::max<int64_t>(1, std::min<int64_t>(ov, c.streams));
+    return (bytes[i] / static_cast<double>(eff) / bw_per) * c.window_ms;
+  };
+  if (n_streams == 1) {
+    double t = 0.0;
+    for (size_t i = begin; i < end; ++i) finish[i] = t = t + duration(i);
+    return;
+  }
+  using Slot = std::pair<double, int64_t>;
+  std::vector<Slot> init;
+  init.reserve(static_cast<size_t>(n_streams));
+  for (int64_t s = 0; s < n_streams; ++s) init.emplace_back(0.0, s);
+  std::priority_queue<Slot, std::vector<Slot>, std::greater<Slot>> heap(std::greater<Slot>(), std::move(init));
+  for (size_t i = begin; i < end; ++i) {
+    Slot s = heap.top();
+    heap.pop();
+    s.first += duration(i);
+    finish[i] = s.first;
+    heap.push(s);
+  }
+}
+
+// bytes/overlap: per row. group_offsets: G+1 row boundaries; group_bw: bandwidth_caps per
+// group. case_groups: K+1 group boundaries; streams/use_overlap/window_ms: per case.
+// Returns finish_ms per row.
+static py::array_t<double> simulate_batch(carray<double> bytes, carray<int64_t> overlap, carray<int64_t> group_offsets,
+                                          carray<double> group_bw, carray<int64_t> case_groups,
+                                          carray<int64_t> streams, carray<bool> use_overlap,
+                                          carray<double> window_ms, int64_t threads) {
+  const size_t n = static_cast<size_t>(bytes.size());
+  if (static_cast<size_t>(overlap.size()) != n) throw std::invalid_argument("overlap must have the same length as bytes");
+  if (group_offsets.size() < 1) throw std::invalid_argument("group_offsets must have G+1 entries");
+  const size_t n_groups = static_cast<size_t>(group_offsets.size()) - 1;
+  if (static_cast<size_t>(group_bw.size()) != n_groups) throw std::invalid_argument("group_bw must have G entries");
+  if (case_groups.size() < 1) throw std::invalid_argument("case_groups must have K+1 entries");
+  const size_t n_cases = static_cast<size_t>(case_groups.size()) - 1;
+  if (static_cast<size_t>(streams.size()) != n_cases || static_cast<size_t>(use_overlap.size()) != n_cases ||
+      static_cast<size_t>(window_ms.size()) != n_cases) {
+    throw std::invalid_argument("streams, use_overlap and window_ms must have K entries");
+  }
+  const int64_t* go = group_offsets.data();
+  const int64_t* cg = case_groups.data();
+  if (go[0] != 0 || static_cast<size_t>(go[n_groups]) != n) throw std::invalid_argument("group_offsets must span all rows");
+  for (size_t g = 0; g < n_groups; ++g) {
+    if (go[g + 1] < go[g]) throw std::invalid_argument("group_offsets must be non-decreasing");
+  }
+  if (cg[0] != 0 || static_cast<size_t>(cg[n_cases]) != n_groups) throw std::invalid_argument("case_groups must span all groups");
+  std::vector<Case> cases(n_cases);
+  std::vector<uint32_t> group_case(n_groups);
+  for (size_t k = 0; k < n_cases; ++k) {
+    if (cg[k + 1] < cg[k]) throw std::invalid_argument("case_groups must be non-decreasing");
+    cases[k] = Case{streams.data()[k], use_overlap.data()[k], window_ms.data()[k]};
+    for (int64_t g = cg[k]; g < cg[k + 1]; ++g) group_case[static_cast<size_t>(g)] = static_cast<uint32_t>(k);
+  }
+
+  py::array_t<double> out(static_cast<py::ssize_t>(n));
+  double* finish = out.mutable_data();
+  const double* b = bytes.data();
+  const int64_t* ov = overlap.data();
+  const double* bw = group_bw.data();
+  {
+    py::gil_scoped_release nogil;
+    size_t n_threads = threads > 0 ? static_cast<size_t>(threads) : std::max(1u, std::thread::hardware_concurrency());
+    // Below ~64k rows thread startup costs more than it saves
+    n_threads = std::min(n_threads, std::max<size_t>(1, std::min(n_groups, n / 65536 + 1)));
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+      for (size_t g; (g = next.fetch_add(1, std::memory_order_relaxed)) < n_groups;) {
+        simulate_group(b, ov, static_cast<size_t>(go[g]), static_cast<size_t>(go[g + 1]), bw[g], cases[group_case[g]],
+                       finish);
+      }
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < n_threads; ++t) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+  }
+  return out;
+}
+
+PYBIND11_MODULE(bodocache_stream_sim, m) {
+  m.def("simulate_batch", &simulate_batch, py::arg("bytes"), py::arg("overlap"), py::arg("group_offsets"),
+        py::arg("group_bw"), py::arg("case_groups"), py::arg("streams"), py::arg("use_overlap"), py::arg("window_ms"),
+        py::arg("threads") = 0);
+}
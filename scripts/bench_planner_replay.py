@@ -0,0 +1,100 @@
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+import pandas as pd
+
+from bodocache.sim.replay import (
+    PlannerCostModel,
+    available_backends,
+    load_trace,
+    save_trace,
+    scaling_curve,
+    synthetic_trace,
+)
+
+
+def int_list(s: str):
+    return [int(float(x)) for x in s.split(",") if x]
+
+
+def pin_cores(n: int) -> None:
+    # Planner threads (Bodo workers, OpenMP/BLAS pools) see n cores
+    for var in ("BODO_NUM_WORKERS", "OMP_NUM_THREADS", "OPENBLAS_NUM_THREADS", "MKL_NUM_THREADS"):
+        os.environ[var] = str(n)
+    if hasattr(os, "sched_setaffinity"):
+        cpus = sorted(os.sched_getaffinity(0))
+        os.sched_setaffinity(0, cpus[:n])
+
+
+def run_curve(args) -> pd.DataFrame:
+    trace = load_trace(args.trace) if args.trace else None
+    backends = args.backends.split(",") if args.backends else None
+    return scaling_curve(
+        int_list(args.requests), layers=int_list(args.layers), trace=trace, repeat=args.repeat,
+        backends=backends, seed=args.seed,
+    )
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Replay planner windows and report per-stage/per-backend scaling")
+    ap.add_argument("--trace", help="Trace directory (requests/heat[/tier_caps/tenant_caps/layer_lat] tables)")
+    ap.add_argument("--requests", default="1e4,1e5,1e6", help="Comma-separated request counts")
+    ap.add_argument("--layers", default="8", help="Comma-separated layer counts (synthetic traces only)")
+    ap.add_argument("--cores", default="", help="Comma-separated core counts; each runs pinned in a child process")
+    ap.add_argument("--backends", default="", help=f"Subset of {available_backends()} (default: all available)")
+    ap.add_argument("--repeat", type=int, default=3)
+    ap.add_argument("--seed", type=int, default=0)
+    ap.add_argument("--write-trace", help="Write a synthetic trace of max(--requests) to this directory and exit")
+    ap.add_argument("--format", default="parquet", choices=["parquet", "arrow", "feather", "csv"])
+    ap.add_argument("--csv", help="Also write the curve as CSV")
+    ap.add_argument("--cost-model", help="Write the fitted planner cost model (JSON) for replay_tuner.py")
+    ap.add_argument("--out", help="Write the JSON report here instead of stdout")
+    ap.add_argument("--pinned", type=int, default=0, help=argparse.SUPPRESS)
+    args = ap.parse_args()
+
+    if args.write_trace:
+        tables, now_ms = synthetic_trace(max(int_list(args.requests)), n_layers=int_list(args.layers)[0], seed=args.seed)
+        save_trace(tables, args.write_trace, now_ms=now_ms, fmt=args.format)
+        print(f"Wrote {len(tables['requests'])} requests to {args.write_trace}")
+        return
+
+    if args.pinned:
+        pin_cores(args.pinned)
+        print(run_curve(args).assign(cores=args.pinned).to_json(orient="records"))
+        return
+
+    if args.cores:
+        parts = []
+        for n in int_list(args.cores):
+            out = subprocess.run(
+                [sys.executable, os.path.abspath(__file__), *sys.argv[1:], "--pinned", str(n)],
+                check=True, capture_output=True, text=True,
+            ).stdout
+            parts.append(pd.DataFrame(json.loads(out.strip().splitlines()[-1])))
+        curve = pd.concat(parts, ignore_index=True)
+    else:
+        curve = run_curve(args).assign(cores=len(os.sched_getaffinity(0)) if hasattr(os, "sched_getaffinity") else os.cpu_count())
+
+    # The cost model is fitted on the widest core count measured
+    model = PlannerCostModel.fit(curve[curve["cores"] == curve["cores"].max()])
+    report = {"curve": json.loads(curve.to_json(orient="records")), "cost_model": model.to_json()}
+    text = json.dumps(report, indent=2)
+    if args.out:
+        with open(args.out, "w") as f:
+            f.write(text)
+    else:
+        print(text)
+    if args.csv:
+        curve.to_csv(args.csv, index=False)
+    if args.cost_model:
+        with open(args.cost_model, "w") as f:
+            json.dump(model.to_json(), f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,14 +1,16 @@
 from __future__ import annotations
 
 import argparse
+import json
 import time
 import pandas as pd
 import numpy as np
 
 from bodocache.planner.scheduler import run_window
 from bodocache.planner.cluster import assign_pclusters_minhash
-from bodocache.agent.sim_node import simulate_plan_streams, summarize_metrics
+from bodocache.agent.sim_node import simulate_plan_streams_batch, summarize_metrics
 from bodocache.config import load_config
+from bodocache.sim.replay import PlannerCostModel, load_trace
 import yaml
 
 
@@ -20,9 +22,11 @@ def sweep_params(req: pd.DataFrame, heat: pd.DataFrame, tiers: pd.DataFrame, lat
                  min_io_list=(256*1024, 512*1024, 1024*1024),
                  credits_list=(16*1024*1024, 32*1024*1024, 64*1024*1024),
                  pmin_list=(0.0, 0.5, 1.0),
-                 umin_list=(-1.0, 0.0, 0.5)):
+                 umin_list=(-1.0, 0.0, 0.5), now_ms=None, cost_model=None, target_requests=None,
+                 streams_list=(4,), sim_threads=0):
     results = []
-    now_ms = int(time.time()*1000)
+    plans = []
+    now_ms = int(time.time()*1000) if now_ms is None else int(now_ms)
     # Assign clusters
     req = assign_pclusters_minhash(req, num_hashes=32, bands=8, k=4)
     for mio in min_io_list:
@@ -31,21 +35,35 @@ def sweep_params(req: pd.DataFrame, heat: pd.DataFrame, tiers: pd.DataFrame, lat
                 for umin in umin_list:
                     t_caps = (req[['tenant']].drop_duplicates().assign(tier=1, bandwidth_caps=credits)
                               .reset_index(drop=True))
+                    t0 = time.perf_counter()
                     plan, _, _ = run_window(
                         req, heat, tiers, t_caps, lats, now_ms,
                         pmin=float(pmin), umin=float(umin), min_io_bytes=int(mio),
                         alpha=1.0, beta=0.0, window_ms=20, max_ops_per_tier=64,
                         enable_admission=False, enable_eviction=False,
                     )
-                    exec_df = simulate_plan_streams(plan, tiers, window_ms=20, streams_per_tier=4, use_overlap=True, layer_lat_df=lats)
-                    m = summarize_metrics(exec_df)
-                    results.append({
-                        'min_io': int(mio), 'credits': int(credits), 'pmin': float(pmin), 'umin': float(umin),
-                        'prefetch_timeliness': m['prefetch_timeliness'],
-                        'avg_finish_ms': m['avg_finish_ms'],
-                        'avg_io_bytes': m['avg_io_bytes'],
-                        'ops': m['ops'],
-                    })
+                    plan_ms = (time.perf_counter() - t0) * 1000.0
+                    for streams in streams_list:
+                        plans.append(plan)
+                        results.append({
+                            'min_io': int(mio), 'credits': int(credits), 'pmin': float(pmin), 'umin': float(umin),
+                            'streams': int(streams), 'plan_ms': plan_ms,
+                        })
+                        if cost_model is not None:
+                            # Planning cost at production request counts, scaled from this trace
+                            n = int(target_requests or len(req))
+                            results[-1]['est_plan_ms'] = plan_ms * cost_model.predict_ms(n) / max(cost_model.predict_ms(len(req)), 1e-9)
+    # Every (plan, stream count) case in one simulator batch
+    settings = [{'window_ms': 20, 'streams_per_tier': r['streams'], 'use_overlap': True} for r in results]
+    for r, exec_df in zip(results, simulate_plan_streams_batch(plans, tiers, settings, layer_lat_df=lats,
+                                                              threads=sim_threads)):
+        m = summarize_metrics(exec_df)
+        r.update({
+            'prefetch_timeliness': m['prefetch_timeliness'],
+            'avg_finish_ms': m['avg_finish_ms'],
+            'avg_io_bytes': m['avg_io_bytes'],
+            'ops': m['ops'],
+        })
     return pd.DataFrame(results)
 
 
@@ -55,6 +73,12 @@ def main():
     ap.add_argument('--heat', required=False, help='CSV with heat')
     ap.add_argument('--tiers', required=False, help='CSV with tier caps')
     ap.add_argument('--lats', required=False, help='CSV with per-layer latencies')
+    ap.add_argument('--trace', required=False, help='Trace directory (Parquet/Arrow/CSV tables); overrides the CSV flags')
+    ap.add_argument('--cost-model', required=False, help='Planner cost model JSON from scripts/bench_planner_replay.py')
+    ap.add_argument('--target-requests', type=int, default=None, help='Request count per window to cost planning at')
+    ap.add_argument('--max-plan-ms', type=float, default=None, help='Drop configs whose (estimated) planning time exceeds this')
+    ap.add_argument('--streams', default='4', help='Comma-separated streams per tier to simulate each plan with')
+    ap.add_argument('--sim-threads', type=int, default=0, help='Simulator threads (0 = all cores)')
     ap.add_argument('--write-staged', default='configs/staged.yaml', help='Write best config to this YAML path')
     args = ap.parse_args()
 
@@ -65,12 +89,27 @@ def main():
         synthetic_tier_caps,
         synthetic_layer_lat,
     )
-    req = load_csv(args.req) if args.req else synthetic_requests()
-    heat = load_csv(args.heat) if args.heat else synthetic_heat(req)
-    tiers = load_csv(args.tiers) if args.tiers else synthetic_tier_caps()
-    lats = load_csv(args.lats) if args.lats else synthetic_layer_lat()
+    now_ms = None
+    if args.trace:
+        tables, now_ms = load_trace(args.trace)
+        req, heat, tiers, lats = tables['requests'], tables['heat'], tables['tier_caps'], tables['layer_lat']
+    else:
+        req = load_csv(args.req) if args.req else synthetic_requests()
+        heat = load_csv(args.heat) if args.heat else synthetic_heat(req)
+        tiers = load_csv(args.tiers) if args.tiers else synthetic_tier_caps()
+        lats = load_csv(args.lats) if args.lats else synthetic_layer_lat()
+    cost_model = None
+    if args.cost_model:
+        with open(args.cost_model) as f:
+            cost_model = PlannerCostModel.from_json(json.load(f))
 
-    res = sweep_params(req, heat, tiers, lats)
+    res = sweep_params(req, heat, tiers, lats, now_ms=now_ms, cost_model=cost_model,
+                       target_requests=args.target_requests,
+                       streams_list=[int(x) for x in args.streams.split(',') if x], sim_threads=args.sim_threads)
+    if args.max_plan_ms is not None:
+        col = 'est_plan_ms' if 'est_plan_ms' in res.columns else 'plan_ms'
+        kept = res[res[col] <= args.max_plan_ms]
+        res = kept if not kept.empty else res
     best = res.sort_values(['prefetch_timeliness','avg_io_bytes'], ascending=[False, False]).head(5)
     print('Top configs:')
     print(best.to_string(index=False))
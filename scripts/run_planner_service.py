@@ -1,6 +1,7 @@
 from __future__ import annotations
 
 import argparse
+import threading
 
 from bodocache.planner.service_http import serve
 
@@ -9,7 +10,17 @@ def main():
     ap = argparse.ArgumentParser()
     ap.add_argument("--host", type=str, default="0.0.0.0")
     ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--rpc", type=str, default="",
+                    help="Also serve the binary Arrow RPC on host:port or unix:/path (needs pyarrow)")
+    ap.add_argument("--rpc-token", type=str, default=None,
+                    help="Shared token the binary RPC requires from its clients")
     args = ap.parse_args()
+    if args.rpc:
+        from bodocache.planner.service_rpc import make_rpc_server
+
+        rpc = make_rpc_server(args.rpc, token=args.rpc_token)
+        threading.Thread(target=rpc.serve_forever, daemon=True).start()
+        print(f"Planner binary RPC listening on {args.rpc}")
     print(f"Planner HTTP service listening on {args.host}:{args.port}")
     serve(args.host, args.port)
 
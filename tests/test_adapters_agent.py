@@ -1,10 +1,16 @@
 from __future__ import annotations
 
 import secrets
+
+import numpy as np
 import pandas as pd
+import pytest
 
+from bodocache.adapters import page_codec
+from bodocache.adapters.packed_segment_backend import PackedSegmentBackend
 from bodocache.adapters.segmented_file_backend import SegmentedFileBackend
-from bodocache.agent.node_agent import NodeAgent
+from bodocache.agent.copy_engine import SimCopyEngine
+from bodocache.agent.node_agent import NodeAgent, io_mode_from_route_hint
 
 
 def test_segmented_file_backend_rw(tmp_path):
@@ -25,6 +31,59 @@ def test_segmented_file_backend_rw(tmp_path):
     n = be.read_range_into(model_id, model_version, layer, 0, 1, page_bytes, buf)
     assert n == 2 * page_bytes
 
+    # Vectored read of two ranges into separate buffers
+    pages = [be.read_range(model_id, model_version, layer, pid, pid, page_bytes) for pid in (0, 1)]
+    bufs = [bytearray(page_bytes), bytearray(page_bytes)]
+    got = be.read_batch(model_id, model_version, [(layer, 1, 1, page_bytes), (layer, 0, 0, page_bytes)], bufs)
+    assert got == [page_bytes, page_bytes]
+    assert bytes(bufs[0]) == pages[1] and bytes(bufs[1]) == pages[0]
+
+
+def test_segmented_file_backend_mmap(tmp_path):
+    be = SegmentedFileBackend(str(tmp_path), mmap_mode=True)
+    data = [secrets.token_bytes(4096) for _ in range(3)]
+    for pid, d in enumerate(data[:2]):
+        be.write_page('m', 'v', 0, pid, 4096, d)
+    assert be.read_range('m', 'v', 0, 0, 1, 4096) == data[0] + data[1]
+    with be.map_range('m', 'v', 0, 1, 1, 4096) as view:
+        assert view.readonly and bytes(view) == data[1]
+    # Growing the segment remaps it; reads past the old end see the new page
+    be.write_page('m', 'v', 0, 2, 4096, data[2])
+    buf = bytearray(2 * 4096)
+    assert be.read_range_into('m', 'v', 0, 1, 2, 4096, buf) == 2 * 4096
+    assert bytes(buf) == data[1] + data[2]
+    assert be.advise('m', 'v', 0, 0, 2, 4096, 'willneed') in (True, False)
+    try:
+        be.read_range('m', 'v', 0, 2, 3, 4096)
+        assert False, "expected IOError"
+    except IOError:
+        pass
+    be.close()
+
+
+def test_node_agent_mmap_path(tmp_path):
+    be = SegmentedFileBackend(str(tmp_path), mmap_mode=True)
+    for pid in range(4):
+        be.write_page('m', 'v', 0, pid, 4096, secrets.token_bytes(4096))
+    engine = SimCopyEngine()
+    calls = []
+    submit = engine.submit_array
+    engine.submit_array = lambda src, *a, **k: calls.append(list(src)) or submit(src, *a, **k)
+    agent = NodeAgent(be, page_bytes=4096, copy_engine=engine)
+    plan_df = pd.DataFrame([
+        ["n0", 0, 0, 1, 4096, None],
+        ["n0", 0, 2, 3, 4096, "io=bounce"],
+    ], columns=["node", "layer", "start_pid", "end_pid", "page_bytes", "route_hint"])
+    ready = []
+    agent.execute(plan_df, 'm', 'v', on_ready=ready.append, dest_resolver=lambda info: 0x10000 + info["start_pid"])
+    base = be.mapped_address('m', 'v', 0, 0, 0, 4096)
+    # The auto row is copied straight from the mapping, which is registered once
+    assert [base] in calls
+    assert base in engine._host_ranges
+    assert sorted(r["start_pid"] for r in ready) == [0, 2]
+    be.close()
+    assert not engine._host_ranges
+
 
 def test_node_agent_exec(tmp_path):
     be = SegmentedFileBackend(str(tmp_path))
@@ -39,3 +98,280 @@ def test_node_agent_exec(tmp_path):
     stats = agent.execute(plan_df, model_id='m', model_version='v')
     assert stats['ops'] == 2
     assert stats['bytes'] == 4 * 4096  # two ranges of two pages each
+
+
+def test_io_mode_from_route_hint():
+    assert io_mode_from_route_hint(None) == "auto"
+    assert io_mode_from_route_hint("prefix:p0") == "auto"
+    assert io_mode_from_route_hint("prefix:p0;io=gds") == "gds"
+    assert io_mode_from_route_hint("io=bounce") == "bounce"
+    assert io_mode_from_route_hint("io=mmap") == "mmap"
+    assert io_mode_from_route_hint("prefix:p0;io=bogus") == "auto"
+
+
+class _WritebackEngine:
+    # Records submit_writeback() columns and completes every op immediately.
+    def __init__(self):
+        self.calls = []
+
+    def submit_writeback(self, src_ptr, bytes, paths, offsets, stream_id=None, gpu_id=None,
+                         deadline_ms=None, tag=None, callback=None):
+        self.calls.append((list(src_ptr), list(bytes), list(paths), list(offsets)))
+        for i, t in enumerate(tag):
+            if callback is not None:
+                callback({"op_id": i, "tag": int(t), "direction": 1, "status": 0})
+        return 0
+
+
+def test_node_agent_evict(tmp_path):
+    be = SegmentedFileBackend(str(tmp_path))
+    engine = _WritebackEngine()
+    agent = NodeAgent(be, page_bytes=4096, copy_engine=engine)
+    evict_df = pd.DataFrame([
+        ["n0", 0, 2, 3, 4096],
+        ["n0", 1, 0, 0, 4096],
+    ], columns=["node", "layer", "start_pid", "end_pid", "page_bytes"])
+    done = []
+    stats = agent.evict(evict_df, 'm', 'v', src_resolver=lambda info: 0x1000 + info["layer"], on_done=done.append)
+    assert stats['ops'] == 2 and stats['bytes'] == 3 * 4096
+    src, sizes, paths, offsets = engine.calls[0]
+    assert src == [0x1000, 0x1001]
+    assert sizes == [2 * 4096, 4096]
+    assert offsets == [2 * 4096, 0]
+    assert paths == [str(be.segment_path('m', 'v', 0)), str(be.segment_path('m', 'v', 1))]
+    assert [(d["layer"], d["start_pid"]) for d in done] == [(0, 2), (1, 0)]
+
+
+def test_node_agent_evict_rejects_encoded_backend(tmp_path):
+    be = SegmentedFileBackend(str(tmp_path), codec="fp8")
+    engine = _WritebackEngine()
+    agent = NodeAgent(be, page_bytes=4096, copy_engine=engine)
+    evict_df = pd.DataFrame([["n0", 0, 0, 1, 4096]], columns=["node", "layer", "start_pid", "end_pid", "page_bytes"])
+    with pytest.raises(ValueError, match="encoded segment"):
+        agent.evict(evict_df, 'm', 'v', src_resolver=lambda info: 0x1000)
+    assert engine.calls == [] and not be.segment_path('m', 'v', 0).exists()
+
+
+def test_native_engine_bad_row_keeps_pool_balanced():
+    native = pytest.importorskip("bodocache_agent_copy_engine")
+    try:
+        eng = native.CopyEngine()
+    except Exception:
+        pytest.skip("no device for the native copy engine")
+    baseline = eng.pool_stats()["bytes_in_use"]
+    buf = eng.acquire_host_buffer(1 << 16)
+    src = eng.buffer_address(buf)
+    # Row 1 is rejected after row 0 was built: neither may keep a hold on the buffer
+    with pytest.raises(ValueError):
+        eng.submit_array(np.array([src, src], dtype=np.uint64), np.array([0x1000, 0], dtype=np.uint64),
+                         np.array([4096, 4096], dtype=np.uint64))
+    assert eng.release_host_buffer(buf)
+    assert eng.pool_stats()["bytes_in_use"] == baseline
+
+
+class _AsyncEngine(SimCopyEngine):
+    # Completes ops only on complete(), through one engine-wide callback that every submit
+    # replaces, like the native engine
+    def __init__(self):
+        super().__init__()
+        self._cb = None
+        self.inflight = []
+
+    def submit_array(self, src_ptr, dst_ptr, bytes, stream_id=None, gpu_id=None, deadline_ms=None, tag=None,
+                     callback=None, **_cols):
+        first = self._next_op_id
+        self._next_op_id += len(src_ptr)
+        self._cb = callback
+        self.inflight += [
+            {"op_id": first + i, "tag": int(tag[i]) if tag is not None else 0, "bytes": int(bytes[i]), "status": 0}
+            for i in range(len(src_ptr))
+        ]
+        return first
+
+    def complete(self):
+        done, self.inflight = self.inflight[::-1], []
+        for rec in done:
+            if self._cb is not None:
+                self._cb(rec)
+            else:
+                self._completed.append(rec)
+
+
+def test_node_agent_routes_overlapping_windows(tmp_path):
+    be = SegmentedFileBackend(str(tmp_path))
+    for layer in range(2):
+        for pid in range(3):
+            be.write_page('m', 'v', layer, pid, 4096, bytes([layer]) * 4096)
+    engine = _AsyncEngine()
+    agent = NodeAgent(be, page_bytes=4096, copy_engine=engine)
+    dst = np.zeros(8 * 4096, dtype=np.uint8)
+    resolver = lambda info: int(dst.ctypes.data) + (info["layer"] * 4 + info["start_pid"]) * 4096
+    plans = [
+        pd.DataFrame({"node": "n0", "layer": layer, "start_pid": [0, 2], "end_pid": [1, 2], "page_bytes": 4096})
+        for layer in range(2)
+    ]
+    ready = [[], []]
+    for layer, plan in enumerate(plans):
+        agent.execute(plan, 'm', 'v', on_ready=ready[layer].append, dest_resolver=resolver,
+                      prefer_native_engine=False)
+    # Both windows are in flight together; every completion reaches its own window's row
+    engine.complete()
+    for layer in range(2):
+        assert sorted((r["layer"], r["start_pid"]) for r in ready[layer]) == [(layer, 0), (layer, 2)]
+
+    # A deferred window clears the op callback while a callback window is still in flight
+    agent.execute(plans[0], 'm', 'v', on_ready=ready[0].append, dest_resolver=resolver, prefer_native_engine=False)
+    agent.execute(plans[1], 'm', 'v', on_ready=ready[1].append, dest_resolver=resolver, prefer_native_engine=False,
+                  defer_completions=True)
+    engine.complete()
+    assert agent.poll_completions() == 4
+    assert len(ready[0]) == 4 and len(ready[1]) == 4 and not agent._routes
+
+
+def test_packed_segment_backend(tmp_path):
+    be = PackedSegmentBackend(str(tmp_path), n_layers=3, max_pages=4, page_bytes=4096)
+    data = {(l, p): secrets.token_bytes(4096) for l in range(3) for p in range(2)}
+    for (l, p), d in data.items():
+        be.write_page('m', 'v', l, p, 4096, d)
+    assert be.read_range('m', 'v', 1, 0, 1, 4096) == data[(1, 0)] + data[(1, 1)]
+    # Pages 0-1 of every layer are one page-major extent
+    path, off, size = be.extent('m', 'v', 0, 0, 1, 4096, layer_end=2)
+    assert off % 4096 == 0 and size == 6 * 4096
+    assert be.extent('m', 'v', 0, 0, 1, 4096) is None
+    want = b"".join(data[(l, p)] for p in range(2) for l in range(3))
+    assert be.read_block('m', 'v', 0, 2, 0, 1, 4096) == want
+    assert be.read_block('m', 'v', 1, 2, 0, 1, 4096) == b"".join(data[(l, p)] for p in range(2) for l in (1, 2))
+    assert be.index('m', 'v')["written_pages"] == 6
+    be.close()
+    # Reopen from the header alone and detect a corrupted page
+    be = PackedSegmentBackend(str(tmp_path), n_layers=1, max_pages=1)
+    assert be.index('m', 'v')["n_layers"] == 3
+    with open(path, "r+b") as f:
+        f.seek(off + 4096)
+        f.write(b"\xff" * 16)
+    assert be.verify('m', 'v') == [(1, 0)]
+    try:
+        be.read_range('m', 'v', 1, 0, 0, 4096)
+        assert False, "expected IOError"
+    except IOError:
+        pass
+    be.close()
+
+
+def test_node_agent_merged_layers(tmp_path):
+    be = PackedSegmentBackend(str(tmp_path), n_layers=2, max_pages=2, page_bytes=4096)
+    for l in range(2):
+        for p in range(2):
+            be.write_page('m', 'v', l, p, 4096, secrets.token_bytes(4096))
+    agent = NodeAgent(be, page_bytes=4096)
+    plan_df = pd.DataFrame([["n0", 0, 1, 0, 1, 4096]], columns=["node", "layer", "layer_end", "start_pid", "end_pid", "page_bytes"])
+    ready = []
+    stats = agent.execute(plan_df, 'm', 'v', on_ready=ready.append)
+    assert stats["bytes"] == 4 * 4096
+    assert ready[0]["layer_end"] == 1 and ready[0]["bytes"] == 4 * 4096
+    be.close()
+
+
+def test_segmented_file_backend_codec(tmp_path):
+    rng = np.random.default_rng(0)
+    pages = [rng.standard_normal(2048).astype(np.float16).tobytes() for _ in range(2)]
+    for codec, tol in (("fp8", 0.07), ("int4", 0.2)):
+        be = SegmentedFileBackend(str(tmp_path / codec), codec=codec)
+        for pid, d in enumerate(pages):
+            be.write_page('m', 'v', 0, pid, 4096, d)
+        stored = be.stored_page_bytes(4096)
+        assert stored == page_codec.encoded_page_bytes(4096, codec) < 4096
+        assert be.segment_path('m', 'v', 0).stat().st_size == 2 * stored
+        got = np.frombuffer(be.read_range('m', 'v', 0, 0, 1, 4096), dtype=np.float16).astype(np.float32)
+        want = np.frombuffer(b"".join(pages), dtype=np.float16).astype(np.float32)
+        assert np.abs(got - want).max() <= tol * np.abs(want).max()
+        enc = bytearray(2 * stored)
+        assert be.read_encoded_into('m', 'v', 0, 0, 1, 4096, enc) == 2 * stored
+        assert page_codec.decode(enc, codec) == be.read_range('m', 'v', 0, 0, 1, 4096)
+
+
+def test_node_agent_device_decode(tmp_path):
+    be = SegmentedFileBackend(str(tmp_path), codec="fp8", kv_dtype="bfloat16")
+    for pid in range(2):
+        be.write_page('m', 'v', 0, pid, 4096, secrets.token_bytes(4096))
+    engine = SimCopyEngine()
+    calls = []
+    submit = engine.submit_array
+    engine.submit_array = lambda *a, **k: calls.append(k) or submit(*a, **k)
+    agent = NodeAgent(be, page_bytes=4096, copy_engine=engine)
+    plan_df = pd.DataFrame([["n0", 0, 0, 1, 4096]], columns=["node", "layer", "start_pid", "end_pid", "page_bytes"])
+    ready = []
+    agent.execute(plan_df, 'm', 'v', on_ready=ready.append, dest_resolver=lambda info: 0x10000)
+    # The stored bytes cross PCIe and the engine is asked to decode them into bf16 pages
+    (kw,) = calls
+    assert list(kw["codec"]) == [page_codec.codec_id("fp8", "bfloat16")]
+    assert list(kw["decoded_bytes"]) == [2 * 4096]
+    assert ready[0]["bytes"] == 2 * 4096
+
+
+def test_node_agent_scatter(tmp_path):
+    be = SegmentedFileBackend(str(tmp_path))
+    for pid in range(3):
+        be.write_page('m', 'v', 0, pid, 4096, secrets.token_bytes(4096))
+    plan_df = pd.DataFrame([["n0", 0, 0, 2, 4096]], columns=["node", "layer", "start_pid", "end_pid", "page_bytes"])
+    # Pages 0 and 1 land in adjacent blocks, page 2 elsewhere
+    blocks = lambda info: [0x100000, 0x101000, 0x200000]
+    engine = SimCopyEngine()
+    calls = []
+    submit = engine.submit_scatter
+    engine.submit_scatter = lambda *a, **k: calls.append(a) or submit(*a, **k)
+    ready = []
+    NodeAgent(be, page_bytes=4096, copy_engine=engine).execute(plan_df, 'm', 'v', on_ready=ready.append, dest_resolver=blocks)
+    (args,) = calls
+    assert list(args[1]) == [0, 2]
+    assert list(args[2]) == [0x100000, 0x200000]
+    assert list(args[3]) == [0, 2 * 4096] and list(args[4]) == [2 * 4096, 4096]
+    assert len(ready) == 1 and ready[0]["bytes"] == 3 * 4096
+
+    # Engines without submit_scatter get one op per segment and still one ready per row
+    engine = SimCopyEngine()
+    engine.submit_scatter = None
+    ready = []
+    NodeAgent(be, page_bytes=4096, copy_engine=engine).execute(plan_df, 'm', 'v', on_ready=ready.append, dest_resolver=blocks)
+    assert len(ready) == 1
+
+
+def test_node_agent_execute_columnar(tmp_path):
+    be = SegmentedFileBackend(str(tmp_path))
+    for layer in range(2):
+        for pid in range(4):
+            be.write_page('m', 'v', layer, pid, 4096, secrets.token_bytes(4096))
+    plan_df = pd.DataFrame(
+        [["n0", 0, 0, 1, 4096, 2, 1], ["n0", 1, 2, 3, 4096, 1, 0], ["n0", 0, 3, 3, 4096, 1, 1]],
+        columns=["node", "layer", "start_pid", "end_pid", "page_bytes", "overlap", "tier_dst"],
+    )
+    dst = np.array([0x100000, 0x200000, 0x300000], dtype=np.uint64)
+    engine = SimCopyEngine()
+    calls = []
+    execute_plan = engine.execute_plan
+    engine.execute_plan = lambda *a, **k: calls.append((a, k)) or execute_plan(*a, **k)
+    ready = []
+    agent = NodeAgent(be, page_bytes=4096, copy_engine=engine)
+    stats = agent.execute_columnar(plan_df, 'm', 'v', dst, on_ready=ready.append, tier_inflight_bytes={1: 8192})
+    assert stats["bytes"] == 5 * 4096
+    ((args, kwargs),) = calls
+    files, file_index, offsets, sizes = args[:4]
+    assert len(files) == 2 and [files[i] for i in file_index] == [str(be.segment_path('m', 'v', l)) for l in (0, 1, 0)]
+    assert list(offsets) == [0, 2 * 4096, 3 * 4096] and list(sizes) == [2 * 4096, 2 * 4096, 4096]
+    assert list(kwargs["overlap"]) == [2, 1, 1] and list(kwargs["tier"]) == [1, 0, 1]
+    assert kwargs["tier_inflight_bytes"] == {1: 8192}
+    assert [(r["layer"], r["start_pid"]) for r in ready] == [(0, 0), (1, 2), (0, 3)]
+
+    # Deferred completions and a missing segment file (status < 0, still one record per row)
+    agent.execute_columnar(plan_df.iloc[:1], 'm', 'v', dst[:1], on_ready=ready.append, defer_completions=True)
+    assert agent.drain_completions() == 1
+    first = engine.execute_plan([str(tmp_path / "missing")], [0], [0], [4096], [0x100000])
+    (rec,) = engine.poll()
+    assert rec["op_id"] == first and rec["status"] < 0 and engine.plan_stats()["rows"] == 5
+
+    # Engines without execute_plan run the same window through execute()
+    engine = SimCopyEngine()
+    engine.execute_plan = None
+    ready = []
+    NodeAgent(be, page_bytes=4096, copy_engine=engine).execute_columnar(plan_df, 'm', 'v', dst, on_ready=ready.append)
+    assert len(ready) == 3
@@ -1,6 +1,7 @@
 from __future__ import annotations
 
 import pandas as pd
+import pytest
 
 from bodocache.planner.cluster import assign_pclusters, assign_pclusters_minhash, hash_bucket
 
@@ -40,3 +41,41 @@ def test_assign_pclusters_minhash_tokens_vs_string():
     assert 'pcluster' in out_str.columns
     assert out_str['pcluster'].iloc[0] == out_str['pcluster'].iloc[1]
 
+
+
+def test_minhash_near_duplicates_share_cluster():
+    base = list(range(100, 164))
+    near = base[:-1] + [999]  # one token differs
+    far = list(range(5000, 5064))
+    df = pd.DataFrame({'prefix_tokens': [base, far, near]})
+    out = assign_pclusters(df)
+    assert out['pcluster'].iloc[0] == out['pcluster'].iloc[2]
+    assert out['pcluster'].iloc[0] != out['pcluster'].iloc[1]
+
+
+def test_minhash_persistent_index_stable_ids():
+    from bodocache.planner.minhash import make_lsh_index
+
+    idx = make_lsh_index(bands=8, rows=4, prefer_native=False)
+    a, b = list(range(64)), list(range(1000, 1064))
+    first = assign_pclusters_minhash(pd.DataFrame({'prefix_tokens': [a, b]}), index=idx)
+    second = assign_pclusters_minhash(pd.DataFrame({'prefix_tokens': [b, list(range(7000, 7064)), a]}), index=idx)
+    assert second['pcluster'].iloc[0] == first['pcluster'].iloc[1]
+    assert second['pcluster'].iloc[2] == first['pcluster'].iloc[0]
+    assert second['pcluster'].iloc[1] not in set(first['pcluster'])
+
+
+def test_native_minhash_matches_numpy():
+    pytest.importorskip("bodocache_minhash")
+    import numpy as np
+    from bodocache.planner.minhash import make_lsh_index, minhash_signatures
+
+    rng = np.random.default_rng(0)
+    seqs = [rng.integers(0, 50, size=n).tolist() for n in (0, 1, 3, 40, 200)] + [[1, 2, 3] * 20]
+    nat = minhash_signatures(seqs, num_hashes=36, k=4, seed=7)
+    ref = minhash_signatures(seqs, num_hashes=36, k=4, seed=7, prefer_native=False)
+    assert np.array_equal(nat, ref)
+    sigs = np.concatenate([ref, ref[::-1]])
+    ids_nat = make_lsh_index(bands=9, rows=4)
+    ids_py = make_lsh_index(bands=9, rows=4, prefer_native=False)
+    assert np.array_equal(ids_nat.assign(sigs), ids_py.assign(sigs))
@@ -1,6 +1,7 @@
 from __future__ import annotations
 
 from bodocache.integrations.vllm_collectors import make_vllm_collector, make_vllm_dest_resolver
+from bodocache.planner.heat_sketch import PageHeatSketch
 
 
 class DummyBM:
@@ -35,3 +36,10 @@ def test_collectors_vllm():
     ptr = resolver({"layer": 0, "start_pid": 0, "end_pid": 2})
     assert isinstance(ptr, object)  # capsule-like
 
+
+def test_collector_records_heat():
+    heat = PageHeatSketch(width=1024, depth=4, k=64)
+    collector = make_vllm_collector(DummyEngine(), heat=heat)
+    collector(state=None)
+    collector(state=None)
+    assert heat.estimate(0, 1) == 2 and heat.estimate(1, 3) == 2
@@ -2,6 +2,7 @@ from __future__ import annotations
 
 import time
 import pandas as pd
+import pytest
 
 import bodocache.planner.scheduler as sched
 
@@ -43,3 +44,30 @@ def test_run_window_fallback_matches_py_core(monkeypatch):
     )
     # Same shape/columns and content equality for this deterministic input
     pd.testing.assert_frame_equal(ref.reset_index(drop=True), plan_df.reset_index(drop=True))
+
+
+def test_native_kernel_matches_py_core():
+    pytest.importorskip("bodocache_planner_kernel")
+    now_ms = int(time.time() * 1000)
+    rows = []
+    # Overlapping, nested and disjoint intervals over two nodes/layers/tenants
+    for i, (node, layer, ps, pe, tenant, dl) in enumerate([
+        ("n1", 0, 0, 10, "a", 30), ("n1", 0, 2, 3, "a", 10), ("n1", 0, 5, 6, "b", 20),
+        ("n1", 0, 14, 15, "a", 5), ("n0", 1, 4, 6, "b", 40), ("n0", 1, 6, 9, "a", 15),
+        ("n0", 0, 0, 0, "a", 25), ("n0", 0, 1, 2, "b", 25), ("n1", 1, 3, 3, "a", 50),
+    ]):
+        rows.append([i, node, "m", "v", f"p{i % 2}", layer, ps, pe, 0, 1, now_ms + dl, 64 * 1024, tenant, 1])
+    req = pd.DataFrame(rows, columns=[
+        "req_id","node","model_id","model_version","prefix_id","layer","page_start","page_end","tier_src","tier_dst","deadline_ms","page_bytes","tenant","est_fill_ms"
+    ]).assign(pcluster=0)
+    heat = pd.DataFrame([[0, 0, 10, 1.0]], columns=["layer","page_id","decay_hits","tenant_weight"])
+    tiers = pd.DataFrame([[1, 1 << 30, 0, 900 * 1024]], columns=["tier","free_bytes","inflight_io","bandwidth_caps"])
+    t_caps = pd.DataFrame([["a", 1, 700 * 1024]], columns=["tenant","tier","bandwidth_caps"])  # "b" uncapped
+    lats = pd.DataFrame([[0, 5.0]], columns=["layer","lat_ms"])
+    for kw in (dict(min_io_bytes=0, max_ops_per_tier=64, enforce_tier_caps=True),
+               dict(min_io_bytes=200 * 1024, max_ops_per_tier=2, enforce_tier_caps=False)):
+        args = (req, heat, tiers, t_caps, lats, now_ms, 0.0, -1e9, kw["min_io_bytes"], 1.0, 0.0, 20,
+                kw["max_ops_per_tier"], kw["enforce_tier_caps"])
+        ref = sched.run_window_core_py(*args)
+        got = sched.run_window_core_native(*args)
+        pd.testing.assert_frame_equal(ref, got)
@@ -0,0 +1,45 @@
+from __future__ import annotations
+
+import threading
+
+import numpy as np
+import pytest
+
+from bodocache.planner.heat_sketch import PageHeatSketch, make_page_heat_sketch
+
+
+def _exercise(sketch):
+    sketch.add(0, 7, 5)
+    sketch.add_batch(np.array([0, 1, 1]), np.array([7, 3, 3]))
+    assert sketch.estimate(0, 7) == 6
+    assert sketch.estimate(1, 3) == 2
+    assert list(sketch.estimate_batch(np.array([0, 1]), np.array([7, 3]))) == [6, 2]
+    heat = sketch.export_heat()
+    assert list(heat) == ["layer", "page_id", "decay_hits", "tenant_weight"]
+    assert list(heat["layer"]) == [0, 1] and list(heat["page_id"]) == [7, 3]
+    assert list(heat["decay_hits"]) == [6, 2]
+
+
+def test_page_heat_sketch_python():
+    _exercise(PageHeatSketch(width=1024, depth=4, k=64))
+
+
+def test_native_heat_sketch_threads():
+    pytest.importorskip("bodocache_heat_sketch")
+    _exercise(make_page_heat_sketch(width=1 << 14, depth=4, k=64, shards=4))
+
+    sketch = make_page_heat_sketch(width=1 << 16, depth=4, k=256, shards=8)
+    pages = np.arange(100, dtype=np.int64)
+
+    def worker():
+        for _ in range(50):
+            sketch.add_batch(np.zeros(len(pages), dtype=np.int64), pages)
+
+    threads = [threading.Thread(target=worker) for _ in range(4)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    # Atomic counters and per-shard locks: no lost hits
+    assert list(sketch.estimate_batch(np.zeros(3, dtype=np.int64), pages[:3])) == [200, 200, 200]
+    assert sketch.stats()["adds"] == 4 * 50 * 100
@@ -0,0 +1,61 @@
+from __future__ import annotations
+
+import pandas as pd
+
+from bodocache.planner.incremental import IncrementalPlanner
+from bodocache.planner.scheduler import run_window_core_py
+
+COLS = [
+    "req_id","node","model_id","model_version","prefix_id","layer","page_start","page_end",
+    "tier_src","tier_dst","deadline_ms","page_bytes","tenant","est_fill_ms","pcluster",
+]
+
+
+def _reqs(now_ms, start_id, n):
+    rows = []
+    for i in range(start_id, start_id + n):
+        ps = (i * 7) % 40
+        rows.append([i, f"n{i % 2}", "m", "v", f"p{i % 3}", i % 2, ps, ps + i % 4, 0, 1,
+                     now_ms + 5 + (i * 13) % 60, 64 * 1024, "ab"[i % 2], 1 + i % 3, i % 3])
+    return pd.DataFrame(rows, columns=COLS)
+
+
+def test_incremental_matches_full_replan():
+    now_ms = 1_000_000
+    tiers = pd.DataFrame([[1, 1 << 30, 0, 4 << 20]], columns=["tier","free_bytes","inflight_io","bandwidth_caps"])
+    t_caps = pd.DataFrame([["a", 1, 3 << 20]], columns=["tenant","tier","bandwidth_caps"])
+    lats = pd.DataFrame([[0, 5.0], [1, 2.0]], columns=["layer","lat_ms"])
+    heat = pd.DataFrame([[0, 0, 10, 1.0], [1, 7, 3, 1.0]], columns=["layer","page_id","decay_hits","tenant_weight"])
+    kw = dict(pmin=2.0, umin=4.0, min_io_bytes=128 * 1024, alpha=1.0, beta=0.0, window_ms=20,
+              max_ops_per_tier=16, enforce_tier_caps=True)
+    planner = IncrementalPlanner(**kw)
+    planner.add_requests(_reqs(now_ms, 0, 60))
+    planner.update_heat(heat)
+
+    prev = None
+    for step in range(4):
+        now = now_ms + 10 * step
+        if step == 1:
+            planner.cancel([3, 4, 5])
+            planner.add_requests(_reqs(now_ms, 60, 10))
+        if step == 2:
+            upd = pd.DataFrame([[0, 14, 50, 1.0]], columns=["layer","page_id","decay_hits","tenant_weight"])
+            planner.update_heat(upd)
+            heat = pd.concat([heat, upd]).drop_duplicates(["layer","page_id"], keep="last")
+            t_caps = pd.DataFrame([["a", 1, 1 << 20]], columns=["tenant","tier","bandwidth_caps"])
+        plan, delta = planner.plan(now, tiers, t_caps, lats)
+        ref = run_window_core_py(
+            planner.requests_df(), heat, tiers, t_caps, lats, now, kw["pmin"], kw["umin"], kw["min_io_bytes"],
+            kw["alpha"], kw["beta"], kw["window_ms"], kw["max_ops_per_tier"], kw["enforce_tier_caps"],
+        )
+        pd.testing.assert_frame_equal(ref, plan)
+        if prev is None:
+            assert len(delta.added) == len(plan) and delta.removed.empty
+        else:
+            assert len(prev) - len(delta.removed) + len(delta.added) == len(plan)
+        prev = plan
+
+    # A quiet window re-scores nothing beyond urgency crossings
+    _, delta = planner.plan(now, tiers, t_caps, lats)
+    assert delta.empty
+    assert planner.last_stats["rescored"] == 0 and planner.last_stats["recoalesced"] == 0
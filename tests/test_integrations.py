@@ -64,6 +64,29 @@ def test_node_agent_with_engine_path(tmp_path):
     assert ready, "on_ready should be called via engine path"
 
 
+def test_vllm_adapter_deferred_completions(tmp_path):
+    be = SegmentedFileBackend(str(tmp_path))
+    for pid in range(2):
+        be.write_page("m", "v", 0, pid, 4096, secrets.token_bytes(4096))
+    agent = NodeAgent(be, page_bytes=4096, copy_engine=SimCopyEngine())
+    adapter = VLLMBCacheAdapter(
+        agent, node="n0", model_id="m", model_version="v", min_io_bytes=0, defer_completions=True
+    )
+    now_ms = int(time.time() * 1000)
+    reqs = [KVRequest("r", "n0", "m", "v", "p", 0, 0, 1, 4096, "t", 1.0, 0, 2, now_ms + 1000)]
+    ready = []
+    res = adapter.prefetch(reqs, now_ms=now_ms, dest_resolver=lambda info: 0, on_ready=lambda info: ready.append(info))
+    assert res.exec_stats["ops"] >= 1
+    # Nothing is delivered until the caller polls
+    assert not ready
+    assert agent.pending_completions() == res.exec_stats["ops"]
+    fired = adapter.poll()
+    assert fired == res.exec_stats["ops"]
+    assert ready and all("route_hint" in info for info in ready)
+    assert agent.pending_completions() == 0
+    assert adapter.drain(timeout_ms=0) == 0
+
+
 def test_vllm_adapter_context_parallel_shard(tmp_path):
     be = SegmentedFileBackend(str(tmp_path))
     # Seed 4 pages for layer 0
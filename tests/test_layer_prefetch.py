@@ -0,0 +1,153 @@
+from __future__ import annotations
+
+import threading
+
+import numpy as np
+import pandas as pd
+
+from bodocache.adapters.segmented_file_backend import SegmentedFileBackend
+from bodocache.agent.copy_engine import SimCopyEngine
+from bodocache.agent.layer_prefetch import LayerAheadPrefetcher, copy_rate_from_stats
+from bodocache.agent.node_agent import NodeAgent
+
+PAGE = 4096
+LAYERS = 6
+
+
+class _FencingEngine(SimCopyEngine):
+    # Sim engine whose telemetry says 8 pages take 2.5 ms, recording readiness fences
+    def __init__(self) -> None:
+        super().__init__()
+        self.fences = []
+
+    def stats(self):
+        stream = {"ops": 1, "bytes": 8 * PAGE, "dma_ns": {"p90_ns": 2_500_000}, "queue_wait_ns": {"p90_ns": 0}}
+        return {"devices": {0: {"streams": {0: stream}}}}
+
+    def stream_wait_ops(self, op_ids, stream, gpu_id=None):
+        self.fences.append((sorted(int(x) for x in op_ids), int(stream)))
+        return 0
+
+
+class _AsyncEngine(SimCopyEngine):
+    # Completes ops only on complete(), through one engine-wide callback that every submit
+    # replaces, like the native engine
+    def __init__(self) -> None:
+        super().__init__()
+        self._cb = None
+        self.inflight = {}
+        self.fences = []
+
+    def submit_array(self, src_ptr, dst_ptr, bytes, stream_id=None, gpu_id=None, deadline_ms=None, tag=None,
+                     callback=None, **_cols):
+        first = self._next_op_id
+        self._next_op_id += len(src_ptr)
+        self._cb = callback
+        for i in range(len(src_ptr)):
+            self.inflight[first + i] = {"op_id": first + i, "tag": int(tag[i]), "bytes": int(bytes[i]), "status": 0}
+        return first
+
+    def complete(self, op_ids=None):
+        for op_id in sorted(self.inflight if op_ids is None else op_ids, reverse=True):
+            self._cb(self.inflight.pop(op_id))
+
+    def stream_wait_ops(self, op_ids, stream, gpu_id=None):
+        self.fences.append(sorted(int(x) for x in op_ids))
+        return 0
+
+
+def _setup(tmp_path, engine):
+    backend = SegmentedFileBackend(str(tmp_path))
+    for layer in range(LAYERS):
+        for pid in range(8):
+            backend.write_page("m", "v", layer, pid, PAGE, bytes([layer]) * PAGE)
+    plan = pd.DataFrame({
+        "node": "n0", "tier_dst": 2, "layer": np.arange(LAYERS), "start_pid": 0, "end_pid": 7,
+        "page_bytes": PAGE, "overlap": 1,
+    })
+    dst = np.zeros(LAYERS * 8 * PAGE, dtype=np.uint8)
+    agent = NodeAgent(backend, page_bytes=PAGE, copy_engine=engine)
+    return agent, plan, lambda info: int(dst.ctypes.data) + info["layer"] * 8 * PAGE, dst
+
+
+def test_fixed_lookahead_issues_layer_by_layer(tmp_path):
+    agent, plan, resolver, _ = _setup(tmp_path, SimCopyEngine())
+    ready = []
+    pf = LayerAheadPrefetcher(agent, "m", "v", dest_resolver=resolver, on_ready=ready.append, lookahead=1,
+                              prefer_native_engine=False)
+    assert pf.begin(plan)["layers_issued"] == 2
+    assert sorted(r["layer"] for r in ready) == [0, 1] and pf.ready(1) and not pf.ready(2)
+    pf.layer_started(0)
+    pf.layer_started(1)
+    assert pf.stats()["layers_issued"] == 3
+    # Layer 4 is needed before compute got there: issued on demand, with layer 3 before it
+    assert pf.wait_layer(4)
+    assert sorted(r["layer"] for r in ready) == [0, 1, 2, 3, 4]
+    st = pf.stats()
+    assert st["demand_issues"] == 1 and st["late_layers"] == 0 and st["on_time_layers"] == 2
+    assert pf.lat_ms[0] >= 0.0
+
+
+def test_adaptive_lookahead_and_stream_fences(tmp_path):
+    engine = _FencingEngine()
+    agent, plan, resolver, _ = _setup(tmp_path, engine)
+    per_ns, fixed_ns = copy_rate_from_stats(engine.stats())
+    assert per_ns == 8 * PAGE / 2_500_000 and fixed_ns == 0
+    lats = pd.DataFrame({"layer": np.arange(LAYERS), "lat_ms": 1.0})
+
+    # 2.5 ms per layer against 1 ms of compute per layer: the third layer ahead fits
+    pf = LayerAheadPrefetcher(agent, "m", "v", lats, dest_resolver=resolver, defer_completions=True,
+                              prefer_native_engine=False)
+    pf.begin(plan)
+    assert pf.lookahead == 3 and pf.stats()["layers_issued"] == 4
+    assert not pf.ready(0)
+
+    # Compute waits on the device for layer 1's copies only; the host does not block
+    assert pf.wait_layer(1, stream=0xBEEF)
+    assert engine.fences == [(pf._op_ids[1], 0xBEEF)] and not pf.ready(1)
+    # Without a stream the copies are awaited on the host
+    assert pf.wait_layer(2) and pf.ready(2)
+    assert pf.stats()["fenced_waits"] == 1 and pf.stats()["host_waits"] == 1
+
+    # The swap window bounds the lookahead
+    pf.begin(plan, wave={"swap_window": (4, 6)})
+    assert pf.lookahead == 2 and pf.stats()["layers_issued"] == 4 + 3
+
+
+def test_late_layers_raise_lookahead(tmp_path):
+    agent, plan, resolver, _ = _setup(tmp_path, SimCopyEngine())
+    pf = LayerAheadPrefetcher(agent, "m", "v", dest_resolver=resolver, defer_completions=True, max_lookahead=4,
+                              prefer_native_engine=False)
+    pf.begin(plan)
+    assert pf.lookahead == 1
+    # Nothing was polled, so compute reaches layer 0 before its copies have landed
+    pf.layer_started(0)
+    assert pf.stats()["late_layers"] == 1 and pf.lookahead == 2
+    assert pf.wait_layer(0, timeout_ms=1000) and agent.pending_completions() == 0
+
+
+def test_overlapping_layer_groups_complete_asynchronously(tmp_path):
+    engine = _AsyncEngine()
+    agent, plan, resolver, _ = _setup(tmp_path, engine)
+    pf = LayerAheadPrefetcher(agent, "m", "v", dest_resolver=resolver, lookahead=2, prefer_native_engine=False)
+    pf.begin(plan)
+    ops = {L: list(pf._op_ids[L]) for L in range(3)}
+    assert len(engine.inflight) == 3 and all(len(v) == 1 for v in ops.values())
+
+    # The newest group's copy lands first: only its layer is ready
+    engine.complete(ops[2])
+    assert pf.ready(2) and not pf.ready(0) and not pf.ready(1)
+    assert pf.wait_layer(0, stream=0xBEEF) and engine.fences == [ops[0]] and not pf.ready(0)
+
+    # A host wait blocks until that layer's own copy has landed
+    t = threading.Timer(0.05, engine.complete, args=(ops[1],))
+    t.start()
+    assert pf.wait_layer(1, timeout_ms=5000)
+    t.join()
+    assert pf.ready(1) and not pf.ready(0)
+    pf.layer_started(0)
+    assert pf.stats()["late_layers"] == 1 and len(engine.inflight) == 1
+    pf.layer_started(1)
+    assert pf.stats()["on_time_layers"] == 1 and len(engine.inflight) == 2
+    engine.complete()
+    assert all(pf.ready(L) for L in range(4))
@@ -0,0 +1,64 @@
+from __future__ import annotations
+
+import numpy as np
+import pytest
+
+from bodocache.planner.models import PageKey, Tier
+from bodocache.planner.page_table import CompactPageTable, Location, PageTable
+
+
+def _key(layer: int, pid: int) -> PageKey:
+    return PageKey("m", "v1", "fp16", 8, 128, layer, pid)
+
+
+def test_compact_table_matches_dict_table():
+    ref, cpt = PageTable(), CompactPageTable(prefer_native=False)
+    keys = [_key(l, p) for l in range(2) for p in range(6)]
+    locs = [Location(tier=Tier.CPU if p % 3 else Tier.GPU, node="n1", gpu_id=p % 2 or None) for l in range(2) for p in range(6)]
+    for k, loc in zip(keys, locs):
+        ref.set(k, loc)
+    cpt.bulk_set(keys, locs)
+    cpt.set(_key(0, 9), Location(tier=Tier.STORAGE, path="/seg/0"))
+    ref.set(_key(0, 9), Location(tier=Tier.STORAGE, path="/seg/0"))
+    probe = keys + [_key(0, 9), _key(3, 1), PageKey("other", "v1", "fp16", 8, 128, 0, 0)]
+    assert cpt.bulk_get(probe) == ref.bulk_get(probe)
+    assert len(cpt) == len(keys) + 1
+
+
+def test_resident_runs_follow_tier_moves():
+    t = CompactPageTable(prefer_native=False)
+    m = t.model_code("m", "v1")
+    t.bulk_set_pages(m, np.zeros(10, dtype=np.int64), np.arange(10), Tier.CPU, node="n1")
+    t.bulk_set_pages(m, [0, 0], [3, 4], Tier.GPU, node="n1", gpu_id=0)
+    t.bulk_set_pages(m, [1, 1, 1], [7, 8, 20], Tier.CPU, node="n2")
+    runs = t.resident_runs("m", "v1", Tier.CPU)
+    assert list(runs.itertuples(index=False, name=None)) == [(0, 0, 2), (0, 5, 9), (1, 7, 8), (1, 20, 20)]
+    on_n1 = t.resident_runs("m", "v1", Tier.CPU, layers=[1], node="n1")
+    assert on_n1.empty
+    got = t.bulk_get_pages(m, [0, 0, 5], [3, 5, 0])
+    assert got["tier"].tolist() == [Tier.GPU.value, Tier.CPU.value, -1]
+    assert got["gpu_id"].tolist() == [0, -1, -1]
+    assert t.erase_pages(m, [0, 0], [5, 6]) == 2
+    assert list(t.resident_runs("m", "v1", Tier.CPU, layers=[0]).page_start) == [0, 7]
+
+
+def test_native_page_table_matches_python():
+    pytest.importorskip("bodocache_page_table")
+    rng = np.random.default_rng(0)
+    tables = [CompactPageTable(), CompactPageTable(prefer_native=False)]
+    for t in tables:
+        m = t.model_code("m", "v1")
+        r = np.random.default_rng(1)
+        for _ in range(20):
+            n = 200
+            t.bulk_set_pages(m, r.integers(0, 4, n), r.integers(0, 500, n), int(r.integers(0, 3)),
+                             node=int(r.integers(0, 2)))
+            t.erase_pages(m, r.integers(0, 4, 50), r.integers(0, 500, 50))
+    layer, pid = rng.integers(0, 5, 1000), rng.integers(0, 600, 1000)
+    a, b = (t.bulk_get_pages(0, layer, pid) for t in tables)
+    for col in ("tier", "node", "gpu_id"):
+        assert np.array_equal(a[col], b[col])
+    assert len(tables[0]) == len(tables[1])
+    for tier in Tier:
+        ra, rb = (t.resident_runs("m", "v1", tier) for t in tables)
+        assert ra.equals(rb)
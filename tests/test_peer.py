@@ -0,0 +1,225 @@
+from __future__ import annotations
+
+import secrets
+import socket
+import struct
+import time
+
+import numpy as np
+import pandas as pd
+import pytest
+
+from bodocache.adapters.segmented_file_backend import SegmentedFileBackend
+from bodocache.agent.copy_engine import PEER_RECV, SimCopyEngine
+from bodocache.agent.node_agent import NodeAgent
+from bodocache.agent.peer import MAX_META_BYTES, MAGIC, PeerClient, PeerPageServer, PeerTier, backend_page_source
+from bodocache.planner.models import PageKey, Tier
+from bodocache.planner.page_table import CompactPageTable, Location, PageTable
+from bodocache.planner.peer import route_peer_requests
+from bodocache.planner.scheduler import run_window
+
+PAGE = 4096
+
+
+def _table(holders):
+    # holders: {(layer, page_id): node}
+    t = CompactPageTable(prefer_native=False)
+    m = t.model_code("m", "v")
+    t.node_code("n0")
+    for (layer, pid), node in holders.items():
+        t.bulk_set_remote_pages(m, [layer], [pid], Tier.CPU, node)
+    return t
+
+
+def test_page_table_remote_locations():
+    pt = PageTable()
+    key = PageKey("m", "v", "bf16", 8, 128, 0, 7)
+    pt.set_remote(key, Location(tier=Tier.GPU, node="n1", gpu_id=2))
+    assert pt.get_remote(key).node == "n1" and pt.get(key) is None
+
+    t = CompactPageTable(prefer_native=False)
+    t.set_remote(key, Location(tier=Tier.GPU, node="n1", gpu_id=2))
+    assert t.get_remote(key) == Location(tier=Tier.GPU, node="n1", gpu_id=2) and t.get(key) is None
+    m = t.model_code("m", "v", "bf16", 8, 128)
+    t.bulk_set_remote_pages(m, [0, 0, 0, 1], [3, 4, 5, 4], Tier.CPU, "n2")
+    runs = t.remote_runs("m", "v")
+    assert runs[["layer", "page_start", "page_end", "peer_node"]].values.tolist() == [
+        [0, 3, 5, "n2"], [0, 7, 7, "n1"], [1, 4, 4, "n2"],
+    ]
+    held = t.remote_holders("m", "v", [0, 0, 0], [3, 6, 7])
+    assert held["node"].tolist() == [t.node_code("n2"), -1, t.node_code("n1")]
+    assert t.drop_remote_node("n2") == 4
+    assert t.remote_runs("m", "v", exclude_node="n1").empty
+    assert t.erase_remote(key) and t.stats()["remote"] == 0
+
+
+def test_route_peer_requests_splits_remote_runs():
+    t = _table({(0, p): "n1" for p in (2, 3, 4, 9)} | {(0, 5): "n0"})
+    cols = ["req_id", "node", "model_id", "model_version", "layer", "page_start", "page_end", "tier_src"]
+    req = pd.DataFrame([
+        [0, "n0", "m", "v", 0, 0, 9, 0],
+        [1, "n0", "m", "v", 0, 2, 4, 1],  # CPU source: left alone
+        [2, "n1", "m", "v", 0, 2, 4, 0],  # n1 holds these itself
+    ], columns=cols)
+    out = route_peer_requests(req, t)
+    assert out[["req_id", "page_start", "page_end", "tier_src"]].values.tolist() == [
+        [0, 0, 1, 0], [0, 2, 4, 3], [0, 5, 8, 0], [0, 9, 9, 3], [1, 2, 4, 1], [2, 2, 4, 0],
+    ]
+    short = route_peer_requests(req, t, min_pages=2)
+    assert short["tier_src"].tolist() == [0, 3, 0, 1, 0]
+    rest = req.iloc[1:]
+    assert route_peer_requests(rest, t) is rest
+
+
+def test_peer_link_caps():
+    now_ms = int(time.time() * 1000)
+    cols = ["req_id", "node", "model_id", "model_version", "prefix_id", "layer", "page_start", "page_end",
+            "tier_src", "tier_dst", "deadline_ms", "page_bytes", "tenant", "est_fill_ms"]
+    req = pd.DataFrame([
+        [i, "n0", "m", "v", f"p{i}", 0, 8 * i, 8 * i + 3, 3 if i < 3 else 0, 2, now_ms + 10 * (i + 1), 256 * 1024, "t", 1]
+        for i in range(5)
+    ], columns=cols)
+    heat = pd.DataFrame([[0, 0, 1, 1.0]], columns=["layer", "page_id", "decay_hits", "tenant_weight"])
+    tenant_caps = pd.DataFrame([["t", 2, 1 << 40]], columns=["tenant", "tier", "bandwidth_caps"])
+    lats = pd.DataFrame([[0, 1.0]], columns=["layer", "lat_ms"])
+    knobs = dict(pmin=0.0, umin=-1.0, min_io_bytes=0, enable_admission=False, enable_eviction=False)
+    tiers = pd.DataFrame([[2, 1 << 40, 1 << 40]], columns=["tier", "bandwidth_caps", "free_bytes"])
+    base = run_window(req, heat, tiers, tenant_caps, lats, now_ms, **knobs)[0]
+    assert (base["tier_src"] == 3).sum() == 3
+
+    # A link budget of two peer ops keeps the two earliest; storage ops are untouched
+    link = pd.concat([tiers, pd.DataFrame([[3, 2 << 20, 0]], columns=tiers.columns)], ignore_index=True)
+    plan = run_window(req, heat, link, tenant_caps, lats, now_ms, **knobs)[0]
+    peer = plan[plan["tier_src"] == 3]
+    assert sorted(peer["start_pid"].tolist()) == [0, 8]
+    pd.testing.assert_frame_equal(plan[plan["tier_src"] == 0].reset_index(drop=True),
+                                  base[base["tier_src"] == 0].reset_index(drop=True))
+    assert (peer["overlap"] == 3).all()  # 1 MiB over a 2 MiB/window link outlasts the layer
+    uncapped = run_window(req, heat, link, tenant_caps, lats, now_ms, enforce_tier_caps=False, **knobs)[0]
+    assert (uncapped["tier_src"] == 3).sum() == 3
+
+
+def test_peer_fetch_and_agent(tmp_path):
+    remote = SegmentedFileBackend(str(tmp_path / "n1"))
+    local = SegmentedFileBackend(str(tmp_path / "n0"))
+    data = [secrets.token_bytes(PAGE) for _ in range(8)]
+    for pid, d in enumerate(data):
+        remote.write_page("m", "v", 0, pid, PAGE, d)
+        local.write_page("m", "v", 0, pid, PAGE, d)
+
+    with PeerPageServer(backend_page_source(remote), "127.0.0.1:0") as server:
+        client = PeerClient({"n1": server.address, "gone": "127.0.0.1:1"}, timeout=2.0)
+        buf = bytearray(3 * PAGE)
+        assert client.fetch_into("n1", "m", "v", 0, 2, 4, PAGE, buf)
+        assert bytes(buf) == b"".join(data[2:5])
+        assert not client.fetch_into("n1", "m", "v", 5, 0, 0, PAGE, bytearray(PAGE))  # miss
+        assert not client.fetch_into("gone", "m", "v", 0, 0, 0, PAGE, bytearray(PAGE))
+        assert not client.request_device_send("n1", "m", "v", 0, 0, 0, PAGE, rank=0)  # no device sender
+
+        t = _table({(0, p): "n1" for p in range(0, 4)} | {(0, p): "gone" for p in range(4, 6)})
+        engine = SimCopyEngine()
+        agent = NodeAgent(local, page_bytes=PAGE, copy_engine=engine,
+                          peer=PeerTier(t, client, node="n0", ranks={"n0": 0, "n1": 1}))
+        plan = pd.DataFrame({
+            "node": "n0", "tier_src": [3, 3, 0], "tier_dst": 2, "layer": 0,
+            "start_pid": [0, 4, 6], "end_pid": [3, 5, 7], "page_bytes": PAGE, "overlap": 1,
+        })
+        ready = []
+        dst = np.zeros(8 * PAGE, dtype=np.uint8)
+        stats = agent.execute(plan, "m", "v", on_ready=ready.append,
+                              dest_resolver=lambda info: int(dst.ctypes.data) + info["start_pid"] * PAGE,
+                              prefer_native_engine=False)
+        client.close()
+    assert stats["ops"] == 3 and stats["bytes"] == 8 * PAGE
+    assert sorted(r["start_pid"] for r in ready) == [0, 4, 6]
+    # "gone" is unreachable, so its run was read from local storage instead
+    assert agent.peer.stats() == {"ops": 2, "bytes": 6 * PAGE, "device_runs": 0, "storage_runs": 1,
+                                   "fallback_ops": 0}
+
+
+class _DstEngine(SimCopyEngine):
+    # Records every destination address it was handed
+    def __init__(self):
+        super().__init__()
+        self.dsts = []
+
+    def submit(self, ops, callback=None):
+        self.dsts += [int(op.dst) for op in ops]
+        return super().submit(ops, callback)
+
+    def submit_array(self, src_ptr, dst_ptr, bytes, *args, **kwargs):
+        self.dsts += [int(d) for d in dst_ptr]
+        return super().submit_array(src_ptr, dst_ptr, bytes, *args, **kwargs)
+
+    def execute_plan(self, files, file_index, offsets, sizes, dst_ptr, *args, **kwargs):
+        self.dsts += [int(d) for d in dst_ptr]
+        return super().execute_plan(files, file_index, offsets, sizes, dst_ptr, *args, **kwargs)
+
+
+@pytest.mark.parametrize("plan_engine", [True, False])
+def test_columnar_keeps_row_destinations_with_peer_rows(tmp_path, plan_engine):
+    remote = SegmentedFileBackend(str(tmp_path / "n1"))
+    local = SegmentedFileBackend(str(tmp_path / "n0"))
+    for pid in range(6):
+        remote.write_page("m", "v", 0, pid, PAGE, bytes([pid]) * PAGE)
+        local.write_page("m", "v", 0, pid, PAGE, bytes([pid]) * PAGE)
+    with PeerPageServer(backend_page_source(remote)) as server, PeerClient({"n1": server.address}) as client:
+        engine = _DstEngine()
+        if not plan_engine:
+            engine.execute_plan = None  # per-row execute() fallback
+        t = _table({(0, p): "n1" for p in (2, 3)})
+        agent = NodeAgent(local, page_bytes=PAGE, copy_engine=engine, peer=PeerTier(t, client, node="n0"))
+        # The peer row sits between storage rows, but is resolved first
+        plan = pd.DataFrame({
+            "node": "n0", "tier_src": [0, 3, 0], "tier_dst": 2, "layer": 0,
+            "start_pid": [0, 2, 4], "end_pid": [1, 3, 5], "page_bytes": PAGE, "overlap": 1,
+        })
+        dst = [0x10000, 0x20000, 0x30000]
+        ready = []
+        stats = agent.execute_columnar(plan, "m", "v", dst, on_ready=ready.append)
+    assert stats["ops"] == 3 and agent.peer.stats()["ops"] == 1
+    assert sorted(engine.dsts) == dst
+    assert sorted((r["row"], r["start_pid"]) for r in ready) == [(0, 0), (1, 2), (2, 4)]
+
+
+def test_peer_server_token_and_meta_cap(tmp_path):
+    remote = SegmentedFileBackend(str(tmp_path))
+    remote.write_page("m", "v", 0, 0, PAGE, b"\x07" * PAGE)
+    with PeerPageServer(backend_page_source(remote), token="s3cret") as server:
+        assert server.address.startswith("127.0.0.1:")
+        buf = bytearray(PAGE)
+        with PeerClient({"n1": server.address}, timeout=2.0) as anon:
+            assert not anon.fetch_into("n1", "m", "v", 0, 0, 0, PAGE, buf)
+        with PeerClient({"n1": server.address}, timeout=2.0, token="s3cret") as client:
+            assert client.fetch_into("n1", "m", "v", 0, 0, 0, PAGE, buf) and bytes(buf) == b"\x07" * PAGE
+        # An oversized meta length is refused before anything is allocated for it
+        host, port = server.address.rsplit(":", 1)
+        with socket.create_connection((host, int(port)), timeout=2.0) as sock:
+            sock.sendall(struct.pack("<4sI", MAGIC, MAX_META_BYTES + 1))
+            assert sock.recv(1) == b""
+
+
+def test_peer_device_sender_posts_engine_sends(tmp_path):
+    holder_engine = SimCopyEngine()
+    holder_engine.peer_init(holder_engine.peer_unique_id(), nranks=2, rank=1)
+    holder = NodeAgent(SegmentedFileBackend(str(tmp_path)), page_bytes=PAGE, copy_engine=holder_engine)
+    resident = {(0, 2): 0xD000}  # (layer, start_pid) -> device address on the holder
+    sender = holder.peer_device_sender(lambda info: resident.get((info["layer"], info["start_pid"])))
+    with PeerPageServer(lambda *a: None, device_sender=sender) as server:
+        with PeerClient({"n1": server.address}, timeout=2.0) as client:
+            assert client.request_device_send("n1", "m", "v", 0, 2, 3, PAGE, rank=0)
+            assert not client.request_device_send("n1", "m", "v", 0, 4, 4, PAGE, rank=0)  # not resident
+    assert holder_engine.peer_stats() == {"peer_ops": 1, "peer_bytes": 2 * PAGE}
+    assert not holder._routes and not holder._early and holder.issued_op_ids == []
+
+
+def test_sim_engine_peer_ops():
+    eng = SimCopyEngine()
+    with pytest.raises(RuntimeError):
+        eng.submit_peer([1], [PAGE], [1])
+    eng.peer_init(eng.peer_unique_id(), nranks=2, rank=0)
+    first = eng.submit_peer([1, 2], [PAGE, PAGE], [1, 1], send=[0, 1])
+    recs = eng.poll()
+    assert [r["op_id"] for r in recs] == [first, first + 1]
+    assert recs[0]["direction"] == PEER_RECV
+    assert eng.peer_stats() == {"peer_ops": 2, "peer_bytes": 2 * PAGE}
@@ -0,0 +1,43 @@
+from __future__ import annotations
+
+import pandas as pd
+
+from bodocache.planner.scheduler import run_window_core_py
+from bodocache.sim.replay import (
+    STAGES,
+    PlannerCostModel,
+    load_trace,
+    save_trace,
+    scaling_curve,
+    synthetic_trace,
+    time_stages,
+)
+
+
+def test_trace_roundtrip_and_stage_timings(tmp_path):
+    tables, now_ms = synthetic_trace(500, n_layers=4, seed=1)
+    save_trace(tables, str(tmp_path), now_ms=now_ms, fmt="csv")
+    loaded, loaded_now = load_trace(str(tmp_path))
+    assert loaded_now == now_ms
+    assert len(loaded["requests"]) == 500
+    pd.testing.assert_frame_equal(loaded["layer_lat"], tables["layer_lat"])
+
+    stages = time_stages(loaded, loaded_now, repeat=1, pmin=0.0, umin=-1.0)
+    for s in STAGES:
+        assert stages[f"{s}_ms"] >= 0.0
+    # The staged timings run the same pipeline as the pandas core
+    req = loaded["requests"].assign(pcluster=pd.factorize(loaded["requests"]["prefix_id"])[0])
+    plan = run_window_core_py(
+        req, loaded["heat"], loaded["tier_caps"], loaded["tenant_caps"], loaded["layer_lat"], loaded_now,
+        0.0, -1.0, 512 * 1024, 1.0, 0.0, 20, 64, True,
+    )
+    assert stages["ops"] == len(plan) > 0
+
+
+def test_scaling_curve_cost_model():
+    curve = scaling_curve([200, 800], layers=[2], repeat=1, backends=["pandas"], pmin=0.0, umin=-1.0)
+    assert set(curve["backend"]) == {"stages", "pandas", "run_window"}
+    assert sorted(curve["requests"].unique()) == [200, 800]
+    model = PlannerCostModel.fit(curve)
+    again = PlannerCostModel.from_json(model.to_json())
+    assert again.predict_ms(10_000, "pandas") == model.predict_ms(10_000, "pandas") >= 0.0
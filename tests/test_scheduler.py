@@ -4,6 +4,7 @@ import time
 
 import pandas as pd
 
+from bodocache.planner.pipeline import merge_layer_runs
 from bodocache.planner.scheduler import run_window
 
 
@@ -108,3 +109,38 @@ def test_admission_eviction_gating():
     plan_df, evict_df, admission_df = run_window(req, heat, tiers, t_caps, lats, now_ms, pmin=0.0, umin=-1.0, enable_admission=False, enable_eviction=False)
     assert evict_df.empty
     assert admission_df.empty
+
+
+def test_merge_layer_runs():
+    cols = ["node", "tier_src", "tier_dst", "pcluster", "layer", "run_id", "bytes", "deadline_ms",
+            "fanout", "overlap", "priority", "start_pid", "end_pid", "page_bytes"]
+    plan = pd.DataFrame([
+        ["n0", 0, 1, 0, 0, 0, 4096, 30, 1, 1, 2.0, 0, 0, 4096],
+        ["n0", 0, 1, 0, 1, 0, 4096, 20, 1, 2, 1.0, 0, 0, 4096],
+        ["n0", 0, 1, 0, 3, 0, 4096, 10, 1, 1, 0.5, 0, 0, 4096],  # layer gap: separate op
+        ["n0", 0, 1, 0, 2, 1, 8192, 10, 1, 1, 0.5, 4, 5, 4096],  # other pages
+    ], columns=cols)
+    out = merge_layer_runs(plan)
+    assert len(out) == 3
+    first = out.iloc[0]
+    assert (first["layer"], first["layer_end"], first["bytes"]) == (0, 1, 8192)
+    assert (first["deadline_ms"], first["overlap"], first["priority"], first["fanout"]) == (20, 2, 1.0, 2)
+    assert (out["layer"] == out["layer_end"]).iloc[1:].all()
+
+
+def test_stored_page_bytes_sizes_plan():
+    now_ms = int(time.time() * 1000)
+    cols = ["req_id", "node", "model_id", "model_version", "prefix_id", "layer", "page_start", "page_end",
+            "tier_src", "tier_dst", "deadline_ms", "page_bytes", "tenant", "est_fill_ms", "stored_page_bytes"]
+    req = pd.DataFrame([[0, "n0", "m", "v", "p0", 0, 0, 7, 0, 1, now_ms + 1000, 256 * 1024, "t", 1, 132 * 1024]], columns=cols)
+    heat = pd.DataFrame([[0, 0, 10, 1.0]], columns=["layer", "page_id", "decay_hits", "tenant_weight"])
+    tiers = pd.DataFrame([[0, 1 << 30, 0, 1 << 30], [1, 1 << 30, 0, 1 << 30]], columns=["tier", "free_bytes", "inflight_io", "bandwidth_caps"])
+    t_caps = pd.DataFrame([["t", 0, 1 << 40], ["t", 1, 1 << 40]], columns=["tenant", "tier", "bandwidth_caps"])
+    lats = pd.DataFrame([[0, 5.0]], columns=["layer", "lat_ms"])
+    plain, _, _ = run_window(req.drop(columns=["stored_page_bytes"]), heat, tiers, t_caps, lats, now_ms, min_io_bytes=0)
+    packed, _, _ = run_window(req, heat, tiers, t_caps, lats, now_ms, min_io_bytes=0)
+    # bytes (and so caps and copy-time estimates) follow the stored size; offsets stay logical
+    assert int(plain["bytes"].iloc[0]) == 8 * 256 * 1024
+    assert int(packed["bytes"].iloc[0]) == 8 * 132 * 1024
+    assert int(packed["page_bytes"].iloc[0]) == 256 * 1024
+    assert int(packed["stored_page_bytes"].iloc[0]) == 132 * 1024
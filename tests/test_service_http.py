@@ -0,0 +1,27 @@
+from __future__ import annotations
+
+from bodocache.agent.copy_engine import SimCopyEngine
+from bodocache.planner.service_http import prometheus_metrics
+
+
+def test_engine_stats_prometheus(tmp_path):
+    seg = tmp_path / "seg.bin"
+    seg.write_bytes(b"\0" * 8192)
+    eng = SimCopyEngine()
+    eng.submit_array([1, 2], [3, 4], [4096, 4096], stream_id=[0, 1], deadline_ms=[1, 0])
+    eng.execute_plan([str(seg)], [0], [0], [8192], [5], tier=[2])
+    st = eng.stats()
+    dev = st["devices"][0]
+    assert dev["ops"] == 3 and dev["bytes"] == 16384 and dev["deadline_misses"] == 1
+    assert dev["streams"][0]["e2e_ns"]["count"] == 2 and dev["streams"][0]["read_ns"]["count"] == 1
+    assert st["tiers"] == {2: {"bytes": 8192, "bytes_per_s": st["tiers"][2]["bytes_per_s"]}}
+
+    text = prometheus_metrics({"n0": st})
+    assert '# TYPE bodocache_engine_latency_seconds summary' in text
+    assert 'bodocache_engine_ops_total{node="n0",gpu="0",stream="0"} 2' in text
+    assert 'bodocache_engine_tier_bytes_total{node="n0",tier="2"} 8192' in text
+    assert 'bodocache_engine_latency_seconds_count{node="n0",gpu="0",stream="0",phase="e2e"} 2' in text
+
+    eng.reset_stats()
+    assert eng.stats()["devices"] == {}
+    assert prometheus_metrics({}) == "\n"
@@ -0,0 +1,90 @@
+from __future__ import annotations
+
+import socket
+import struct
+import threading
+import time
+
+import pandas as pd
+import pytest
+
+pytest.importorskip("pyarrow")
+
+from bodocache.planner.service_http import plan_from_frames
+from bodocache.planner.service_rpc import (
+    KIND_ERROR, KIND_PLAN, MAGIC, MAX_META_BYTES, PlannerRPCClient, make_rpc_server, recv_message, send_message,
+)
+from bodocache.sim.utils import synthetic_heat, synthetic_layer_lat, synthetic_tenant_caps, synthetic_tier_caps
+
+
+@pytest.mark.parametrize("use_shm", [False, True])
+def test_rpc_plan_matches_frames(use_shm, tmp_path):
+    now_ms = int(time.time() * 1000)
+    req = pd.DataFrame({
+        "req_id": [0, 1, 2], "node": ["n0", "n0", "n1"], "model_id": "m", "model_version": "v",
+        "prefix_id": ["p1", "p1", "p2"], "layer": [0, 0, 1], "page_start": [0, 2, 0], "page_end": [1, 3, 3],
+        "tier_src": 0, "tier_dst": 1, "deadline_ms": now_ms + 500, "page_bytes": 256 * 1024,
+        "tenant": ["A", "A", "B"], "est_fill_ms": 1,
+    })
+    tables = (req, synthetic_heat(req), synthetic_tier_caps(), synthetic_tenant_caps(req["tenant"], 1 << 30),
+              synthetic_layer_lat(2))
+    knobs = {"pmin": 0.0, "umin": -1.0, "enable_admission": False, "enable_eviction": False}
+    if use_shm and not hasattr(socket, "AF_UNIX"):
+        pytest.skip("shared-memory requests need unix sockets")
+    address = f"unix:{tmp_path / 'p.sock'}" if use_shm else "127.0.0.1:0"
+    server = make_rpc_server(address)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    try:
+        if not use_shm:
+            host, port = server.server_address[:2]
+            address = f"{host}:{port}"
+        with PlannerRPCClient(address, use_shm=use_shm) as client:
+            for _ in range(2):  # persistent connection, reused segment
+                plan, evict, admission = client.get_plan(*tables, now_ms, knobs)
+        expected = plan_from_frames(*tables, now_ms, knobs)[0]
+        assert len(plan) == len(expected) > 0
+        pd.testing.assert_frame_equal(plan.reset_index(drop=True), expected.reset_index(drop=True), check_dtype=False)
+        with PlannerRPCClient(address) as client:
+            with pytest.raises(RuntimeError, match="planner error"):
+                client.get_plan(req.drop(columns=["tenant"]), *tables[1:], now_ms, knobs)
+    finally:
+        server.shutdown()
+        server.server_close()
+
+
+def test_rpc_rejects_shm_over_tcp():
+    server = make_rpc_server("127.0.0.1:0")
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    try:
+        with pytest.raises(ValueError, match="unix"):
+            PlannerRPCClient("%s:%d" % server.server_address[:2], use_shm=True)
+        with socket.create_connection(server.server_address[:2], timeout=5) as sock:
+            send_message(sock, KIND_PLAN, {"tables": [], "shm": "psm_not_ours", "body_bytes": 0})
+            kind, meta, _ = recv_message(sock)
+        assert kind == KIND_ERROR and "unix" in meta["error"]
+    finally:
+        server.shutdown()
+        server.server_close()
+
+
+def test_rpc_token_and_frame_caps():
+    server = make_rpc_server(":0", token="s3cret")
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    try:
+        host, port = server.server_address[:2]
+        assert host == "127.0.0.1"
+        with PlannerRPCClient(f"{host}:{port}") as client:
+            with pytest.raises(RuntimeError, match="token"):
+                client.get_plan(*[pd.DataFrame()] * 5, 0)
+        # Oversized frames are refused from the header or meta alone
+        with socket.create_connection((host, port), timeout=5) as sock:
+            sock.sendall(struct.pack("<4sIQ", MAGIC, KIND_PLAN, MAX_META_BYTES + 1))
+            kind, meta, _ = recv_message(sock)
+            assert kind == KIND_ERROR and "exceeds" in meta["error"]
+        with socket.create_connection((host, port), timeout=5) as sock:
+            send_message(sock, KIND_PLAN, {"token": "s3cret", "body_bytes": 1 << 40})
+            kind, meta, _ = recv_message(sock)
+            assert kind == KIND_ERROR and "exceeds" in meta["error"]
+    finally:
+        server.shutdown()
+        server.server_close()
@@ -0,0 +1,45 @@
+from __future__ import annotations
+
+import time
+
+import pandas as pd
+import pytest
+
+from bodocache.planner.scheduler import run_window
+from bodocache.planner.sharded import run_window_sharded
+from bodocache.sim.replay import synthetic_trace
+
+
+@pytest.mark.parametrize("executor", ["serial", "thread"])
+@pytest.mark.parametrize("shard_by", [("node",), ("node", "tier_dst")])
+def test_sharded_plan_matches_run_window(executor, shard_by):
+    tables, now_ms = synthetic_trace(2000, n_layers=4, n_nodes=5, seed=3)
+    req = tables["requests"]
+    req.loc[req.index % 3 == 0, "tier_dst"] = 2  # two destination tiers per node
+    args = (req, tables["heat"], tables["tier_caps"], tables["tenant_caps"], tables["layer_lat"], now_ms)
+    knobs = dict(pmin=0.0, umin=-1.0, min_io_bytes=256 * 1024, max_ops_per_tier=16)
+    ref = run_window(*args, **knobs)
+    got = run_window_sharded(*args, **knobs, shard_by=shard_by, executor=executor, max_workers=4)
+    assert len(ref[0]) > 0
+    for r, g in zip(ref, got):
+        pd.testing.assert_frame_equal(r.reset_index(drop=True), g.reset_index(drop=True))
+
+
+def test_sharded_global_tenant_credits():
+    now_ms = int(time.time() * 1000)
+    cols = ["req_id", "node", "model_id", "model_version", "prefix_id", "layer", "page_start", "page_end",
+            "tier_src", "tier_dst", "deadline_ms", "page_bytes", "tenant", "est_fill_ms"]
+    req = pd.DataFrame([
+        [0, "n0", "m", "v", "p", 0, 0, 3, 0, 1, now_ms + 300, 256 * 1024, "t", 1],
+        [1, "n1", "m", "v", "p", 0, 0, 3, 0, 1, now_ms + 100, 256 * 1024, "t", 1],
+    ], columns=cols)
+    heat = pd.DataFrame([[0, 99, 1, 1.0]], columns=["layer", "page_id", "decay_hits", "tenant_weight"])
+    tiers = pd.DataFrame([[1, 1 << 40, 1 << 40]], columns=["tier", "bandwidth_caps", "free_bytes"])
+    caps = pd.DataFrame([["t", 1, 1 << 20]], columns=["tenant", "tier", "bandwidth_caps"])  # one request's bytes
+    lats = pd.DataFrame([[0, 5.0]], columns=["layer", "lat_ms"])
+    knobs = dict(pmin=0.0, umin=-1.0, min_io_bytes=0, enable_admission=False, enable_eviction=False)
+    per_node, _, _ = run_window_sharded(req, heat, tiers, caps, lats, now_ms, **knobs)
+    assert sorted(per_node["node"]) == ["n0", "n1"]
+    shared, _, _ = run_window_sharded(req, heat, tiers, caps, lats, now_ms, tenant_credit_scope="global", **knobs)
+    # The cluster-wide credit goes to the earliest deadline
+    assert shared["node"].tolist() == ["n1"]
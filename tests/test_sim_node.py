@@ -0,0 +1,58 @@
+from __future__ import annotations
+
+import numpy as np
+import pandas as pd
+
+from bodocache.agent.sim_node import simulate_plan_streams, simulate_plan_streams_batch
+from bodocache.sim.utils import synthetic_layer_lat, synthetic_tier_caps
+
+
+def _reference_finish(plan: pd.DataFrame, tiers: pd.DataFrame, window_ms: int, streams: int, use_overlap: bool):
+    # Linear-scan stream selection, as simulate_plan_streams originally did it
+    df = plan.merge(tiers[["tier", "bandwidth_caps"]].rename(columns={"tier": "tier_dst"}), on="tier_dst", how="left")
+    df = df.sort_values(by=["node", "tier_dst", "priority"], ascending=[True, True, False]).reset_index(drop=True)
+    out = []
+    for _, grp in df.groupby(["node", "tier_dst"], sort=False):
+        bw_per = float(grp["bandwidth_caps"].iloc[0]) / max(1, streams)
+        st = [0.0] * max(1, streams)
+        for row in grp.itertuples(index=False):
+            eff = max(1, min(int(row.overlap) if use_overlap else 1, streams))
+            dur = (float(row.bytes) / float(eff) / max(1.0, bw_per)) * float(window_ms)
+            s = min(range(len(st)), key=lambda i: st[i])
+            st[s] += dur
+            out.append(st[s])
+    return np.array(out)
+
+
+def test_simulate_plan_streams_heap_matches_scan():
+    rng = np.random.default_rng(7)
+    n = 300
+    plan = pd.DataFrame({
+        "node": rng.choice(["n0", "n1", "n2"], n),
+        "tier_dst": rng.choice([0, 1, 2], n),  # tier 2 has no cap row
+        "pcluster": rng.integers(0, 5, n),
+        "layer": rng.integers(0, 8, n),
+        "bytes": rng.integers(1, 64, n) * 128 * 1024,
+        "deadline_ms": 1000,
+        "overlap": rng.integers(1, 4, n),
+        "priority": rng.integers(0, 10, n).astype(float),
+    })
+    tiers = synthetic_tier_caps()
+    lats = synthetic_layer_lat(8)
+    settings = [
+        {"window_ms": 20, "streams_per_tier": s, "use_overlap": ov} for s in (1, 2, 4, 8) for ov in (False, True)
+    ]
+    batch = simulate_plan_streams_batch(plan, tiers, settings, layer_lat_df=lats)
+    for st, exec_df in zip(settings, batch):
+        ref = _reference_finish(plan, tiers, st["window_ms"], st["streams_per_tier"], st["use_overlap"])
+        np.testing.assert_array_equal(exec_df["finish_ms"].to_numpy(), ref)
+    single = simulate_plan_streams(plan, tiers, window_ms=20, streams_per_tier=4, use_overlap=True, layer_lat_df=lats)
+    pd.testing.assert_frame_equal(single, batch[5])
+    cum = lats["lat_ms"].cumsum().to_numpy()
+    np.testing.assert_array_equal(single["deadline_ms"].to_numpy(), cum[single["layer"].to_numpy()])
+    assert list(single.columns) == ["node", "tier_dst", "pcluster", "layer", "priority", "deadline_ms", "finish_ms",
+                                    "bytes", "on_time", "deadline_rel_ms"]
+
+    # Empty plans pass through; distinct plans per setting are batched together
+    out = simulate_plan_streams_batch([plan.iloc[:0], plan.iloc[:50]], tiers, settings[:2])
+    assert out[0].empty and len(out[1]) == 50
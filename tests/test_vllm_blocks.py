@@ -1,6 +1,11 @@
 from __future__ import annotations
 
-from bodocache.integrations.vllm_blocks import VLLMCacheConfig, build_requests_from_blocks, coalesce_blocks
+from bodocache.integrations.vllm_blocks import (
+    VLLMCacheConfig,
+    block_dest_resolver,
+    build_requests_from_blocks,
+    coalesce_blocks,
+)
 
 
 def test_coalesce_blocks():
@@ -30,3 +35,12 @@ def test_build_requests_from_blocks():
         assert r.page_bytes == pbytes
         assert r.deadline_ms == now_ms + 20
 
+
+
+def test_block_dest_resolver():
+    cfg = VLLMCacheConfig(block_size=16, num_layers=2, num_kv_heads=8, head_size=64, kv_dtype="float16")
+    bb = cfg.bytes_per_block()
+    resolve = block_dest_resolver(cfg, lambda layer: 0x10000000 * (layer + 1), {4: 7, 5: 2})
+    assert resolve({"layer": 0, "start_pid": 4, "end_pid": 5}) == [0x10000000 + 7 * bb, 0x10000000 + 2 * bb]
+    # Merged layers: page-major
+    assert resolve({"layer": 0, "layer_end": 1, "start_pid": 4, "end_pid": 4}) == [0x10000000 + 7 * bb, 0x20000000 + 7 * bb]